@@ -0,0 +1,17 @@
+#include <iostream>
+#include <vector>
+
+int main() {
+    // 64 independent products of the shape in test/complex_test.cpp
+    std::vector<Matrix> A(64, Matrix(8, 6));
+    std::vector<Matrix> B(64, Matrix(6, 10));
+    std::vector<Matrix> C(64, Matrix(8, 10));
+    
+    // Batched product: all items share one core configuration and are
+    // spread over the banks and MAC cores
+    for (int b = 0; b < 64; ++b) {
+        C[b] = A[b] * B[b];
+    }
+    
+    return 0;
+}
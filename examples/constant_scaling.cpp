@@ -0,0 +1,31 @@
+#include <iostream>
+
+int main() {
+    // Matrix declarations with explicit dimensions
+    Matrix X(16, 8);
+    Matrix W(8, 12);
+    
+    // S scales the features of X; its elements are known when compiling
+    Matrix S(8, 8);
+    S(0, 0) = 2; S(1, 1) = 1; S(2, 2) = 4; S(3, 3) = 1;
+    S(4, 4) = 3; S(5, 5) = 1; S(6, 6) = 2; S(7, 7) = 1;
+    
+    // Swaps the two halves of the output features
+    Matrix P(12, 12) = {{0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0},
+                        {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0},
+                        {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0},
+                        {0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0},
+                        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0},
+                        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+                        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+                        {0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+                        {0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+                        {0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+                        {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0},
+                        {0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0}};
+    
+    // Scaling and permuting fold into one multiply-accumulate per element
+    Y = X * S * W * P;
+    
+    return 0;
+}
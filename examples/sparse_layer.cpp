@@ -0,0 +1,17 @@
+#include <iostream>
+
+// W is a pruned weight matrix: only the elements listed in
+// sparse_layer.nnz ("row col" per line) are nonzero
+#pragma pim sparse(W, "sparse_layer.nnz")
+
+int main() {
+    // Matrix declarations with explicit dimensions
+    Matrix W(32, 64);
+    Matrix X(64, 16);
+    Matrix B(32, 16);
+    
+    // Fully connected layer: the code skips the zeros of W
+    Y = W * X + B;
+    
+    return 0;
+}
@@ -0,0 +1,15 @@
+#include <iostream>
+
+int main() {
+    // Square products split by -fstrassen=16 into 7 half-size products
+    Matrix A(16, 16);
+    Matrix B(16, 16);
+    Matrix C = A * B;
+    
+    // An even size that is not a power of two: 10×10 blocks
+    Matrix D(20, 20);
+    Matrix E(20, 20);
+    Matrix F = D * E;
+    
+    return 0;
+}
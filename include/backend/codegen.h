@@ -6,7 +6,14 @@
 #include <memory>
 #include "../frontend/parser.h"
 #include "../memorymap/memorymap.h"
+#include "../ir/loop_nest.h"
+#include "../ir/transforms.h"
 #include "../pim_isa/instructions.h"
+#include "../pim_isa/lut_tables.h"
+#include "../pim_isa/instruction_sink.h"
+#include "../pim_isa/packed_program.h"
+#include "../pim_isa/object_file.h"
+#include "../pim_isa/assembly_writer.h"
 
 namespace Backend {
 
@@ -27,20 +34,112 @@ public:
      * 
      * @param matrices Parsed matrix information
      * @param operations Parsed matrix operations
-     * @return Vector of generated instructions
+     * @return Generated program
      */
-    std::vector<PIM_ISA::Instruction> generateInstructions(
+    PIM_ISA::PackedProgram generateInstructions(
         const std::vector<Frontend::MatrixInfo>& matrices,
         const std::vector<Frontend::MatrixOperation>& operations);
     
+    /**
+     * @brief Generate instructions and stream them into a sink
+     * 
+     * Instructions are handed to the sink as soon as they are generated, so
+     * memory use does not grow with the size of the program.
+     * 
+     * @param matrices Parsed matrix information
+     * @param operations Parsed matrix operations
+     * @param sink Destination for the generated instructions
+     */
+    void generateInstructions(
+        const std::vector<Frontend::MatrixInfo>& matrices,
+        const std::vector<Frontend::MatrixOperation>& operations,
+        PIM_ISA::InstructionSink& sink);
+    
+    /**
+     * @brief Map matrices to memory and build a loop nest for each operation
+     * 
+     * @param matrices Parsed matrix information
+     * @param operations Parsed matrix operations
+     * @return The LUT core initialization followed by one loop nest per
+     *         supported operation, in program order
+     */
+    std::vector<IR::Kernel> buildLoopNests(
+        const std::vector<Frontend::MatrixInfo>& matrices,
+        const std::vector<Frontend::MatrixOperation>& operations);
+    
+    /**
+     * @brief Lower loop nests into a complete instruction stream
+     * 
+     * Emits the setups and expansion of every loop nest, starting with the
+     * LUT core initialization, and the final END instruction.
+     * 
+     * @param kernels Loop nests built by buildLoopNests()
+     * @param sink Destination for the generated instructions
+     */
+    void emitInstructions(const std::vector<IR::Kernel>& kernels, PIM_ISA::InstructionSink& sink);
+    
+    /**
+     * @brief Lower one loop nest, programming the cores it needs first
+     * 
+     * Emitting every nest in order from initialCoreState(), then END, gives
+     * the stream of emitInstructions().
+     * 
+     * @param kernel Loop nest built by buildLoopNests()
+     * @param coreOps Operation programmed into each core, updated
+     * @param sink Destination for the generated instructions
+     */
+    void emitKernel(const IR::Kernel& kernel, std::vector<int>& coreOps, PIM_ISA::InstructionSink& sink);
+    
+    /**
+     * @brief Get the core state before the first loop nest: no core programmed
+     * 
+     * @return Operation programmed into each core (-1 if none)
+     */
+    static std::vector<int> initialCoreState();
+    
     /**
      * @brief Write generated instructions to an output file
      * 
-     * @param instructions Generated instructions
+     * @param program Generated program
+     * @param outputFile Path to the output file
+     * @return true if writing was successful
+     */
+    bool writeToFile(const PIM_ISA::PackedProgram& program, const std::string& outputFile);
+    
+    /**
+     * @brief Write generated instructions to a binary object file (.pbin)
+     * 
+     * @param program Generated program
      * @param outputFile Path to the output file
      * @return true if writing was successful
      */
-    bool writeToFile(const std::vector<PIM_ISA::Instruction>& instructions, const std::string& outputFile);
+    bool writeBinaryFile(const PIM_ISA::PackedProgram& program, const std::string& outputFile);
+    
+    /**
+     * @brief Write generated instructions as assembly text to a stream
+     * 
+     * @param program Generated program
+     * @param out Output stream
+     * @return true if writing was successful
+     */
+    bool writeAssembly(const PIM_ISA::PackedProgram& program, std::ostream& out);
+    
+    /**
+     * @brief Write generated instructions as a binary object (.pbin) to a stream
+     * 
+     * @param program Generated program
+     * @param out Output stream
+     * @return true if writing was successful
+     */
+    bool writeBinary(const PIM_ISA::PackedProgram& program, std::ostream& out);
+    
+    /**
+     * @brief Get the object file matrix table for the current memory map
+     * 
+     * @return One entry per mapped matrix (views excluded) and per item
+     *         of a batch (named <batch>[<item>])
+     */
+    std::vector<PIM_ISA::ObjectMatrix> getMatrixTable() const;
     
     /**
      * @brief Set verbose mode
@@ -49,6 +148,33 @@ public:
      */
     void setVerbose(bool verbose);
     
+    /**
+     * @brief Set the number of code generation threads
+     * 
+     * With more than one thread, loop nests are lowered in tiles of outer
+     * iterations (rows of the result matrix) that are filled concurrently and
+     * emitted in order, so the output is identical to a single-threaded run. The same
+     * thread count is used to format assembly output.
+     * 
+     * @param threads Number of threads (at least 1)
+     */
+    void setThreads(unsigned threads);
+    
+    /**
+     * @brief Set the operand width of the generated code
+     * 
+     * The LUT cores compute on 4-bit operands. Wider operands are split into
+     * nibbles: every compute of a loop nest becomes the sequence of 4-bit
+     * lookups of IR::sliceComputeNodes(), so 8-bit products take 4 lookups
+     * plus 2 shift-adds and 16-bit products 16 lookups plus 6 shift-adds.
+     * Each element takes bits / 4 nibbles of a memory row, so the matrices
+     * mapped afterwards take as many times more rows.
+     * 
+     * @param bits Operand width (4, 8 or 16; default: 4)
+     * @return true if the width is supported
+     */
+    bool setPrecision(uint32_t bits);
+    
 private:
     // Memory mapper
     std::shared_ptr<MemoryMap::MemoryMapper> memoryMapper_;
@@ -56,22 +182,164 @@ private:
     // Verbosity flag
     bool verbose_{false};
     
+    // Number of code generation threads
+    unsigned threads_{1};
+    
+    // Operand width in bits (a multiple of the 4-bit LUT operands)
+    uint32_t precision_{PIM_ISA::LUT_OPERAND_BITS};
+    
     /**
-     * @brief Generate instructions for matrix multiplication
+     * @brief Build the loop nest for a matrix multiplication
      * 
      * @param op Matrix multiplication operation
-     * @param instructions Vector to append generated instructions
+     * @return Loop nest computing the product
+     */
+    IR::Kernel buildMatrixMultiplyKernel(const Frontend::MatrixOperation& op);
+    
+    /**
+     * @brief Build the blocked loop nest for a matrix multiplication
+     * 
+     * Each tile of C keeps one accumulator core per element and loads every
+     * operand row once per k, so loads are shared across the tile.
+     * 
+     * @param name Description of the operation
+     * @param a Left operand
+     * @param b Right operand
+     * @param c Result
+     * @param tileRows Rows of C per tile
+     * @param tileCols Columns of C per tile
+     * @param bias Matrix accumulated with the product (nullptr if none)
+     * @param scale 1x1 matrix scaling the bias (nullptr if none)
+     * @return Loop nest computing the product
+     */
+    IR::Kernel buildTiledMatrixMultiplyKernel(const std::string& name,
+                                              const MemoryMap::MatrixHandle& a,
+                                              const MemoryMap::MatrixHandle& b,
+                                              const MemoryMap::MatrixHandle& c,
+                                              uint32_t tileRows, uint32_t tileCols,
+                                              const MemoryMap::MatrixHandle* bias,
+                                              const MemoryMap::MatrixHandle* scale) const;
+    
+    /**
+     * @brief Build the loop nest for a product with a sparse left operand
+     * 
+     * Same schedule as the dense loop nests (blocked when tileRows and
+     * tileCols are set), with the sums over k unrolled per row of A so that
+     * reads of A and multiply-accumulates are emitted only for its nonzero
+     * elements. A tile reads B for every k where one of its rows of A has a
+     * nonzero.
+     * 
+     * @param name Description of the operation
+     * @param a Left operand
+     * @param b Right operand
+     * @param c Result
+     * @param tileRows Rows of C per tile (0 if not tiled)
+     * @param tileCols Columns of C per tile (0 if not tiled)
+     * @param bias Matrix accumulated with the product (nullptr if none)
+     * @param scale 1x1 matrix scaling the bias (nullptr if none)
+     * @return Loop nest computing the product
+     */
+    IR::Kernel buildSparseMatrixMultiplyKernel(const std::string& name,
+                                               const MemoryMap::SparseLayout& a,
+                                               const MemoryMap::MatrixHandle& b,
+                                               const MemoryMap::MatrixHandle& c,
+                                               uint32_t tileRows, uint32_t tileCols,
+                                               const MemoryMap::MatrixHandle* bias,
+                                               const MemoryMap::MatrixHandle* scale) const;
+    
+    /**
+     * @brief Build the loop nest for a batch of products
+     * 
+     * All items are computed by one loop nest, so they share one core
+     * configuration. Groups of op.tileCols items (one if not set) are
+     * computed together, item t of a group accumulating on MAC core t; as
+     * every item starts on its own memory row, the reads of a group go to
+     * consecutive banks.
+     * 
+     * @param op BATCH_MULTIPLY operation
+     * @return Loop nest computing every item of the result
+     */
+    IR::Kernel buildBatchMultiplyKernel(const Frontend::MatrixOperation& op);
+    
+    /**
+     * @brief Build the loop nest for an element-wise sum or difference
+     * 
+     * @param op ADD or SUBTRACT operation
+     * @return Loop nest computing the result
+     */
+    IR::Kernel buildElementwiseKernel(const Frontend::MatrixOperation& op);
+    
+    /**
+     * @brief Build the loop nest copying the transpose of a matrix
+     * 
+     * Transposes used as operands are views and need no code; this is for
+     * an assignment of a bare transpose.
+     * 
+     * @param op TRANSPOSE operation
+     * @return Loop nest computing the result
+     */
+    IR::Kernel buildTransposeKernel(const Frontend::MatrixOperation& op);
+    
+    /**
+     * @brief Build the loop nest for a product by a constant matrix with
+     *        at most one nonzero per row or column
+     * 
+     * Each element of the result is one multiply-accumulate of the
+     * selected element of the other operand with the nonzero (the optimizer
+     * folds diagonal, permutation and zero matrices into these); a row or
+     * column without nonzeros is written from the cleared accumulator.
+     * 
+     * @param op SCALE_ROWS or SCALE_COLUMNS operation
+     * @return Loop nest computing the result
+     */
+    IR::Kernel buildScaleKernel(const Frontend::MatrixOperation& op);
+    
+    /**
+     * @brief Lower a top-level loop of a loop nest on several threads
+     * 
+     * @param kernel Loop nest
+     * @param index Index of the loop in kernel.body
+     * @param sink Destination for generated instructions
      */
-    void generateMatrixMultiplyInstructions(
-        const Frontend::MatrixOperation& op,
-        std::vector<PIM_ISA::Instruction>& instructions);
+    void lowerLoopParallel(const IR::Kernel& kernel, size_t index, PIM_ISA::InstructionSink& sink) const;
     
     /**
-     * @brief Generate initialization instructions for LUT cores
+     * @brief Program the cores a loop nest needs that are not set up yet
      * 
-     * @param instructions Vector to append generated instructions
+     * @param kernel Loop nest about to be lowered
+     * @param coreOps Operation programmed into each core (-1 if none), updated
+     * @param sink Destination for generated instructions
      */
-    void generateInitInstructions(std::vector<PIM_ISA::Instruction>& instructions);
+    void generateKernelSetup(const IR::Kernel& kernel, std::vector<int>& coreOps,
+                             PIM_ISA::InstructionSink& sink) const;
+    
+    /**
+     * @brief Generate the LUT configuration for a core operation
+     * 
+     * @param opType Operation to program
+     * @return Configuration data
+     */
+    std::vector<uint8_t> generateConfig(PIM_ISA::CoreOpType opType) const;
+    
+    /**
+     * @brief Build the loop nest that programs the LUT cores at program start
+     * 
+     * The nest has no body; its setups program the multiplier (core 0),
+     * adder (core 1) and MAC (core 2) cores for the nests that follow.
+     * 
+     * @return Setup-only loop nest
+     */
+    IR::Kernel buildInitKernel() const;
+    
+    /**
+     * @brief Add setups for the fixed cores a loop nest computes on
+     * 
+     * Cores 0-2 keep the operation buildInitKernel() programs; every other
+     * core must already have a setup.
+     * 
+     * @param kernel Loop nest to complete
+     */
+    void declareFixedCores(IR::Kernel& kernel) const;
     
     /**
      * @brief Generate LUT configuration for multiplier core
@@ -90,9 +358,19 @@ private:
     /**
      * @brief Generate LUT configuration for MAC core
      * 
+     * The multiplier table for partial products followed by the adder table
+     * for the shift-adds that combine them.
+     * 
      * @return Configuration data
      */
     std::vector<uint8_t> generateMACConfig() const;
+    
+    /**
+     * @brief Generate LUT configuration for subtractor core
+     * 
+     * @return Configuration data
+     */
+    std::vector<uint8_t> generateSubtractorConfig() const;
 };
 
 } // namespace Backend
@@ -1,13 +1,20 @@
 #ifndef PIM_COMPILER_H
 #define PIM_COMPILER_H
 
+#include <map>
 #include <string>
 #include <vector>
 #include <memory>
+#include <iosfwd>
+#include "pim_isa/lut_tables.h"
+#include "pim_isa/packed_program.h"
 
 // Forward declarations
 namespace Frontend {
     class Parser;
+    struct MatrixInfo;
+    struct MatrixOperation;
+    using SideFiles = std::map<std::string, std::string>;
 }
 
 namespace Optimizer {
@@ -22,8 +29,12 @@ namespace MemoryMap {
     class MemoryMapper;
 }
 
-namespace PIM_ISA {
-    struct Instruction;
+namespace Utils {
+    class CompileCache;
+}
+
+namespace IR {
+    struct Kernel;
 }
 
 /**
@@ -35,6 +46,23 @@ namespace PIM_ISA {
  */
 class PIMCompiler {
 public:
+    /**
+     * @brief Output file formats
+     */
+    enum class OutputFormat {
+        ASSEMBLY,   // pPIM assembly text
+        BINARY      // Binary object file (.pbin)
+    };
+    
+    /**
+     * @brief Reuse of earlier builds by the last incremental compilation
+     */
+    struct IncrementalStats {
+        uint32_t nests{0};      // Loop nests of the program, with the core initialization
+        uint32_t reused{0};     // Nests whose instructions were reused
+        bool fullBuild{true};   // Whether no nest was reused
+    };
+    
     /**
      * @brief Constructor
      */
@@ -48,12 +76,40 @@ public:
     /**
      * @brief Compile a C++ file into pPIM instructions
      * 
+     * With a compile cache, an output cached for the same source, side
+     * files, compiler and options is copied instead; getInstructions()
+     * then returns an empty program.
+     * 
      * @param inputFile Path to the input C++ file
-     * @param outputFile Path to the output assembly file
+     * @param outputFile Path to the output file (assembly or binary object)
      * @return true if compilation was successful, false otherwise
      */
     bool compile(const std::string& inputFile, const std::string& outputFile);
     
+    /**
+     * @brief Compile C++ source text and write the output to a stream
+     * 
+     * The compile cache is not consulted. In bounded-memory mode assembly
+     * is written while it is generated; a binary object is written once
+     * complete, since its header is filled in last.
+     * 
+     * @param sourceCode C++ source text
+     * @param sourceFile Name of the source; relative side file paths are
+     *                   resolved against its directory
+     * @param out Stream receiving the assembly or binary object
+     * @return true if compilation was successful, false otherwise
+     */
+    bool compileSource(const std::string& sourceCode, const std::string& sourceFile, std::ostream& out);
+    
+    /**
+     * @brief Get the reason the last compilation failed
+     * 
+     * Errors reported by exception are not recorded.
+     * 
+     * @return Error message, empty after a successful compilation
+     */
+    const std::string& getLastError() const { return lastError_; }
+    
     /**
      * @brief Set optimization level
      * 
@@ -68,6 +124,109 @@ public:
      */
     void setVerbose(bool verbose);
     
+    /**
+     * @brief Set bounded-memory mode
+     * 
+     * In bounded-memory mode instructions are streamed from the code generator
+     * through the optimizer straight into the output file, so peak memory
+     * does not grow with the size of the program. getInstructions() returns
+     * an empty program after a bounded-memory compilation.
+     * 
+     * @param boundedMemory Whether to stream instructions instead of storing them
+     */
+    void setBoundedMemory(bool boundedMemory);
+    
+    /**
+     * @brief Set output file format
+     * 
+     * @param format Assembly text or binary object file
+     */
+    void setOutputFormat(OutputFormat format);
+    
+    /**
+     * @brief Set the number of threads used for code generation and output
+     * 
+     * The generated program is identical for every thread count.
+     * 
+     * @param threads Number of threads (at least 1)
+     */
+    void setThreads(unsigned threads);
+    
+    /**
+     * @brief Force the tile size used for blocked matrix multiplication at -O3
+     * 
+     * @param rows Rows of the result per tile
+     * @param cols Columns of the result per tile
+     * @return true if the tile size is valid
+     */
+    bool setTileSize(uint32_t rows, uint32_t cols);
+    
+    /**
+     * @brief Enable or disable fusing sums into products (GEMM + bias)
+     * 
+     * @param fusion Whether to fuse from -O1 (default: true)
+     */
+    void setFusion(bool fusion);
+    
+    /**
+     * @brief Split square products of at least this size (Strassen-Winograd)
+     * 
+     * @param threshold Smallest matrix size to split from -O1 (0 disables splitting)
+     */
+    void setStrassenThreshold(uint32_t threshold);
+    
+    /**
+     * @brief Set the operand width, computed as 4-bit LUT lookups
+     * 
+     * @param bits Operand width (4, 8 or 16; default: 4)
+     * @return true if the width is supported
+     */
+    bool setPrecision(uint32_t bits);
+    
+    /**
+     * @brief Cache outputs in a directory shared by compiler runs
+     * 
+     * Outputs are found by a hash of the whitespace-normalized source, the
+     * contents of its side files, the compiler executable and the options
+     * that change the output; the thread count and bounded-memory mode do
+     * not. The least recently used outputs are evicted to bound the size
+     * of the directory.
+     * 
+     * @param directory Cache directory, created if needed
+     * @param maxBytes Bound on the size of the cached outputs
+     * @return true if the directory can be used
+     */
+    bool setCache(const std::string& directory, uint64_t maxBytes);
+    
+    /**
+     * @brief Reuse the instructions of unchanged operations of the previous build
+     * 
+     * compile() keeps a segment table next to the output file (see
+     * Utils::SegmentTable): the instructions of each loop nest (one per
+     * operation), generated and optimized on their own, under a fingerprint
+     * of the nest, which holds the operand shapes and placement, and of
+     * which of its cores are already programmed when it starts, since those
+     * PROGs are skipped. A later compilation regenerates only the nests
+     * whose fingerprint is new and splices the kept instructions of the
+     * others into the program.
+     * 
+     * Without a table, or when the compiler, the options or the memory
+     * layout changed, every nest is generated and the table is rebuilt.
+     * Every nest is optimized on its own in either case, so the program
+     * depends only on the source and options, not on earlier builds. Since
+     * instruction-level optimizations do not cross loop nests, it can be
+     * slightly slower than the program of a normal compilation. Ignored in
+     * bounded-memory mode and by compileSource().
+     * 
+     * @param incremental Whether to keep and reuse loop nest instructions
+     */
+    void setIncremental(bool incremental);
+    
+    /**
+     * @brief Get the reuse of the last incremental compilation
+     */
+    const IncrementalStats& getIncrementalStats() const { return incrementalStats_; }
+    
     /**
      * @brief Get generated instructions
      * 
@@ -75,19 +234,135 @@ public:
      */
     std::vector<PIM_ISA::Instruction> getInstructions() const;
     
+    /**
+     * @brief Get the generated program in packed form
+     * 
+     * @return Packed pPIM program
+     */
+    const PIM_ISA::PackedProgram& getProgram() const;
+    
 private:
     // Components
     std::unique_ptr<Frontend::Parser> parser_;
     std::unique_ptr<Optimizer::Optimizer> optimizer_;
     std::unique_ptr<Backend::CodeGenerator> codeGenerator_;
     std::unique_ptr<MemoryMap::MemoryMapper> memoryMapper_;
+    std::unique_ptr<Utils::CompileCache> cache_;
+    
+    // Reuse of the segment table of the previous build
+    bool incremental_{false};
+    IncrementalStats incrementalStats_;
     
     // Compilation parameters
     int optimizationLevel_{0};
     bool verbose_{false};
+    bool boundedMemory_{false};
+    unsigned threads_{1};
+    uint32_t precision_{PIM_ISA::LUT_OPERAND_BITS};
+    OutputFormat outputFormat_{OutputFormat::ASSEMBLY};
+    uint32_t tileRows_{0};
+    uint32_t tileCols_{0};
+    bool fusion_{true};
+    uint32_t strassenThreshold_{0};
     
-    // Generated instructions
-    std::vector<PIM_ISA::Instruction> instructions_;
+    // Front-end phase timings of the last compilation (milliseconds)
+    double parseMs_{0.0};
+    double operationMs_{0.0};
+    
+    // Generated program
+    PIM_ISA::PackedProgram program_;
+    
+    // Reason the last compilation failed
+    std::string lastError_;
+    
+    // Destination of the output
+    struct OutputTarget;
+    
+    /**
+     * @brief Parse, optimize and generate a program and write it to the output
+     * 
+     * @param sourceCode C++ source text
+     * @param inputFile Name of the source
+     * @param sideFiles Contents of its side files, or null to read them from disk
+     * @param output Destination of the output
+     * @return true if compilation was successful, false otherwise
+     */
+    bool compileProgram(const std::string& sourceCode, const std::string& inputFile,
+                        const Frontend::SideFiles* sideFiles, OutputTarget& output);
+    
+    /**
+     * @brief Generate the instructions of the loop nests and optimize the whole program
+     * 
+     * @param kernels Optimized loop nests
+     * @param codegenMs Incremented by the time spent generating instructions
+     * @param instructionMs Incremented by the time spent optimizing them
+     */
+    void generateProgram(const std::vector<IR::Kernel>& kernels, double& codegenMs, double& instructionMs);
+    
+    /**
+     * @brief Generate the program, reusing the segments of unchanged loop nests
+     * 
+     * Falls back to generateProgram() when nothing is reusable, then
+     * records the segment of every nest for the next build.
+     * 
+     * @param kernels Optimized loop nests
+     * @param tableFile Segment table of the previous build, replaced by this one's
+     * @param codegenMs Incremented by the time spent generating instructions
+     * @param instructionMs Incremented by the time spent optimizing them
+     */
+    void generateIncremental(const std::vector<IR::Kernel>& kernels, const std::string& tableFile,
+                             double& codegenMs, double& instructionMs);
+    
+    /**
+     * @brief Describe the options that change the generated program
+     */
+    std::string optionsKey() const;
+    
+    /**
+     * @brief Describe the placement of every matrix in memory
+     */
+    std::string layoutKey() const;
+    
+    /**
+     * @brief Describe a compilation for the compile cache
+     * 
+     * @param sourceCode C++ source text
+     * @param inputFile Path to the input C++ file
+     * @param sideFiles Contents of every side file of the source
+     * @return Cache key
+     */
+    std::string cacheKey(const std::string& sourceCode, const std::string& inputFile,
+                         const Frontend::SideFiles& sideFiles) const;
+    
+    /**
+     * @brief Generate, optimize and write instructions without storing them
+     * 
+     * @param matrices Parsed matrices
+     * @param operations Optimized operations
+     * @param target Destination of the output
+     * @return true if compilation was successful, false otherwise
+     */
+    bool compileStreaming(const std::vector<Frontend::MatrixInfo>& matrices,
+                          const std::vector<Frontend::MatrixOperation>& operations,
+                          OutputTarget& target);
+    
+    /**
+     * @brief Print the estimated execution time without folding, fusion or Strassen splitting and with dense matrices
+     * 
+     * For each of these optimizations that changed the program, regenerates
+     * the parsed program with it disabled and simulates it, for comparison
+     * with the estimate of the compiled program.
+     */
+    void printBaselineEstimates();
+    
+    /**
+     * @brief Print the estimated execution time of the program compiled by another optimizer
+     * 
+     * @param label Description of the baseline
+     * @param baseline Optimizer configured for the baseline
+     * @param dense Whether to compile sparse matrices as dense
+     */
+    void printBaselineEstimate(const std::string& label, Optimizer::Optimizer& baseline, bool dense = false);
 };
 
 #endif // PIM_COMPILER_H
@@ -1,6 +1,7 @@
 #ifndef FRONTEND_PARSER_H
 #define FRONTEND_PARSER_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
@@ -9,6 +10,17 @@
 
 namespace Frontend {
 
+// 1x1 matrices holding the constants 1 and -1 (names no source matrix can
+// have); the loader stores their values
+constexpr const char* CONSTANT_ONE = "const.1";
+constexpr const char* CONSTANT_MINUS_ONE = "const.-1";
+
+// (row, col) positions of matrix elements
+using Coordinates = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// Contents of side files, by path as resolved by Parser::findSideFiles()
+using SideFiles = std::map<std::string, std::string>;
+
 /**
  * @brief Represents a matrix in the source code
  */
@@ -18,12 +30,65 @@ struct MatrixInfo {
     uint32_t cols;           // Number of columns
     bool isInput;            // Whether this is an input matrix
     bool isOutput;           // Whether this is an output matrix
+    bool isTemporary;        // Whether this holds an intermediate of an expression
+    std::string aliasOf;     // Matrix whose storage this one shares (empty if none)
+    bool transposed;         // Whether an alias is the transpose of aliasOf (a strided view)
+    bool block;              // Whether an alias is the block of aliasOf at (blockRow, blockCol)
+    uint32_t blockRow;
+    uint32_t blockCol;
+    std::shared_ptr<const Coordinates> nonzeros;  // Sparse matrix: nonzero positions in row-major order (null if dense)
+    std::shared_ptr<const std::vector<double>> values;  // Constant matrix: elements in row-major order (null if unknown)
+    uint32_t batch;          // Batch of matrices: number of rows x cols items (0 for a single matrix)
     
     // Default constructor for containers
-    MatrixInfo() : rows(0), cols(0), isInput(false), isOutput(false) {}
+    MatrixInfo()
+        : rows(0), cols(0), isInput(false), isOutput(false), isTemporary(false), transposed(false), block(false),
+          blockRow(0), blockCol(0), batch(0) {}
+    
+    MatrixInfo(const std::string& n, uint32_t r, uint32_t c, bool in, bool out, bool temporary = false)
+        : name(n), rows(r), cols(c), isInput(in), isOutput(out), isTemporary(temporary), transposed(false),
+          block(false), blockRow(0), blockCol(0), batch(0) {}
+};
+
+/**
+ * @brief Kinds of expression nodes
+ */
+enum class ExpressionKind {
+    MATRIX,     // Named matrix
+    MULTIPLY,   // Product of two or more operands
+    ADD,        // Element-wise sum of two operands
+    SUBTRACT,   // Element-wise difference of two operands
+    TRANSPOSE   // Transpose of one operand (B^T or B.transpose())
+};
+
+/**
+ * @brief Matrix expression on the right-hand side of an assignment
+ * 
+ * Products are n-ary: A * B * C is one MULTIPLY node with three operands,
+ * while a parenthesized product such as (B * C) is a nested MULTIPLY node.
+ * Sums and differences are binary and left-associative: A + B - C is
+ * SUBTRACT(ADD(A, B), C). '*' binds tighter than '+' and '-'.
+ */
+struct Expression {
+    ExpressionKind kind{ExpressionKind::MATRIX};
+    std::string matrix;                   // MATRIX: matrix name
+    std::vector<Expression> operands;     // MULTIPLY: factors in order; ADD, SUBTRACT: both terms;
+                                          // TRANSPOSE: the transposed operand
+    uint32_t rows{0};                     // Rows of the result
+    uint32_t cols{0};                     // Columns of the result
     
-    MatrixInfo(const std::string& n, uint32_t r, uint32_t c, bool in, bool out)
-        : name(n), rows(r), cols(c), isInput(in), isOutput(out) {}
+    /**
+     * @brief Format the expression as source text (nested products in parentheses)
+     */
+    std::string toString() const;
+};
+
+/**
+ * @brief Assignment of an expression to a matrix
+ */
+struct Assignment {
+    std::string output;
+    Expression expression;
 };
 
 /**
@@ -33,9 +98,15 @@ enum class OperationType {
     MULTIPLY,
     ADD,
     SUBTRACT,
-    TRANSPOSE
+    TRANSPOSE,
+    SCALE_ROWS,
+    SCALE_COLUMNS,
+    BATCH_MULTIPLY
 };
 
+// Entry of MatrixOperation::selected for a row or column without nonzeros
+constexpr uint32_t NO_ELEMENT = UINT32_MAX;
+
 /**
  * @brief Represents a matrix operation
  */
@@ -44,6 +115,29 @@ struct MatrixOperation {
     std::vector<std::string> inputs;      // Input matrix names
     std::string output;                   // Output matrix name
     
+    // A MULTIPLY with four inputs computes inputs[0] * inputs[1] +
+    // k * inputs[2], where k is the element of the 1x1 matrix inputs[3]
+    // (fused GEMM + bias: the bias is accumulated with the products).
+    // A TRANSPOSE copies the transpose of inputs[0], multiplying each
+    // element by the 1x1 matrix inputs[1] (CONSTANT_ONE).
+    // SCALE_ROWS and SCALE_COLUMNS are products inputs[0] * inputs[1] by a
+    // constant matrix with at most one nonzero per row (SCALE_ROWS, the
+    // constant is inputs[0]) or per column (SCALE_COLUMNS, inputs[1]): row
+    // i of the result is row selected[i] of inputs[1] times
+    // inputs[0][i, selected[i]], column j is column selected[j] of
+    // inputs[0] times inputs[1][selected[j], j]. Diagonal, permutation and
+    // zero matrices are of this kind.
+    // A BATCH_MULTIPLY computes item b of the batch output as item b of
+    // inputs[0] times item b of inputs[1], for every item of the batches.
+    std::vector<uint32_t> selected;
+    
+    // Blocking chosen by the optimizer for MULTIPLY (0 = not tiled); for
+    // SCALE_ROWS and SCALE_COLUMNS, tileCols is the number of MAC cores
+    // the rows or columns go to in turn, for BATCH_MULTIPLY the number of
+    // items computed at once, each on its own MAC core
+    uint32_t tileRows{0};                 // Rows of the output per tile
+    uint32_t tileCols{0};                 // Columns of the output per tile
+    
     MatrixOperation(OperationType t, const std::vector<std::string>& in, const std::string& out)
         : type(t), inputs(in), output(out) {}
 };
@@ -66,6 +160,26 @@ public:
      */
     bool parseFile(const std::string& sourceFile);
     
+    /**
+     * @brief Parse source text
+     * 
+     * @param sourceCode Source code content
+     * @param sourceFile Name of the source file; relative side file paths
+     *                   are resolved against its directory
+     * @param sideFiles Contents of the side files, already read (see
+     *                  readSideFiles()); null to read them from disk
+     * @return true if parsing was successful
+     */
+    bool parseSource(const std::string& sourceCode, const std::string& sourceFile,
+                     const SideFiles* sideFiles = nullptr);
+    
+    /**
+     * @brief Get the reason the last parse failed
+     * 
+     * @return Error message, empty after a successful parse
+     */
+    const std::string& getLastError() const { return lastError_; }
+    
     /**
      * @brief Get all matrices found in the source code
      * 
@@ -80,6 +194,20 @@ public:
      */
     std::vector<MatrixOperation> getOperations() const;
     
+    /**
+     * @brief Get the assignments found in the source code
+     * 
+     * Each assignment is also lowered into binary operations, as written:
+     * products, sums and differences are evaluated left to right,
+     * parenthesized subexpressions first, with intermediates in temporary
+     * matrices named <output>.<n>. A transposed operand X^T is a view of
+     * X (a matrix named "X^T" aliasing X's storage), so only an assignment
+     * of a bare transpose, C = X^T, becomes a TRANSPOSE operation.
+     * 
+     * @return Assignments in source order
+     */
+    const std::vector<Assignment>& getAssignments() const { return assignments_; }
+    
     /**
      * @brief Get number of operations
      * 
@@ -103,6 +231,31 @@ public:
      */
     bool hasMatrix(const std::string& name) const;
     
+    /**
+     * @brief Find the side files a source file reads
+     * 
+     * Lists the nonzero files of its #pragma pim sparse annotations,
+     * resolved as parseFile() resolves them, without parsing the program.
+     * 
+     * @param sourceCode Source code content
+     * @param sourceFile Path to the source file
+     * @return Paths of the side files in source order
+     */
+    static std::vector<std::string> findSideFiles(const std::string& sourceCode, const std::string& sourceFile);
+    
+    /**
+     * @brief Read the side files a source file reads
+     * 
+     * Parsing with the contents read here, rather than reading the files
+     * again, guarantees that the program is built from the same bytes.
+     * 
+     * @param sourceCode Source code content
+     * @param sourceFile Path to the source file
+     * @param sideFiles Receives the contents of every side file that can be read
+     * @return true if every side file was read
+     */
+    static bool readSideFiles(const std::string& sourceCode, const std::string& sourceFile, SideFiles& sideFiles);
+    
 private:
     // Parsed matrices
     std::map<std::string, MatrixInfo> matrices_;
@@ -110,6 +263,18 @@ private:
     // Parsed operations
     std::vector<MatrixOperation> operations_;
     
+    // Parsed assignments
+    std::vector<Assignment> assignments_;
+    
+    // Temporaries created so far for each output
+    std::map<std::string, uint32_t> temporaryCounts_;
+    
+    // Source position of the last constant element assignment of each matrix
+    std::map<std::string, size_t> lastElementWrites_;
+    
+    // Reason the last parse failed
+    std::string lastError_;
+    
     /**
      * @brief Parse matrix declarations
      * 
@@ -117,13 +282,102 @@ private:
      */
     void parseMatrixDeclarations(const std::string& sourceCode);
     
+    /**
+     * @brief Parse batched products
+     * 
+     * A batch of equally shaped matrices is declared as
+     * std::vector<Matrix> A(<count>, Matrix(<rows>, <cols>));. A batched
+     * product C[b] = A[b] * B[b]; of three batches with the same count,
+     * inside a loop for (int b = 0; b < <count>; ++b) over all items,
+     * becomes one BATCH_MULTIPLY. Batches are used by these products only,
+     * so their operations are independent of all others.
+     * 
+     * @param sourceCode Source code content
+     * @throws std::runtime_error if a batch is undeclared, the batches do
+     *         not match or the loop does not cover the whole batch
+     */
+    void parseBatchedProducts(const std::string& sourceCode);
+    
+    /**
+     * @brief Parse sparsity annotations
+     * 
+     * An input matrix is declared sparse with
+     * #pragma pim sparse(<matrix>, "<file>"), where the file lists the
+     * row and column of each nonzero element, one "row col" pair per line
+     * ('#' starts a comment). A relative path is resolved against the
+     * directory of the source file. Elements not listed are zero.
+     * 
+     * @param sourceCode Source code content
+     * @param sourceFile Path to the source file
+     * @throws std::runtime_error if the matrix is not declared or the file
+     *         cannot be read or lists an element outside the matrix
+     */
+    void parseSparsityAnnotations(const std::string& sourceCode, const std::string& sourceFile,
+                                  const SideFiles* sideFiles);
+    
+    /**
+     * @brief Parse constant element values
+     * 
+     * A matrix is constant when it is given an initializer list,
+     * Matrix I(2, 2) = {1, 0, 0, 1}; or {{1, 0}, {0, 1}}, or its elements
+     * are assigned numeric literals at literal positions, I(0, 0) = 1;.
+     * Elements never assigned are zero, as in a zero-initialized Matrix.
+     * Any other element assignment (a computed position or value, or a
+     * compound assignment) leaves the values unknown.
+     * 
+     * @param sourceCode Source code content
+     * @throws std::runtime_error if an initializer list or element
+     *         assignment is outside the matrix
+     */
+    void parseConstantValues(const std::string& sourceCode);
+    
     /**
      * @brief Parse matrix operations
      * 
+     * Matrices assigned by an operation, or read by one before their last
+     * constant element assignment, lose their constant values.
+     * 
      * @param sourceCode Source code content
+     * @throws std::runtime_error if an operation assigns a sparse matrix
      */
     void parseMatrixOperations(const std::string& sourceCode);
     
+    /**
+     * @brief Parse the right-hand side of an assignment
+     * 
+     * Accepts identifiers, '*', '+', '-', parentheses and the postfix
+     * transposes ^T and .transpose(). A sum or
+     * difference that names no declared matrix is ordinary C++ arithmetic,
+     * not a matrix expression.
+     * 
+     * @param text Expression text
+     * @param expression Parsed expression
+     * @return false if the text is not a matrix expression
+     * @throws std::runtime_error if it uses an undeclared matrix or the
+     *         dimensions of a product, sum or difference do not match
+     */
+    bool parseExpression(const std::string& text, Expression& expression);
+    
+    /**
+     * @brief Append the binary operations computing an expression
+     * 
+     * @param expression Expression to lower
+     * @param assignment Output of the assignment, used to name temporaries
+     * @param output Matrix receiving the result (empty for a new temporary)
+     * @return Name of the matrix holding the result
+     */
+    std::string lowerExpression(const Expression& expression, const std::string& assignment,
+                                const std::string& output);
+    
+    /**
+     * @brief Get the transposed view of a matrix, creating it if needed
+     * 
+     * @param matrix Matrix to transpose
+     * @return Name of the view ("<matrix>^T"), or the viewed matrix if
+     *         matrix is itself a transposed view
+     */
+    std::string transposedView(const std::string& matrix);
+    
     /**
      * @brief Extract matrix dimensions from declaration
      * 
@@ -0,0 +1,284 @@
+#ifndef IR_LOOP_NEST_H
+#define IR_LOOP_NEST_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../pim_isa/instruction_sink.h"
+#include "../memorymap/memorymap.h"
+
+namespace IR {
+
+/**
+ * @brief Identifier of a loop induction variable within a kernel
+ */
+using LoopId = uint32_t;
+
+/**
+ * @brief Affine expression over loop induction variables
+ *
+ * Value is constant + Σ coefficient · iv(loop).
+ */
+struct AffineExpr {
+    int64_t constant{0};
+    std::vector<std::pair<LoopId, int64_t>> terms;
+
+    /**
+     * @brief Add a term (coefficients of the same loop are combined)
+     *
+     * @param loop Induction variable
+     * @param coefficient Coefficient of the induction variable
+     * @return This expression
+     */
+    AffineExpr& add(LoopId loop, int64_t coefficient);
+
+    /**
+     * @brief Add a scaled copy of another expression
+     *
+     * @param other Expression to add
+     * @param scale Factor applied to every term and the constant of other
+     * @return This expression
+     */
+    AffineExpr& add(const AffineExpr& other, int64_t scale);
+
+    /**
+     * @brief Create the expression iv(loop)
+     *
+     * @param loop Induction variable
+     * @return Expression with a single unit term
+     */
+    static AffineExpr index(LoopId loop);
+
+    /**
+     * @brief Create a constant expression
+     *
+     * @param value Constant value
+     * @return Expression without terms
+     */
+    static AffineExpr value(int64_t value);
+
+    /**
+     * @brief Get the coefficient of an induction variable
+     *
+     * @param loop Induction variable
+     * @return Coefficient (0 if the expression does not use the loop)
+     */
+    int64_t coefficient(LoopId loop) const;
+
+    /**
+     * @brief Evaluate the expression
+     *
+     * @param ivs Current value of every induction variable, indexed by LoopId
+     * @return Value of the expression
+     */
+    int64_t evaluate(const std::vector<int64_t>& ivs) const {
+        int64_t value = constant;
+        for (const auto& term : terms) {
+            value += term.second * ivs[term.first];
+        }
+        return value;
+    }
+
+    /**
+     * @brief Check whether two expressions have the same terms and constant
+     */
+    bool operator==(const AffineExpr& other) const {
+        return constant == other.constant && terms == other.terms;
+    }
+};
+
+/**
+ * @brief Address of a matrix element as seen by the pPIM row decoder
+ *
+ * Row address = baseAddress + floor(offset / NIBBLES_PER_MEMORY_ROW), where
+ * offset is the nibble offset from the start of the matrix.
+ */
+struct Address {
+    uint16_t baseAddress{0};
+    AffineExpr offset;
+
+    /**
+     * @brief Evaluate the row address
+     *
+     * @param ivs Current value of every induction variable
+     * @return Row address
+     */
+    uint16_t evaluate(const std::vector<int64_t>& ivs) const {
+        return static_cast<uint16_t>(baseAddress + offset.evaluate(ivs) / MemoryMap::NIBBLES_PER_MEMORY_ROW);
+    }
+
+    /**
+     * @brief Check whether two addresses are the same row for every iteration
+     */
+    bool operator==(const Address& other) const {
+        return baseAddress == other.baseAddress && offset == other.offset;
+    }
+};
+
+/**
+ * @brief Kinds of loop-nest nodes
+ */
+enum class NodeKind {
+    LOOP,       // Counted loop over a body
+    LOAD,       // EXE Read of a row into a read slot
+    COMPUTE,    // EXE on a LUT core
+    STORE       // EXE Write of a core result to a row
+};
+
+/**
+ * @brief Operations performed by COMPUTE nodes
+ */
+enum class ComputeOp {
+    MULTIPLY,   // Start a new product
+    MAC,        // Multiply and accumulate
+    ADD,        // Sum of two elements
+    SUBTRACT    // Difference of two elements
+};
+
+/**
+ * @brief Node of a loop nest
+ *
+ * Loops own their body; the other kinds each lower to exactly one
+ * instruction per execution.
+ */
+struct Node {
+    NodeKind kind{NodeKind::LOAD};
+
+    // LOOP: induction variable over [begin, end) with the given step
+    LoopId loop{0};
+    uint32_t begin{0};
+    uint32_t end{0};
+    uint32_t step{1};
+    std::vector<Node> body;
+
+    // LOAD / STORE: pointer field of the EXE and the element accessed
+    uint8_t slot{0};
+    Address address;
+
+    // COMPUTE: operation, executing core and its row-address field
+    ComputeOp op{ComputeOp::MAC};
+    uint8_t core{0};
+    uint16_t rowAddress{0};
+
+    /**
+     * @brief Number of iterations of a loop
+     */
+    uint32_t tripCount() const {
+        return end > begin ? (end - begin + step - 1) / step : 0;
+    }
+
+    /**
+     * @brief Number of instructions the node lowers to
+     */
+    uint64_t instructionCount() const;
+
+    static Node makeLoop(LoopId loop, uint32_t begin, uint32_t end, std::vector<Node> body, uint32_t step = 1);
+    static Node makeLoad(uint8_t slot, Address address);
+    static Node makeCompute(ComputeOp op, uint8_t core, uint16_t rowAddress = 0);
+    static Node makeStore(uint8_t slot, Address address);
+};
+
+/**
+ * @brief LUT core a kernel expects to be programmed before it runs
+ */
+struct CoreSetup {
+    uint8_t core;
+    PIM_ISA::CoreOpType opType;
+};
+
+/**
+ * @brief Loop nest computing one matrix operation
+ */
+struct Kernel {
+    // Description used in reports (e.g. "C = A * B")
+    std::string name;
+
+    // Number of induction variables used by the nest
+    LoopId loopCount{0};
+
+    // Top-level nodes, executed in order
+    std::vector<Node> body;
+
+    // Cores to program before the nest runs: the cores it computes on, and
+    // cores programmed ahead for later nests
+    std::vector<CoreSetup> cores;
+
+    /**
+     * @brief Allocate a new induction variable
+     */
+    LoopId newLoop() { return loopCount++; }
+
+    /**
+     * @brief Number of IR nodes in the nest
+     */
+    size_t nodeCount() const;
+
+    /**
+     * @brief Number of instructions the nest lowers to
+     */
+    uint64_t instructionCount() const;
+
+    /**
+     * @brief Cores the compute nodes of the nest run on, in ascending order
+     */
+    std::vector<uint8_t> computeCores() const;
+};
+
+/**
+ * @brief Expand a kernel into instructions
+ *
+ * @param kernel Loop nest to lower
+ * @param sink Destination for the instructions
+ */
+void lower(const Kernel& kernel, PIM_ISA::InstructionSink& sink);
+
+/**
+ * @brief Expand one top-level node of a kernel into instructions
+ *
+ * Lowering every top-level node in order produces the same stream as lower().
+ *
+ * @param kernel Loop nest
+ * @param index Index of the node in kernel.body
+ * @param sink Destination for the instructions
+ */
+void lowerTopLevelNode(const Kernel& kernel, size_t index, PIM_ISA::InstructionSink& sink);
+
+/**
+ * @brief Expand a range of iterations of a top-level loop into instructions
+ *
+ * Lowering consecutive ranges in order produces the same stream as
+ * lowerTopLevelNode().
+ *
+ * @param kernel Loop nest
+ * @param index Index of a LOOP node in kernel.body
+ * @param firstIteration Index of the first iteration to lower
+ * @param lastIteration One past the index of the last iteration
+ * @param sink Destination for the instructions
+ */
+void lowerLoopIterations(const Kernel& kernel, size_t index, uint32_t firstIteration, uint32_t lastIteration,
+                         PIM_ISA::InstructionSink& sink);
+
+/**
+ * @brief Encode everything the instructions of a kernel depend on
+ *
+ * Two kernels with the same fingerprint lower to the same instructions and
+ * program the same cores; the name is not part of it.
+ *
+ * @param kernel Loop nest to encode
+ * @return Compact binary encoding of the nodes and core setup
+ */
+std::string fingerprint(const Kernel& kernel);
+
+/**
+ * @brief Print a kernel as indented pseudo-code
+ *
+ * @param kernel Loop nest to print
+ * @param out Output stream
+ */
+void print(const Kernel& kernel, std::ostream& out);
+
+} // namespace IR
+
+#endif // IR_LOOP_NEST_H
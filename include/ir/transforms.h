@@ -0,0 +1,64 @@
+#ifndef IR_TRANSFORMS_H
+#define IR_TRANSFORMS_H
+
+#include <cstdint>
+#include "loop_nest.h"
+
+namespace IR {
+
+/**
+ * @brief Unroll every innermost loop of a kernel
+ *
+ * Each innermost loop with at least `factor` iterations is replaced by a
+ * loop whose body holds `factor` copies of the original body, followed by a
+ * remainder loop for the leftover iterations. The lowered instruction stream
+ * is unchanged.
+ *
+ * @param kernel Loop nest to transform
+ * @param factor Unroll factor (at least 2)
+ * @return Number of loops unrolled
+ */
+size_t unrollInnermostLoops(Kernel& kernel, uint32_t factor);
+
+/**
+ * @brief Split the compute EXEs of a kernel into 4-bit LUT lookups
+ *
+ * Operands of `slices` nibbles are processed one lookup at a time on the
+ * core of the original EXE:
+ * - a product (MULTIPLY or MAC) becomes slices² partial products, nibble i
+ *   of one operand times nibble j of the other, accumulated at 16^(i+j),
+ *   with the operand slots of the product
+ * - a sum or difference becomes one lookup per nibble, the carry or borrow
+ *   rippling through bit 4 of each result
+ * - the store of a product first writes the 2·slices − 1 column sums to the
+ *   result's row and reads that row back into the product's first operand
+ *   slot; 2·(slices − 1) shift-add lookups then ripple the carries from
+ *   column to column through the core, reading the column sums from that
+ *   slot, before the result is written
+ * The ISA has no nibble selector, so as with the elements of a row, the
+ * nibbles a lookup reads are implied by its position in the sequence. The
+ * first operand slot of every product is reloaded before its next use, so
+ * the column sums may replace its contents. With one slice the kernel is
+ * unchanged.
+ *
+ * @param kernel Loop nest to transform
+ * @param slices Nibbles per operand (operand bits / 4)
+ * @return Number of compute nodes split
+ */
+size_t sliceComputeNodes(Kernel& kernel, uint32_t slices);
+
+/**
+ * @brief Move the work of a kernel to other cores
+ *
+ * Renames the core of every compute node, the core pointer of every store
+ * and the core of every setup. The lowered stream is the same up to the
+ * core numbers as long as the renaming is one-to-one on the cores used.
+ *
+ * @param kernel Loop nest to transform
+ * @param cores New number of each core, indexed by its old number
+ */
+void renameCores(Kernel& kernel, const std::vector<uint8_t>& cores);
+
+} // namespace IR
+
+#endif // IR_TRANSFORMS_H
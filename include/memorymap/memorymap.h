@@ -6,9 +6,14 @@
 #include <tuple>
 #include <map>
 #include <string>
+#include <utility>
 
 namespace MemoryMap {
 
+// Number of 4-bit operands (nibbles) held by one memory row; an element of
+// B bits takes B / 4 of them
+constexpr uint32_t NIBBLES_PER_MEMORY_ROW = 256;
+
 /**
  * @brief Matrix dimensions
  */
@@ -32,6 +37,104 @@ struct AddressRange {
     AddressRange(uint16_t start, uint16_t end) : startAddress(start), endAddress(end) {}
 };
 
+/**
+ * @brief Resolved location and layout of a mapped matrix
+ * 
+ * Obtained once per matrix from MemoryMapper::resolveMatrix() so that
+ * element addresses can be computed without looking the matrix up by name.
+ * Element (row, col) lives at nibble offset offset + row * rowStride +
+ * col * colStride from baseAddress; offset is 0 except for a block of a
+ * larger matrix. The mapper addresses an element by the memory
+ * row that holds the first element of its matrix row, so with elements of w
+ * nibbles a plain mapping has rowStride = cols * w and colStride = 0, and a
+ * transposed view of an R x C matrix (C x R, element (i, j) stored as
+ * (j, i)) has rowStride = 0 and colStride = C * w.
+ * 
+ * A batch has the dimensions of one item; element (row, col) of item b
+ * lies batchStride nibbles further than that of item b - 1.
+ */
+struct MatrixHandle {
+    uint16_t baseAddress{0};
+    uint32_t rows{0};
+    uint32_t cols{0};
+    uint32_t rowStride{0};
+    uint32_t colStride{0};
+    uint32_t offset{0};
+    uint32_t batch{0};          // Items of a batch (0 for a single matrix)
+    uint32_t batchStride{0};
+    
+    /**
+     * @brief Get the row address of an element (no bounds checks)
+     * 
+     * @param row Row index
+     * @param col Column index
+     * @return Row address of the element
+     */
+    uint16_t elementAddress(uint32_t row, uint32_t col) const {
+        return static_cast<uint16_t>(baseAddress + (offset + row * rowStride + col * colStride) / NIBBLES_PER_MEMORY_ROW);
+    }
+    
+    /**
+     * @brief Get the handle of the transpose of this matrix (same storage)
+     */
+    MatrixHandle transposed() const {
+        MatrixHandle handle = *this;
+        handle.rows = cols;
+        handle.cols = rows;
+        handle.rowStride = colStride;
+        handle.colStride = rowStride;
+        return handle;
+    }
+    
+    /**
+     * @brief Get the handle of a block of this matrix (same storage, no bounds checks)
+     * 
+     * @param row Row of the block's first element
+     * @param col Column of the block's first element
+     * @param blockRows Rows of the block
+     * @param blockCols Columns of the block
+     */
+    MatrixHandle block(uint32_t row, uint32_t col, uint32_t blockRows, uint32_t blockCols) const {
+        MatrixHandle handle = *this;
+        handle.rows = blockRows;
+        handle.cols = blockCols;
+        handle.offset += row * rowStride + col * colStride;
+        return handle;
+    }
+};
+
+/**
+ * @brief Compressed sparse row (CSR) layout of a sparse matrix
+ * 
+ * Only the nonzero elements are stored, in row-major order, from
+ * baseAddress on. The nonzeros of row r are elements rowStart[r] to
+ * rowStart[r + 1] - 1 of the storage, and columns holds the column of each.
+ * As in the dense layout, an element is addressed by the memory row that
+ * holds the first stored element of its matrix row, so a matrix with every
+ * element listed gets the addresses of the dense layout.
+ */
+struct SparseLayout {
+    uint16_t baseAddress{0};
+    uint32_t rows{0};
+    uint32_t cols{0};
+    std::vector<uint32_t> rowStart;   // rows + 1 entries
+    std::vector<uint32_t> columns;    // One entry per nonzero
+    uint32_t elementWidth{1};         // Nibbles per stored element
+    
+    /**
+     * @brief Get the number of stored elements
+     */
+    size_t nonzeroCount() const { return columns.size(); }
+    
+    /**
+     * @brief Get the nibble offset from baseAddress of a row's nonzeros
+     * 
+     * @param row Row index
+     * @return Offset of the row's first stored element
+     */
+    uint32_t rowOffset(uint32_t row) const { return rowStart[row] * elementWidth; }
+};
+
 /**
  * @brief Class to handle mapping of matrix data to DRAM subarrays
  */
@@ -51,6 +154,95 @@ public:
      */
     uint16_t mapMatrix(const std::string& matrixName, const MatrixDimensions& dimensions);
     
+    /**
+     * @brief Map a batch of equally shaped matrices to memory
+     * 
+     * Every item starts on a memory row of its own, so consecutive items
+     * lie in consecutive banks. resolveMatrix() gives the batch the
+     * dimensions of one item and the distance between items.
+     * 
+     * @param matrixName Name of the batch
+     * @param dimensions Dimensions of each item
+     * @param count Number of items
+     * @return Row address of the first item
+     */
+    uint16_t mapBatch(const std::string& matrixName, const MatrixDimensions& dimensions, uint32_t count);
+    
+    /**
+     * @brief Map a sparse matrix to memory in CSR layout
+     * 
+     * Allocates memory rows for the nonzeros only.
+     * 
+     * @param matrixName Name of the matrix
+     * @param dimensions Matrix dimensions
+     * @param nonzeros (row, col) of each nonzero, in row-major order without duplicates
+     * @return Row address of the matrix start
+     * @throws std::runtime_error if a position lies outside the matrix or is out of order
+     */
+    uint16_t mapSparseMatrix(const std::string& matrixName, const MatrixDimensions& dimensions,
+                             const std::vector<std::pair<uint32_t, uint32_t>>& nonzeros);
+    
+    /**
+     * @brief Map a matrix onto the storage of another mapped matrix
+     * 
+     * The alias gets the address and dimensions of the target and takes no
+     * memory of its own; use it for a matrix known to hold the same values.
+     * 
+     * @param aliasName Name of the alias
+     * @param targetName Name of the matrix whose storage it shares
+     * @return Row address of the matrix start
+     */
+    uint16_t mapAlias(const std::string& aliasName, const std::string& targetName);
+    
+    /**
+     * @brief Map a matrix as the transpose of another mapped matrix
+     * 
+     * The view shares the storage of the target, with the dimensions
+     * swapped; resolveMatrix() gives it the strides of the transposed
+     * layout, so no data is moved. A view of a view is the original layout.
+     * 
+     * @param viewName Name of the view
+     * @param targetName Name of the matrix it transposes
+     * @return Row address of the matrix start
+     * @throws std::runtime_error if the target is sparse
+     */
+    uint16_t mapTransposedView(const std::string& viewName, const std::string& targetName);
+    
+    /**
+     * @brief Map a matrix as a block of another mapped matrix
+     * 
+     * The view shares the storage of the target; resolveMatrix() gives it
+     * the target's strides and the offset of the block's first element.
+     * 
+     * @param viewName Name of the view
+     * @param targetName Name of the matrix it is a block of
+     * @param row Row of the block's first element in the target
+     * @param col Column of the block's first element in the target
+     * @param dimensions Dimensions of the block
+     * @return Row address of the target start
+     * @throws std::runtime_error if the target is sparse or the block does
+     *         not lie within it
+     */
+    uint16_t mapBlockView(const std::string& viewName, const std::string& targetName,
+                          uint32_t row, uint32_t col, const MatrixDimensions& dimensions);
+    
+    /**
+     * @brief Resolve a mapped matrix to a handle
+     * 
+     * @param matrixName Name of the matrix
+     * @return Base address, dimensions and strides of the matrix
+     * @throws std::runtime_error if the matrix is not mapped or is sparse
+     */
+    MatrixHandle resolveMatrix(const std::string& matrixName) const;
+    
+    /**
+     * @brief Get the layout of a sparse matrix
+     * 
+     * @param matrixName Name of the matrix
+     * @return CSR layout, or nullptr if the matrix is not mapped as sparse
+     */
+    const SparseLayout* getSparseLayout(const std::string& matrixName) const;
+    
     /**
      * @brief Get mapped address for a matrix element
      * 
@@ -80,6 +272,14 @@ public:
      */
     uint8_t getBankIndex(const std::string& matrixName, uint32_t row, uint32_t col) const;
     
+    /**
+     * @brief Get the number of items of a batch
+     * 
+     * @param matrixName Name of the matrix
+     * @return Items of the batch, or 0 if the matrix is not mapped as a batch
+     */
+    uint32_t getBatchSize(const std::string& matrixName) const;
+    
     /**
      * @brief Check if a matrix is mapped
      * 
@@ -88,6 +288,14 @@ public:
      */
     bool isMatrixMapped(const std::string& matrixName) const;
     
+    /**
+     * @brief Check if a matrix is mapped as a view (transpose or block) of another
+     * 
+     * @param matrixName Name of the matrix
+     * @return true if the matrix has its own strides over shared storage, false otherwise
+     */
+    bool isView(const std::string& matrixName) const;
+    
     /**
      * @brief Get matrix dimensions
      * 
@@ -105,7 +313,21 @@ public:
     AddressRange getMatrixAddressRange(const std::string& matrixName) const;
     
     /**
-     * @brief Reset memory map
+     * @brief Get the names of all mapped matrices
+     * 
+     * @return Matrix names in name order
+     */
+    std::vector<std::string> getMatrixNames() const;
+    
+    /**
+     * @brief Set the width of the elements mapped from now on
+     * 
+     * @param nibbles 4-bit operands per element (1 for 4-bit elements)
+     */
+    void setElementWidth(uint32_t nibbles);
+    
+    /**
+     * @brief Reset memory map (the element width is kept)
      */
     void reset();
     
@@ -113,9 +335,21 @@ private:
     // Memory layout map (matrix name -> tuple of <start address, dimensions>)
     std::map<std::string, std::tuple<uint16_t, MatrixDimensions>> matrixMap_;
     
+    // Layout of matrices mapped as views of another matrix's storage
+    std::map<std::string, MatrixHandle> views_;
+    
+    // Layout of matrices mapped as sparse
+    std::map<std::string, SparseLayout> sparse_;
+    
+    // Number of items of matrices mapped as batches
+    std::map<std::string, uint32_t> batches_;
+    
     // Memory allocation counter (next available row address)
     uint16_t nextRowAddress_{0};
     
+    // Nibbles each element takes
+    uint32_t elementWidth_{1};
+    
     /**
      * @brief Calculate required memory size for a matrix
      * 
@@ -123,6 +357,14 @@ private:
      * @return Memory size in rows
      */
     uint16_t calculateMatrixSize(const MatrixDimensions& dimensions) const;
+    
+    /**
+     * @brief Calculate required memory size for the nonzeros of a sparse matrix
+     * 
+     * @param nonzeroCount Number of stored elements
+     * @return Memory size in rows
+     */
+    uint16_t calculateSparseSize(size_t nonzeroCount) const;
 };
 
 } // namespace MemoryMap
@@ -0,0 +1,203 @@
+#ifndef OPTIMIZER_DEPENDENCY_GRAPH_H
+#define OPTIMIZER_DEPENDENCY_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../pim_isa/instructions.h"
+#include "../pim_isa/instruction_sink.h"
+#include "../pim_isa/packed_program.h"
+#include "../pim_isa/resources.h"
+
+namespace Optimizer {
+
+/**
+ * @brief Kinds of dependency edges
+ */
+enum class DependencyKind : uint8_t {
+    RAW = 0,    // Reads what the predecessor wrote
+    WAW = 1,    // Overwrites what the predecessor wrote
+    ORDER = 2,  // Ordered by a barrier
+    WAR = 3     // Overwrites what the predecessor read
+};
+
+/**
+ * @brief Dependency DAG over an instruction sequence
+ *
+ * Nodes are instruction indices. Edges are stored twice in compressed
+ * sparse row form (predecessors and successors of each node), each edge as
+ * one 32-bit word holding the other node in the low 30 bits and the
+ * DependencyKind in the top 2 bits. A graph costs about 10 bytes per node
+ * plus 8 bytes per edge; code generated for matrix products has about
+ * three edges per instruction.
+ *
+ * An edge from p to n means n must start at least delay(p, kind) cycles
+ * after p: p's latency, except that a WAR edge from a compute only requires
+ * n to start no earlier than p, since operands are taken when the compute
+ * starts.
+ */
+class DependencyGraph {
+public:
+    using NodeId = uint32_t;
+
+    // Largest number of nodes or edges a graph can hold
+    static constexpr uint32_t MAX_NODES = (1u << 30) - 1;
+    static constexpr uint32_t MAX_EDGES = UINT32_MAX;
+
+    /**
+     * @brief Contiguous run of packed edges
+     */
+    struct EdgeList {
+        const uint32_t* first;
+        const uint32_t* last;
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+    /**
+     * @brief Node at the other end of a packed edge
+     */
+    static NodeId edgeNode(uint32_t edge) { return edge & MAX_NODES; }
+
+    /**
+     * @brief Kind of a packed edge
+     */
+    static DependencyKind edgeKind(uint32_t edge) { return static_cast<DependencyKind>(edge >> 30); }
+
+    /**
+     * @brief Build the graph of a packed program
+     *
+     * @param program Program to analyze
+     * @return Dependency graph with one node per instruction
+     */
+    static DependencyGraph build(const PIM_ISA::PackedProgram& program);
+
+    /**
+     * @brief Build the graph of an instruction list
+     *
+     * @param instructions Instructions to analyze
+     * @return Dependency graph with one node per instruction
+     */
+    static DependencyGraph build(const std::vector<PIM_ISA::Instruction>& instructions);
+
+    size_t size() const { return latencies_.size(); }
+    uint64_t edgeCount() const { return predecessors_.size(); }
+
+    EdgeList predecessors(NodeId node) const {
+        return {predecessors_.data() + predecessorOffsets_[node], predecessors_.data() + predecessorOffsets_[node + 1]};
+    }
+
+    EdgeList successors(NodeId node) const {
+        return {successors_.data() + successorOffsets_[node], successors_.data() + successorOffsets_[node + 1]};
+    }
+
+    uint32_t latency(NodeId node) const { return latencies_[node]; }
+
+    /**
+     * @brief Minimum start-to-start distance of an edge leaving a node
+     *
+     * @param from Source node
+     * @param kind Kind of the edge
+     * @return Cycles the destination waits after the source starts
+     */
+    uint32_t delay(NodeId from, DependencyKind kind) const {
+        return kind == DependencyKind::WAR ? warDelays_[from] : latencies_[from];
+    }
+
+    /**
+     * @brief Length of the longest path from each node to the end of the graph
+     *
+     * Includes the node's own latency, so the largest value is the critical
+     * path of the sequence.
+     */
+    std::vector<uint64_t> heights() const;
+
+    /**
+     * @brief Bytes held by the graph
+     */
+    size_t memoryBytes() const;
+
+private:
+    friend class DependencyGraphBuilder;
+
+    std::vector<uint8_t> latencies_;
+    std::vector<uint8_t> warDelays_;
+    std::vector<uint32_t> predecessorOffsets_;
+    std::vector<uint32_t> predecessors_;
+    std::vector<uint32_t> successorOffsets_;
+    std::vector<uint32_t> successors_;
+};
+
+/**
+ * @brief Incremental builder of a DependencyGraph
+ *
+ * Instructions are added in program order, so every edge of a new node
+ * comes from an older one and the predecessor lists are written once, in
+ * order. For each slot, core and row the builder keeps the last writer and
+ * the readers since then; a barrier instead depends on every node since
+ * the previous barrier that has no successor yet, and nodes after it
+ * without other predecessors depend on the barrier. The number of edges is
+ * therefore linear in the number of instructions.
+ *
+ * The builder can be reused: build() hands over the graph and resets it.
+ */
+class DependencyGraphBuilder : public PIM_ISA::InstructionSink {
+public:
+    DependencyGraphBuilder();
+
+    /**
+     * @brief Reserve space for a number of instructions
+     */
+    void reserve(size_t instructions);
+
+    /**
+     * @brief Add the next instruction
+     *
+     * @param instruction Instruction in program order
+     * @return Node of the instruction
+     * @throws std::runtime_error if the graph exceeds MAX_NODES or MAX_EDGES
+     */
+    DependencyGraph::NodeId add(const PIM_ISA::Instruction& instruction);
+
+    void emit(const PIM_ISA::Instruction& instruction) override { add(instruction); }
+
+    /**
+     * @brief Number of instructions added since the last build()
+     */
+    size_t size() const { return graph_.latencies_.size(); }
+
+    /**
+     * @brief Finish the graph and reset the builder
+     *
+     * @return Graph of the instructions added since the last build()
+     */
+    DependencyGraph build();
+
+private:
+    static constexpr DependencyGraph::NodeId NO_NODE = UINT32_MAX;
+
+    // Last writer and readers of a slot, core or row
+    struct Tracker {
+        DependencyGraph::NodeId writer{NO_NODE};
+        std::vector<DependencyGraph::NodeId> readers;
+    };
+
+    Tracker& tracker(const PIM_ISA::ResourceAccess& access);
+    void addEdge(DependencyGraph::NodeId from, DependencyKind kind);
+    void clearTrackers();
+
+    DependencyGraph graph_;
+    std::vector<bool> hasSuccessor_;
+    DependencyGraph::NodeId lastBarrier_{NO_NODE};
+
+    std::vector<Tracker> slots_;
+    std::vector<Tracker> cores_;
+    std::vector<Tracker> rows_;
+};
+
+} // namespace Optimizer
+
+#endif // OPTIMIZER_DEPENDENCY_GRAPH_H
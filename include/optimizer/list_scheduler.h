@@ -0,0 +1,145 @@
+#ifndef OPTIMIZER_LIST_SCHEDULER_H
+#define OPTIMIZER_LIST_SCHEDULER_H
+
+#include <cstdint>
+#include <deque>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "../pim_isa/instructions.h"
+#include "../pim_isa/instruction_sink.h"
+#include "dependency_graph.h"
+
+namespace Optimizer {
+
+/**
+ * @brief Result of list scheduling an instruction stream
+ */
+struct ScheduleStats {
+    // Instructions scheduled
+    uint64_t instructions{0};
+
+    // Groups of instructions that start in the same cycle
+    uint64_t bundles{0};
+
+    // Cycle at which the last instruction finishes
+    uint64_t cycles{0};
+};
+
+/**
+ * @brief Streaming list scheduler for pPIM instructions
+ *
+ * Keeps a window of upcoming instructions and repeatedly starts the ready
+ * instruction with the earliest start cycle, oldest first on ties. An
+ * instruction is ready once everything it depends on has been scheduled.
+ * Dependencies follow resourceAccesses(), as in DependencyGraph, but are
+ * tracked incrementally over the window:
+ * - read slots: a compute waits for the Reads of its operands, a Read for
+ *   earlier computes using its slot to start and for the previous Read of it
+ * - cores: PROG, compute and Write on the same core keep their order
+ * - rows: a Read waits for earlier Writes of its row, a Write for earlier
+ *   Reads and Writes of it
+ * Reads and Writes also need their bank, which serves one access at a time.
+ * Latencies are the cycle costs of instructions.h, so the schedule matches
+ * PIM_ISA::ParallelSimulationSink.
+ *
+ * Instructions leave the scheduler in start-cycle order; the first of each
+ * cycle is marked as the start of a bundle. END and ReadWrite EXEs are
+ * barriers that start after everything before them has finished.
+ */
+class ListScheduler : public PIM_ISA::InstructionFilter {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param next Sink receiving the scheduled instructions
+     * @param window Maximum number of unscheduled instructions held back
+     * @param stats Counts updated as instructions are scheduled
+     */
+    ListScheduler(PIM_ISA::InstructionSink& next, size_t window, ScheduleStats& stats);
+
+    void emit(const PIM_ISA::Instruction& instruction) override;
+    bool finish() override;
+
+private:
+    // Instruction waiting in the window
+    struct Node {
+        PIM_ISA::Instruction instruction;
+        uint64_t earliest{0};                 // Earliest start allowed by scheduled predecessors
+        uint32_t latency{0};
+        uint32_t pendingPredecessors{0};
+        bool scheduled{false};
+        std::vector<std::pair<uint64_t, uint32_t>> successors;  // (node id, start-to-start delay)
+    };
+
+    // Readers a tracker holds before scheduled ones are dropped
+    static constexpr size_t READER_PRUNE_THRESHOLD = 256;
+
+    // Last writer and readers of a slot, core or row
+    struct Tracker {
+        int64_t writer{-1};                   // Node id of the last writer (-1 if none)
+        uint64_t writeReady{0};               // Earliest dependent start once the writer is scheduled
+        std::vector<uint64_t> readers;        // Node ids reading since the last write
+        uint64_t readRelease{0};              // Earliest overwrite once scheduled readers are done
+        size_t pruneSize{READER_PRUNE_THRESHOLD};  // Reader count at which scheduled readers are dropped
+    };
+
+    using ReadyEntry = std::pair<uint64_t, uint64_t>;  // (earliest start, node id)
+    using ReadyQueue = std::priority_queue<ReadyEntry, std::vector<ReadyEntry>, std::greater<ReadyEntry>>;
+
+    Node& node(uint64_t id) { return window_[id - firstId_]; }
+    bool isPending(uint64_t id) const { return id >= firstId_ && !window_[id - firstId_].scheduled; }
+
+    // Tracker of the slot, core or row an access uses
+    Tracker& tracker(const PIM_ISA::ResourceAccess& access);
+
+    // Cycles after a reader starts before its resource may be overwritten
+    static uint32_t readerDelay(PIM_ISA::Resource resource);
+
+    // Add the dependencies of a new node on the slot, core and row it uses
+    void addReadAccess(uint64_t id, Tracker& tracker);
+    void addWriteAccess(uint64_t id, Tracker& tracker, uint32_t readerDelay);
+    void addEdge(uint64_t from, uint64_t to, uint32_t delay);
+
+    // Schedule the best ready instruction
+    void scheduleNext();
+
+    // Queue a node whose predecessors have all been scheduled
+    void makeReady(uint64_t id);
+
+    // Schedule every instruction in the window
+    void drain();
+
+    // Start an instruction and pass it downstream
+    void start(Node& scheduled, uint64_t id, uint64_t cycle);
+
+    // Schedule a barrier after everything before it
+    void scheduleBarrier(const PIM_ISA::Instruction& instruction);
+
+    // Bank a Read or Write occupies (-1 for other instructions)
+    static int bankOf(const PIM_ISA::Instruction& instruction);
+
+    size_t windowSize_;
+    ScheduleStats& stats_;
+
+    std::deque<Node> window_;
+    uint64_t firstId_{0};
+    uint64_t nextId_{0};
+    size_t pending_{0};
+
+    ReadyQueue ready_;                    // Ready PROGs and computes
+    std::vector<ReadyQueue> bankReady_;   // Ready Reads and Writes of each bank
+
+    std::vector<Tracker> slots_;
+    std::vector<Tracker> cores_;
+    std::vector<Tracker> rows_;
+    std::vector<uint64_t> bankFree_;
+
+    uint64_t cycle_{0};           // Start cycle of the last scheduled instruction
+    uint64_t floor_{0};           // No instruction starts before the last barrier finished
+    bool cycleOpen_{false};       // Whether an instruction already started in cycle_
+};
+
+} // namespace Optimizer
+
+#endif // OPTIMIZER_LIST_SCHEDULER_H
@@ -3,11 +3,34 @@
 
 #include <vector>
 #include <memory>
+#include <utility>
 #include "../frontend/parser.h"
+#include "../ir/loop_nest.h"
 #include "../pim_isa/instructions.h"
+#include "../pim_isa/instruction_sink.h"
+#include "../pim_isa/packed_program.h"
+#include "dependency_graph.h"
+#include "list_scheduler.h"
 
 namespace Optimizer {
 
+/**
+ * @brief Counts collected by the instruction-level passes
+ */
+struct OptimizationStats {
+    // Instructions the reordering pass moved
+    uint64_t reorderedInstructions{0};
+    
+    // EXE Read instructions seen by the memory access pass
+    uint64_t reads{0};
+    
+    // Reads removed because the read slot already held the row
+    uint64_t eliminatedReads{0};
+    
+    // Result of the instruction scheduling pass
+    ScheduleStats schedule;
+};
+
 /**
  * @brief Optimizer class for optimizing matrix operations
  */
@@ -32,23 +55,135 @@ public:
      */
     void setVerbose(bool verbose);
     
+    /**
+     * @brief Force the tile size used for blocked matrix multiplication
+     * 
+     * Without a forced size, -O3 picks one from the bank and core counts.
+     * 
+     * @param rows Rows of the result per tile
+     * @param cols Columns of the result per tile
+     * @return true if the tile fits the read slots and accumulator cores
+     */
+    bool setTileSize(uint32_t rows, uint32_t cols);
+    
+    /**
+     * @brief Enable or disable folding products by constant matrices
+     * 
+     * Folding is enabled by default from -O1.
+     * 
+     * @param folding Whether to fold
+     */
+    void setConstantFolding(bool folding) { folding_ = folding; }
+    
+    /**
+     * @brief Number of products folded by the last optimizeOperations()
+     */
+    uint32_t getFoldedOperationCount() const { return foldedOperations_; }
+    
+    /**
+     * @brief Enable or disable fusing sums into the products they add to
+     * 
+     * Fusion is enabled by default from -O1.
+     * 
+     * @param fusion Whether to fuse
+     */
+    void setFusion(bool fusion) { fusion_ = fusion; }
+    
+    /**
+     * @brief Number of sums fused into products by the last optimizeOperations()
+     */
+    uint32_t getFusedOperationCount() const { return fusedOperations_; }
+    
+    /**
+     * @brief Set the size from which square products are split (Strassen-Winograd)
+     * 
+     * From -O1, a product of two n x n matrices with n even and at least
+     * the threshold becomes 7 products of n/2 x n/2 blocks plus 15 sums and
+     * differences, recursively. Splitting is disabled by default.
+     * 
+     * @param threshold Smallest n to split (0 disables splitting)
+     */
+    void setStrassenThreshold(uint32_t threshold) { strassenThreshold_ = threshold; }
+    
+    /**
+     * @brief Set the nibbles each matrix element takes in memory
+     * 
+     * Used to check whether the temporaries of a split fit in memory.
+     * 
+     * @param nibbles 4-bit operands per element (1 for 4-bit elements)
+     */
+    void setElementWidth(uint32_t nibbles) { elementWidth_ = nibbles; }
+    
+    /**
+     * @brief Number of products split by the last optimizeOperations()
+     */
+    uint32_t getStrassenSplitCount() const { return strassenSplits_; }
+    
     /**
      * @brief Optimize matrix operations
      * 
      * @param operations Matrix operations to optimize
+     * @param matrices Matrices the operations refer to; temporaries the
+     *                 optimizer replaces are removed and new ones appended
      * @return Optimized matrix operations
      */
     std::vector<Frontend::MatrixOperation> optimizeOperations(
-        const std::vector<Frontend::MatrixOperation>& operations);
+        const std::vector<Frontend::MatrixOperation>& operations,
+        std::vector<Frontend::MatrixInfo>& matrices);
+    
+    /**
+     * @brief Optimize the loop nests built for the operations
+     * 
+     * Loop-level passes work on the loop nests before they are expanded into
+     * instructions, so their cost does not grow with the matrix sizes.
+     * 
+     * @param kernels Loop nests to transform in place
+     */
+    void optimizeLoopNests(std::vector<IR::Kernel>& kernels);
+    
+    /**
+     * @brief PROGs of the loop nests after the last optimizeLoopNests()
+     */
+    uint32_t getProgCount() const { return progCount_; }
+    
+    /**
+     * @brief PROGs of the loop nests before the last optimizeLoopNests()
+     */
+    uint32_t getProgBaseline() const { return progBaseline_; }
     
     /**
      * @brief Optimize pPIM instructions
      * 
-     * @param instructions pPIM instructions to optimize
-     * @return Optimized pPIM instructions
+     * @param program pPIM program to optimize
+     * @return Optimized pPIM program
      */
-    std::vector<PIM_ISA::Instruction> optimizeInstructions(
-        const std::vector<PIM_ISA::Instruction>& instructions);
+    PIM_ISA::PackedProgram optimizeInstructions(const PIM_ISA::PackedProgram& program);
+    
+    /**
+     * @brief Create the streaming instruction-level optimization pipeline
+     * 
+     * Instructions emitted into the returned sink pass through every pass
+     * enabled at the current optimization level before reaching the output
+     * sink. The pipeline must be finished to flush buffered instructions.
+     * 
+     * @param output Sink receiving the optimized instructions
+     * @return Head of the pipeline
+     */
+    std::unique_ptr<PIM_ISA::InstructionSink> createInstructionPipeline(
+        PIM_ISA::InstructionSink& output);
+    
+    /**
+     * @brief Get the counts of the most recent instruction pipeline
+     * 
+     * Valid once the pipeline returned by createInstructionPipeline() has
+     * been finished.
+     */
+    const OptimizationStats& getStats() const { return stats_; }
+    
+    /**
+     * @brief Print the counts of the most recent instruction pipeline
+     */
+    void printStats() const;
     
 private:
     // Optimization level
@@ -57,41 +192,208 @@ private:
     // Verbosity flag
     bool verbose_{false};
     
+    // Forced tile size (0 = choose automatically)
+    uint32_t tileRows_{0};
+    uint32_t tileCols_{0};
+    
+    // Whether products by constant matrices are folded, and how many were
+    bool folding_{true};
+    uint32_t foldedOperations_{0};
+    
+    // Whether sums are fused into products, and how many were
+    bool fusion_{true};
+    uint32_t fusedOperations_{0};
+    
+    // Smallest square product split by Strassen-Winograd (0 = never), and how many were
+    uint32_t strassenThreshold_{0};
+    uint32_t strassenSplits_{0};
+    
+    // Nibbles each matrix element takes in memory
+    uint32_t elementWidth_{1};
+    
+    // PROGs of the last loop nests optimized, after and before core configuration
+    uint32_t progCount_{0};
+    uint32_t progBaseline_{0};
+    
+    // Counts of the most recent instruction pipeline
+    OptimizationStats stats_;
+    
+    /**
+     * @brief Fold products by constant identity, zero, diagonal and permutation matrices
+     * 
+     * A product with a constant operand (MatrixInfo::values) that has at
+     * most one nonzero per column (on the right) or per row (on the left)
+     * needs one multiply-accumulate per result element instead of a dot
+     * product: it becomes a SCALE_COLUMNS or SCALE_ROWS operation. A
+     * product by the identity is a copy and is removed where storage can be
+     * shared as in eliminateCommonSubexpressions(): a temporary result is
+     * replaced by the other operand, and a named result becomes an alias of
+     * it, or takes over its storage if that is a temporary. Sharing needs a
+     * result assigned once and not read before, and an operand not
+     * assigned again afterwards. Sparse operands are not folded.
+     * 
+     * @param operations Operations to rewrite
+     * @param matrices Matrices the operations refer to (removed temporaries
+     *                 are erased, results marked as aliases)
+     */
+    void foldConstantOperands(std::vector<Frontend::MatrixOperation>& operations,
+                              std::vector<Frontend::MatrixInfo>& matrices);
+    
+    /**
+     * @brief Reassociate chained products to minimize multiply-accumulates
+     * 
+     * A chain is a product whose operands include temporaries computed by
+     * other products, as the parser produces for A * B * C. Each chain is
+     * flattened into its factors and re-parenthesized by dynamic
+     * programming over the MAC count m·n·p of every product; chains whose
+     * written order is already optimal are left unchanged.
+     * 
+     * @param operations Operations to rewrite
+     * @param matrices Matrices the operations refer to (temporaries are replaced)
+     */
+    void applyChainOrdering(std::vector<Frontend::MatrixOperation>& operations,
+                            std::vector<Frontend::MatrixInfo>& matrices);
+    
+    /**
+     * @brief Compute each distinct product once
+     * 
+     * Value numbering over the operations: a product of the same values as
+     * an earlier one is removed. A duplicated temporary is replaced by the
+     * earlier result in the operations that use it; a duplicated named
+     * matrix becomes an alias of the earlier result (MatrixInfo::aliasOf),
+     * so both share storage. Only results assigned once, and not read
+     * before that, are reused or aliased, so sharing storage never changes
+     * what another operation reads.
+     * 
+     * @param operations Operations to rewrite
+     * @param matrices Matrices the operations refer to (temporaries are
+     *                 removed, duplicated outputs marked as aliases)
+     */
+    void eliminateCommonSubexpressions(std::vector<Frontend::MatrixOperation>& operations,
+                                       std::vector<Frontend::MatrixInfo>& matrices);
+    
+    /**
+     * @brief Fuse sums into the products they add to (GEMM + bias)
+     * 
+     * E = T + D, E = D + T and E = T - D, where the temporary T = A * B is
+     * used only there, become one product whose accumulators start from
+     * ±D[i,j] instead of 0, so T is never written or read back. The sign
+     * comes from a 1x1 constant matrix (const.1 or const.-1) added to the
+     * matrices; the loader stores its value.
+     * 
+     * @param operations Operations to rewrite
+     * @param matrices Matrices the operations refer to (fused temporaries
+     *                 are removed, constants appended)
+     */
+    void applyBiasFusion(std::vector<Frontend::MatrixOperation>& operations,
+                         std::vector<Frontend::MatrixInfo>& matrices);
+    
+    /**
+     * @brief Split large square products into seven half-size products
+     * 
+     * Strassen-Winograd: C = A * B with n x n operands becomes, over the
+     * n/2 x n/2 blocks of A, B and C,
+     *   S1 = A21 + A22, S2 = S1 - A11, S3 = A11 - A21, S4 = A12 - S2
+     *   T1 = B12 - B11, T2 = B22 - T1, T3 = B22 - B12, T4 = T2 - B21
+     *   M1 = A11 * B11, M2 = A12 * B21, M3 = S4 * B22, M4 = A22 * T4,
+     *   M5 = S1 * T1, M6 = S2 * T2, M7 = S3 * T3
+     *   C11 = M1 + M2, U2 = M1 + M6, U3 = U2 + M7, U4 = U2 + M5,
+     *   C12 = U4 + M3, C21 = U3 - M4, C22 = U3 + M5
+     * Blocks are views of their matrix (MatrixInfo::block); the 18 others
+     * are temporaries. The M products are split again while they qualify.
+     * A product is left alone when its temporaries would not fit in memory.
+     * 
+     * @param operations Operations to rewrite
+     * @param matrices Matrices the operations refer to (blocks and
+     *                 temporaries appended)
+     */
+    void applyStrassen(std::vector<Frontend::MatrixOperation>& operations,
+                       std::vector<Frontend::MatrixInfo>& matrices);
+    
+    /**
+     * @brief Apply blocking to matrix multiplications
+     * 
+     * Annotates each multiplication with the tile size code generation
+     * should use.
+     * 
+     * @param operations Operations to annotate
+     * @param matrices Matrices the operations refer to
+     */
+    void applyTiling(std::vector<Frontend::MatrixOperation>& operations,
+                     const std::vector<Frontend::MatrixInfo>& matrices);
+    
+    /**
+     * @brief Spread the dot products of untiled multiplications over MAC cores
+     * 
+     * Annotates each multiplication left untiled with a one-row tile, so
+     * code generation accumulates consecutive elements of a row of the
+     * result on separate cores that run in parallel. Folded products
+     * (SCALE_ROWS, SCALE_COLUMNS) spread their rows or columns likewise,
+     * and batched products (BATCH_MULTIPLY) compute up to 16 items at once.
+     * 
+     * @param operations Operations to annotate
+     * @param matrices Matrices the operations refer to
+     */
+    void applyCoreAllocation(std::vector<Frontend::MatrixOperation>& operations,
+                             const std::vector<Frontend::MatrixInfo>& matrices);
+    
+    /**
+     * @brief Choose the tile size for a matrix product
+     * 
+     * @param rows Rows of the result
+     * @param cols Columns of the result
+     * @return Tile rows and columns
+     */
+    std::pair<uint32_t, uint32_t> chooseTileSize(uint32_t rows, uint32_t cols) const;
+    
+    /**
+     * @brief Program only the cores loop nests use, as rarely as possible
+     * 
+     * Liveness: each nest keeps the setups of the cores it computes on, so
+     * cores that are never used (e.g. the adder of a program without sums)
+     * are not programmed. The nests then run in order (from level 2, any
+     * order allowed by the memory rows they read and write, picking the
+     * ready nest that needs the fewest PROGs), each moved onto cores that
+     * already hold its configuration or are still unprogrammed. A PROG that
+     * remains is hoisted to just after the last nest using its core.
+     * 
+     * @param kernels Loop nests to reorder and rewrite in place
+     */
+    void applyCoreConfiguration(std::vector<IR::Kernel>& kernels);
+    
     /**
-     * @brief Apply loop unrolling optimization
+     * @brief Apply loop unrolling to a loop nest
      * 
-     * @param instructions pPIM instructions to optimize
-     * @return Optimized pPIM instructions
+     * @param kernel Loop nest to transform
      */
-    std::vector<PIM_ISA::Instruction> applyLoopUnrolling(
-        const std::vector<PIM_ISA::Instruction>& instructions);
+    void applyLoopUnrolling(IR::Kernel& kernel);
     
     /**
-     * @brief Apply instruction reordering optimization
+     * @brief Create the instruction reordering pass
      * 
-     * @param instructions pPIM instructions to optimize
-     * @return Optimized pPIM instructions
+     * @param next Sink receiving the pass output
+     * @return Streaming pass
      */
-    std::vector<PIM_ISA::Instruction> applyInstructionReordering(
-        const std::vector<PIM_ISA::Instruction>& instructions);
+    std::unique_ptr<PIM_ISA::InstructionFilter> createInstructionReorderingPass(
+        PIM_ISA::InstructionSink& next);
     
     /**
-     * @brief Apply memory access optimization
+     * @brief Create the memory access optimization pass
      * 
-     * @param instructions pPIM instructions to optimize
-     * @return Optimized pPIM instructions
+     * @param next Sink receiving the pass output
+     * @return Streaming pass
      */
-    std::vector<PIM_ISA::Instruction> applyMemoryAccessOptimization(
-        const std::vector<PIM_ISA::Instruction>& instructions);
+    std::unique_ptr<PIM_ISA::InstructionFilter> createMemoryAccessPass(
+        PIM_ISA::InstructionSink& next);
     
     /**
-     * @brief Apply instruction scheduling optimization
+     * @brief Create the instruction scheduling pass
      * 
-     * @param instructions pPIM instructions to optimize
-     * @return Optimized pPIM instructions
+     * @param next Sink receiving the pass output
+     * @return Streaming pass
      */
-    std::vector<PIM_ISA::Instruction> applyInstructionScheduling(
-        const std::vector<PIM_ISA::Instruction>& instructions);
+    std::unique_ptr<PIM_ISA::InstructionFilter> createInstructionSchedulingPass(
+        PIM_ISA::InstructionSink& next);
 };
 
 } // namespace Optimizer
@@ -0,0 +1,100 @@
+#ifndef PIM_ISA_ASSEMBLY_WRITER_H
+#define PIM_ISA_ASSEMBLY_WRITER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "instructions.h"
+#include "instruction_sink.h"
+#include "packed_program.h"
+
+namespace PIM_ISA {
+
+/**
+ * @brief Formats instructions as pPIM assembly lines
+ *
+ * Produces exactly the text of Instruction::toString() followed by a
+ * newline, but appends into a caller-owned buffer using precomputed
+ * prefixes and std::to_chars instead of a stringstream per instruction.
+ */
+class AssemblyFormatter {
+public:
+    /**
+     * @brief Append one instruction as a line of assembly
+     *
+     * @param buffer Buffer to append to
+     * @param instruction Instruction to format
+     */
+    static void appendLine(std::string& buffer, const Instruction& instruction);
+
+    /**
+     * @brief Append one packed instruction word as a line of assembly
+     *
+     * @param buffer Buffer to append to
+     * @param word Packed instruction word
+     * @param configs LUT configuration table the word refers to
+     */
+    static void appendLine(std::string& buffer, uint32_t word, const std::vector<LutConfig>& configs);
+
+    /**
+     * @brief Append the comment line that opens a bundle
+     *
+     * Written before every instruction marked as the start of a bundle.
+     *
+     * @param buffer Buffer to append to
+     * @param bundle Bundle number, counted from 0
+     */
+    static void appendBundleMarker(std::string& buffer, uint64_t bundle);
+};
+
+/**
+ * @brief Sink that writes pPIM assembly text to a stream
+ *
+ * Lines are formatted into a large reusable buffer that is written out in
+ * big chunks. The assembly header is written on construction.
+ */
+class AssemblyWriterSink : public InstructionSink {
+public:
+    explicit AssemblyWriterSink(std::ostream& out);
+
+    void emit(const Instruction& instruction) override;
+    bool finish() override;
+
+    /**
+     * @brief Number of bytes written so far (including the header)
+     */
+    uint64_t bytesWritten() const { return bytesWritten_ + buffer_.size(); }
+
+private:
+    std::ostream& out_;
+    std::string buffer_;
+    uint64_t bytesWritten_{0};
+    uint64_t bundles_{0};
+
+    void flushBuffer();
+};
+
+/**
+ * @brief Write a packed program as pPIM assembly text
+ *
+ * The program is split into chunks that are formatted concurrently and
+ * written in program order, so the output is identical for any thread count.
+ *
+ * @param program Program to write
+ * @param out Output stream
+ * @param threads Number of formatting threads (0 selects the hardware concurrency)
+ * @return true if writing was successful
+ */
+bool writeAssembly(const PackedProgram& program, std::ostream& out, unsigned threads = 0);
+
+/**
+ * @brief Write the standard assembly file header
+ *
+ * @param out Output stream
+ */
+void writeAssemblyHeader(std::ostream& out);
+
+} // namespace PIM_ISA
+
+#endif // PIM_ISA_ASSEMBLY_WRITER_H
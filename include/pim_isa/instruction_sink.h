@@ -0,0 +1,231 @@
+#ifndef PIM_ISA_INSTRUCTION_SINK_H
+#define PIM_ISA_INSTRUCTION_SINK_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "instructions.h"
+
+namespace PIM_ISA {
+
+class PackedProgram;
+
+/**
+ * @brief Consumer of a stream of pPIM instructions
+ *
+ * Code generation and the instruction-level optimization passes push
+ * instructions into a sink one at a time, so a program never has to be
+ * materialized in full unless the consumer chooses to store it.
+ */
+class InstructionSink {
+public:
+    virtual ~InstructionSink() = default;
+
+    /**
+     * @brief Consume one instruction
+     *
+     * @param instruction Instruction to consume
+     */
+    virtual void emit(const Instruction& instruction) = 0;
+
+    /**
+     * @brief Consume a block of instructions generated ahead of time
+     *
+     * The default implementation emits the block one instruction at a
+     * time. Sinks that store packed words override it to append the block
+     * in bulk.
+     *
+     * @param block Instructions to consume, in order
+     */
+    virtual void emitBlock(const PackedProgram& block);
+
+    /**
+     * @brief Signal the end of the instruction stream
+     *
+     * @return true if all buffered state was flushed successfully
+     */
+    virtual bool finish() { return true; }
+};
+
+/**
+ * @brief Sink that forwards every instruction to a downstream sink
+ *
+ * Streaming optimization passes derive from this class and override
+ * emit() and finish() to rewrite the stream on its way through.
+ */
+class InstructionFilter : public InstructionSink {
+public:
+    explicit InstructionFilter(InstructionSink& next) : next_(next) {}
+
+    void emit(const Instruction& instruction) override { next_.emit(instruction); }
+    bool finish() override { return next_.finish(); }
+
+protected:
+    InstructionSink& next_;
+};
+
+/**
+ * @brief Sink that stores every instruction in a vector
+ */
+class VectorSink : public InstructionSink {
+public:
+    explicit VectorSink(std::vector<Instruction>& instructions) : instructions_(instructions) {}
+
+    void emit(const Instruction& instruction) override { instructions_.push_back(instruction); }
+
+private:
+    std::vector<Instruction>& instructions_;
+};
+
+/**
+ * @brief Sink that duplicates the stream into two downstream sinks
+ */
+class TeeSink : public InstructionSink {
+public:
+    TeeSink(InstructionSink& first, InstructionSink& second) : first_(first), second_(second) {}
+
+    void emit(const Instruction& instruction) override;
+    bool finish() override;
+
+private:
+    InstructionSink& first_;
+    InstructionSink& second_;
+};
+
+/**
+ * @brief Instruction counts by kind
+ */
+struct InstructionCounts {
+    uint64_t prog{0};
+    uint64_t read{0};
+    uint64_t write{0};
+    uint64_t compute{0};
+    uint64_t end{0};
+
+    uint64_t total() const { return prog + read + write + compute + end; }
+};
+
+/**
+ * @brief Sink that only counts instructions by kind
+ */
+class CountingSink : public InstructionSink {
+public:
+    void emit(const Instruction& instruction) override;
+
+    const InstructionCounts& counts() const { return counts_; }
+
+private:
+    InstructionCounts counts_;
+};
+
+/**
+ * @brief Sink that accumulates the sequential cycle cost of the stream
+ *
+ * Uses the same per-instruction cycle costs as sim/pim_simulator.cpp.
+ */
+class SimulationSink : public InstructionSink {
+public:
+    void emit(const Instruction& instruction) override;
+
+    uint64_t totalCycles() const { return totalCycles_; }
+    const InstructionCounts& counts() const { return counts_; }
+
+private:
+    uint64_t totalCycles_{0};
+    InstructionCounts counts_;
+};
+
+/**
+ * @brief Sink that estimates the cycle count with parallel cores and banks
+ *
+ * Instructions are dispatched in program order, and any number may start in
+ * the same cycle once the units they use are free and their inputs are
+ * ready. Latencies are the same as in SimulationSink:
+ * - Read: occupies the bank of its row; waits until every compute reading
+ *   the previous contents of its slot has started
+ * - compute EXE: occupies its core; waits for both operand slots
+ * - Write: occupies the bank of its row; waits for the core named by its
+ *   pointer, which stays busy until the result is stored
+ * - PROG: occupies its core
+ * - END: waits for every instruction to finish
+ *
+ * The critical path is the same model without banks and program order: the
+ * longest chain of slot, core and row dependencies, with END and ReadWrite
+ * EXEs waiting for everything before them. No schedule is shorter.
+ */
+class ParallelSimulationSink : public InstructionSink {
+public:
+    ParallelSimulationSink();
+
+    void emit(const Instruction& instruction) override;
+
+    // Cycle at which the last instruction finishes
+    uint64_t totalCycles() const { return totalCycles_; }
+
+    // Cycles if every instruction ran after the previous one finished
+    uint64_t sequentialCycles() const { return sequentialCycles_; }
+
+    // Cycles spent in compute EXEs, summed over all cores
+    uint64_t computeCycles() const { return computeCycles_; }
+
+    // Number of cores that executed at least one compute EXE
+    uint32_t computeCoresUsed() const;
+
+    // Length of the longest dependency chain
+    uint64_t criticalPathCycles() const { return criticalPath_; }
+
+    // Instructions marked as the start of a bundle
+    uint64_t bundles() const { return bundles_; }
+
+private:
+    // Start an instruction no earlier than `ready`, keeping program order
+    uint64_t dispatch(uint64_t ready, uint32_t latency);
+
+    // Extend the critical path with an instruction
+    void trackDependencies(const Instruction& instruction);
+
+    uint64_t lastStart_{0};
+    uint64_t totalCycles_{0};
+    uint64_t sequentialCycles_{0};
+    uint64_t computeCycles_{0};
+
+    std::vector<uint64_t> coreFree_;       // Cycle each core becomes free
+    std::vector<uint64_t> bankFree_;       // Cycle each bank becomes free
+    std::vector<uint64_t> slotReady_;      // Cycle each read slot holds its row
+    std::vector<uint64_t> slotLastUse_;    // Latest start of a compute reading each slot
+    std::vector<bool> coreComputed_;
+
+    // Dependency-only state of one slot, core or row
+    struct DependencyTimes {
+        uint64_t written{0};               // Finish of the last writer
+        uint64_t released{0};              // Earliest start of a writer after its readers
+    };
+
+    // Dependency-only state for the critical path
+    uint64_t criticalPath_{0};
+    uint64_t depFloor_{0};                 // Finish of the last barrier
+    uint64_t bundles_{0};
+    std::vector<DependencyTimes> depSlots_;
+    std::vector<DependencyTimes> depCores_;
+    std::vector<DependencyTimes> depRows_;
+};
+
+/**
+ * @brief Sink that writes the 32-bit binary encoding of each instruction
+ *
+ * Words are written little-endian, one per instruction.
+ */
+class BinaryEncoderSink : public InstructionSink {
+public:
+    explicit BinaryEncoderSink(std::ostream& out) : out_(out) {}
+
+    void emit(const Instruction& instruction) override;
+    bool finish() override;
+
+private:
+    std::ostream& out_;
+};
+
+} // namespace PIM_ISA
+
+#endif // PIM_ISA_INSTRUCTION_SINK_H
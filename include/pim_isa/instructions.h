@@ -7,6 +7,61 @@
 
 namespace PIM_ISA {
 
+// Cycle costs used by the compiler's cost model (same as sim/pim_simulator.cpp)
+constexpr uint32_t PROG_CYCLES = 10;     // Cycles for PROG instruction
+constexpr uint32_t READ_CYCLES = 2;      // Cycles for memory read
+constexpr uint32_t WRITE_CYCLES = 2;     // Cycles for memory write
+constexpr uint32_t COMPUTE_CYCLES = 1;   // Cycles for core computation
+constexpr uint32_t END_CYCLES = 1;       // Cycles for END instruction
+
+// Resources addressable by the ISA
+constexpr uint32_t NUM_CORES = 64;       // 6-bit core pointer
+constexpr uint32_t NUM_READ_SLOTS = 64;  // 6-bit read pointer
+constexpr uint32_t NUM_ROWS = 512;       // 9-bit row address
+constexpr uint32_t NUM_BANKS = 16;       // DRAM banks per array
+
+/**
+ * @brief Bank holding a memory row (consecutive rows are interleaved)
+ */
+constexpr uint8_t bankOfRow(uint16_t rowAddress) {
+    return static_cast<uint8_t>(rowAddress % NUM_BANKS);
+}
+
+/**
+ * @brief Operand slots of a compute EXE
+ *
+ * A compute EXE uses its row-address field to select the read slots holding
+ * its two operands: bits 0-3 give the first slot and bits 4-8 the second.
+ * The value 0 selects the default operands, slots 0 and 1.
+ */
+constexpr uint32_t MAX_OPERAND_SLOT_A = 15;
+constexpr uint32_t MAX_OPERAND_SLOT_B = 31;
+
+/**
+ * @brief Encode the operand slots of a compute EXE
+ *
+ * @param slotA Slot of the first operand (at most MAX_OPERAND_SLOT_A)
+ * @param slotB Slot of the second operand (at most MAX_OPERAND_SLOT_B)
+ * @return Row-address field value
+ */
+constexpr uint16_t encodeOperandSlots(uint8_t slotA, uint8_t slotB) {
+    return (slotA == 0 && slotB == 1) ? 0 : static_cast<uint16_t>((slotA & 0xF) | ((slotB & 0x1F) << 4));
+}
+
+/**
+ * @brief Decode the first operand slot of a compute EXE
+ */
+constexpr uint8_t operandSlotA(uint16_t rowAddress) {
+    return rowAddress == 0 ? 0 : static_cast<uint8_t>(rowAddress & 0xF);
+}
+
+/**
+ * @brief Decode the second operand slot of a compute EXE
+ */
+constexpr uint8_t operandSlotB(uint16_t rowAddress) {
+    return rowAddress == 0 ? 1 : static_cast<uint8_t>((rowAddress >> 4) & 0x1F);
+}
+
 /**
  * @brief Instruction types in the pPIM architecture
  */
@@ -28,7 +83,8 @@ enum class CoreOpType : uint8_t {
     LOGIC_OR,    // Logical OR
     LOGIC_XOR,   // Logical XOR
     COMPARATOR,  // Comparator
-    CUSTOM       // Custom function (requires specific LUT configuration)
+    CUSTOM,      // Custom function (requires specific LUT configuration)
+    SUBTRACTOR   // Subtractor function
 };
 
 /**
@@ -51,6 +107,11 @@ struct Instruction {
     CoreOpType coreOpType;         // Type of operation to program
     std::vector<uint8_t> lutConfig; // LUT configuration data (for PROG instructions)
     
+    // Set by the instruction scheduler on the first instruction of each
+    // bundle (instructions that start in the same cycle); not part of the
+    // 19-bit encoding
+    bool bundleStart{false};
+    
     /**
      * @brief Constructor for EXE and END instructions
      */
@@ -0,0 +1,58 @@
+#ifndef PIM_ISA_LUT_TABLES_H
+#define PIM_ISA_LUT_TABLES_H
+
+#include <array>
+#include <cstdint>
+
+namespace PIM_ISA {
+
+// Operand width of one LUT lookup
+constexpr uint32_t LUT_OPERAND_BITS = 4;
+
+// Entries of a LUT: one per pair of 4-bit operands
+constexpr uint32_t LUT_ENTRIES = 1u << (2 * LUT_OPERAND_BITS);
+
+/**
+ * @brief Contents of a 4-bit LUT, indexed by (a << 4) | b
+ */
+using LutTable = std::array<uint8_t, LUT_ENTRIES>;
+
+/**
+ * @brief Build a LUT from the function it computes
+ *
+ * @param function Function of the two 4-bit operands (a, b)
+ * @return Table holding function(a, b) at index (a << 4) | b
+ */
+template <typename Function>
+constexpr LutTable makeLutTable(Function function) {
+    LutTable table{};
+    for (uint32_t a = 0; a < (1u << LUT_OPERAND_BITS); ++a) {
+        for (uint32_t b = 0; b < (1u << LUT_OPERAND_BITS); ++b) {
+            table[(a << LUT_OPERAND_BITS) | b] = static_cast<uint8_t>(function(a, b));
+        }
+    }
+    return table;
+}
+
+/**
+ * @brief 4 x 4 -> 8-bit products (partial products of wider multiplies)
+ */
+constexpr LutTable MULTIPLIER_LUT = makeLutTable([](uint32_t a, uint32_t b) { return a * b; });
+
+/**
+ * @brief 4 + 4-bit sums; bit 4 is the carry into the next nibble
+ */
+constexpr LutTable ADDER_LUT = makeLutTable([](uint32_t a, uint32_t b) { return a + b; });
+
+/**
+ * @brief 4 - 4-bit differences; bit 4 is the borrow from the next nibble
+ */
+constexpr LutTable SUBTRACTOR_LUT = makeLutTable([](uint32_t a, uint32_t b) { return (a - b) & 0x1F; });
+
+static_assert(MULTIPLIER_LUT[(15 << LUT_OPERAND_BITS) | 15] == 225, "multiplier LUT holds 4-bit products");
+static_assert(ADDER_LUT[(15 << LUT_OPERAND_BITS) | 1] == 0x10, "adder LUT carries into bit 4");
+static_assert(SUBTRACTOR_LUT[(0 << LUT_OPERAND_BITS) | 1] == 0x1F, "subtractor LUT borrows into bit 4");
+
+} // namespace PIM_ISA
+
+#endif // PIM_ISA_LUT_TABLES_H
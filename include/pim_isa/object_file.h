@@ -0,0 +1,165 @@
+#ifndef PIM_ISA_OBJECT_FILE_H
+#define PIM_ISA_OBJECT_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "instructions.h"
+#include "instruction_sink.h"
+#include "packed_program.h"
+
+namespace PIM_ISA {
+
+/**
+ * @brief pPIM binary object format (.pbin)
+ *
+ * All fields are little-endian.
+ *
+ * Offset   Contents
+ * 0        ObjectHeader (64 bytes)
+ * 4096     Instruction section: instructionCount packed 32-bit words
+ *          (see packed_program.h), page aligned so it can be mapped
+ *          and used in place
+ * ...      LUT configuration table: per entry
+ *          u8 opType, u8 reserved, u16 length, length data bytes
+ * ...      Matrix table: per entry
+ *          u32 rows, u32 cols, u16 startAddress, u16 endAddress,
+ *          u16 nameLength, nameLength name bytes
+ *
+ * The variable-size tables follow the instructions so a writer can stream
+ * the instruction section and patch the header when the stream ends.
+ */
+constexpr char OBJECT_MAGIC[8] = {'P', 'P', 'I', 'M', 'B', 'I', 'N', '\0'};
+constexpr uint32_t OBJECT_VERSION = 1;
+constexpr uint64_t OBJECT_SECTION_ALIGNMENT = 4096;
+
+/**
+ * @brief Fixed-size header at the start of a .pbin file
+ */
+struct ObjectHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t matrixCount;
+    uint32_t configCount;
+    uint64_t instructionCount;
+    uint64_t instructionOffset;
+    uint64_t configTableOffset;
+    uint64_t matrixTableOffset;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ObjectHeader) == 64, "ObjectHeader must be 64 bytes");
+
+/**
+ * @brief Matrix table entry
+ */
+struct ObjectMatrix {
+    std::string name;
+    uint32_t rows{0};
+    uint32_t cols{0};
+    uint16_t startAddress{0};
+    uint16_t endAddress{0};
+};
+
+/**
+ * @brief Sink that streams instructions into a .pbin file
+ *
+ * The output stream must be seekable; the header is rewritten by finish().
+ */
+class ObjectWriterSink : public InstructionSink {
+public:
+    explicit ObjectWriterSink(std::ostream& out);
+
+    /**
+     * @brief Set the matrix table written at the end of the file
+     *
+     * @param matrices Matrix table entries
+     */
+    void setMatrixTable(const std::vector<ObjectMatrix>& matrices) { matrices_ = matrices; }
+
+    void emit(const Instruction& instruction) override;
+    bool finish() override;
+
+private:
+    std::ostream& out_;
+    std::vector<ObjectMatrix> matrices_;
+    uint64_t instructionCount_{0};
+
+    // Only the config table of this program is used
+    PackedProgram configPool_;
+};
+
+/**
+ * @brief Write a packed program as a .pbin file
+ *
+ * @param program Program to write
+ * @param matrices Matrix table entries
+ * @param out Seekable output stream
+ * @return true if writing was successful
+ */
+bool writeObjectFile(const PackedProgram& program, const std::vector<ObjectMatrix>& matrices, std::ostream& out);
+
+/**
+ * @brief Read-only view of a .pbin file backed by a memory mapping
+ *
+ * The instruction section is used in place without copying.
+ */
+class ObjectFile {
+public:
+    /**
+     * @brief Map and validate a .pbin file
+     *
+     * @param path Path to the file
+     * @throws std::runtime_error if the file cannot be mapped or is malformed
+     */
+    explicit ObjectFile(const std::string& path);
+
+    ~ObjectFile();
+
+    ObjectFile(const ObjectFile&) = delete;
+    ObjectFile& operator=(const ObjectFile&) = delete;
+
+    const ObjectHeader& header() const { return header_; }
+    uint64_t instructionCount() const { return header_.instructionCount; }
+
+    /**
+     * @brief Packed instruction words, pointing into the mapping
+     */
+    const uint32_t* words() const { return words_; }
+
+    const std::vector<LutConfig>& configs() const { return configs_; }
+    const std::vector<ObjectMatrix>& matrices() const { return matrices_; }
+
+    /**
+     * @brief Decode an instruction
+     *
+     * @param index Instruction index
+     * @return Decoded instruction
+     */
+    Instruction instruction(uint64_t index) const;
+
+    /**
+     * @brief Stream every instruction into a sink
+     *
+     * @param sink Destination sink (not finished by this call)
+     */
+    void replay(InstructionSink& sink) const;
+
+private:
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+    ObjectHeader header_{};
+    const uint32_t* words_{nullptr};
+    std::vector<LutConfig> configs_;
+    std::vector<ObjectMatrix> matrices_;
+
+    void parseTables();
+};
+
+} // namespace PIM_ISA
+
+#endif // PIM_ISA_OBJECT_FILE_H
@@ -0,0 +1,154 @@
+#ifndef PIM_ISA_PACKED_PROGRAM_H
+#define PIM_ISA_PACKED_PROGRAM_H
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+#include "instructions.h"
+#include "instruction_sink.h"
+
+namespace PIM_ISA {
+
+/**
+ * @brief Packed instruction word layout
+ *
+ * 31            30-19          18-0
+ * Bundle start  Config index   Instruction::toBinary()
+ *
+ * The config index is only meaningful for PROG instructions and refers to
+ * an entry of the program's LUT configuration table. The bundle start bit
+ * carries Instruction::bundleStart.
+ */
+constexpr uint32_t PACKED_INSTRUCTION_MASK = 0x7FFFF;  // Bits 0-18
+constexpr uint32_t PACKED_CONFIG_SHIFT = 19;
+constexpr uint32_t PACKED_CONFIG_MASK = 0xFFF;         // 12-bit config index
+constexpr uint32_t MAX_PACKED_CONFIGS = PACKED_CONFIG_MASK + 1;
+constexpr uint32_t PACKED_BUNDLE_START = 1u << 31;
+
+/**
+ * @brief LUT configuration payload of a PROG instruction
+ */
+struct LutConfig {
+    CoreOpType opType;           // Operation programmed into the core
+    std::vector<uint8_t> data;   // LUT configuration data
+
+    LutConfig(CoreOpType type, const std::vector<uint8_t>& config) : opType(type), data(config) {}
+};
+
+// Field accessors for packed instruction words
+inline InstructionType packedType(uint32_t word) { return static_cast<InstructionType>((word >> 17) & 0x3); }
+inline uint8_t packedPointer(uint32_t word) { return static_cast<uint8_t>((word >> 11) & 0x3F); }
+inline bool packedRead(uint32_t word) { return (word >> 10) & 0x1; }
+inline bool packedWrite(uint32_t word) { return (word >> 9) & 0x1; }
+inline uint16_t packedRowAddress(uint32_t word) { return static_cast<uint16_t>(word & 0x1FF); }
+inline uint32_t packedConfigIndex(uint32_t word) { return (word >> PACKED_CONFIG_SHIFT) & PACKED_CONFIG_MASK; }
+inline bool packedBundleStart(uint32_t word) { return (word & PACKED_BUNDLE_START) != 0; }
+
+/**
+ * @brief Compact program container
+ *
+ * Stores one 32-bit word per instruction. PROG payloads are interned in a
+ * deduplicated LUT configuration table and referenced by index, so EXE
+ * instructions cost 4 bytes instead of a full Instruction object.
+ */
+class PackedProgram {
+public:
+    /**
+     * @brief Append an instruction
+     *
+     * @param instruction Instruction to append
+     */
+    void append(const Instruction& instruction);
+
+    /**
+     * @brief Append an already packed word
+     *
+     * @param word Packed word (its config index must refer to this program's table)
+     */
+    void appendWord(uint32_t word) { words_.push_back(word); }
+
+    /**
+     * @brief Append every instruction of another program
+     *
+     * Words are copied in bulk; PROG config indices are remapped into this
+     * program's config table.
+     *
+     * @param other Program to append
+     */
+    void appendProgram(const PackedProgram& other);
+
+    /**
+     * @brief Intern a LUT configuration in the config table
+     *
+     * @param opType Operation programmed into the core
+     * @param data LUT configuration data
+     * @return Index of the (possibly pre-existing) table entry
+     */
+    uint32_t internConfig(CoreOpType opType, const std::vector<uint8_t>& data);
+
+    /**
+     * @brief Decode an instruction
+     *
+     * @param index Instruction index
+     * @return Decoded instruction (PROG payload restored from the config table)
+     */
+    Instruction instruction(size_t index) const;
+
+    /**
+     * @brief Stream every instruction into a sink
+     *
+     * @param sink Destination sink (not finished by this call)
+     */
+    void replay(InstructionSink& sink) const;
+
+    /**
+     * @brief Decode the whole program
+     *
+     * @return Vector of decoded instructions
+     */
+    std::vector<Instruction> toInstructions() const;
+
+    /**
+     * @brief Approximate heap memory used by the program in bytes
+     */
+    size_t memoryUsage() const;
+
+    uint32_t word(size_t index) const { return words_[index]; }
+    const std::vector<uint32_t>& words() const { return words_; }
+    const LutConfig& config(uint32_t index) const { return configs_[index]; }
+    const std::vector<LutConfig>& configs() const { return configs_; }
+
+    size_t size() const { return words_.size(); }
+    bool empty() const { return words_.empty(); }
+    void reserve(size_t count) { words_.reserve(count); }
+    void clear();
+
+private:
+    // One packed word per instruction
+    std::vector<uint32_t> words_;
+
+    // Deduplicated LUT configuration table
+    std::vector<LutConfig> configs_;
+
+    // Lookup from (operation, data) to config table index
+    std::map<std::pair<uint8_t, std::vector<uint8_t>>, uint32_t> configIndex_;
+};
+
+/**
+ * @brief Sink that appends streamed instructions to a packed program
+ */
+class PackedProgramSink : public InstructionSink {
+public:
+    explicit PackedProgramSink(PackedProgram& program) : program_(program) {}
+
+    void emit(const Instruction& instruction) override { program_.append(instruction); }
+    void emitBlock(const PackedProgram& block) override { program_.appendProgram(block); }
+
+private:
+    PackedProgram& program_;
+};
+
+} // namespace PIM_ISA
+
+#endif // PIM_ISA_PACKED_PROGRAM_H
@@ -0,0 +1,62 @@
+#ifndef PIM_ISA_RESOURCES_H
+#define PIM_ISA_RESOURCES_H
+
+#include <cstddef>
+#include <cstdint>
+#include "instructions.h"
+
+namespace PIM_ISA {
+
+/**
+ * @brief State an instruction reads or writes
+ */
+enum class Resource : uint8_t {
+    SLOT,   // Read slot (operand buffer) named by a read pointer
+    CORE,   // LUT configuration and accumulator of a core
+    ROW     // Memory row
+};
+
+/**
+ * @brief One resource an instruction uses
+ */
+struct ResourceAccess {
+    Resource resource;
+    uint16_t index;
+    bool read;
+    bool write;
+};
+
+// Most resources a single instruction uses (a compute reads two slots and its core)
+constexpr size_t MAX_RESOURCE_ACCESSES = 3;
+
+/**
+ * @brief List the slots, cores and rows an instruction uses
+ *
+ * - PROG writes its core
+ * - Read reads its row and writes the slot named by its pointer
+ * - compute EXE reads both operand slots and updates its core
+ * - Write updates the core named by its pointer (it stores and clears the
+ *   accumulator) and writes its row
+ * END and ReadWrite EXEs use no resources; they are barriers.
+ *
+ * @param instruction Instruction to inspect
+ * @param accesses Destination for at most MAX_RESOURCE_ACCESSES entries
+ * @return Number of entries written
+ */
+size_t resourceAccesses(const Instruction& instruction, ResourceAccess* accesses);
+
+/**
+ * @brief Whether an instruction waits for everything before it
+ *
+ * END and ReadWrite EXEs are ordered against every other instruction.
+ */
+bool isBarrier(const Instruction& instruction);
+
+/**
+ * @brief Cycles an instruction occupies its core or bank (from instructions.h)
+ */
+uint32_t instructionLatency(const Instruction& instruction);
+
+} // namespace PIM_ISA
+
+#endif // PIM_ISA_RESOURCES_H
@@ -0,0 +1,217 @@
+#ifndef SERVER_COMPILE_SERVER_H
+#define SERVER_COMPILE_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Server {
+
+// Default path of the server socket
+constexpr const char* DEFAULT_SOCKET_PATH = "/tmp/pim_compiler.sock";
+
+// Longest request line (command and options)
+constexpr size_t MAX_REQUEST_LINE = 4096;
+
+// Largest source text accepted in one request
+constexpr uint64_t MAX_SOURCE_BYTES = 64ull * 1024 * 1024;
+
+// Compile requests waiting for a worker before new ones are refused
+constexpr size_t MAX_QUEUED_REQUESTS = 1024;
+
+// Compile requests whose latencies make up the percentiles
+constexpr size_t LATENCY_WINDOW = 1024;
+
+/**
+ * @brief Load and latency of a compile server
+ */
+struct ServerStats {
+    unsigned workers{0};        // Worker threads
+    unsigned active{0};         // Requests being compiled
+    size_t queueDepth{0};       // Requests waiting for a worker
+    uint64_t completed{0};      // Requests answered since the server started
+    uint64_t failed{0};         // Completed requests that did not compile
+    double p50Ms{0.0};          // Median latency over the latency window
+    double p99Ms{0.0};          // 99th percentile latency over the latency window
+};
+
+/**
+ * @brief Long-running compiler serving requests on a Unix domain socket
+ *
+ * Each connection carries one request, a line naming the command:
+ *
+ *   compile <bytes> [options]\n<bytes of source text>
+ *   stats\n
+ *
+ * The compile options are those of the command line that change the
+ * output (-O<level>, -fbinary, -fbounded-memory, -ftile=<R>x<C>,
+ * -fno-fusion, -fstrassen=<N>, -fprecision=<B>) and --source=<path>, the
+ * name against which relative side file paths are resolved. The reply is
+ * a sequence of frames "data <n>\n" followed by n bytes of output, ended
+ * by "ok\n" or "error <message>\n"; a failed compilation may have sent
+ * part of its output. A stats reply is one data frame of "<name> <value>"
+ * lines.
+ *
+ * The listening thread never blocks on a client: it polls the socket and
+ * every accepted connection that has not sent its request line yet, reads
+ * lines as their bytes arrive and answers stats requests itself. Compile
+ * requests are queued for a pool of workers, each of which reads the
+ * source, compiles it with a PIMCompiler of its own and streams the output
+ * back as it is written.
+ */
+class CompileServer {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param socketPath Path of the socket to listen on
+     * @param workers Number of worker threads (at least 1)
+     */
+    CompileServer(const std::string& socketPath, unsigned workers);
+
+    /**
+     * @brief Destructor; stops the workers
+     */
+    ~CompileServer();
+
+    /**
+     * @brief Set verbose mode, logging one line per request
+     *
+     * @param verbose Whether to log requests
+     */
+    void setVerbose(bool verbose) { verbose_ = verbose; }
+
+    /**
+     * @brief Serve requests until stop() is called or SIGINT or SIGTERM arrives
+     *
+     * Queued requests are completed before returning and the socket is
+     * removed.
+     *
+     * @return true if the socket could be opened
+     */
+    bool run();
+
+    /**
+     * @brief Ask run() to return
+     */
+    void stop() { stopping_ = true; }
+
+    /**
+     * @brief Get the current load and latency percentiles
+     */
+    ServerStats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief A compile request waiting for a worker
+     */
+    struct Request {
+        int fd{-1};                     // Connection
+        uint64_t id{0};                 // Sequence number, for the log
+        uint64_t sourceBytes{0};        // Length of the source text
+        std::string options;            // Options of the request line
+        std::string source;             // Source text read with the request line
+        Clock::time_point received;     // When the request line was read
+    };
+
+    /**
+     * @brief An accepted connection whose request line is incomplete
+     */
+    struct Connection {
+        int fd{-1};                     // Non-blocking connection
+        std::string buffer;             // Bytes received so far
+        Clock::time_point accepted;     // When the connection was accepted
+    };
+
+    std::string socketPath_;
+    unsigned workerCount_;
+    bool verbose_{false};
+    std::atomic<bool> stopping_{false};
+    uint64_t nextId_{0};
+
+    // Request queue and statistics, guarded by mutex_
+    mutable std::mutex mutex_;
+    std::condition_variable queueReady_;
+    std::deque<Request> queue_;
+    bool draining_{false};
+    unsigned active_{0};
+    uint64_t completed_{0};
+    uint64_t failed_{0};
+    std::vector<double> latencies_;
+    size_t nextLatency_{0};
+
+    std::vector<std::thread> workers_;
+
+    // Connections waiting for their request line (listening thread only)
+    std::vector<Connection> pending_;
+
+    /**
+     * @brief Accept a connection and wait for its request line
+     *
+     * @param listenFd Listening socket with a connection to accept
+     */
+    void accept(int listenFd);
+
+    /**
+     * @brief Read what a connection has sent of its request line
+     *
+     * Dispatches the request once the line is complete and closes the
+     * connection on an error, end of file or an overlong line.
+     *
+     * @param connection Pending connection
+     * @return true once the connection is no longer pending
+     */
+    bool receive(Connection& connection);
+
+    /**
+     * @brief Close connections that did not send their request line in time
+     */
+    void expirePending();
+
+    /**
+     * @brief Answer or queue a request whose line has been read
+     *
+     * @param fd Connection, closed unless queued
+     * @param line Request line
+     * @param rest Bytes received after the line
+     */
+    void dispatch(int fd, const std::string& line, const std::string& rest);
+
+    /**
+     * @brief Compile queued requests until the server stops
+     */
+    void workerLoop();
+
+    /**
+     * @brief Compile one request and stream the reply
+     *
+     * @param request Request to compile
+     * @return true if it compiled
+     */
+    bool compile(Request& request);
+
+    /**
+     * @brief Record the completion of a compile request
+     *
+     * @param request Completed request
+     * @param success Whether it compiled
+     */
+    void complete(const Request& request, bool success);
+
+    /**
+     * @brief Format the stats reply
+     */
+    std::string formatStats() const;
+};
+
+} // namespace Server
+
+#endif // SERVER_COMPILE_SERVER_H
@@ -0,0 +1,64 @@
+#ifndef UTILS_BINARY_IO_H
+#define UTILS_BINARY_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Utils {
+
+/**
+ * @brief Append an integer in little-endian byte order
+ *
+ * @param out Buffer to append to
+ * @param value Integer to write
+ * @param bytes Number of low-order bytes of value to write (at most 8)
+ */
+void putInteger(std::string& out, uint64_t value, unsigned bytes);
+
+/**
+ * @brief Append a byte string preceded by its 8-byte length
+ */
+void putBytes(std::string& out, const std::string& bytes);
+
+/**
+ * @brief Read an integer written by putInteger()
+ *
+ * @param data Buffer to read from
+ * @param offset Position in data, advanced past the integer
+ * @param bytes Width of the integer
+ * @param value Integer read
+ * @return false if data ends before the integer
+ */
+bool getInteger(const std::string& data, size_t& offset, unsigned bytes, uint64_t& value);
+
+/**
+ * @brief Read a byte string written by putBytes()
+ *
+ * @return false if data ends before the string
+ */
+bool getBytes(const std::string& data, size_t& offset, std::string& bytes);
+
+/**
+ * @brief Read a whole file
+ *
+ * @return false if the file cannot be read
+ */
+bool readFile(const std::string& path, std::string& contents);
+
+/**
+ * @brief Replace a file atomically
+ *
+ * The data is written to a temporary file next to path, under a name
+ * unique to this process and thread, and renamed over path, so readers
+ * see either the old file or the complete new one.
+ *
+ * @param path File to replace
+ * @param data New contents
+ * @return true if the file was replaced
+ */
+bool writeFileAtomically(const std::string& path, const std::string& data);
+
+} // namespace Utils
+
+#endif // UTILS_BINARY_IO_H
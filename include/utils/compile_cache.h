@@ -0,0 +1,123 @@
+#ifndef UTILS_COMPILE_CACHE_H
+#define UTILS_COMPILE_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+namespace Utils {
+
+// Default bound on the size of a compile cache directory
+constexpr uint64_t DEFAULT_CACHE_BYTES = 256ull * 1024 * 1024;
+
+/**
+ * @brief Usage counters and contents of a compile cache
+ */
+struct CacheStats {
+    uint64_t hits{0};       // Lookups that found their output, over all runs
+    uint64_t misses{0};     // Lookups that did not
+    uint64_t entries{0};    // Outputs stored
+    uint64_t bytes{0};      // Size of the stored outputs
+};
+
+/**
+ * @brief Content-addressed on-disk cache of compiler outputs
+ *
+ * An entry is found by the hash of its key, the complete description of a
+ * compilation (normalized source, compiler identity and options), and holds
+ * the key itself and the output file. A lookup compares the stored key with
+ * the requested one, so a hash collision is a miss, never a wrong output.
+ *
+ * Entries are written to a temporary file and renamed into place, so
+ * several compilers may share a directory. A hit marks its entry as used
+ * by updating its modification time; when a store makes the directory
+ * larger than its bound, the least recently used entries are removed. The
+ * hit and miss counters are kept in the directory across runs; updates
+ * take a lock file, so concurrent compilers do not lose counts.
+ */
+class CompileCache {
+public:
+    /**
+     * @brief Open a cache directory, creating it if needed
+     *
+     * @param directory Directory holding the entries
+     * @param maxBytes Bound on the total size of the entries
+     * @throws std::runtime_error if the directory cannot be created
+     */
+    CompileCache(const std::string& directory, uint64_t maxBytes = DEFAULT_CACHE_BYTES);
+
+    /**
+     * @brief Copy the cached output of a compilation to a file
+     *
+     * @param key Description of the compilation
+     * @param outputFile Path to write the output to
+     * @return true on a hit (the output is written), false on a miss
+     */
+    bool lookup(const std::string& key, const std::string& outputFile);
+
+    /**
+     * @brief Store the output of a compilation, then evict down to the bound
+     *
+     * @param key Description of the compilation
+     * @param outputFile Path of the output just written
+     * @return true if the entry was stored
+     */
+    bool store(const std::string& key, const std::string& outputFile);
+
+    /**
+     * @brief Get the hit and miss counters and the current contents
+     */
+    CacheStats getStats() const;
+
+    /**
+     * @brief Get the cache directory
+     */
+    const std::string& getDirectory() const { return directory_; }
+
+    /**
+     * @brief Get the bound on the total size of the entries
+     */
+    uint64_t getMaxBytes() const { return maxBytes_; }
+
+    /**
+     * @brief Get the name of the entry file of a key
+     *
+     * @param key Description of the compilation
+     * @return 64-bit FNV-1a hash of the key in hexadecimal
+     */
+    static std::string entryName(const std::string& key);
+
+    /**
+     * @brief Normalize source text for use in a key
+     *
+     * The parser does not depend on line breaks or on the amount of
+     * whitespace between tokens, so each run of whitespace becomes one space
+     * and leading and trailing whitespace is dropped.
+     *
+     * @param source Source text
+     * @return Normalized text
+     */
+    static std::string normalizeSource(const std::string& source);
+
+private:
+    std::string directory_;
+    uint64_t maxBytes_;
+
+    /**
+     * @brief Add to the hit or miss counter kept in the directory
+     *
+     * The counters are updated under an exclusive lock on a lock file and
+     * replaced by rename, so getStats() never reads a partial update.
+     *
+     * @param hit Whether the lookup was a hit
+     */
+    void count(bool hit);
+
+    /**
+     * @brief Remove least recently used entries until the bound is met
+     */
+    void evict();
+};
+
+} // namespace Utils
+
+#endif // UTILS_COMPILE_CACHE_H
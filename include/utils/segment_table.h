@@ -0,0 +1,58 @@
+#ifndef UTILS_SEGMENT_TABLE_H
+#define UTILS_SEGMENT_TABLE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "../pim_isa/packed_program.h"
+
+namespace Utils {
+
+// Suffix of the segment table kept next to an output file
+constexpr const char* SEGMENT_TABLE_SUFFIX = ".segments";
+
+/**
+ * @brief Optimized instructions of each loop nest of a build, kept next to its output
+ *
+ * Incremental builds read the table of the previous build and reuse the
+ * segment of every loop nest whose fingerprint is unchanged. The compiler
+ * identity, options and memory layout it was built with are stored too:
+ * segments hold absolute addresses, so they are only valid while all three
+ * stay the same.
+ */
+struct SegmentTable {
+    std::string compiler;   // Compiler build that generated the segments
+    std::string options;    // Options that change the generated program
+    std::string layout;     // Placement of every matrix in memory
+
+    // Fingerprint and optimized instructions of each loop nest, in program order
+    std::vector<std::pair<std::string, PIM_ISA::PackedProgram>> segments;
+
+    /**
+     * @brief Read a table written by save()
+     *
+     * @param path Table file
+     * @return true if the file exists and is complete
+     */
+    bool load(const std::string& path);
+
+    /**
+     * @brief Write the table, replacing the file atomically
+     *
+     * @param path Table file
+     * @return true if the table was written
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * @brief Get the path of the table kept next to an output file
+     *
+     * @param outputFile Output of the build
+     * @return outputFile followed by SEGMENT_TABLE_SUFFIX
+     */
+    static std::string pathFor(const std::string& outputFile) { return outputFile + SEGMENT_TABLE_SUFFIX; }
+};
+
+} // namespace Utils
+
+#endif // UTILS_SEGMENT_TABLE_H
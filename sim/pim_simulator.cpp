@@ -5,6 +5,11 @@
 #include <sstream>
 #include <chrono>
 #include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include "../include/pim_isa/instruction_sink.h"
+#include "../include/pim_isa/object_file.h"
 
 // pPIM architecture constants
 constexpr int PROG_CYCLES = 10;      // Cycles for PROG instruction
@@ -23,6 +28,41 @@ enum class InstructionType {
     UNKNOWN
 };
 
+// Cycle counts of one simulated program
+struct SimulationResult {
+    std::string filename;
+    uint64_t totalCycles;
+    uint64_t parallelCycles;  // 0 for assembly text
+};
+
+// Print the products per second of a run on parallel cores and banks (nothing if it computes none)
+void printThroughput(uint64_t products, const char* source, double parallelTimeUs) {
+    if (products == 0 || parallelTimeUs <= 0.0) {
+        return;
+    }
+    std::cout << "Throughput: " << std::fixed << std::setprecision(0)
+              << static_cast<double>(products) / parallelTimeUs * 1e6 << " products per second ("
+              << products << " products, " << source << ")" << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+// Count the products of a batched program: the items of its largest batch,
+// listed in the matrix table as A[0], A[1], ... (0 without batches)
+uint64_t batchProducts(const std::vector<PIM_ISA::ObjectMatrix>& matrices) {
+    std::map<std::string, uint64_t> items;
+    for (const auto& matrix : matrices) {
+        size_t open = matrix.name.find('[');
+        if (open != std::string::npos && open > 0 && matrix.name.back() == ']') {
+            items[matrix.name.substr(0, open)]++;
+        }
+    }
+    uint64_t products = 0;
+    for (const auto& batch : items) {
+        products = std::max(products, batch.second);
+    }
+    return products;
+}
+
 // Instruction representation
 struct Instruction {
     InstructionType type;
@@ -76,7 +116,8 @@ std::vector<Instruction> parseAssembly(const std::string& filename) {
 }
 
 // Simulate execution of the pPIM assembly
-void simulateExecution(const std::vector<Instruction>& instructions, const std::string& filename) {
+SimulationResult simulateExecution(const std::vector<Instruction>& instructions, const std::string& filename,
+                                   uint64_t products) {
     // Count instructions by type
     int progCount = 0;
     int readCount = 0;
@@ -102,7 +143,8 @@ void simulateExecution(const std::vector<Instruction>& instructions, const std::
     // Calculate execution time in microseconds
     double executionTimeUs = static_cast<double>(totalCycles) / CLOCK_RATE_MHZ;
     
-    // Estimate parallel execution time (assuming 20% cycle reduction due to bank parallelism)
+    // Estimate parallel execution time (assuming 20% cycle reduction due to bank parallelism);
+    // the assembly text omits read and core pointers, so object files get the full model
     double parallelTimeUs = executionTimeUs * 0.8;
     
     // Output results
@@ -117,30 +159,149 @@ void simulateExecution(const std::vector<Instruction>& instructions, const std::
     std::cout << "Total cycles: " << totalCycles << std::endl;
     std::cout << "Sequential execution time: " << executionTimeUs << " microseconds" << std::endl;
     std::cout << "Parallel execution time: " << parallelTimeUs << " microseconds" << std::endl;
+    if (products > 0) {
+        std::cout << "Throughput: needs an object file (-fbinary) for the parallel model" << std::endl;
+    }
+    std::cout << std::endl;
+    
+    return {filename, static_cast<uint64_t>(totalCycles), 0};
+}
+
+// Check whether a file starts with the .pbin magic
+bool isObjectFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(PIM_ISA::OBJECT_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, PIM_ISA::OBJECT_MAGIC, sizeof(magic)) == 0;
+}
+
+// Simulate a binary object file on parallel cores and banks
+//
+// Unlike the assembly text, the object file keeps the read pointer of every
+// Read and the core of every Write, so operand dependencies can be tracked.
+SimulationResult simulateObjectFile(const std::string& filename, uint64_t products) {
+    PIM_ISA::ObjectFile object(filename);
+    PIM_ISA::SimulationSink sequential;
+    PIM_ISA::ParallelSimulationSink parallel;
+    PIM_ISA::TeeSink simulation(sequential, parallel);
+    object.replay(simulation);
+    
+    const auto& counts = sequential.counts();
+    double sequentialTimeUs = static_cast<double>(sequential.totalCycles()) / CLOCK_RATE_MHZ;
+    double parallelTimeUs = static_cast<double>(parallel.totalCycles()) / CLOCK_RATE_MHZ;
+    
+    std::cout << "=== pPIM Simulation for " << filename << " ===" << std::endl;
+    std::cout << "Total instructions: " << counts.total() << std::endl;
+    std::cout << "  PROG instructions: " << counts.prog << std::endl;
+    std::cout << "  READ instructions: " << counts.read << std::endl;
+    std::cout << "  WRITE instructions: " << counts.write << std::endl;
+    std::cout << "  COMPUTE instructions: " << counts.compute << std::endl;
+    std::cout << std::endl;
+    
+    std::cout << "Total cycles: " << sequential.totalCycles() << std::endl;
+    std::cout << "Parallel cycles: " << parallel.totalCycles() << std::endl;
+    std::cout << "Critical path cycles: " << parallel.criticalPathCycles() << std::endl;
+    if (parallel.bundles() > 0) {
+        std::cout << "Bundles: " << parallel.bundles() << std::endl;
+    }
+    std::cout << "Compute cores used: " << parallel.computeCoresUsed() << std::endl;
+    std::cout << "Average busy compute cores: " << std::fixed << std::setprecision(2)
+              << static_cast<double>(parallel.computeCycles()) / std::max<uint64_t>(1, parallel.totalCycles())
+              << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+    std::cout << "Sequential execution time: " << sequentialTimeUs << " microseconds" << std::endl;
+    std::cout << "Parallel execution time: " << parallelTimeUs << " microseconds" << std::endl;
+    if (products > 0) {
+        printThroughput(products, "given", parallelTimeUs);
+    } else {
+        printThroughput(batchProducts(object.matrices()), "items of the largest batch", parallelTimeUs);
+    }
+    std::cout << std::endl;
+    
+    return {filename, sequential.totalCycles(), parallel.totalCycles()};
+}
+
+// Format the change from a baseline cycle count
+std::string describeChange(uint64_t baseline, uint64_t cycles) {
+    std::ostringstream text;
+    text << cycles << " (";
+    if (cycles <= baseline) {
+        text << baseline - cycles << " fewer";
+    } else {
+        text << cycles - baseline << " more";
+    }
+    text << ", " << std::fixed << std::setprecision(2)
+         << static_cast<double>(baseline) / std::max<uint64_t>(1, cycles) << "x speedup)";
+    return text.str();
+}
+
+// Compare the cycles of every program with the first one (e.g. a dense and a sparse build)
+void printComparison(const std::vector<SimulationResult>& results) {
+    const SimulationResult& baseline = results.front();
+    std::cout << "=== Cycles relative to " << baseline.filename << " ===" << std::endl;
+    for (size_t i = 1; i < results.size(); ++i) {
+        const SimulationResult& result = results[i];
+        std::cout << result.filename << ":" << std::endl;
+        std::cout << "  Total cycles: " << describeChange(baseline.totalCycles, result.totalCycles) << std::endl;
+        if (baseline.parallelCycles > 0 && result.parallelCycles > 0) {
+            std::cout << "  Parallel cycles: " << describeChange(baseline.parallelCycles, result.parallelCycles)
+                      << std::endl;
+        }
+    }
     std::cout << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     std::vector<std::string> filesToProcess;
     
+    // --products=<n>: the matrix products each program computes, to report
+    // throughput in products per second; by default an object file's
+    // largest batch gives the count
+    uint64_t products = 0;
+    
     if (argc > 1) {
         // Process files specified on command line
         for (int i = 1; i < argc; ++i) {
-            filesToProcess.push_back(argv[i]);
+            std::string arg = argv[i];
+            if (arg.rfind("--products=", 0) == 0) {
+                std::string count = arg.substr(std::strlen("--products="));
+                if (count.empty() || count.size() > 18 || count.find_first_not_of("0123456789") != std::string::npos) {
+                    std::cerr << "Error: Invalid product count " << count << std::endl;
+                    return 1;
+                }
+                products = std::stoull(count);
+                continue;
+            }
+            filesToProcess.push_back(arg);
         }
-    } else {
+    }
+    if (filesToProcess.empty()) {
         // Default files if none specified
         filesToProcess.push_back("real_output.asm");
         filesToProcess.push_back("complex_output.asm");
     }
     
     // Process each assembly file
+    std::vector<SimulationResult> results;
     for (const auto& file : filesToProcess) {
+        if (isObjectFile(file)) {
+            try {
+                results.push_back(simulateObjectFile(file, products));
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+            }
+            continue;
+        }
+        
         auto instructions = parseAssembly(file);
         if (!instructions.empty()) {
-            simulateExecution(instructions, file);
+            results.push_back(simulateExecution(instructions, file, products));
         }
     }
     
+    if (results.size() > 1) {
+        printComparison(results);
+    }
+    
     return 0;
 } 
\ No newline at end of file
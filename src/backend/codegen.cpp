@@ -5,43 +5,187 @@
 #include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 namespace Backend {
 
+namespace {
+
+// Approximate number of instructions generated per tile in parallel mode
+constexpr uint64_t TARGET_TILE_INSTRUCTIONS = 1 << 16;
+
+// Tiles handed to each thread per round; bounds the buffered instructions
+constexpr uint64_t TILES_PER_THREAD_ROUND = 8;
+
+// Core assignments:
+// Core 0: Multiplier (for partial products)
+// Core 1: Adder (for accumulation)
+// Core 2: MAC (for combining multiply and accumulate)
+constexpr uint8_t MULTIPLIER_CORE = 0;
+constexpr uint8_t ADDER_CORE = 1;
+constexpr uint8_t MAC_CORE = 2;
+
+// First core available to kernels (e.g. as tile accumulators)
+constexpr uint8_t FIRST_ALLOCATABLE_CORE = 3;
+
+// Marks a core that has not been programmed yet
+constexpr int UNPROGRAMMED = -1;
+
+// Row address of element (row, col) of a matrix as a loop-nest address
+IR::Address elementAddress(const MemoryMap::MatrixHandle& handle,
+                           const IR::AffineExpr& row, const IR::AffineExpr& col) {
+    IR::Address address;
+    address.baseAddress = handle.baseAddress;
+    address.offset.add(IR::AffineExpr::value(handle.offset), 1).add(row, handle.rowStride).add(col, handle.colStride);
+    return address;
+}
+
+// Row address of element (row, col) of an item of a batch as a loop-nest address
+IR::Address itemElementAddress(const MemoryMap::MatrixHandle& handle, const IR::AffineExpr& item,
+                               const IR::AffineExpr& row, const IR::AffineExpr& col) {
+    IR::Address address = elementAddress(handle, row, col);
+    address.offset.add(item, handle.batchStride);
+    return address;
+}
+
+} // namespace
+
 // Constructor
 CodeGenerator::CodeGenerator(std::shared_ptr<MemoryMap::MemoryMapper> memoryMapper)
     : memoryMapper_(memoryMapper) {
 }
 
 // Generate instructions from parsed matrices and operations
-std::vector<PIM_ISA::Instruction> CodeGenerator::generateInstructions(
+PIM_ISA::PackedProgram CodeGenerator::generateInstructions(
     const std::vector<Frontend::MatrixInfo>& matrices,
     const std::vector<Frontend::MatrixOperation>& operations) {
     
-    std::vector<PIM_ISA::Instruction> instructions;
+    PIM_ISA::PackedProgram program;
+    PIM_ISA::PackedProgramSink sink(program);
+    generateInstructions(matrices, operations, sink);
+    return program;
+}
+
+// Generate instructions and stream them into a sink
+void CodeGenerator::generateInstructions(
+    const std::vector<Frontend::MatrixInfo>& matrices,
+    const std::vector<Frontend::MatrixOperation>& operations,
+    PIM_ISA::InstructionSink& sink) {
+    
+    emitInstructions(buildLoopNests(matrices, operations), sink);
+}
+
+// Map matrices to memory and build a loop nest for each operation
+std::vector<IR::Kernel> CodeGenerator::buildLoopNests(
+    const std::vector<Frontend::MatrixInfo>& matrices,
+    const std::vector<Frontend::MatrixOperation>& operations) {
     
     // Map matrices to memory
     for (const auto& matrix : matrices) {
+        if (!matrix.aliasOf.empty()) {
+            continue;
+        }
+        
         MemoryMap::MatrixDimensions dimensions(matrix.rows, matrix.cols);
-        memoryMapper_->mapMatrix(matrix.name, dimensions);
+        if (matrix.nonzeros) {
+            memoryMapper_->mapSparseMatrix(matrix.name, dimensions, *matrix.nonzeros);
+        } else if (matrix.batch > 0) {
+            memoryMapper_->mapBatch(matrix.name, dimensions, matrix.batch);
+        } else {
+            memoryMapper_->mapMatrix(matrix.name, dimensions);
+        }
         
         if (verbose_) {
-            std::cout << "Mapped matrix " << matrix.name << " (" 
-                     << matrix.rows << "x" << matrix.cols << ") to memory" << std::endl;
+            std::cout << "Mapped " << (matrix.nonzeros ? "sparse matrix " : matrix.batch > 0 ? "batch " : "matrix ")
+                     << matrix.name << " (";
+            if (matrix.batch > 0) {
+                std::cout << matrix.batch << " x ";
+            }
+            std::cout << matrix.rows << "x" << matrix.cols;
+            if (matrix.nonzeros) {
+                std::cout << ", " << matrix.nonzeros->size() << " nonzeros";
+            }
+            std::cout << ") to memory" << std::endl;
             
             auto range = memoryMapper_->getMatrixAddressRange(matrix.name);
             std::cout << "  Address range: " << range.startAddress << " - " << range.endAddress << std::endl;
         }
     }
     
-    // Generate initialization instructions for LUT cores
-    generateInitInstructions(instructions);
+    // Matrices holding the same values as another, its transpose or a block
+    // of it share its storage; map each once the matrix it refers to is mapped
+    std::vector<const Frontend::MatrixInfo*> aliases;
+    for (const auto& matrix : matrices) {
+        if (!matrix.aliasOf.empty()) {
+            aliases.push_back(&matrix);
+        }
+    }
+    while (!aliases.empty()) {
+        size_t remaining = 0;
+        for (const Frontend::MatrixInfo* matrix : aliases) {
+            if (!memoryMapper_->isMatrixMapped(matrix->aliasOf)) {
+                aliases[remaining++] = matrix;
+                continue;
+            }
+            
+            if (matrix->transposed) {
+                memoryMapper_->mapTransposedView(matrix->name, matrix->aliasOf);
+            } else if (matrix->block) {
+                memoryMapper_->mapBlockView(matrix->name, matrix->aliasOf, matrix->blockRow, matrix->blockCol,
+                                            MemoryMap::MatrixDimensions(matrix->rows, matrix->cols));
+            } else {
+                memoryMapper_->mapAlias(matrix->name, matrix->aliasOf);
+            }
+            
+            if (verbose_) {
+                std::cout << "Mapped matrix " << matrix->name << " (" 
+                         << matrix->rows << "x" << matrix->cols << ") onto "
+                         << (matrix->transposed ? "the transpose of " : matrix->block ? "a block of " : "")
+                         << matrix->aliasOf << std::endl;
+            }
+        }
+        if (remaining == aliases.size()) {
+            throw std::runtime_error("Matrix '" + aliases.front()->name + "' refers to unknown matrix '" +
+                                    aliases.front()->aliasOf + "'");
+        }
+        aliases.resize(remaining);
+    }
     
-    // Generate instructions for each operation
+    // Build a loop nest for each operation, after the LUT core initialization
+    std::vector<IR::Kernel> kernels;
+    kernels.push_back(buildInitKernel());
     for (const auto& op : operations) {
+        // Sparse matrices are only read as the left operand of a product
+        for (size_t n = op.type == Frontend::OperationType::MULTIPLY ? 1 : 0; n < op.inputs.size(); ++n) {
+            if (memoryMapper_->getSparseLayout(op.inputs[n]) != nullptr) {
+                throw std::runtime_error("Sparse matrix '" + op.inputs[n] + "' is used in " + op.output +
+                                        " other than as the left operand of a product");
+            }
+        }
+        
         switch (op.type) {
             case Frontend::OperationType::MULTIPLY:
-                generateMatrixMultiplyInstructions(op, instructions);
+                kernels.push_back(buildMatrixMultiplyKernel(op));
+                break;
+                
+            case Frontend::OperationType::ADD:
+            case Frontend::OperationType::SUBTRACT:
+                kernels.push_back(buildElementwiseKernel(op));
+                break;
+                
+            case Frontend::OperationType::TRANSPOSE:
+                kernels.push_back(buildTransposeKernel(op));
+                break;
+                
+            case Frontend::OperationType::SCALE_ROWS:
+            case Frontend::OperationType::SCALE_COLUMNS:
+                kernels.push_back(buildScaleKernel(op));
+                break;
+                
+            case Frontend::OperationType::BATCH_MULTIPLY:
+                kernels.push_back(buildBatchMultiplyKernel(op));
                 break;
                 
             // Add other operation types here
@@ -52,31 +196,124 @@ std::vector<PIM_ISA::Instruction> CodeGenerator::generateInstructions(
         }
     }
     
+    // Declare the fixed cores each nest computes on, and split the computes
+    // of wide operands into 4-bit LUT lookups
+    uint32_t slices = precision_ / PIM_ISA::LUT_OPERAND_BITS;
+    for (auto& kernel : kernels) {
+        declareFixedCores(kernel);
+        size_t sliced = IR::sliceComputeNodes(kernel, slices);
+        if (verbose_ && sliced > 0) {
+            std::cout << "Bit-sliced " << sliced << " compute(s) of " << kernel.name << " into "
+                     << slices << " nibbles per " << precision_ << "-bit operand" << std::endl;
+        }
+    }
+    
+    return kernels;
+}
+
+// Lower loop nests into a complete instruction stream
+void CodeGenerator::emitInstructions(const std::vector<IR::Kernel>& kernels, PIM_ISA::InstructionSink& sink) {
+    // Operation currently programmed into each core
+    std::vector<int> coreOps = initialCoreState();
+    
+    for (const auto& kernel : kernels) {
+        emitKernel(kernel, coreOps, sink);
+    }
+    
     // Add termination instruction
-    instructions.push_back(PIM_ISA::createEndInstruction());
+    sink.emit(PIM_ISA::createEndInstruction());
+}
+
+// Lower one loop nest, programming the cores it needs first
+void CodeGenerator::emitKernel(const IR::Kernel& kernel, std::vector<int>& coreOps, PIM_ISA::InstructionSink& sink) {
+    generateKernelSetup(kernel, coreOps, sink);
     
-    return instructions;
+    // Expand the nest; large loops are split across threads
+    for (size_t index = 0; index < kernel.body.size(); ++index) {
+        const IR::Node& node = kernel.body[index];
+        if (threads_ > 1 && node.kind == IR::NodeKind::LOOP && node.tripCount() > 1) {
+            lowerLoopParallel(kernel, index, sink);
+        } else {
+            IR::lowerTopLevelNode(kernel, index, sink);
+        }
+    }
+}
+
+// Get the core state before the first loop nest
+std::vector<int> CodeGenerator::initialCoreState() {
+    return std::vector<int>(PIM_ISA::NUM_CORES, UNPROGRAMMED);
 }
 
 // Write generated instructions to an output file
-bool CodeGenerator::writeToFile(const std::vector<PIM_ISA::Instruction>& instructions, const std::string& outputFile) {
+bool CodeGenerator::writeToFile(const PIM_ISA::PackedProgram& program, const std::string& outputFile) {
     std::ofstream file(outputFile);
     if (!file.is_open()) {
         std::cerr << "Error: Could not open output file " << outputFile << std::endl;
         return false;
     }
     
-    // Write header
-    file << "// pPIM Assembly generated by pPIM Compiler" << std::endl;
-    file << "// Format: <Instruction> <Parameters>" << std::endl;
-    file << std::endl;
-    
-    // Write instructions
-    for (const auto& instruction : instructions) {
-        file << instruction.toString() << std::endl;
+    return writeAssembly(program, file);
+}
+
+// Write generated instructions to a binary object file (.pbin)
+bool CodeGenerator::writeBinaryFile(const PIM_ISA::PackedProgram& program, const std::string& outputFile) {
+    std::ofstream file(outputFile, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open output file " << outputFile << std::endl;
+        return false;
     }
     
-    return true;
+    return writeBinary(program, file);
+}
+
+// Write generated instructions as assembly text to a stream
+bool CodeGenerator::writeAssembly(const PIM_ISA::PackedProgram& program, std::ostream& out) {
+    // Write header and instructions
+    return PIM_ISA::writeAssembly(program, out, threads_);
+}
+
+// Write generated instructions as a binary object to a stream
+bool CodeGenerator::writeBinary(const PIM_ISA::PackedProgram& program, std::ostream& out) {
+    return PIM_ISA::writeObjectFile(program, getMatrixTable(), out);
+}
+
+// Get the object file matrix table for the current memory map
+std::vector<PIM_ISA::ObjectMatrix> CodeGenerator::getMatrixTable() const {
+    std::vector<PIM_ISA::ObjectMatrix> table;
+    for (const auto& name : memoryMapper_->getMatrixNames()) {
+        // Views hold no data of their own and are not laid out row-major
+        if (memoryMapper_->isView(name)) {
+            continue;
+        }
+        
+        PIM_ISA::ObjectMatrix entry;
+        entry.name = name;
+        
+        auto dimensions = memoryMapper_->getMatrixDimensions(name);
+        entry.rows = dimensions.rows;
+        entry.cols = dimensions.cols;
+        
+        auto range = memoryMapper_->getMatrixAddressRange(name);
+        entry.startAddress = range.startAddress;
+        entry.endAddress = range.endAddress;
+        
+        // Each item of a batch is a matrix of its own to the loader
+        uint32_t batch = memoryMapper_->getBatchSize(name);
+        uint32_t itemSize = (range.endAddress - range.startAddress + 1) / std::max<uint32_t>(batch, 1);
+        for (uint32_t item = 0; item < batch; ++item) {
+            PIM_ISA::ObjectMatrix itemEntry = entry;
+            itemEntry.name = name + "[" + std::to_string(item) + "]";
+            itemEntry.startAddress = static_cast<uint16_t>(range.startAddress + item * itemSize);
+            itemEntry.endAddress = static_cast<uint16_t>(itemEntry.startAddress + itemSize - 1);
+            table.push_back(itemEntry);
+        }
+        if (batch > 0) {
+            continue;
+        }
+        
+        table.push_back(entry);
+    }
+    return table;
 }
 
 // Set verbose mode
@@ -84,24 +321,57 @@ void CodeGenerator::setVerbose(bool verbose) {
     verbose_ = verbose;
 }
 
-// Generate instructions for matrix multiplication
-void CodeGenerator::generateMatrixMultiplyInstructions(
-    const Frontend::MatrixOperation& op,
-    std::vector<PIM_ISA::Instruction>& instructions) {
+// Set the number of code generation threads
+void CodeGenerator::setThreads(unsigned threads) {
+    threads_ = std::max(1u, threads);
+}
+
+// Set the operand width of the generated code
+bool CodeGenerator::setPrecision(uint32_t bits) {
+    if (bits != 4 && bits != 8 && bits != 16) {
+        std::cerr << "Error: Unsupported precision " << bits << " (expected 4, 8 or 16 bits)" << std::endl;
+        return false;
+    }
+    precision_ = bits;
+    memoryMapper_->setElementWidth(bits / PIM_ISA::LUT_OPERAND_BITS);
+    return true;
+}
+
+// Build the loop nest for a matrix multiplication
+IR::Kernel CodeGenerator::buildMatrixMultiplyKernel(const Frontend::MatrixOperation& op) {
     
-    if (op.inputs.size() != 2) {
-        throw std::runtime_error("Matrix multiplication requires exactly 2 input matrices");
+    if (op.inputs.size() != 2 && op.inputs.size() != 4) {
+        throw std::runtime_error("Matrix multiplication requires 2 input matrices (4 with a fused bias)");
     }
     
     const std::string& matrixA = op.inputs[0];
     const std::string& matrixB = op.inputs[1];
     const std::string& matrixC = op.output;
+    bool fused = op.inputs.size() == 4;
+    
+    // Resolve the operands once; the loop nest refers to them by address only
+    const MemoryMap::SparseLayout* sparseA = memoryMapper_->getSparseLayout(matrixA);
+    MemoryMap::MatrixHandle handleA;
+    if (sparseA != nullptr) {
+        handleA.rows = sparseA->rows;
+        handleA.cols = sparseA->cols;
+    } else {
+        handleA = memoryMapper_->resolveMatrix(matrixA);
+    }
+    MemoryMap::MatrixHandle handleB = memoryMapper_->resolveMatrix(matrixB);
+    MemoryMap::MatrixHandle handleC = memoryMapper_->resolveMatrix(matrixC);
+    MemoryMap::MatrixHandle handleBias;
+    MemoryMap::MatrixHandle handleScale;
+    if (fused) {
+        handleBias = memoryMapper_->resolveMatrix(op.inputs[2]);
+        handleScale = memoryMapper_->resolveMatrix(op.inputs[3]);
+    }
     
     // Get matrix dimensions
-    uint32_t rowsA = memoryMapper_->getMatrixDimensions(matrixA).rows;
-    uint32_t colsA = memoryMapper_->getMatrixDimensions(matrixA).cols;
-    uint32_t rowsB = memoryMapper_->getMatrixDimensions(matrixB).rows;
-    uint32_t colsB = memoryMapper_->getMatrixDimensions(matrixB).cols;
+    uint32_t rowsA = handleA.rows;
+    uint32_t colsA = handleA.cols;
+    uint32_t rowsB = handleB.rows;
+    uint32_t colsB = handleB.cols;
     
     // Verify dimensions
     if (colsA != rowsB) {
@@ -114,122 +384,1049 @@ void CodeGenerator::generateMatrixMultiplyInstructions(
     uint32_t rowsC = rowsA;
     uint32_t colsC = colsB;
     
+    // Every element of the product must have a place in C
+    if (handleC.rows < rowsC || handleC.cols < colsC) {
+        throw std::out_of_range("Result matrix " + matrixC + " is too small for " +
+                               matrixA + " * " + matrixB);
+    }
+    
+    // A fused bias has the shape of the product and a 1x1 scale
+    if (fused && (handleBias.rows != rowsC || handleBias.cols != colsC ||
+                  handleScale.rows != 1 || handleScale.cols != 1)) {
+        throw std::runtime_error("Invalid bias " + op.inputs[2] + " for " + matrixA + " * " + matrixB);
+    }
+    
     if (verbose_) {
-        std::cout << "Generating instructions for matrix multiplication: " 
+        std::cout << "Building loop nest for matrix multiplication: " 
                  << matrixC << " = " << matrixA << " * " << matrixB << std::endl;
         std::cout << "  Dimensions: (" << rowsA << "x" << colsA << ") * (" 
                  << rowsB << "x" << colsB << ") = (" << rowsC << "x" << colsC << ")" << std::endl;
     }
     
+    std::string name = matrixC + " = " + matrixA + " * " + matrixB;
+    if (fused) {
+        name += " + " + op.inputs[3] + " * " + op.inputs[2];
+    }
+    
+    // Zero-skipping code generation for a sparse A
+    if (sparseA != nullptr) {
+        return buildSparseMatrixMultiplyKernel(name, *sparseA, handleB, handleC, op.tileRows, op.tileCols,
+                                               fused ? &handleBias : nullptr, fused ? &handleScale : nullptr);
+    }
+    
+    // Blocked code generation when the optimizer chose a tiling
+    if (op.tileRows > 0 && op.tileCols > 0) {
+        return buildTiledMatrixMultiplyKernel(name, handleA, handleB, handleC, op.tileRows, op.tileCols,
+                                              fused ? &handleBias : nullptr, fused ? &handleScale : nullptr);
+    }
+    
     // Implementation of matrix multiplication for the pPIM architecture
     // We'll use a simple algorithm that iterates through all elements of C
     // and computes the dot product of the corresponding row in A and column in B
     
     // For matrix multiplication C = A * B:
     // C[i,j] = Σ(k=0 to n-1) A[i,k] * B[k,j]
+    //
+    // for i in [0, rowsC)
+    //   for j in [0, colsC)
+    //     read A[i,0]; read B[0,j]; multiply          (k = 0 peeled)
+    //     for k in [1, colsA)
+    //       read A[i,k]; read B[k,j]; multiply-accumulate
+    //     write C[i,j]
+    //
+    // With a fused bias D scaled by k, the accumulator starts from k·D[i,j]:
+    //
+    //     read D[i,j]; read k; multiply-accumulate
+    //     for k in [0, colsA)
+    //       read A[i,k]; read B[k,j]; multiply-accumulate
+    //
+    // When B is a transposed view, column j of B is stored as one row, so
+    // B[k,j] is read once before the k loop and only A is read per k.
+    bool hoistB = handleB.rowStride == 0;
     
-    // Core assignments:
-    // Core 0: Multiplier (for partial products)
-    // Core 1: Adder (for accumulation)
-    // Core 2: MAC (for combining multiply and accumulate)
+    IR::Kernel kernel;
+    kernel.name = name;
+    IR::LoopId i = kernel.newLoop();
+    IR::LoopId j = kernel.newLoop();
+    IR::LoopId k = kernel.newLoop();
     
-    // Constants for core indices
-    constexpr uint8_t MULTIPLIER_CORE = 0;
-    constexpr uint8_t ADDER_CORE = 1;
-    constexpr uint8_t MAC_CORE = 2;
+    const IR::AffineExpr rowIndex = IR::AffineExpr::index(i);
+    const IR::AffineExpr colIndex = IR::AffineExpr::index(j);
+    const IR::AffineExpr sumIndex = IR::AffineExpr::index(k);
+    const IR::AffineExpr firstIndex = IR::AffineExpr::value(0);
     
-    // We need a nested loop structure to compute each element of C
-    for (uint32_t i = 0; i < rowsC; ++i) {
-        for (uint32_t j = 0; j < colsC; ++j) {
-            // Compute C[i,j] = Σ(k=0 to colsA-1) A[i,k] * B[k,j]
-            
-            // For each element in C, we need to:
-            // 1. Initialize an accumulator to 0
-            // 2. For each k, load A[i,k] and B[k,j]
-            // 3. Multiply them and add to accumulator
-            // 4. Store the final result to C[i,j]
+    std::vector<IR::Node> elementBody;
+    uint32_t firstMac = 1;
+    if (fused) {
+        // Seed the accumulator with the scaled bias; every product accumulates
+        elementBody.push_back(IR::Node::makeLoad(0, elementAddress(handleBias, rowIndex, colIndex)));
+        elementBody.push_back(IR::Node::makeLoad(1, elementAddress(handleScale, firstIndex, firstIndex)));
+        elementBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, MAC_CORE));
+        firstMac = 0;
+    }
+    if (hoistB && colsA > 0) {
+        elementBody.push_back(IR::Node::makeLoad(1, elementAddress(handleB, firstIndex, colIndex)));
+    }
+    if (!fused && colsA > 0) {
+        // First iteration: multiply only (no accumulation yet)
+        elementBody.push_back(IR::Node::makeLoad(0, elementAddress(handleA, rowIndex, firstIndex)));
+        if (!hoistB) {
+            elementBody.push_back(IR::Node::makeLoad(1, elementAddress(handleB, firstIndex, colIndex)));
+        }
+        elementBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MULTIPLY, MULTIPLIER_CORE));
+    }
+    
+    if (colsA > firstMac) {
+        // Subsequent iterations: multiply and accumulate
+        std::vector<IR::Node> macBody;
+        macBody.push_back(IR::Node::makeLoad(0, elementAddress(handleA, rowIndex, sumIndex)));
+        if (!hoistB) {
+            macBody.push_back(IR::Node::makeLoad(1, elementAddress(handleB, sumIndex, colIndex)));
+        }
+        macBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, MAC_CORE));
+        elementBody.push_back(IR::Node::makeLoop(k, firstMac, colsA, std::move(macBody)));
+    }
+    
+    // Store result to C[i,j] (write operation)
+    elementBody.push_back(IR::Node::makeStore(2, elementAddress(handleC, rowIndex, colIndex)));
+    
+    std::vector<IR::Node> rowBody;
+    rowBody.push_back(IR::Node::makeLoop(j, 0, colsC, std::move(elementBody)));
+    kernel.body.push_back(IR::Node::makeLoop(i, 0, rowsC, std::move(rowBody)));
+    
+    if (verbose_) {
+        std::cout << "  Loop nest: " << kernel.nodeCount() << " nodes for "
+                 << kernel.instructionCount() << " instructions" << std::endl;
+    }
+    
+    return kernel;
+}
+
+// Build the blocked loop nest for a matrix multiplication
+IR::Kernel CodeGenerator::buildTiledMatrixMultiplyKernel(const std::string& name,
+                                                         const MemoryMap::MatrixHandle& a,
+                                                         const MemoryMap::MatrixHandle& b,
+                                                         const MemoryMap::MatrixHandle& c,
+                                                         uint32_t tileRows, uint32_t tileCols,
+                                                         const MemoryMap::MatrixHandle* bias,
+                                                         const MemoryMap::MatrixHandle* scale) const {
+    // Operand slots: rows of A first, columns of B after them; operands whose
+    // row address is the same for every iteration share one slot and load.
+    // Accumulators: one MAC core per element of the tile.
+    if (tileRows == 0 || tileCols == 0 ||
+        FIRST_ALLOCATABLE_CORE + tileRows * tileCols > PIM_ISA::NUM_CORES) {
+        throw std::runtime_error("Tile size " + std::to_string(tileRows) + "x" + std::to_string(tileCols) +
+                                " exceeds the available cores");
+    }
+    
+    // For each tile of C with top-left element (i, j):
+    //
+    // for k in [0, colsA)
+    //   read A[i+r,k] into slot slotA(r)             (r < tileRows)
+    //   read B[k,j+c] into slot slotB(c)             (c < tileCols)
+    //   multiply-accumulate slot slotA(r) * slot slotB(c) on core (r, c)
+    // write C[i+r,j+c] from core (r, c)              (writing clears the accumulator)
+    //
+    // A fused bias D scaled by k seeds each accumulator before the k loop:
+    // read k into slot 1, then per element read D[i+r,j+c] into slot 0 and
+    // multiply-accumulate on core (r, c).
+    //
+    // When B is a transposed view, its columns are stored as rows and
+    // B[k,j+c] is the same row for every k: it is read once per tile, after
+    // the bias, and the k loop reads only A.
+    //
+    // Tiles at the right and bottom edges are smaller; the matrix is split into
+    // up to four regions with a fixed tile size each.
+    uint32_t rows = a.rows;
+    uint32_t cols = b.cols;
+    uint32_t depth = a.cols;
+    
+    IR::Kernel kernel;
+    kernel.name = name;
+    IR::LoopId i = kernel.newLoop();
+    IR::LoopId j = kernel.newLoop();
+    IR::LoopId k = kernel.newLoop();
+    
+    for (uint32_t r = 0; r < tileRows * tileCols; ++r) {
+        kernel.cores.push_back({static_cast<uint8_t>(FIRST_ALLOCATABLE_CORE + r), PIM_ISA::CoreOpType::MAC});
+    }
+    
+    uint32_t fullRows = rows - rows % tileRows;
+    uint32_t fullCols = cols - cols % tileCols;
+    
+    struct Region {
+        uint32_t rowBegin, rowEnd, colBegin, colEnd;
+    };
+    const Region regions[] = {
+        {0, fullRows, 0, fullCols},
+        {0, fullRows, fullCols, cols},
+        {fullRows, rows, 0, fullCols},
+        {fullRows, rows, fullCols, cols}
+    };
+    
+    for (const auto& region : regions) {
+        if (region.rowBegin >= region.rowEnd || region.colBegin >= region.colEnd) {
+            continue;
+        }
+        
+        uint32_t regionTileRows = std::min(tileRows, region.rowEnd - region.rowBegin);
+        uint32_t regionTileCols = std::min(tileCols, region.colEnd - region.colBegin);
+        auto accumulator = [&](uint32_t r, uint32_t col) {
+            return static_cast<uint8_t>(FIRST_ALLOCATABLE_CORE + r * regionTileCols + col);
+        };
+        
+        // Load each distinct operand row once per k (B rows once per tile
+        // when they do not depend on k)
+        std::vector<IR::Node> kBody;
+        std::vector<IR::Node> loadsB;
+        uint8_t nextSlot = 0;
+        auto loadSlot = [&](std::vector<IR::Node>& body, const IR::Address& address, size_t firstLoad) {
+            for (size_t n = firstLoad; n < body.size(); ++n) {
+                if (body[n].address == address) {
+                    return body[n].slot;
+                }
+            }
+            uint8_t slot = nextSlot++;
+            body.push_back(IR::Node::makeLoad(slot, address));
+            return slot;
+        };
+        
+        std::vector<uint8_t> slotA(regionTileRows);
+        for (uint32_t r = 0; r < regionTileRows; ++r) {
+            IR::AffineExpr row = IR::AffineExpr::index(i).add(IR::AffineExpr::value(r), 1);
+            slotA[r] = loadSlot(kBody, elementAddress(a, row, IR::AffineExpr::index(k)), 0);
+        }
+        size_t firstSlotB = nextSlot;
+        std::vector<IR::Node>& bodyB = b.rowStride == 0 ? loadsB : kBody;
+        size_t firstLoadB = bodyB.size();
+        std::vector<uint8_t> slotB(regionTileCols);
+        for (uint32_t col = 0; col < regionTileCols; ++col) {
+            IR::AffineExpr column = IR::AffineExpr::index(j).add(IR::AffineExpr::value(col), 1);
+            slotB[col] = loadSlot(bodyB, elementAddress(b, IR::AffineExpr::index(k), column), firstLoadB);
+        }
+        
+        if (firstSlotB - 1 > PIM_ISA::MAX_OPERAND_SLOT_A || nextSlot - 1u > PIM_ISA::MAX_OPERAND_SLOT_B) {
+            throw std::runtime_error("Tile size " + std::to_string(tileRows) + "x" + std::to_string(tileCols) +
+                                    " exceeds the available read slots");
+        }
+        
+        for (uint32_t r = 0; r < regionTileRows; ++r) {
+            for (uint32_t col = 0; col < regionTileCols; ++col) {
+                uint16_t operands = PIM_ISA::encodeOperandSlots(slotA[r], slotB[col]);
+                kBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, accumulator(r, col), operands));
+            }
+        }
+        
+        std::vector<IR::Node> tileBody;
+        if (bias != nullptr) {
+            const IR::AffineExpr first = IR::AffineExpr::value(0);
+            tileBody.push_back(IR::Node::makeLoad(1, elementAddress(*scale, first, first)));
+            for (uint32_t r = 0; r < regionTileRows; ++r) {
+                for (uint32_t col = 0; col < regionTileCols; ++col) {
+                    IR::AffineExpr row = IR::AffineExpr::index(i).add(IR::AffineExpr::value(r), 1);
+                    IR::AffineExpr column = IR::AffineExpr::index(j).add(IR::AffineExpr::value(col), 1);
+                    tileBody.push_back(IR::Node::makeLoad(0, elementAddress(*bias, row, column)));
+                    tileBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, accumulator(r, col)));
+                }
+            }
+        }
+        for (auto& load : loadsB) {
+            tileBody.push_back(std::move(load));
+        }
+        tileBody.push_back(IR::Node::makeLoop(k, 0, depth, std::move(kBody)));
+        for (uint32_t r = 0; r < regionTileRows; ++r) {
+            for (uint32_t col = 0; col < regionTileCols; ++col) {
+                IR::AffineExpr row = IR::AffineExpr::index(i).add(IR::AffineExpr::value(r), 1);
+                IR::AffineExpr column = IR::AffineExpr::index(j).add(IR::AffineExpr::value(col), 1);
+                tileBody.push_back(IR::Node::makeStore(accumulator(r, col), elementAddress(c, row, column)));
+            }
+        }
+        
+        std::vector<IR::Node> rowBody;
+        rowBody.push_back(IR::Node::makeLoop(j, region.colBegin, region.colEnd, std::move(tileBody), regionTileCols));
+        kernel.body.push_back(IR::Node::makeLoop(i, region.rowBegin, region.rowEnd, std::move(rowBody), regionTileRows));
+    }
+    
+    if (verbose_) {
+        std::cout << "  Tiled loop nest (" << tileRows << "x" << tileCols << " tiles): "
+                 << kernel.nodeCount() << " nodes for " << kernel.instructionCount() << " instructions" << std::endl;
+    }
+    
+    return kernel;
+}
+
+// Build the loop nest for a product with a sparse left operand
+IR::Kernel CodeGenerator::buildSparseMatrixMultiplyKernel(const std::string& name,
+                                                          const MemoryMap::SparseLayout& a,
+                                                          const MemoryMap::MatrixHandle& b,
+                                                          const MemoryMap::MatrixHandle& c,
+                                                          uint32_t tileRows, uint32_t tileCols,
+                                                          const MemoryMap::MatrixHandle* bias,
+                                                          const MemoryMap::MatrixHandle* scale) const {
+    bool tiled = tileRows > 0 && tileCols > 0;
+    if (tiled && FIRST_ALLOCATABLE_CORE + tileRows * tileCols > PIM_ISA::NUM_CORES) {
+        throw std::runtime_error("Tile size " + std::to_string(tileRows) + "x" + std::to_string(tileCols) +
+                                " exceeds the available cores");
+    }
+    
+    // The dense loop nests with the loops over rows of A and over k
+    // unrolled, since the k with A[i,k] != 0 differ from row to row. Each
+    // row (each block of tileRows rows when tiled) gets a loop over the
+    // columns of C:
+    //
+    // for j in [0, colsC) (step tileCols)
+    //   for each k with A[i+r,k] != 0 for some r < tileRows
+    //     read A[i+r,k] into slot slotA(r)           (rows r with A[i+r,k] != 0)
+    //     read B[k,j+c] into slot slotB(c)           (c < tileCols)
+    //     multiply-accumulate slot slotA(r) * slot slotB(c) on core (r, c)
+    //   write C[i+r,j+c] from core (r, c)
+    //
+    // Untiled, the first nonzero of a row starts the product on the
+    // multiplier and the rest accumulate on the MAC core, as in the dense
+    // loop nest; the result of a row without nonzeros is the cleared MAC
+    // core. A fused bias and a transposed B are handled as in the dense
+    // loop nests. With every element listed, the instructions are those of
+    // the dense loop nest.
+    uint32_t rows = a.rows;
+    uint32_t cols = b.cols;
+    
+    IR::Kernel kernel;
+    kernel.name = name;
+    IR::LoopId j = kernel.newLoop();
+    const IR::AffineExpr first = IR::AffineExpr::value(0);
+    
+    // Stored elements are addressed by the memory row of their matrix row's first one
+    auto addressA = [&](uint32_t row) {
+        IR::Address address;
+        address.baseAddress = a.baseAddress;
+        address.offset = IR::AffineExpr::value(a.rowOffset(row));
+        return address;
+    };
+    
+    if (!tiled) {
+        bool hoistB = b.rowStride == 0;
+        const IR::AffineExpr column = IR::AffineExpr::index(j);
+        
+        for (uint32_t i = 0; i < rows; ++i) {
+            const IR::AffineExpr row = IR::AffineExpr::value(i);
+            uint32_t begin = a.rowStart[i];
+            uint32_t end = a.rowStart[i + 1];
             
-            // For the pPIM architecture, we break this down into a sequence of instructions:
+            std::vector<IR::Node> elementBody;
+            if (bias != nullptr) {
+                elementBody.push_back(IR::Node::makeLoad(0, elementAddress(*bias, row, column)));
+                elementBody.push_back(IR::Node::makeLoad(1, elementAddress(*scale, first, first)));
+                elementBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, MAC_CORE));
+            }
+            if (hoistB && begin < end) {
+                elementBody.push_back(IR::Node::makeLoad(1, elementAddress(b, first, column)));
+            }
+            for (uint32_t n = begin; n < end; ++n) {
+                elementBody.push_back(IR::Node::makeLoad(0, addressA(i)));
+                if (!hoistB) {
+                    IR::AffineExpr sumIndex = IR::AffineExpr::value(a.columns[n]);
+                    elementBody.push_back(IR::Node::makeLoad(1, elementAddress(b, sumIndex, column)));
+                }
+                bool start = n == begin && bias == nullptr;
+                elementBody.push_back(IR::Node::makeCompute(start ? IR::ComputeOp::MULTIPLY : IR::ComputeOp::MAC,
+                                                            start ? MULTIPLIER_CORE : MAC_CORE));
+            }
+            elementBody.push_back(IR::Node::makeStore(MAC_CORE, elementAddress(c, row, column)));
+            kernel.body.push_back(IR::Node::makeLoop(j, 0, cols, std::move(elementBody)));
+        }
+    } else {
+        for (uint32_t r = 0; r < tileRows * tileCols; ++r) {
+            kernel.cores.push_back({static_cast<uint8_t>(FIRST_ALLOCATABLE_CORE + r), PIM_ISA::CoreOpType::MAC});
+        }
+        
+        uint32_t fullRows = rows - rows % tileRows;
+        uint32_t fullCols = cols - cols % tileCols;
+        
+        struct Region {
+            uint32_t rowBegin, rowEnd, colBegin, colEnd;
+        };
+        const Region regions[] = {
+            {0, fullRows, 0, fullCols},
+            {0, fullRows, fullCols, cols},
+            {fullRows, rows, 0, fullCols},
+            {fullRows, rows, fullCols, cols}
+        };
+        
+        for (const auto& region : regions) {
+            if (region.rowBegin >= region.rowEnd || region.colBegin >= region.colEnd) {
+                continue;
+            }
             
-            // First, load initial values and clear accumulator (read flag only)
-            // The accumulator is implicitly cleared when we execute a new MAC operation
+            uint32_t regionTileRows = std::min(tileRows, region.rowEnd - region.rowBegin);
+            uint32_t regionTileCols = std::min(tileCols, region.colEnd - region.colBegin);
+            auto accumulator = [&](uint32_t r, uint32_t col) {
+                return static_cast<uint8_t>(FIRST_ALLOCATABLE_CORE + r * regionTileCols + col);
+            };
+            std::vector<IR::AffineExpr> columns;
+            for (uint32_t col = 0; col < regionTileCols; ++col) {
+                columns.push_back(IR::AffineExpr::index(j).add(IR::AffineExpr::value(col), 1));
+            }
             
-            // For each k, perform MAC operation
-            for (uint32_t k = 0; k < colsA; ++k) {
-                // Get memory addresses for A[i,k] and B[k,j]
-                uint16_t addrA = memoryMapper_->getElementAddress(matrixA, i, k);
-                uint16_t addrB = memoryMapper_->getElementAddress(matrixB, k, j);
+            for (uint32_t i = region.rowBegin; i < region.rowEnd; i += regionTileRows) {
+                // Slots as in the dense tile: rows of A first, columns of B
+                // after them, operands with the same address sharing a slot
+                std::vector<IR::Address> slotAddresses;
+                auto assignSlot = [&](const IR::Address& address, size_t firstSlot) {
+                    for (size_t slot = firstSlot; slot < slotAddresses.size(); ++slot) {
+                        if (slotAddresses[slot] == address) {
+                            return static_cast<uint8_t>(slot);
+                        }
+                    }
+                    slotAddresses.push_back(address);
+                    return static_cast<uint8_t>(slotAddresses.size() - 1);
+                };
                 
-                // Load A[i,k] (read operation)
-                instructions.push_back(PIM_ISA::createMemoryInstruction(0, true, false, addrA));
+                std::vector<uint8_t> slotA(regionTileRows);
+                for (uint32_t r = 0; r < regionTileRows; ++r) {
+                    slotA[r] = assignSlot(addressA(i + r), 0);
+                }
+                size_t firstSlotB = slotAddresses.size();
+                std::vector<uint8_t> slotB(regionTileCols);
+                for (uint32_t col = 0; col < regionTileCols; ++col) {
+                    slotB[col] = assignSlot(elementAddress(b, first, columns[col]), firstSlotB);
+                }
+                
+                if (firstSlotB - 1 > PIM_ISA::MAX_OPERAND_SLOT_A ||
+                    slotAddresses.size() - 1 > PIM_ISA::MAX_OPERAND_SLOT_B) {
+                    throw std::runtime_error("Tile size " + std::to_string(tileRows) + "x" +
+                                            std::to_string(tileCols) + " exceeds the available read slots");
+                }
                 
-                // Load B[k,j] (read operation)
-                instructions.push_back(PIM_ISA::createMemoryInstruction(1, true, false, addrB));
+                std::vector<IR::Node> tileBody;
+                if (bias != nullptr) {
+                    tileBody.push_back(IR::Node::makeLoad(1, elementAddress(*scale, first, first)));
+                    for (uint32_t r = 0; r < regionTileRows; ++r) {
+                        for (uint32_t col = 0; col < regionTileCols; ++col) {
+                            IR::AffineExpr row = IR::AffineExpr::value(i + r);
+                            tileBody.push_back(IR::Node::makeLoad(0, elementAddress(*bias, row, columns[col])));
+                            tileBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, accumulator(r, col)));
+                        }
+                    }
+                }
                 
-                // Execute MACs directly using LUT cores
-                // This would ideally be a single MAC operation, but for the pPIM architecture
-                // we need to break it down into multiply and accumulate steps
+                // Load each distinct operand once per k (B once per tile
+                // when its address does not depend on k)
+                bool hoistB = b.rowStride == 0;
+                std::vector<bool> loaded(slotAddresses.size(), false);
+                auto loadOnce = [&](uint8_t slot, const IR::Address& address) {
+                    if (!loaded[slot]) {
+                        loaded[slot] = true;
+                        tileBody.push_back(IR::Node::makeLoad(slot, address));
+                    }
+                };
+                if (hoistB) {
+                    for (uint32_t col = 0; col < regionTileCols; ++col) {
+                        loadOnce(slotB[col], elementAddress(b, first, columns[col]));
+                    }
+                }
                 
-                if (k == 0) {
-                    // First iteration: multiply only (no accumulation yet)
-                    instructions.push_back(PIM_ISA::createComputeInstruction(MULTIPLIER_CORE, 0));
-                } else {
-                    // Subsequent iterations: multiply and accumulate
-                    instructions.push_back(PIM_ISA::createComputeInstruction(MAC_CORE, 0));
+                // Visit the nonzero columns of the tile's rows in ascending k
+                std::vector<uint32_t> next(regionTileRows);
+                for (uint32_t r = 0; r < regionTileRows; ++r) {
+                    next[r] = a.rowStart[i + r];
                 }
+                std::vector<uint32_t> active;
+                while (true) {
+                    uint32_t k = UINT32_MAX;
+                    for (uint32_t r = 0; r < regionTileRows; ++r) {
+                        if (next[r] < a.rowStart[i + r + 1]) {
+                            k = std::min(k, a.columns[next[r]]);
+                        }
+                    }
+                    if (k == UINT32_MAX) {
+                        break;
+                    }
+                    
+                    active.clear();
+                    for (uint32_t r = 0; r < regionTileRows; ++r) {
+                        if (next[r] < a.rowStart[i + r + 1] && a.columns[next[r]] == k) {
+                            active.push_back(r);
+                            next[r]++;
+                        }
+                    }
+                    
+                    std::fill(loaded.begin(), loaded.begin() + firstSlotB, false);
+                    for (uint32_t r : active) {
+                        loadOnce(slotA[r], addressA(i + r));
+                    }
+                    if (!hoistB) {
+                        std::fill(loaded.begin() + firstSlotB, loaded.end(), false);
+                        for (uint32_t col = 0; col < regionTileCols; ++col) {
+                            loadOnce(slotB[col], elementAddress(b, IR::AffineExpr::value(k), columns[col]));
+                        }
+                    }
+                    for (uint32_t r : active) {
+                        for (uint32_t col = 0; col < regionTileCols; ++col) {
+                            uint16_t operands = PIM_ISA::encodeOperandSlots(slotA[r], slotB[col]);
+                            tileBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, accumulator(r, col),
+                                                                     operands));
+                        }
+                    }
+                }
+                
+                for (uint32_t r = 0; r < regionTileRows; ++r) {
+                    for (uint32_t col = 0; col < regionTileCols; ++col) {
+                        IR::AffineExpr row = IR::AffineExpr::value(i + r);
+                        tileBody.push_back(IR::Node::makeStore(accumulator(r, col),
+                                                               elementAddress(c, row, columns[col])));
+                    }
+                }
+                
+                kernel.body.push_back(IR::Node::makeLoop(j, region.colBegin, region.colEnd, std::move(tileBody),
+                                                         regionTileCols));
             }
+        }
+    }
+    
+    if (verbose_) {
+        uint64_t dense = static_cast<uint64_t>(rows) * a.cols * cols;
+        uint64_t sparse = static_cast<uint64_t>(a.nonzeroCount()) * cols;
+        std::cout << "  Sparse loop nest";
+        if (tiled) {
+            std::cout << " (" << tileRows << "x" << tileCols << " tiles)";
+        }
+        std::cout << ": " << sparse << " of " << dense << " multiply-accumulates, "
+                 << kernel.nodeCount() << " nodes for " << kernel.instructionCount() << " instructions" << std::endl;
+    }
+    
+    return kernel;
+}
+
+// Build the loop nest for a batch of products
+IR::Kernel CodeGenerator::buildBatchMultiplyKernel(const Frontend::MatrixOperation& op) {
+    if (op.inputs.size() != 2) {
+        throw std::runtime_error("Batched multiplication requires 2 input batches");
+    }
+    
+    MemoryMap::MatrixHandle a = memoryMapper_->resolveMatrix(op.inputs[0]);
+    MemoryMap::MatrixHandle b = memoryMapper_->resolveMatrix(op.inputs[1]);
+    MemoryMap::MatrixHandle c = memoryMapper_->resolveMatrix(op.output);
+    std::string name = op.output + "[] = " + op.inputs[0] + "[] * " + op.inputs[1] + "[]";
+    
+    if (a.batch == 0 || a.batch != b.batch || a.batch != c.batch) {
+        throw std::runtime_error("Batched multiplication " + name + " requires batches of the same size");
+    }
+    if (a.cols != b.rows || c.rows != a.rows || c.cols != b.cols) {
+        throw std::runtime_error("Invalid matrix dimensions for batched multiplication " + name);
+    }
+    
+    // Item t of a group reads A into slot t and B into slot group + t and
+    // accumulates on its own MAC core
+    uint32_t group = std::max<uint32_t>(op.tileCols, 1);
+    if (group - 1 > PIM_ISA::MAX_OPERAND_SLOT_A || 2 * group - 1 > PIM_ISA::MAX_OPERAND_SLOT_B ||
+        FIRST_ALLOCATABLE_CORE + group > PIM_ISA::NUM_CORES) {
+        throw std::runtime_error("Batch group of " + std::to_string(group) + " items exceeds the available cores");
+    }
+    
+    if (verbose_) {
+        std::cout << "Building loop nest for batched multiplication: " << name << std::endl;
+        std::cout << "  Dimensions: " << a.batch << " x (" << a.rows << "x" << a.cols << ") * ("
+                 << b.rows << "x" << b.cols << ") = (" << c.rows << "x" << c.cols << "), "
+                 << group << " item(s) at a time" << std::endl;
+    }
+    
+    // For each group of items g, g+1, ..., g+group-1:
+    //
+    // for i in [0, rowsC)
+    //   for j in [0, colsC)
+    //     for k in [0, colsA)
+    //       read A[g+t][i,k] into slot t               (t < group)
+    //       read B[g+t][k,j] into slot group + t
+    //       multiply-accumulate slot t * slot group + t on core t
+    //     write C[g+t][i,j] from core t                (writing clears the accumulator)
+    //
+    // A last group with fewer items gets a loop nest of its own. One item at
+    // a time keeps the schedule of an ordinary product: the first k is a
+    // multiply on the multiplier core, the others accumulate on the MAC core.
+    IR::Kernel kernel;
+    kernel.name = name;
+    IR::LoopId g = kernel.newLoop();
+    IR::LoopId i = kernel.newLoop();
+    IR::LoopId j = kernel.newLoop();
+    IR::LoopId k = kernel.newLoop();
+    
+    auto accumulator = [group](uint32_t t) {
+        return group == 1 ? MAC_CORE : static_cast<uint8_t>(FIRST_ALLOCATABLE_CORE + t);
+    };
+    for (uint32_t t = 0; group > 1 && t < group; ++t) {
+        kernel.cores.push_back({accumulator(t), PIM_ISA::CoreOpType::MAC});
+    }
+    
+    const IR::AffineExpr row = IR::AffineExpr::index(i);
+    const IR::AffineExpr column = IR::AffineExpr::index(j);
+    const IR::AffineExpr sum = IR::AffineExpr::index(k);
+    
+    uint32_t fullItems = a.batch - a.batch % group;
+    const std::pair<uint32_t, uint32_t> regions[] = {{0, fullItems}, {fullItems, a.batch}};
+    for (const auto& region : regions) {
+        if (region.first >= region.second) {
+            continue;
+        }
+        uint32_t items = std::min(group, region.second - region.first);
+        
+        std::vector<IR::Node> elementBody;
+        if (group == 1 && a.cols > 0) {
+            const IR::AffineExpr item = IR::AffineExpr::index(g);
+            const IR::AffineExpr first = IR::AffineExpr::value(0);
+            elementBody.push_back(IR::Node::makeLoad(0, itemElementAddress(a, item, row, first)));
+            elementBody.push_back(IR::Node::makeLoad(1, itemElementAddress(b, item, first, column)));
+            elementBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MULTIPLY, MULTIPLIER_CORE));
+        }
+        
+        std::vector<IR::Node> kBody;
+        for (uint32_t t = 0; t < items; ++t) {
+            IR::AffineExpr item = IR::AffineExpr::index(g).add(IR::AffineExpr::value(t), 1);
+            kBody.push_back(IR::Node::makeLoad(static_cast<uint8_t>(t), itemElementAddress(a, item, row, sum)));
+            kBody.push_back(IR::Node::makeLoad(static_cast<uint8_t>(group + t),
+                                               itemElementAddress(b, item, sum, column)));
+        }
+        for (uint32_t t = 0; t < items; ++t) {
+            uint16_t operands = PIM_ISA::encodeOperandSlots(static_cast<uint8_t>(t), static_cast<uint8_t>(group + t));
+            kBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, accumulator(t), group > 1 ? operands : 0));
+        }
+        uint32_t firstMac = group == 1 ? 1 : 0;
+        if (a.cols > firstMac) {
+            elementBody.push_back(IR::Node::makeLoop(k, firstMac, a.cols, std::move(kBody)));
+        }
+        for (uint32_t t = 0; t < items; ++t) {
+            IR::AffineExpr item = IR::AffineExpr::index(g).add(IR::AffineExpr::value(t), 1);
+            elementBody.push_back(IR::Node::makeStore(accumulator(t), itemElementAddress(c, item, row, column)));
+        }
+        
+        std::vector<IR::Node> rowBody;
+        rowBody.push_back(IR::Node::makeLoop(j, 0, c.cols, std::move(elementBody)));
+        std::vector<IR::Node> itemBody;
+        itemBody.push_back(IR::Node::makeLoop(i, 0, c.rows, std::move(rowBody)));
+        kernel.body.push_back(IR::Node::makeLoop(g, region.first, region.second, std::move(itemBody), items));
+    }
+    
+    if (verbose_) {
+        std::cout << "  Loop nest: " << kernel.nodeCount() << " nodes for "
+                 << kernel.instructionCount() << " instructions" << std::endl;
+    }
+    
+    return kernel;
+}
+
+// Build the loop nest for an element-wise sum or difference
+IR::Kernel CodeGenerator::buildElementwiseKernel(const Frontend::MatrixOperation& op) {
+    bool add = op.type == Frontend::OperationType::ADD;
+    const char* symbol = add ? " + " : " - ";
+    
+    if (op.inputs.size() != 2) {
+        throw std::runtime_error(std::string("Matrix ") + (add ? "addition" : "subtraction") +
+                                " requires exactly 2 input matrices");
+    }
+    
+    const std::string& matrixA = op.inputs[0];
+    const std::string& matrixB = op.inputs[1];
+    const std::string& matrixC = op.output;
+    
+    MemoryMap::MatrixHandle handleA = memoryMapper_->resolveMatrix(matrixA);
+    MemoryMap::MatrixHandle handleB = memoryMapper_->resolveMatrix(matrixB);
+    MemoryMap::MatrixHandle handleC = memoryMapper_->resolveMatrix(matrixC);
+    
+    if (handleA.rows != handleB.rows || handleA.cols != handleB.cols) {
+        throw std::runtime_error(std::string("Invalid matrix dimensions for ") + (add ? "addition: " : "subtraction: ") +
+                                matrixA + "(" + std::to_string(handleA.rows) + "x" + std::to_string(handleA.cols) + ")" +
+                                symbol +
+                                matrixB + "(" + std::to_string(handleB.rows) + "x" + std::to_string(handleB.cols) + ")");
+    }
+    if (handleC.rows < handleA.rows || handleC.cols < handleA.cols) {
+        throw std::out_of_range("Result matrix " + matrixC + " is too small for " + matrixA + symbol + matrixB);
+    }
+    
+    if (verbose_) {
+        std::cout << "Building loop nest for matrix " << (add ? "addition: " : "subtraction: ")
+                 << matrixC << " = " << matrixA << symbol << matrixB << std::endl;
+    }
+    
+    // for i in [0, rows)
+    //   for j in [0, cols)
+    //     read A[i,j]; read B[i,j]; add (or subtract)
+    //     write C[i,j]
+    //
+    // Sums use the adder core programmed at program start; differences
+    // program the first allocatable core as a subtractor.
+    IR::Kernel kernel;
+    kernel.name = matrixC + " = " + matrixA + symbol + matrixB;
+    IR::LoopId i = kernel.newLoop();
+    IR::LoopId j = kernel.newLoop();
+    
+    uint8_t core = ADDER_CORE;
+    if (!add) {
+        core = FIRST_ALLOCATABLE_CORE;
+        kernel.cores.push_back({core, PIM_ISA::CoreOpType::SUBTRACTOR});
+    }
+    
+    const IR::AffineExpr rowIndex = IR::AffineExpr::index(i);
+    const IR::AffineExpr colIndex = IR::AffineExpr::index(j);
+    
+    std::vector<IR::Node> elementBody;
+    elementBody.push_back(IR::Node::makeLoad(0, elementAddress(handleA, rowIndex, colIndex)));
+    elementBody.push_back(IR::Node::makeLoad(1, elementAddress(handleB, rowIndex, colIndex)));
+    elementBody.push_back(IR::Node::makeCompute(add ? IR::ComputeOp::ADD : IR::ComputeOp::SUBTRACT, core));
+    elementBody.push_back(IR::Node::makeStore(core, elementAddress(handleC, rowIndex, colIndex)));
+    
+    std::vector<IR::Node> rowBody;
+    rowBody.push_back(IR::Node::makeLoop(j, 0, handleA.cols, std::move(elementBody)));
+    kernel.body.push_back(IR::Node::makeLoop(i, 0, handleA.rows, std::move(rowBody)));
+    
+    if (verbose_) {
+        std::cout << "  Loop nest: " << kernel.nodeCount() << " nodes for "
+                 << kernel.instructionCount() << " instructions" << std::endl;
+    }
+    
+    return kernel;
+}
+
+// Build the loop nest copying the transpose of a matrix
+IR::Kernel CodeGenerator::buildTransposeKernel(const Frontend::MatrixOperation& op) {
+    if (op.inputs.size() != 2) {
+        throw std::runtime_error("Matrix transpose requires a matrix and a 1x1 scale");
+    }
+    
+    const std::string& matrixA = op.inputs[0];
+    const std::string& matrixC = op.output;
+    
+    // Walk the source through its transposed layout
+    MemoryMap::MatrixHandle handleA = memoryMapper_->resolveMatrix(matrixA).transposed();
+    MemoryMap::MatrixHandle handleScale = memoryMapper_->resolveMatrix(op.inputs[1]);
+    MemoryMap::MatrixHandle handleC = memoryMapper_->resolveMatrix(matrixC);
+    
+    if (handleScale.rows != 1 || handleScale.cols != 1) {
+        throw std::runtime_error("Invalid scale " + op.inputs[1] + " for the transpose of " + matrixA);
+    }
+    if (handleC.rows < handleA.rows || handleC.cols < handleA.cols) {
+        throw std::out_of_range("Result matrix " + matrixC + " is too small for " + matrixA + "^T");
+    }
+    
+    if (verbose_) {
+        std::cout << "Building loop nest for matrix transpose: " << matrixC << " = " << matrixA << "^T" << std::endl;
+    }
+    
+    // read k (the constant 1) into slot 1
+    // for i in [0, cols of A)
+    //   for j in [0, rows of A)
+    //     read A[j,i]; multiply-accumulate with k
+    //     write C[i,j]                           (writing clears the accumulator)
+    IR::Kernel kernel;
+    kernel.name = matrixC + " = " + matrixA + "^T";
+    IR::LoopId i = kernel.newLoop();
+    IR::LoopId j = kernel.newLoop();
+    
+    const IR::AffineExpr rowIndex = IR::AffineExpr::index(i);
+    const IR::AffineExpr colIndex = IR::AffineExpr::index(j);
+    const IR::AffineExpr firstIndex = IR::AffineExpr::value(0);
+    
+    std::vector<IR::Node> elementBody;
+    elementBody.push_back(IR::Node::makeLoad(0, elementAddress(handleA, rowIndex, colIndex)));
+    elementBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, MAC_CORE));
+    elementBody.push_back(IR::Node::makeStore(MAC_CORE, elementAddress(handleC, rowIndex, colIndex)));
+    
+    std::vector<IR::Node> rowBody;
+    rowBody.push_back(IR::Node::makeLoop(j, 0, handleA.cols, std::move(elementBody)));
+    kernel.body.push_back(IR::Node::makeLoad(1, elementAddress(handleScale, firstIndex, firstIndex)));
+    kernel.body.push_back(IR::Node::makeLoop(i, 0, handleA.rows, std::move(rowBody)));
+    
+    if (verbose_) {
+        std::cout << "  Loop nest: " << kernel.nodeCount() << " nodes for "
+                 << kernel.instructionCount() << " instructions" << std::endl;
+    }
+    
+    return kernel;
+}
+
+// Build the loop nest for a product by a constant matrix with at most one nonzero per row or column
+IR::Kernel CodeGenerator::buildScaleKernel(const Frontend::MatrixOperation& op) {
+    bool byColumn = op.type == Frontend::OperationType::SCALE_COLUMNS;
+    if (op.inputs.size() != 2) {
+        throw std::runtime_error("Scaling " + op.output + " requires a matrix and a constant matrix");
+    }
+    
+    MemoryMap::MatrixHandle handleA = memoryMapper_->resolveMatrix(op.inputs[0]);
+    MemoryMap::MatrixHandle handleB = memoryMapper_->resolveMatrix(op.inputs[1]);
+    MemoryMap::MatrixHandle handleC = memoryMapper_->resolveMatrix(op.output);
+    
+    if (handleA.cols != handleB.rows) {
+        throw std::runtime_error("Invalid matrix dimensions for multiplication: " + op.inputs[0] + "(" +
+                                std::to_string(handleA.rows) + "x" + std::to_string(handleA.cols) + ") * " +
+                                op.inputs[1] + "(" + std::to_string(handleB.rows) + "x" +
+                                std::to_string(handleB.cols) + ")");
+    }
+    if (handleC.rows < handleA.rows || handleC.cols < handleB.cols) {
+        throw std::out_of_range("Result matrix " + op.output + " is too small");
+    }
+    if (op.selected.size() != (byColumn ? handleB.cols : handleA.rows)) {
+        throw std::runtime_error("Scaling " + op.output + " selects " + std::to_string(op.selected.size()) +
+                                " nonzeros for " + std::to_string(byColumn ? handleB.cols : handleA.rows) +
+                                (byColumn ? " columns" : " rows"));
+    }
+    
+    if (verbose_) {
+        std::cout << "Building loop nest for scaled " << (byColumn ? "columns" : "rows") << ": " << op.output
+                 << " = " << op.inputs[0] << " * " << op.inputs[1] << std::endl;
+    }
+    
+    // Columns (by rows: the same with rows and columns swapped), unrolled
+    // since each reads its own element of the constant B:
+    //
+    // for each column j of C, with B[k,j] its nonzero
+    //   read B[k,j] into slot 1
+    //   for i in [0, rows of C)
+    //     read A[i,k]; multiply-accumulate with B[k,j]
+    //     write C[i,j]                       (writing clears the accumulator)
+    //
+    // A column of B without nonzeros writes the cleared accumulator. With
+    // op.tileCols cores, each group of that many columns runs its loop
+    // together: the nonzeros of B go to the slots after the operand-A
+    // range, column j + c accumulates on core c, and elements of A with
+    // the same address share a slot.
+    IR::Kernel kernel;
+    kernel.name = op.output + " = " + op.inputs[0] + " * " + op.inputs[1];
+    IR::LoopId i = kernel.newLoop();
+    const IR::AffineExpr index = IR::AffineExpr::index(i);
+    
+    const MemoryMap::MatrixHandle& constant = byColumn ? handleB : handleA;
+    const MemoryMap::MatrixHandle& source = byColumn ? handleA : handleB;
+    uint32_t length = byColumn ? handleA.rows : handleB.cols;
+    uint32_t lines = static_cast<uint32_t>(op.selected.size());
+    
+    // Address of the nonzero of a line and of the element it scales
+    auto constantAddress = [&](uint32_t line) {
+        const IR::AffineExpr fixed = IR::AffineExpr::value(line);
+        const IR::AffineExpr selected = IR::AffineExpr::value(op.selected[line]);
+        return byColumn ? elementAddress(constant, selected, fixed) : elementAddress(constant, fixed, selected);
+    };
+    auto sourceAddress = [&](uint32_t line) {
+        const IR::AffineExpr selected = IR::AffineExpr::value(op.selected[line]);
+        return byColumn ? elementAddress(source, index, selected) : elementAddress(source, selected, index);
+    };
+    auto resultAddress = [&](uint32_t line) {
+        const IR::AffineExpr fixed = IR::AffineExpr::value(line);
+        return byColumn ? elementAddress(handleC, index, fixed) : elementAddress(handleC, fixed, index);
+    };
+    
+    if (op.tileCols == 0) {
+        for (uint32_t line = 0; line < lines; ++line) {
+            std::vector<IR::Node> elementBody;
+            if (op.selected[line] != Frontend::NO_ELEMENT) {
+                kernel.body.push_back(IR::Node::makeLoad(1, constantAddress(line)));
+                elementBody.push_back(IR::Node::makeLoad(0, sourceAddress(line)));
+                elementBody.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC, MAC_CORE));
+            }
+            elementBody.push_back(IR::Node::makeStore(MAC_CORE, resultAddress(line)));
+            kernel.body.push_back(IR::Node::makeLoop(i, 0, length, std::move(elementBody)));
+        }
+    } else {
+        uint32_t cores = op.tileCols;
+        if (FIRST_ALLOCATABLE_CORE + cores > PIM_ISA::NUM_CORES ||
+            PIM_ISA::MAX_OPERAND_SLOT_A + cores > PIM_ISA::MAX_OPERAND_SLOT_B) {
+            throw std::runtime_error("Scaling " + op.output + " on " + std::to_string(cores) +
+                                    " cores exceeds the available cores or read slots");
+        }
+        for (uint32_t c = 0; c < cores; ++c) {
+            kernel.cores.push_back({static_cast<uint8_t>(FIRST_ALLOCATABLE_CORE + c), PIM_ISA::CoreOpType::MAC});
+        }
+        
+        for (uint32_t first = 0; first < lines; first += cores) {
+            uint32_t group = std::min(cores, lines - first);
             
-            // Get memory address for C[i,j]
-            uint16_t addrC = memoryMapper_->getElementAddress(matrixC, i, j);
-            
-            // Store result to C[i,j] (write operation)
-            instructions.push_back(PIM_ISA::createMemoryInstruction(2, false, true, addrC));
+            // Loads first (one slot per distinct address of A), then computes and writes
+            std::vector<IR::Node> elementBody;
+            std::vector<IR::Node> computes;
+            for (uint32_t c = 0; c < group; ++c) {
+                uint32_t line = first + c;
+                if (op.selected[line] == Frontend::NO_ELEMENT) {
+                    continue;
+                }
+                uint8_t constantSlot = static_cast<uint8_t>(PIM_ISA::MAX_OPERAND_SLOT_A + 1 + c);
+                kernel.body.push_back(IR::Node::makeLoad(constantSlot, constantAddress(line)));
+                
+                IR::Address address = sourceAddress(line);
+                uint8_t sourceSlot = 0;
+                while (sourceSlot < elementBody.size() && !(elementBody[sourceSlot].address == address)) {
+                    sourceSlot++;
+                }
+                if (sourceSlot == elementBody.size()) {
+                    elementBody.push_back(IR::Node::makeLoad(sourceSlot, address));
+                }
+                computes.push_back(IR::Node::makeCompute(IR::ComputeOp::MAC,
+                                                         static_cast<uint8_t>(FIRST_ALLOCATABLE_CORE + c),
+                                                         PIM_ISA::encodeOperandSlots(sourceSlot, constantSlot)));
+            }
+            elementBody.insert(elementBody.end(), computes.begin(), computes.end());
+            for (uint32_t c = 0; c < group; ++c) {
+                elementBody.push_back(IR::Node::makeStore(static_cast<uint8_t>(FIRST_ALLOCATABLE_CORE + c),
+                                                          resultAddress(first + c)));
+            }
+            kernel.body.push_back(IR::Node::makeLoop(i, 0, length, std::move(elementBody)));
         }
     }
+    
+    if (verbose_) {
+        std::cout << "  Loop nest: " << kernel.nodeCount() << " nodes for "
+                 << kernel.instructionCount() << " instructions" << std::endl;
+    }
+    
+    return kernel;
 }
 
-// Generate initialization instructions for LUT cores
-void CodeGenerator::generateInitInstructions(std::vector<PIM_ISA::Instruction>& instructions) {
-    // Program the multiplier core (Core 0)
-    instructions.push_back(PIM_ISA::createProgInstruction(
-        0, PIM_ISA::CoreOpType::MULTIPLIER, generateMultiplierConfig()));
+// Lower a top-level loop of a loop nest on several threads
+void CodeGenerator::lowerLoopParallel(const IR::Kernel& kernel, size_t index, PIM_ISA::InstructionSink& sink) const {
+    // A tile is a run of consecutive outer iterations (rows or row blocks of C)
+    const IR::Node& loop = kernel.body[index];
+    uint64_t iterations = loop.tripCount();
+    uint64_t instructionsPerIteration = std::max<uint64_t>(1, loop.instructionCount() / iterations);
+    uint64_t tileIterations = std::max<uint64_t>(1, TARGET_TILE_INSTRUCTIONS / instructionsPerIteration);
+    uint64_t tileCount = (iterations + tileIterations - 1) / tileIterations;
     
-    // Program the adder core (Core 1)
-    instructions.push_back(PIM_ISA::createProgInstruction(
-        1, PIM_ISA::CoreOpType::ADDER, generateAdderConfig()));
+    unsigned threads = static_cast<unsigned>(std::min<uint64_t>(threads_, tileCount));
+    uint64_t tilesPerRound = std::min<uint64_t>(tileCount, threads * TILES_PER_THREAD_ROUND);
     
-    // Program the MAC core (Core 2)
-    instructions.push_back(PIM_ISA::createProgInstruction(
-        2, PIM_ISA::CoreOpType::MAC, generateMACConfig()));
+    if (verbose_) {
+        std::cout << "  Parallel code generation for " << kernel.name << ": " << tileCount
+                 << " tiles of up to " << tileIterations << " iterations on " << threads << " threads" << std::endl;
+    }
+    
+    // Thread-local buffers, reused from round to round
+    std::vector<PIM_ISA::PackedProgram> buffers(tilesPerRound);
+    
+    for (uint64_t firstTile = 0; firstTile < tileCount; firstTile += tilesPerRound) {
+        uint64_t roundTiles = std::min(tilesPerRound, tileCount - firstTile);
+        std::atomic<uint64_t> nextTile{0};
+        std::vector<std::exception_ptr> errors(threads);
+        
+        auto worker = [&](unsigned thread) {
+            try {
+                for (uint64_t tile = nextTile++; tile < roundTiles; tile = nextTile++) {
+                    uint64_t begin = (firstTile + tile) * tileIterations;
+                    uint64_t end = std::min(begin + tileIterations, iterations);
+                    
+                    PIM_ISA::PackedProgram& buffer = buffers[tile];
+                    buffer.clear();
+                    buffer.reserve((end - begin) * instructionsPerIteration);
+                    PIM_ISA::PackedProgramSink tileSink(buffer);
+                    IR::lowerLoopIterations(kernel, index, static_cast<uint32_t>(begin),
+                                            static_cast<uint32_t>(end), tileSink);
+                }
+            } catch (...) {
+                errors[thread] = std::current_exception();
+            }
+        };
+        
+        std::vector<std::thread> workers;
+        for (unsigned thread = 1; thread < threads; ++thread) {
+            workers.emplace_back(worker, thread);
+        }
+        worker(0);
+        for (auto& thread : workers) {
+            thread.join();
+        }
+        
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        
+        // Concatenate in tile order so the stream matches a serial run
+        for (uint64_t tile = 0; tile < roundTiles; ++tile) {
+            sink.emitBlock(buffers[tile]);
+        }
+    }
+}
+
+// Build the loop nest that programs the LUT cores at program start
+IR::Kernel CodeGenerator::buildInitKernel() const {
+    IR::Kernel kernel;
+    kernel.name = "LUT initialization";
+    kernel.cores.push_back({MULTIPLIER_CORE, PIM_ISA::CoreOpType::MULTIPLIER});
+    kernel.cores.push_back({ADDER_CORE, PIM_ISA::CoreOpType::ADDER});
+    kernel.cores.push_back({MAC_CORE, PIM_ISA::CoreOpType::MAC});
+    return kernel;
+}
+
+// Add setups for the fixed cores a loop nest computes on
+void CodeGenerator::declareFixedCores(IR::Kernel& kernel) const {
+    for (uint8_t core : kernel.computeCores()) {
+        bool declared = std::any_of(kernel.cores.begin(), kernel.cores.end(),
+                                    [&](const IR::CoreSetup& setup) { return setup.core == core; });
+        if (declared) {
+            continue;
+        }
+        
+        switch (core) {
+            case MULTIPLIER_CORE:
+                kernel.cores.push_back({core, PIM_ISA::CoreOpType::MULTIPLIER});
+                break;
+            case ADDER_CORE:
+                kernel.cores.push_back({core, PIM_ISA::CoreOpType::ADDER});
+                break;
+            case MAC_CORE:
+                kernel.cores.push_back({core, PIM_ISA::CoreOpType::MAC});
+                break;
+            default:
+                throw std::runtime_error("Loop nest " + kernel.name + " computes on core " + std::to_string(core) +
+                                        " without programming it");
+        }
+    }
+}
+
+// Program the cores a loop nest needs that are not set up yet
+void CodeGenerator::generateKernelSetup(const IR::Kernel& kernel, std::vector<int>& coreOps,
+                                        PIM_ISA::InstructionSink& sink) const {
+    for (const auto& setup : kernel.cores) {
+        if (coreOps[setup.core] == static_cast<int>(setup.opType)) {
+            continue;
+        }
+        
+        sink.emit(PIM_ISA::createProgInstruction(setup.core, setup.opType, generateConfig(setup.opType)));
+        coreOps[setup.core] = static_cast<int>(setup.opType);
+    }
+}
+
+// Generate the LUT configuration for a core operation
+std::vector<uint8_t> CodeGenerator::generateConfig(PIM_ISA::CoreOpType opType) const {
+    switch (opType) {
+        case PIM_ISA::CoreOpType::MULTIPLIER:
+            return generateMultiplierConfig();
+        case PIM_ISA::CoreOpType::ADDER:
+            return generateAdderConfig();
+        case PIM_ISA::CoreOpType::MAC:
+            return generateMACConfig();
+        case PIM_ISA::CoreOpType::SUBTRACTOR:
+            return generateSubtractorConfig();
+        default:
+            return {};
+    }
 }
 
 // Generate LUT configuration for multiplier core
 std::vector<uint8_t> CodeGenerator::generateMultiplierConfig() const {
-    // This is a simplified implementation for demonstration
-    // In a real implementation, this would configure the LUT for 8-bit multiplication
-    
-    // For now, we'll just return a placeholder configuration
-    return {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    return std::vector<uint8_t>(PIM_ISA::MULTIPLIER_LUT.begin(), PIM_ISA::MULTIPLIER_LUT.end());
 }
 
 // Generate LUT configuration for adder core
 std::vector<uint8_t> CodeGenerator::generateAdderConfig() const {
-    // This is a simplified implementation for demonstration
-    // In a real implementation, this would configure the LUT for 8-bit addition
-    
-    // For now, we'll just return a placeholder configuration
-    return {0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+    return std::vector<uint8_t>(PIM_ISA::ADDER_LUT.begin(), PIM_ISA::ADDER_LUT.end());
 }
 
 // Generate LUT configuration for MAC core
 std::vector<uint8_t> CodeGenerator::generateMACConfig() const {
-    // This is a simplified implementation for demonstration
-    // In a real implementation, this would configure the LUT for
-    // multiply-accumulate operations
-    
-    // For now, we'll just return a placeholder configuration
-    return {0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17};
+    std::vector<uint8_t> config = generateMultiplierConfig();
+    config.insert(config.end(), PIM_ISA::ADDER_LUT.begin(), PIM_ISA::ADDER_LUT.end());
+    return config;
 }
 
-} // namespace Backend
+// Generate LUT configuration for subtractor core
+std::vector<uint8_t> CodeGenerator::generateSubtractorConfig() const {
+    return std::vector<uint8_t>(PIM_ISA::SUBTRACTOR_LUT.begin(), PIM_ISA::SUBTRACTOR_LUT.end());
+}
 
+} // namespace Backend
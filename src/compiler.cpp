@@ -3,7 +3,104 @@
 #include "../include/optimizer/optimizer.h"
 #include "../include/backend/codegen.h"
 #include "../include/memorymap/memorymap.h"
+#include "../include/pim_isa/instruction_sink.h"
+#include "../include/pim_isa/object_file.h"
+#include "../include/pim_isa/assembly_writer.h"
+#include "../include/utils/binary_io.h"
+#include "../include/utils/compile_cache.h"
+#include "../include/utils/segment_table.h"
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Milliseconds elapsed since a time point
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Print one line of the timing report
+void printPhaseTime(const std::string& phase, double ms) {
+    std::cout << "  " << std::left << std::setw(26) << phase << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10) << ms << " ms" << std::endl;
+}
+
+// Print output size and write throughput
+void printOutputThroughput(const std::string& outputFile, double ms) {
+    std::error_code error;
+    auto bytes = std::filesystem::file_size(outputFile, error);
+    if (error) {
+        return;
+    }
+    
+    double megabytes = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    double seconds = ms / 1000.0;
+    std::cout << "  Output: " << std::fixed << std::setprecision(2) << megabytes << " MB";
+    if (seconds > 0.0) {
+        std::cout << " at " << megabytes / seconds << " MB/s";
+    }
+    std::cout << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+// Print the estimated execution time of a program
+void printCycleEstimate(const PIM_ISA::ParallelSimulationSink& simulation) {
+    std::cout << "Estimated execution: " << simulation.totalCycles() << " cycles on "
+              << simulation.computeCoresUsed() << " compute cores ("
+              << simulation.sequentialCycles() << " sequential, " << std::fixed << std::setprecision(1)
+              << static_cast<double>(simulation.sequentialCycles()) / std::max<uint64_t>(1, simulation.totalCycles())
+              << "x)" << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+    std::cout << "Critical path: " << simulation.criticalPathCycles() << " cycles";
+    if (simulation.bundles() > 0) {
+        std::cout << ", " << simulation.bundles() << " bundles";
+    }
+    std::cout << std::endl;
+}
+
+// Identify the compiler build by its executable, so a rebuilt compiler misses the cache
+std::string compilerIdentity() {
+    std::error_code error;
+    std::filesystem::path executable = std::filesystem::read_symlink("/proc/self/exe", error);
+    if (!error) {
+        std::error_code timeError;
+        auto size = std::filesystem::file_size(executable, error);
+        auto modified = std::filesystem::last_write_time(executable, timeError);
+        if (!error && !timeError) {
+            return executable.string() + " " + std::to_string(size) + " " +
+                   std::to_string(modified.time_since_epoch().count());
+        }
+    }
+    return "built " __DATE__ " " __TIME__;
+}
+
+// Print the counters and contents of a compile cache
+void printCacheStats(const Utils::CompileCache& cache) {
+    Utils::CacheStats stats = cache.getStats();
+    std::cout << "Compile cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+              << stats.entries << " entries (" << stats.bytes / 1024 << " KB of "
+              << cache.getMaxBytes() / (1024 * 1024) << " MB)" << std::endl;
+}
+
+// Identify the instructions of a loop nest: the nest, and which of the cores
+// it sets up are already programmed, since those PROGs are skipped
+std::string segmentKey(const IR::Kernel& kernel, const std::vector<int>& coreOps) {
+    std::string key = IR::fingerprint(kernel);
+    for (const auto& setup : kernel.cores) {
+        key.push_back(coreOps[setup.core] == static_cast<int>(setup.opType) ? '1' : '0');
+    }
+    return key;
+}
+
+} // namespace
 
 // Constructor
 PIMCompiler::PIMCompiler() {
@@ -25,14 +122,112 @@ PIMCompiler::~PIMCompiler() {
     memoryMapper_.reset();
 }
 
+// Destination of the output, opened once the program has been generated or is about to be streamed
+struct PIMCompiler::OutputTarget {
+    std::string name;               // Output file, or a description of the stream
+    std::ostream* stream{nullptr};  // Caller's stream; the file is opened when null
+    std::ofstream file;
+    
+    // Open the output; null (after reporting) if the file cannot be opened
+    std::ostream* open(bool binary) {
+        if (stream == nullptr) {
+            file.open(name, binary ? std::ios::out | std::ios::binary : std::ios::out);
+            if (!file.is_open()) {
+                std::cerr << "Error: Could not open output file " << name << std::endl;
+                return nullptr;
+            }
+            stream = &file;
+        }
+        return stream;
+    }
+};
+
 // Compile a C++ file into pPIM instructions
 bool PIMCompiler::compile(const std::string& inputFile, const std::string& outputFile) {
+    // The source and side files are read once: the cache key and the program
+    // come from the same bytes even if the files change meanwhile
+    std::string sourceCode;
+    if (!Utils::readFile(inputFile, sourceCode)) {
+        lastError_ = "Could not open file " + inputFile;
+        std::cerr << "Error: " << lastError_ << std::endl;
+        return false;
+    }
+    Frontend::SideFiles sideFiles;
+    bool sideFilesRead = Frontend::Parser::readSideFiles(sourceCode, inputFile, sideFiles);
+    
+    OutputTarget output;
+    output.name = outputFile;
+    std::string key = cache_ && sideFilesRead ? cacheKey(sourceCode, inputFile, sideFiles) : std::string();
+    if (key.empty()) {
+        return compileProgram(sourceCode, inputFile, &sideFiles, output);
+    }
+    
+    auto lookupStart = Clock::now();
+    if (cache_->lookup(key, outputFile)) {
+        program_.clear();
+        if (verbose_) {
+            std::cout << "Compile cache hit for " << inputFile << " (" << Utils::CompileCache::entryName(key)
+                      << "): wrote " << outputFile << " in " << std::fixed << std::setprecision(2)
+                      << elapsedMs(lookupStart) << " ms" << std::endl;
+            printCacheStats(*cache_);
+        }
+        return true;
+    }
+    
+    if (verbose_) {
+        std::cout << "Compile cache miss for " << inputFile << " ("
+                  << Utils::CompileCache::entryName(key) << ")" << std::endl;
+    }
+    if (!compileProgram(sourceCode, inputFile, &sideFiles, output)) {
+        return false;
+    }
+    output.file.close();
+    
+    bool stored = cache_->store(key, outputFile);
+    if (verbose_) {
+        if (!stored) {
+            std::cout << "Compile cache: output of " << inputFile << " not stored" << std::endl;
+        }
+        printCacheStats(*cache_);
+    }
+    return true;
+}
+
+// Compile C++ source text and write the output to a stream
+bool PIMCompiler::compileSource(const std::string& sourceCode, const std::string& sourceFile, std::ostream& out) {
+    OutputTarget output;
+    output.name = "output stream";
+    output.stream = &out;
+    if (outputFormat_ != OutputFormat::BINARY) {
+        return compileProgram(sourceCode, sourceFile, nullptr, output);
+    }
+    
+    // The object writer completes the header last, so it needs a seekable stream
+    std::stringstream object(std::ios::in | std::ios::out | std::ios::binary);
+    output.stream = &object;
+    if (!compileProgram(sourceCode, sourceFile, nullptr, output)) {
+        return false;
+    }
+    if (!(out << object.rdbuf()) || !out.flush()) {
+        lastError_ = "Failed to write output stream";
+        return false;
+    }
+    return true;
+}
+
+// Parse, optimize and generate a program and write it to the output
+bool PIMCompiler::compileProgram(const std::string& sourceCode, const std::string& inputFile,
+                                 const Frontend::SideFiles* sideFiles, OutputTarget& output) {
+    const std::string& outputFile = output.name;
+    lastError_.clear();
+    
     // Reset the memory mapper
     memoryMapper_->reset();
     
     // Set verbosity on all components
     optimizer_->setVerbose(verbose_);
     codeGenerator_->setVerbose(verbose_);
+    codeGenerator_->setThreads(threads_);
     
     // Set optimization level
     optimizer_->setOptimizationLevel(optimizationLevel_);
@@ -40,10 +235,18 @@ bool PIMCompiler::compile(const std::string& inputFile, const std::string& outpu
     if (verbose_) {
         std::cout << "Compiling " << inputFile << " to " << outputFile << std::endl;
         std::cout << "Optimization level: " << optimizationLevel_ << std::endl;
+        if (threads_ > 1) {
+            std::cout << "Threads: " << threads_ << std::endl;
+        }
+        if (precision_ != PIM_ISA::LUT_OPERAND_BITS) {
+            std::cout << "Operand precision: " << precision_ << " bits" << std::endl;
+        }
     }
     
     // Parse the input file
-    if (!parser_->parseFile(inputFile)) {
+    auto phaseStart = Clock::now();
+    if (!parser_->parseSource(sourceCode, inputFile, sideFiles)) {
+        lastError_ = parser_->getLastError();
         std::cerr << "Error: Failed to parse input file " << inputFile << std::endl;
         return false;
     }
@@ -51,6 +254,7 @@ bool PIMCompiler::compile(const std::string& inputFile, const std::string& outpu
     // Get matrices and operations from the parser
     std::vector<Frontend::MatrixInfo> matrices = parser_->getMatrices();
     std::vector<Frontend::MatrixOperation> operations = parser_->getOperations();
+    parseMs_ = elapsedMs(phaseStart);
     
     if (verbose_) {
         std::cout << "Parsed " << matrices.size() << " matrices and " 
@@ -58,28 +262,206 @@ bool PIMCompiler::compile(const std::string& inputFile, const std::string& outpu
     }
     
     // Apply optimizations to the operations
-    operations = optimizer_->optimizeOperations(operations);
+    phaseStart = Clock::now();
+    operations = optimizer_->optimizeOperations(operations, matrices);
+    operationMs_ = elapsedMs(phaseStart);
     
-    // Generate instructions
-    instructions_ = codeGenerator_->generateInstructions(matrices, operations);
+    if (boundedMemory_) {
+        return compileStreaming(matrices, operations, output);
+    }
     
-    // Apply instruction-level optimizations
-    instructions_ = optimizer_->optimizeInstructions(instructions_);
+    // Build and optimize the loop nests
+    phaseStart = Clock::now();
+    std::vector<IR::Kernel> kernels = codeGenerator_->buildLoopNests(matrices, operations);
+    optimizer_->optimizeLoopNests(kernels);
+    double loopNestMs = elapsedMs(phaseStart);
+    
+    double codegenMs = 0.0;
+    double instructionMs = 0.0;
+    if (incremental_ && output.stream == nullptr) {
+        // Generate and optimize the nests that changed, reuse the others
+        generateIncremental(kernels, Utils::SegmentTable::pathFor(outputFile), codegenMs, instructionMs);
+    } else {
+        generateProgram(kernels, codegenMs, instructionMs);
+    }
     
     // Write the output file
-    if (!codeGenerator_->writeToFile(instructions_, outputFile)) {
+    phaseStart = Clock::now();
+    bool binary = (outputFormat_ == OutputFormat::BINARY);
+    std::ostream* out = output.open(binary);
+    bool written = out != nullptr &&
+        (binary ? codeGenerator_->writeBinary(program_, *out) : codeGenerator_->writeAssembly(program_, *out));
+    if (!written) {
+        lastError_ = "Failed to write " + outputFile;
         std::cerr << "Error: Failed to write output file " << outputFile << std::endl;
         return false;
     }
+    double writeMs = elapsedMs(phaseStart);
     
     if (verbose_) {
         std::cout << "Successfully compiled to " << outputFile << std::endl;
-        std::cout << "Generated " << instructions_.size() << " instructions" << std::endl;
+        std::cout << "Generated " << program_.size() << " instructions ("
+                 << program_.memoryUsage() / 1024 << " KB packed, "
+                 << program_.configs().size() << " LUT configurations)" << std::endl;
+        
+        PIM_ISA::ParallelSimulationSink simulation;
+        program_.replay(simulation);
+        printCycleEstimate(simulation);
+        printBaselineEstimates();
+        
+        std::cout << "Timing:" << std::endl;
+        printPhaseTime("Parsing", parseMs_);
+        printPhaseTime("Operation optimization", operationMs_);
+        printPhaseTime("Loop nest optimization", loopNestMs);
+        printPhaseTime("Code generation", codegenMs);
+        printPhaseTime("Instruction optimization", instructionMs);
+        printPhaseTime("Output writing", writeMs);
+        printOutputThroughput(outputFile, writeMs);
+    }
+    
+    return true;
+}
+
+// Stream code generation through the optimizer into the output file
+bool PIMCompiler::compileStreaming(const std::vector<Frontend::MatrixInfo>& matrices,
+                                   const std::vector<Frontend::MatrixOperation>& operations,
+                                   OutputTarget& target) {
+    const std::string& outputFile = target.name;
+    program_.clear();
+    
+    bool binary = (outputFormat_ == OutputFormat::BINARY);
+    std::ostream* out = target.open(binary);
+    if (out == nullptr) {
+        lastError_ = "Failed to write " + outputFile;
+        std::cerr << "Error: Failed to write output file " << outputFile << std::endl;
+        return false;
+    }
+    std::ostream& file = *out;
+    
+    // Codegen -> optimization passes -> (writer, counter)
+    std::unique_ptr<PIM_ISA::InstructionSink> writer;
+    PIM_ISA::ObjectWriterSink* objectWriter = nullptr;
+    if (binary) {
+        auto sink = std::make_unique<PIM_ISA::ObjectWriterSink>(file);
+        objectWriter = sink.get();
+        writer = std::move(sink);
+    } else {
+        writer = std::make_unique<PIM_ISA::AssemblyWriterSink>(file);
+    }
+    PIM_ISA::CountingSink counter;
+    PIM_ISA::ParallelSimulationSink simulation;
+    PIM_ISA::TeeSink measured(counter, simulation);
+    PIM_ISA::TeeSink output(*writer, verbose_ ? static_cast<PIM_ISA::InstructionSink&>(measured) : counter);
+    
+    auto phaseStart = Clock::now();
+    std::vector<IR::Kernel> kernels = codeGenerator_->buildLoopNests(matrices, operations);
+    optimizer_->optimizeLoopNests(kernels);
+    
+    auto pipeline = optimizer_->createInstructionPipeline(output);
+    codeGenerator_->emitInstructions(kernels, *pipeline);
+    
+    // Matrices are mapped by now; the object writer emits its table on finish
+    if (objectWriter != nullptr) {
+        objectWriter->setMatrixTable(codeGenerator_->getMatrixTable());
+    }
+    
+    if (!pipeline->finish()) {
+        lastError_ = "Failed to write " + outputFile;
+        std::cerr << "Error: Failed to write output file " << outputFile << std::endl;
+        return false;
+    }
+    
+    double streamMs = elapsedMs(phaseStart);
+    
+    if (verbose_) {
+        std::cout << "Successfully compiled to " << outputFile << " (bounded memory)" << std::endl;
+        std::cout << "Generated " << counter.counts().total() << " instructions" << std::endl;
+        printCycleEstimate(simulation);
+        optimizer_->printStats();
+        printBaselineEstimates();
+        
+        std::cout << "Timing:" << std::endl;
+        printPhaseTime("Parsing", parseMs_);
+        printPhaseTime("Operation optimization", operationMs_);
+        printPhaseTime("Generate, optimize, write", streamMs);
+        printOutputThroughput(outputFile, streamMs);
     }
     
     return true;
 }
 
+// Print the estimated execution time without folding, fusion or Strassen splitting and with dense matrices
+void PIMCompiler::printBaselineEstimates() {
+    uint32_t folded = optimizer_->getFoldedOperationCount();
+    if (folded > 0) {
+        Optimizer::Optimizer unfolded(*optimizer_);
+        unfolded.setConstantFolding(false);
+        printBaselineEstimate("Without folding of " + std::to_string(folded) + " product" + (folded == 1 ? "" : "s"),
+                              unfolded);
+    }
+    
+    uint32_t fused = optimizer_->getFusedOperationCount();
+    if (fused > 0) {
+        Optimizer::Optimizer unfused(*optimizer_);
+        unfused.setFusion(false);
+        printBaselineEstimate("Without fusion of " + std::to_string(fused) + " operation" + (fused == 1 ? "" : "s"),
+                              unfused);
+    }
+    
+    uint32_t split = optimizer_->getStrassenSplitCount();
+    if (split > 0) {
+        Optimizer::Optimizer classic(*optimizer_);
+        classic.setStrassenThreshold(0);
+        printBaselineEstimate("Classic schedule without " + std::to_string(split) + " Strassen split" +
+                              (split == 1 ? "" : "s"), classic);
+    }
+    
+    size_t sparse = 0;
+    for (const auto& matrix : parser_->getMatrices()) {
+        sparse += matrix.nonzeros ? 1 : 0;
+    }
+    if (sparse > 0) {
+        Optimizer::Optimizer dense(*optimizer_);
+        printBaselineEstimate("Dense layout of " + std::to_string(sparse) + " sparse matri" +
+                              (sparse == 1 ? "x" : "ces"), dense, true);
+    }
+}
+
+// Print the estimated execution time of the program compiled by another optimizer
+void PIMCompiler::printBaselineEstimate(const std::string& label, Optimizer::Optimizer& baseline, bool dense) {
+    // Same pipeline as the real compilation, on separate components
+    baseline.setVerbose(false);
+    
+    try {
+        std::vector<Frontend::MatrixInfo> matrices = parser_->getMatrices();
+        if (dense) {
+            for (auto& matrix : matrices) {
+                matrix.nonzeros.reset();
+            }
+        }
+        std::vector<Frontend::MatrixOperation> operations =
+            baseline.optimizeOperations(parser_->getOperations(), matrices);
+        
+        Backend::CodeGenerator generator(std::make_shared<MemoryMap::MemoryMapper>());
+        generator.setThreads(threads_);
+        generator.setPrecision(precision_);
+        std::vector<IR::Kernel> kernels = generator.buildLoopNests(matrices, operations);
+        baseline.optimizeLoopNests(kernels);
+        
+        PIM_ISA::CountingSink counter;
+        PIM_ISA::ParallelSimulationSink simulation;
+        PIM_ISA::TeeSink measured(counter, simulation);
+        auto pipeline = baseline.createInstructionPipeline(measured);
+        generator.emitInstructions(kernels, *pipeline);
+        pipeline->finish();
+        
+        std::cout << label << ": " << simulation.totalCycles() << " cycles (" << simulation.sequentialCycles()
+                  << " sequential, " << counter.counts().total() << " instructions)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cout << label << ": not estimated (" << e.what() << ")" << std::endl;
+    }
+}
+
 // Set optimization level
 void PIMCompiler::setOptimizationLevel(int level) {
     optimizationLevel_ = level;
@@ -90,8 +472,223 @@ void PIMCompiler::setVerbose(bool verbose) {
     verbose_ = verbose;
 }
 
+// Set output file format
+void PIMCompiler::setOutputFormat(OutputFormat format) {
+    outputFormat_ = format;
+}
+
+// Set bounded-memory mode
+void PIMCompiler::setBoundedMemory(bool boundedMemory) {
+    boundedMemory_ = boundedMemory;
+}
+
+// Set the number of threads
+void PIMCompiler::setThreads(unsigned threads) {
+    threads_ = std::max(1u, threads);
+}
+
+// Force the tile size for blocked matrix multiplication
+bool PIMCompiler::setTileSize(uint32_t rows, uint32_t cols) {
+    if (!optimizer_->setTileSize(rows, cols)) {
+        return false;
+    }
+    tileRows_ = rows;
+    tileCols_ = cols;
+    return true;
+}
+
+// Enable or disable fusing sums into products
+void PIMCompiler::setFusion(bool fusion) {
+    optimizer_->setFusion(fusion);
+    fusion_ = fusion;
+}
+
+// Split square products of at least a given size
+void PIMCompiler::setStrassenThreshold(uint32_t threshold) {
+    optimizer_->setStrassenThreshold(threshold);
+    strassenThreshold_ = threshold;
+}
+
+// Set the operand width
+bool PIMCompiler::setPrecision(uint32_t bits) {
+    if (!codeGenerator_->setPrecision(bits)) {
+        return false;
+    }
+    optimizer_->setElementWidth(bits / PIM_ISA::LUT_OPERAND_BITS);
+    precision_ = bits;
+    return true;
+}
+
+// Cache outputs in a directory shared by compiler runs
+bool PIMCompiler::setCache(const std::string& directory, uint64_t maxBytes) {
+    try {
+        cache_ = std::make_unique<Utils::CompileCache>(directory, maxBytes);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Generate the instructions of the loop nests and optimize the whole program
+void PIMCompiler::generateProgram(const std::vector<IR::Kernel>& kernels, double& codegenMs, double& instructionMs) {
+    // Generate instructions
+    auto phaseStart = Clock::now();
+    program_.clear();
+    PIM_ISA::PackedProgramSink programSink(program_);
+    codeGenerator_->emitInstructions(kernels, programSink);
+    codegenMs += elapsedMs(phaseStart);
+    
+    // Apply instruction-level optimizations
+    phaseStart = Clock::now();
+    program_ = optimizer_->optimizeInstructions(program_);
+    instructionMs += elapsedMs(phaseStart);
+}
+
+// Generate the program, reusing the segments of unchanged loop nests
+void PIMCompiler::generateIncremental(const std::vector<IR::Kernel>& kernels, const std::string& tableFile,
+                                      double& codegenMs, double& instructionMs) {
+    Utils::SegmentTable table;
+    table.compiler = compilerIdentity();
+    table.options = optionsKey();
+    table.layout = layoutKey();
+    
+    // Addresses are baked into the instructions, so segments of another
+    // layout (or compiler, or options) are never reused
+    Utils::SegmentTable previous;
+    bool loaded = previous.load(tableFile);
+    bool layoutKept = loaded && previous.compiler == table.compiler && previous.options == table.options &&
+                      previous.layout == table.layout;
+    std::unordered_map<std::string, const PIM_ISA::PackedProgram*> reusable;
+    if (layoutKept) {
+        for (const auto& segment : previous.segments) {
+            reusable.emplace(segment.first, &segment.second);
+        }
+    }
+    
+    // The key of a nest depends on the cores the nests before it programmed
+    std::vector<std::string> keys;
+    std::vector<int> coreOps = Backend::CodeGenerator::initialCoreState();
+    for (const auto& kernel : kernels) {
+        keys.push_back(segmentKey(kernel, coreOps));
+        for (const auto& setup : kernel.cores) {
+            coreOps[setup.core] = static_cast<int>(setup.opType);
+        }
+    }
+    
+    incrementalStats_ = IncrementalStats();
+    incrementalStats_.nests = static_cast<uint32_t>(kernels.size());
+    for (const auto& key : keys) {
+        incrementalStats_.reused += reusable.count(key) > 0 ? 1 : 0;
+    }
+    incrementalStats_.fullBuild = incrementalStats_.reused == 0;
+    
+    // Every segment is optimized on its own, whether it is generated now or
+    // was by an earlier build, so the program only depends on the keys: a
+    // full build and one that reuses segments write the same bytes
+    Optimizer::Optimizer segmentOptimizer;
+    segmentOptimizer.setOptimizationLevel(optimizationLevel_);
+    
+    program_.clear();
+    coreOps = Backend::CodeGenerator::initialCoreState();
+    for (size_t i = 0; i < kernels.size(); ++i) {
+        auto found = reusable.find(keys[i]);
+        PIM_ISA::PackedProgram segment;
+        if (found != reusable.end()) {
+            segment = *found->second;
+            for (const auto& setup : kernels[i].cores) {
+                coreOps[setup.core] = static_cast<int>(setup.opType);
+            }
+        } else {
+            auto phaseStart = Clock::now();
+            PIM_ISA::PackedProgram generated;
+            PIM_ISA::PackedProgramSink sink(generated);
+            codeGenerator_->emitKernel(kernels[i], coreOps, sink);
+            codegenMs += elapsedMs(phaseStart);
+            
+            phaseStart = Clock::now();
+            segment = segmentOptimizer.optimizeInstructions(generated);
+            instructionMs += elapsedMs(phaseStart);
+        }
+        
+        program_.appendProgram(segment);
+        table.segments.emplace_back(keys[i], std::move(segment));
+    }
+    
+    PIM_ISA::PackedProgram end;
+    end.append(PIM_ISA::createEndInstruction());
+    program_.appendProgram(segmentOptimizer.optimizeInstructions(end));
+    
+    bool saved = table.save(tableFile);
+    if (!saved) {
+        std::cerr << "Warning: Could not write segment table " << tableFile << std::endl;
+    }
+    
+    if (verbose_) {
+        if (loaded && !layoutKept) {
+            std::cout << "Incremental build: compiler, options or memory layout changed, rebuilding every loop nest"
+                      << std::endl;
+        }
+        std::cout << "Incremental build: reused " << incrementalStats_.reused << " of "
+                  << incrementalStats_.nests << " loop nests" << std::endl;
+    }
+}
+
+// Describe the options that change the generated program
+std::string PIMCompiler::optionsKey() const {
+    std::ostringstream key;
+    key << "-O" << optimizationLevel_
+        << " -ftile=" << tileRows_ << "x" << tileCols_
+        << (fusion_ ? "" : " -fno-fusion")
+        << " -fstrassen=" << strassenThreshold_
+        << " -fprecision=" << precision_;
+    return key.str();
+}
+
+// Describe the placement of every matrix in memory
+std::string PIMCompiler::layoutKey() const {
+    std::ostringstream key;
+    for (const auto& name : memoryMapper_->getMatrixNames()) {
+        auto dimensions = memoryMapper_->getMatrixDimensions(name);
+        auto range = memoryMapper_->getMatrixAddressRange(name);
+        key << name << " " << dimensions.rows << "x" << dimensions.cols << " " << range.startAddress << "-"
+            << range.endAddress << " " << memoryMapper_->getBatchSize(name)
+            << (memoryMapper_->isView(name) ? " view" : "") << "\n";
+    }
+    return key.str();
+}
+
+// Describe a compilation for the compile cache
+std::string PIMCompiler::cacheKey(const std::string& sourceCode, const std::string& inputFile,
+                                  const Frontend::SideFiles& sideFiles) const {
+    // Only options that change the output; threads and bounded memory do not
+    std::ostringstream key;
+    key << "compiler " << compilerIdentity() << "\n"
+        << "options " << optionsKey() << (outputFormat_ == OutputFormat::BINARY ? " -fbinary" : "") << "\n";
+    
+    std::string source = Utils::CompileCache::normalizeSource(sourceCode);
+    key << "source " << source.size() << "\n" << source << "\n";
+    
+    // Side files in source order: their contents, not their names, decide the output
+    for (const auto& path : Frontend::Parser::findSideFiles(sourceCode, inputFile)) {
+        const std::string& contents = sideFiles.at(path);
+        key << "side " << contents.size() << "\n" << contents << "\n";
+    }
+    return key.str();
+}
+
+// Reuse the instructions of unchanged operations of the previous build
+void PIMCompiler::setIncremental(bool incremental) {
+    incremental_ = incremental;
+}
+
 // Get generated instructions
 std::vector<PIM_ISA::Instruction> PIMCompiler::getInstructions() const {
-    return instructions_;
+    return program_.toInstructions();
+}
+
+// Get the generated program in packed form
+const PIM_ISA::PackedProgram& PIMCompiler::getProgram() const {
+    return program_;
 }
 
@@ -1,8 +1,12 @@
 #include "../../include/frontend/parser.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cctype>
+#include <functional>
 #include <regex>
+#include <set>
 #include <stdexcept>
 
 namespace Frontend {
@@ -13,10 +17,6 @@ Parser::Parser() {
 
 // Parse source file
 bool Parser::parseFile(const std::string& sourceFile) {
-    // Clear previous data
-    matrices_.clear();
-    operations_.clear();
-    
     // Open the file
     std::ifstream file(sourceFile);
     if (!file.is_open()) {
@@ -27,17 +27,32 @@ bool Parser::parseFile(const std::string& sourceFile) {
     // Read file contents
     std::stringstream buffer;
     buffer << file.rdbuf();
-    std::string sourceCode = buffer.str();
+    return parseSource(buffer.str(), sourceFile);
+}
+
+// Parse source text
+bool Parser::parseSource(const std::string& sourceCode, const std::string& sourceFile, const SideFiles* sideFiles) {
+    // Clear previous data
+    matrices_.clear();
+    operations_.clear();
+    assignments_.clear();
+    temporaryCounts_.clear();
+    lastElementWrites_.clear();
+    lastError_.clear();
     
     try {
         // Parse matrix declarations
         parseMatrixDeclarations(sourceCode);
+        parseSparsityAnnotations(sourceCode, sourceFile, sideFiles);
+        parseConstantValues(sourceCode);
         
         // Parse matrix operations
         parseMatrixOperations(sourceCode);
+        parseBatchedProducts(sourceCode);
         
         return true;
     } catch (const std::exception& e) {
+        lastError_ = e.what();
         std::cerr << "Error parsing file: " << e.what() << std::endl;
         return false;
     }
@@ -97,64 +112,763 @@ void Parser::parseMatrixDeclarations(const std::string& sourceCode) {
             matrices_.insert(std::make_pair(name, MatrixInfo(name, rows, cols, true, false)));
         }
     }
+    
+    // Regex for batch declarations like: std::vector<Matrix> A(64, Matrix(8, 6));
+    std::regex batchDeclRegex(
+        R"(std::vector\s*<\s*Matrix(?:<\w+>)?\s*>\s+(\w+)\s*\(\s*(\d+)\s*,)"
+        R"(\s*Matrix(?:<\w+>)?\s*\(\s*(\d+)\s*,\s*(\d+)\s*\)\s*\))");
+    
+    for (auto i = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), batchDeclRegex); i != end; ++i) {
+        std::smatch match = *i;
+        std::string name = match[1].str();
+        uint32_t count = std::stoi(match[2].str());
+        if (count == 0) {
+            throw std::runtime_error("Batch '" + name + "' has no matrices");
+        }
+        
+        MatrixInfo batch(name, std::stoi(match[3].str()), std::stoi(match[4].str()), true, false);
+        batch.batch = count;
+        matrices_.insert(std::make_pair(name, batch));
+    }
+}
+
+namespace {
+
+// Regex for annotations like: #pragma pim sparse(W, "W.nnz")
+const std::regex& sparseAnnotationRegex() {
+    static const std::regex sparseRegex(R"regex(#\s*pragma\s+pim\s+sparse\s*\(\s*(\w+)\s*,\s*"([^"]*)"\s*\))regex");
+    return sparseRegex;
+}
+
+// Resolve the path of a side file; relative paths are found next to the source
+std::string resolveSideFile(const std::string& path, const std::string& sourceFile) {
+    size_t slash = sourceFile.find_last_of('/');
+    if (!path.empty() && path[0] != '/' && slash != std::string::npos) {
+        return sourceFile.substr(0, slash + 1) + path;
+    }
+    return path;
+}
+
+} // namespace
+
+// Find the side files a source file reads
+std::vector<std::string> Parser::findSideFiles(const std::string& sourceCode, const std::string& sourceFile) {
+    std::vector<std::string> paths;
+    auto begin = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), sparseAnnotationRegex());
+    for (auto i = begin; i != std::sregex_iterator(); ++i) {
+        paths.push_back(resolveSideFile((*i)[2].str(), sourceFile));
+    }
+    return paths;
+}
+
+// Read the side files a source file reads
+bool Parser::readSideFiles(const std::string& sourceCode, const std::string& sourceFile, SideFiles& sideFiles) {
+    bool complete = true;
+    for (const auto& path : findSideFiles(sourceCode, sourceFile)) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            complete = false;
+            continue;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        sideFiles[path] = contents.str();
+    }
+    return complete;
+}
+
+// Parse sparsity annotations
+void Parser::parseSparsityAnnotations(const std::string& sourceCode, const std::string& sourceFile,
+                                      const SideFiles* sideFiles) {
+    auto begin = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), sparseAnnotationRegex());
+    auto end = std::sregex_iterator();
+    
+    for (std::sregex_iterator i = begin; i != end; ++i) {
+        std::smatch match = *i;
+        std::string name = match[1].str();
+        std::string path = resolveSideFile(match[2].str(), sourceFile);
+        
+        auto it = matrices_.find(name);
+        if (it == matrices_.end()) {
+            throw std::runtime_error("Sparse matrix '" + name + "' is not declared");
+        }
+        MatrixInfo& matrix = it->second;
+        if (matrix.batch > 0) {
+            throw std::runtime_error("Batch '" + name + "' cannot be sparse");
+        }
+        
+        // Side files read by the caller are not read again
+        std::stringstream file;
+        bool opened = false;
+        if (sideFiles != nullptr) {
+            auto contents = sideFiles->find(path);
+            opened = contents != sideFiles->end();
+            if (opened) {
+                file.str(contents->second);
+            }
+        } else {
+            std::ifstream disk(path);
+            opened = disk.is_open();
+            if (opened) {
+                file << disk.rdbuf();
+            }
+        }
+        if (!opened) {
+            throw std::runtime_error("Could not open nonzero list " + path + " of matrix '" + name + "'");
+        }
+        
+        auto nonzeros = std::make_shared<Coordinates>();
+        std::string line;
+        uint32_t lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+            
+            std::istringstream fields(line);
+            long long row = 0;
+            long long col = 0;
+            std::string rest;
+            if (!(fields >> row)) {
+                continue;
+            }
+            if (!(fields >> col) || (fields >> rest) || row < 0 || col < 0 ||
+                row >= matrix.rows || col >= matrix.cols) {
+                throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected a row and column of " +
+                                         name + "(" + std::to_string(matrix.rows) + "x" +
+                                         std::to_string(matrix.cols) + ")");
+            }
+            nonzeros->emplace_back(static_cast<uint32_t>(row), static_cast<uint32_t>(col));
+        }
+        
+        std::sort(nonzeros->begin(), nonzeros->end());
+        nonzeros->erase(std::unique(nonzeros->begin(), nonzeros->end()), nonzeros->end());
+        matrix.nonzeros = nonzeros;
+    }
+}
+
+namespace {
+
+// Text without leading and trailing whitespace
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+// Parse a numeric literal such as 1, -0.5 or 2.0f
+bool parseNumber(const std::string& text, double& value) {
+    static const std::regex numberRegex(R"(\s*([-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?)[fF]?\s*)");
+    std::smatch match;
+    if (!std::regex_match(text, match, numberRegex)) {
+        return false;
+    }
+    value = std::stod(match[1].str());
+    return true;
+}
+
+// Parse an integer literal used as a row or column index
+bool parseIndex(const std::string& text, uint32_t& index) {
+    static const std::regex indexRegex(R"(\s*(\d{1,9})[uU]?\s*)");
+    std::smatch match;
+    if (!std::regex_match(text, match, indexRegex)) {
+        return false;
+    }
+    index = static_cast<uint32_t>(std::stoul(match[1].str()));
+    return true;
+}
+
+// Split the inside of a brace-enclosed list at its top-level commas (blank items are dropped)
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::string item;
+    int depth = 0;
+    for (char ch : text + ",") {
+        if (ch == ',' && depth == 0) {
+            item = trim(item);
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+            item.clear();
+            continue;
+        }
+        depth += ch == '{' ? 1 : ch == '}' ? -1 : 0;
+        item += ch;
+    }
+    return items;
+}
+
+// Whether an item of an initializer list is itself a brace-enclosed list
+bool isList(const std::string& item) {
+    return item.size() >= 2 && item.front() == '{' && item.back() == '}';
+}
+
+} // namespace
+
+// Parse constant element values
+void Parser::parseConstantValues(const std::string& sourceCode) {
+    // Regex for initializer lists like: Matrix I(2, 2) = {1, 0, 0, 1}; or Matrix I(2, 2) = {{1, 0}, {0, 1}};
+    std::regex initializerRegex(R"(Matrix(?:<\w+>)?\s+(\w+)\s*\(\s*\d+\s*,\s*\d+\s*\)\s*=\s*(\{[^;]*\})\s*;)");
+    
+    // Regex for element assignments like: I(0, 0) = 1; or A(i, j) += x;
+    std::regex elementRegex(R"((\w+)\s*\(([^(){};]*),([^(){};]*)\)\s*(<<|>>|[-+*/%&|^]?)=([^=;][^;]*);)");
+    
+    std::map<std::string, std::vector<double>> constants;
+    std::set<std::string> computed;
+    
+    auto end = std::sregex_iterator();
+    for (auto i = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), initializerRegex); i != end; ++i) {
+        std::smatch match = *i;
+        auto it = matrices_.find(match[1].str());
+        if (it == matrices_.end()) {
+            continue;
+        }
+        const MatrixInfo& matrix = it->second;
+        std::string shape = "'" + matrix.name + "' (" + std::to_string(matrix.rows) + "x" +
+                            std::to_string(matrix.cols) + ")";
+        
+        // A flat list fills the matrix in row-major order, a list of lists row by row
+        std::string list = match[2].str();
+        std::vector<std::string> items = splitList(list.substr(1, list.size() - 2));
+        bool nested = std::any_of(items.begin(), items.end(), isList);
+        std::vector<double> values(static_cast<size_t>(matrix.rows) * matrix.cols, 0.0);
+        bool constant = true;
+        if (nested) {
+            if (items.size() > matrix.rows) {
+                throw std::runtime_error("Initializer of matrix " + shape + " has too many rows");
+            }
+            for (size_t row = 0; row < items.size() && constant; ++row) {
+                std::vector<std::string> elements;
+                if (isList(items[row])) {
+                    elements = splitList(items[row].substr(1, items[row].size() - 2));
+                }
+                if (elements.size() > matrix.cols) {
+                    throw std::runtime_error("Initializer of matrix " + shape + " has too many columns in row " +
+                                             std::to_string(row));
+                }
+                for (size_t col = 0; col < elements.size() && constant; ++col) {
+                    constant = parseNumber(elements[col], values[row * matrix.cols + col]);
+                }
+                constant = constant && isList(items[row]);
+            }
+        } else {
+            if (items.size() > values.size()) {
+                throw std::runtime_error("Initializer of matrix " + shape + " has too many elements");
+            }
+            for (size_t n = 0; n < items.size() && constant; ++n) {
+                constant = parseNumber(items[n], values[n]);
+            }
+        }
+        
+        // Lists of run-time values initialize the matrix when the program runs
+        if (constant) {
+            constants[matrix.name] = std::move(values);
+        } else {
+            computed.insert(matrix.name);
+        }
+    }
+    
+    for (auto i = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), elementRegex); i != end; ++i) {
+        std::smatch match = *i;
+        auto it = matrices_.find(match[1].str());
+        if (it == matrices_.end() || it->second.batch > 0) {
+            continue;
+        }
+        const MatrixInfo& matrix = it->second;
+        
+        // Only whole statements assign elements; this skips declarations
+        // such as Matrix I(2, 2) = {...}
+        size_t position = static_cast<size_t>(match.position(0));
+        size_t previous = position == 0 ? std::string::npos : sourceCode.find_last_not_of(" \t\r\n", position - 1);
+        if (previous != std::string::npos && std::string(";{})").find(sourceCode[previous]) == std::string::npos) {
+            continue;
+        }
+        
+        uint32_t row = 0;
+        uint32_t col = 0;
+        double value = 0.0;
+        if (match[4].length() > 0 || !parseIndex(match[2].str(), row) || !parseIndex(match[3].str(), col) ||
+            !parseNumber(match[5].str(), value)) {
+            computed.insert(matrix.name);
+            continue;
+        }
+        if (row >= matrix.rows || col >= matrix.cols) {
+            throw std::runtime_error("Element (" + std::to_string(row) + ", " + std::to_string(col) +
+                                     ") is outside matrix '" + matrix.name + "' (" + std::to_string(matrix.rows) +
+                                     "x" + std::to_string(matrix.cols) + ")");
+        }
+        
+        auto& values = constants[matrix.name];
+        values.resize(static_cast<size_t>(matrix.rows) * matrix.cols, 0.0);
+        values[static_cast<size_t>(row) * matrix.cols + col] = value;
+        lastElementWrites_[matrix.name] = position;
+    }
+    
+    for (auto& constant : constants) {
+        if (!computed.count(constant.first)) {
+            matrices_.at(constant.first).values =
+                std::make_shared<const std::vector<double>>(std::move(constant.second));
+        }
+    }
 }
 
 // Parse matrix operations
 void Parser::parseMatrixOperations(const std::string& sourceCode) {
-    // Regex for matrix multiplications like: C = A * B;
-    std::regex multiplyRegex(R"((\w+)\s*=\s*(\w+)\s*\*\s*(\w+)\s*;)");
+    // Regex for assignments of matrix expressions like: C = A * B; or E = A * (B * C)^T + D;
+    std::regex assignmentRegex(R"((\w+)\s*=\s*([\w\s\*\+\-\^\.\(\)]+?)\s*;)");
     
     // Start matching from the beginning of the source code
-    auto begin = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), multiplyRegex);
+    auto begin = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), assignmentRegex);
     auto end = std::sregex_iterator();
     
     for (std::sregex_iterator i = begin; i != end; ++i) {
         std::smatch match = *i;
-        if (match.size() == 4) {
-            std::string outputName = match[1].str();
-            std::string inputName1 = match[2].str();
-            std::string inputName2 = match[3].str();
-            
-            // Verify that input matrices exist
-            if (!hasMatrix(inputName1)) {
-                throw std::runtime_error("Matrix '" + inputName1 + "' used in operation but not declared");
+        std::string outputName = match[1].str();
+        
+        // Only products, sums, differences and transposes are operations; anything else is ordinary C++
+        Expression expression;
+        if (!parseExpression(match[2].str(), expression) || expression.kind == ExpressionKind::MATRIX) {
+            continue;
+        }
+        
+        // Elements assigned after this reads them are not constant for it
+        size_t position = static_cast<size_t>(match.position(0));
+        std::function<void(const Expression&)> dropLaterConstants = [&](const Expression& operand) {
+            for (const auto& nested : operand.operands) {
+                dropLaterConstants(nested);
             }
-            
-            if (!hasMatrix(inputName2)) {
-                throw std::runtime_error("Matrix '" + inputName2 + "' used in operation but not declared");
+            auto write = lastElementWrites_.find(operand.matrix);
+            if (operand.kind == ExpressionKind::MATRIX && write != lastElementWrites_.end() &&
+                write->second > position) {
+                matrices_.at(operand.matrix).values.reset();
             }
-            
-            // Create or update output matrix
-            if (!hasMatrix(outputName)) {
-                // If output matrix doesn't exist, we need to create it
-                // For matrix multiplication, dimensions are: (A.rows, B.cols)
-                const MatrixInfo& inputMatrix1 = getMatrixInfo(inputName1);
-                const MatrixInfo& inputMatrix2 = getMatrixInfo(inputName2);
-                
-                // Validate dimensions for matrix multiplication
-                if (inputMatrix1.cols != inputMatrix2.rows) {
-                    throw std::runtime_error("Invalid matrix dimensions for multiplication: " + 
-                                            inputName1 + "(" + std::to_string(inputMatrix1.rows) + "x" + std::to_string(inputMatrix1.cols) + ") * " +
-                                            inputName2 + "(" + std::to_string(inputMatrix2.rows) + "x" + std::to_string(inputMatrix2.cols) + ")");
-                }
-                
-                // Create output matrix with correct dimensions
-                matrices_.insert(std::make_pair(outputName, MatrixInfo(outputName, inputMatrix1.rows, inputMatrix2.cols, false, true)));
+        };
+        dropLaterConstants(expression);
+        
+        // Create or update output matrix
+        if (hasMatrix(outputName) && matrices_.at(outputName).nonzeros) {
+            throw std::runtime_error("Sparse matrix '" + outputName + "' cannot be assigned");
+        }
+        if (hasMatrix(outputName) && matrices_.at(outputName).batch > 0) {
+            throw std::runtime_error("Batch '" + outputName + "' can only be assigned item by item");
+        }
+        if (!hasMatrix(outputName)) {
+            // If output matrix doesn't exist, it takes the dimensions of the expression
+            matrices_.insert(std::make_pair(outputName, MatrixInfo(outputName, expression.rows, expression.cols, false, true)));
+        }
+        
+        // Mark output matrix as an output
+        auto it = matrices_.find(outputName);
+        if (it != matrices_.end()) {
+            it->second.isOutput = true;
+            it->second.values.reset();
+        }
+        
+        // Add the operations computing it
+        lowerExpression(expression, outputName, outputName);
+        assignments_.push_back(Assignment{outputName, std::move(expression)});
+    }
+}
+
+// Parse batched products
+void Parser::parseBatchedProducts(const std::string& sourceCode) {
+    // Regex for batched products like: C[b] = A[b] * B[b];
+    std::regex productRegex(R"((\w+)\s*\[\s*(\w+)\s*\]\s*=\s*(\w+)\s*\[\s*\2\s*\]\s*\*\s*(\w+)\s*\[\s*\2\s*\]\s*;)");
+    
+    // Regex for loops over a batch like: for (int b = 0; b < 64; ++b) or for (size_t b = 0; b < A.size(); b++)
+    std::regex loopRegex(
+        R"(for\s*\(\s*(?:[\w:]+\s+)*(\w+)\s*=\s*0\s*;)"
+        R"(\s*\1\s*<\s*(\d+|\w+\s*\.\s*size\s*\(\s*\))\s*;\s*(?:\+\+\s*\1|\1\s*\+\+)\s*\))");
+    
+    // Regex for any indexing like: C[0] or A[b + 1]
+    std::regex indexRegex(R"((\w+)\s*\[)");
+    
+    auto end = std::sregex_iterator();
+    std::vector<std::pair<size_t, size_t>> productSpans;
+    for (auto i = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), productRegex); i != end; ++i) {
+        std::smatch match = *i;
+        productSpans.emplace_back(static_cast<size_t>(match.position(0)),
+                                  static_cast<size_t>(match.position(0) + match.length(0)));
+        std::string index = match[2].str();
+        std::string names[] = {match[1].str(), match[3].str(), match[4].str()};
+        std::string statement = names[0] + "[" + index + "] = " + names[1] + "[" + index + "] * " +
+                                names[2] + "[" + index + "]";
+        
+        for (const auto& name : names) {
+            if (!hasMatrix(name)) {
+                throw std::runtime_error("Batch '" + name + "' used in operation but not declared");
             }
-            
-            // Mark output matrix as an output
-            auto it = matrices_.find(outputName);
-            if (it != matrices_.end()) {
-                it->second.isOutput = true;
+            if (matrices_.at(name).batch == 0) {
+                throw std::runtime_error("Matrix '" + name + "' in " + statement + " is not a batch; declare it as "
+                                         "std::vector<Matrix> " + name + "(<count>, Matrix(<rows>, <cols>))");
             }
-            
-            // Add operation
-            std::vector<std::string> inputs = {inputName1, inputName2};
-            operations_.push_back(MatrixOperation(OperationType::MULTIPLY, inputs, outputName));
         }
+        MatrixInfo& c = matrices_.at(names[0]);
+        const MatrixInfo& a = matrices_.at(names[1]);
+        const MatrixInfo& b = matrices_.at(names[2]);
+        
+        if (a.batch != b.batch || a.batch != c.batch) {
+            throw std::runtime_error("Batches of " + statement + " have different sizes (" +
+                                     std::to_string(c.batch) + ", " + std::to_string(a.batch) + ", " +
+                                     std::to_string(b.batch) + ")");
+        }
+        if (a.cols != b.rows) {
+            throw std::runtime_error("Invalid matrix dimensions for batched multiplication: " + a.name + "[" + index +
+                                     "](" + std::to_string(a.rows) + "x" + std::to_string(a.cols) + ") * " +
+                                     b.name + "[" + index + "](" + std::to_string(b.rows) + "x" +
+                                     std::to_string(b.cols) + ")");
+        }
+        if (c.rows != a.rows || c.cols != b.cols) {
+            throw std::runtime_error("Batch '" + c.name + "' (" + std::to_string(c.rows) + "x" +
+                                     std::to_string(c.cols) + ") cannot hold the products of " + statement);
+        }
+        
+        // The statement must run for every item: the nearest loop over its
+        // index before it counts from 0 to the batch size
+        size_t position = static_cast<size_t>(match.position(0));
+        uint32_t count = 0;
+        for (auto loop = std::sregex_iterator(sourceCode.begin(), sourceCode.begin() + position, loopRegex);
+             loop != end; ++loop) {
+            if ((*loop)[1].str() != index) {
+                continue;
+            }
+            std::string bound = (*loop)[2].str();
+            std::string sized = bound.substr(0, bound.find_first_of(" \t\r\n."));
+            if (std::isdigit(static_cast<unsigned char>(bound[0]))) {
+                count = static_cast<uint32_t>(std::stoul(bound));
+            } else {
+                count = hasMatrix(sized) ? matrices_.at(sized).batch : 0;
+            }
+        }
+        if (count != a.batch) {
+            throw std::runtime_error(statement + " must be in a loop over all " + std::to_string(a.batch) +
+                                     " items: for (int " + index + " = 0; " + index + " < " +
+                                     std::to_string(a.batch) + "; ++" + index + ")");
+        }
+        
+        c.isOutput = true;
+        operations_.push_back(MatrixOperation(OperationType::BATCH_MULTIPLY, {a.name, b.name}, c.name));
+    }
+    
+    // Items of a batch are only supported in batched products; any other
+    // use would otherwise be skipped as ordinary C++
+    for (auto i = std::sregex_iterator(sourceCode.begin(), sourceCode.end(), indexRegex); i != end; ++i) {
+        std::string name = (*i)[1].str();
+        size_t position = static_cast<size_t>(i->position(0));
+        if (!hasMatrix(name) || matrices_.at(name).batch == 0) {
+            continue;
+        }
+        bool inProduct = std::any_of(productSpans.begin(), productSpans.end(), [&](const auto& span) {
+            return position >= span.first && position < span.second;
+        });
+        if (!inProduct) {
+            size_t lineStart = sourceCode.find_last_of("\n;{}", position);
+            lineStart = lineStart == std::string::npos ? 0 : lineStart + 1;
+            size_t lineEnd = sourceCode.find_first_of("\n;", position);
+            std::string statement = sourceCode.substr(lineStart, lineEnd == std::string::npos
+                                                                     ? std::string::npos
+                                                                     : lineEnd - lineStart);
+            statement.erase(0, statement.find_first_not_of(" \t\r"));
+            throw std::runtime_error("Batch '" + name + "' can only be used in batched products like " + name +
+                                     "[b] = A[b] * B[b] in a loop over its items, not in: " + statement);
+        }
+    }
+}
+
+namespace {
+
+// Split expression text into identifiers, '*', '+', '-', '^', '.', '(' and ')'; false on any other character
+bool tokenize(const std::string& text, std::vector<std::string>& tokens) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pos++;
+        } else if (c == '*' || c == '+' || c == '-' || c == '^' || c == '.' || c == '(' || c == ')') {
+            tokens.emplace_back(1, c);
+            pos++;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t start = pos;
+            while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')) {
+                pos++;
+            }
+            tokens.push_back(text.substr(start, pos - start));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Format an operand of a product, with its dimensions
+std::string describeOperand(const Expression& operand) {
+    return operand.toString() + "(" + std::to_string(operand.rows) + "x" + std::to_string(operand.cols) + ")";
+}
+
+} // namespace
+
+// Format an expression as source text
+std::string Expression::toString() const {
+    if (kind == ExpressionKind::MATRIX) {
+        return matrix;
+    }
+    if (kind == ExpressionKind::TRANSPOSE) {
+        const Expression& operand = operands[0];
+        return (operand.kind == ExpressionKind::MATRIX ? operand.toString() : "(" + operand.toString() + ")") + "^T";
+    }
+    if (kind != ExpressionKind::MULTIPLY) {
+        // Sums are left-associative, so only a sum on the right needs parentheses
+        const Expression& right = operands[1];
+        bool group = right.kind == ExpressionKind::ADD || right.kind == ExpressionKind::SUBTRACT;
+        return operands[0].toString() + (kind == ExpressionKind::ADD ? " + " : " - ") +
+               (group ? "(" + right.toString() + ")" : right.toString());
+    }
+    std::string text;
+    for (size_t i = 0; i < operands.size(); ++i) {
+        if (i > 0) {
+            text += " * ";
+        }
+        const Expression& operand = operands[i];
+        text += operand.kind == ExpressionKind::MATRIX ? operand.toString() : "(" + operand.toString() + ")";
+    }
+    return text;
+}
+
+// Parse the right-hand side of an assignment
+bool Parser::parseExpression(const std::string& text, Expression& expression) {
+    std::vector<std::string> tokens;
+    if (!tokenize(text, tokens)) {
+        return false;
+    }
+    
+    // Recursive descent over:
+    //   sum := product (('+' | '-') product)*
+    //   product := factor ('*' factor)*
+    //   factor := (name | '(' sum ')') ('^' 'T' | '.' 'transpose' '(' ')')*
+    size_t pos = 0;
+    std::function<bool(Expression&)> parseSum;
+    auto isOperator = [](const std::string& token) {
+        return token == "*" || token == "+" || token == "-" || token == "^" || token == "." || token == ")";
+    };
+    auto accept = [&](std::initializer_list<const char*> expected) {
+        size_t next = pos;
+        for (const char* token : expected) {
+            if (next >= tokens.size() || tokens[next] != token) {
+                return false;
+            }
+            next++;
+        }
+        pos = next;
+        return true;
+    };
+    auto parseFactor = [&](Expression& factor) {
+        if (pos >= tokens.size()) {
+            return false;
+        }
+        if (tokens[pos] == "(") {
+            pos++;
+            if (!parseSum(factor) || pos >= tokens.size() || tokens[pos] != ")") {
+                return false;
+            }
+            pos++;
+        } else if (isOperator(tokens[pos])) {
+            return false;
+        } else {
+            factor.kind = ExpressionKind::MATRIX;
+            factor.matrix = tokens[pos++];
+        }
+        while (accept({"^", "T"}) || accept({".", "transpose", "(", ")"})) {
+            Expression transpose;
+            transpose.kind = ExpressionKind::TRANSPOSE;
+            transpose.operands.push_back(std::move(factor));
+            factor = std::move(transpose);
+        }
+        return true;
+    };
+    auto parseProduct = [&](Expression& product) {
+        std::vector<Expression> factors(1);
+        if (!parseFactor(factors.back())) {
+            return false;
+        }
+        while (pos < tokens.size() && tokens[pos] == "*") {
+            pos++;
+            factors.emplace_back();
+            if (!parseFactor(factors.back())) {
+                return false;
+            }
+        }
+        if (factors.size() == 1) {
+            product = std::move(factors.front());
+        } else {
+            product = Expression();
+            product.kind = ExpressionKind::MULTIPLY;
+            product.operands = std::move(factors);
+        }
+        return true;
+    };
+    parseSum = [&](Expression& sum) {
+        if (!parseProduct(sum)) {
+            return false;
+        }
+        while (pos < tokens.size() && (tokens[pos] == "+" || tokens[pos] == "-")) {
+            Expression node;
+            node.kind = tokens[pos++] == "+" ? ExpressionKind::ADD : ExpressionKind::SUBTRACT;
+            node.operands.resize(2);
+            node.operands[0] = std::move(sum);
+            if (!parseProduct(node.operands[1])) {
+                return false;
+            }
+            sum = std::move(node);
+        }
+        return true;
+    };
+    
+    if (!parseSum(expression) || pos != tokens.size()) {
+        return false;
+    }
+    if (expression.kind == ExpressionKind::MATRIX) {
+        return true;
+    }
+    
+    // Sums of names that are not matrices are ordinary arithmetic (e.g. i = i + j)
+    bool namesMatrix = false;
+    std::function<void(const Expression&)> findMatrix = [&](const Expression& node) {
+        if (node.kind == ExpressionKind::MATRIX) {
+            namesMatrix = namesMatrix || hasMatrix(node.matrix);
+        }
+        for (const auto& operand : node.operands) {
+            findMatrix(operand);
+        }
+    };
+    findMatrix(expression);
+    if (!namesMatrix && expression.kind != ExpressionKind::MULTIPLY) {
+        return false;
+    }
+    
+    // Resolve matrices and check the dimensions of every operation
+    std::function<void(Expression&)> resolve = [&](Expression& node) {
+        if (node.kind == ExpressionKind::MATRIX) {
+            if (!hasMatrix(node.matrix)) {
+                throw std::runtime_error("Matrix '" + node.matrix + "' used in operation but not declared");
+            }
+            const MatrixInfo& info = matrices_.at(node.matrix);
+            if (info.batch > 0) {
+                throw std::runtime_error("Batch '" + node.matrix + "' can only be used item by item");
+            }
+            node.rows = info.rows;
+            node.cols = info.cols;
+            return;
+        }
+        for (auto& operand : node.operands) {
+            resolve(operand);
+        }
+        if (node.kind == ExpressionKind::TRANSPOSE) {
+            node.rows = node.operands[0].cols;
+            node.cols = node.operands[0].rows;
+            return;
+        }
+        if (node.kind != ExpressionKind::MULTIPLY) {
+            const Expression& left = node.operands[0];
+            const Expression& right = node.operands[1];
+            if (left.rows != right.rows || left.cols != right.cols) {
+                bool add = node.kind == ExpressionKind::ADD;
+                throw std::runtime_error(std::string("Invalid matrix dimensions for ") +
+                                        (add ? "addition: " : "subtraction: ") + describeOperand(left) +
+                                        (add ? " + " : " - ") + describeOperand(right));
+            }
+            node.rows = left.rows;
+            node.cols = left.cols;
+            return;
+        }
+        for (size_t i = 1; i < node.operands.size(); ++i) {
+            if (node.operands[i - 1].cols != node.operands[i].rows) {
+                throw std::runtime_error("Invalid matrix dimensions for multiplication: " +
+                                        describeOperand(node.operands[i - 1]) + " * " +
+                                        describeOperand(node.operands[i]));
+            }
+        }
+        node.rows = node.operands.front().rows;
+        node.cols = node.operands.back().cols;
+    };
+    resolve(expression);
+    return true;
+}
+
+// Append the binary operations computing an expression
+std::string Parser::lowerExpression(const Expression& expression, const std::string& assignment,
+                                    const std::string& output) {
+    if (expression.kind == ExpressionKind::MATRIX) {
+        return expression.matrix;
+    }
+    
+    if (expression.kind == ExpressionKind::TRANSPOSE) {
+        std::string source = lowerExpression(expression.operands[0], assignment, "");
+        if (matrices_.at(source).nonzeros) {
+            throw std::runtime_error("Sparse matrix '" + source + "' cannot be transposed");
+        }
+        if (output.empty()) {
+            return transposedView(source);
+        }
+        
+        // Only C = X^T moves data: each element is copied through a MAC with 1
+        if (!hasMatrix(CONSTANT_ONE)) {
+            matrices_.insert(std::make_pair(CONSTANT_ONE, MatrixInfo(CONSTANT_ONE, 1, 1, true, false)));
+        }
+        operations_.push_back(MatrixOperation(OperationType::TRANSPOSE, {source, CONSTANT_ONE}, output));
+        return output;
+    }
+    
+    if (expression.kind != ExpressionKind::MULTIPLY) {
+        std::string left = lowerExpression(expression.operands[0], assignment, "");
+        std::string right = lowerExpression(expression.operands[1], assignment, "");
+        std::string target = output;
+        if (target.empty()) {
+            target = assignment + "." + std::to_string(++temporaryCounts_[assignment]);
+            matrices_.insert(std::make_pair(target, MatrixInfo(target, expression.rows, expression.cols,
+                                                               false, false, true)));
+        }
+        OperationType type = expression.kind == ExpressionKind::ADD ? OperationType::ADD : OperationType::SUBTRACT;
+        operations_.push_back(MatrixOperation(type, {left, right}, target));
+        return target;
+    }
+    
+    std::vector<std::string> factors;
+    for (const auto& operand : expression.operands) {
+        factors.push_back(lowerExpression(operand, assignment, ""));
+    }
+    
+    // Multiply left to right; only the last product goes to the output
+    std::string result = factors.front();
+    uint32_t rows = expression.operands.front().rows;
+    for (size_t i = 1; i < factors.size(); ++i) {
+        std::string target = output;
+        if (i + 1 < factors.size() || target.empty()) {
+            target = assignment + "." + std::to_string(++temporaryCounts_[assignment]);
+            uint32_t cols = expression.operands[i].cols;
+            matrices_.insert(std::make_pair(target, MatrixInfo(target, rows, cols, false, false, true)));
+        }
+        operations_.push_back(MatrixOperation(OperationType::MULTIPLY, {result, factors[i]}, target));
+        result = target;
+    }
+    return result;
+}
+
+// Get the transposed view of a matrix, creating it if needed
+std::string Parser::transposedView(const std::string& matrix) {
+    const MatrixInfo& source = matrices_.at(matrix);
+    if (source.transposed) {
+        return source.aliasOf;
     }
     
-    // For completeness, we could add more regex patterns for other operations (ADD, SUBTRACT, etc.)
+    std::string name = matrix + "^T";
+    if (!hasMatrix(name)) {
+        MatrixInfo view(name, source.cols, source.rows, false, false);
+        view.aliasOf = matrix;
+        view.transposed = true;
+        matrices_.insert(std::make_pair(name, view));
+    }
+    return name;
 }
 
 // Extract matrix dimensions from declaration
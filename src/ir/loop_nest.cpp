@@ -0,0 +1,404 @@
+#include "../../include/ir/loop_nest.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace IR {
+
+namespace {
+
+// Emit the instructions of a list of nodes
+void lowerNodes(const std::vector<Node>& nodes, std::vector<int64_t>& ivs, PIM_ISA::InstructionSink& sink);
+
+// Check whether a loop body contains no further loops
+bool isInnermost(const Node& loop) {
+    for (const auto& node : loop.body) {
+        if (node.kind == NodeKind::LOOP) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Emit the instructions of an innermost loop
+//
+// Address offsets are evaluated once at loop entry and then advanced by
+// their stride, so each instruction costs one addition.
+void lowerInnermostLoop(const Node& loop, std::vector<int64_t>& ivs, PIM_ISA::InstructionSink& sink) {
+    const std::vector<Node>& body = loop.body;
+    std::vector<int64_t> offsets(body.size(), 0);
+    std::vector<int64_t> strides(body.size(), 0);
+
+    ivs[loop.loop] = loop.begin;
+    for (size_t n = 0; n < body.size(); ++n) {
+        offsets[n] = body[n].address.offset.evaluate(ivs);
+        strides[n] = body[n].address.offset.coefficient(loop.loop) * loop.step;
+    }
+
+    for (int64_t iv = loop.begin; iv < loop.end; iv += loop.step) {
+        for (size_t n = 0; n < body.size(); ++n) {
+            const Node& node = body[n];
+            uint16_t address = static_cast<uint16_t>(
+                node.address.baseAddress + offsets[n] / MemoryMap::NIBBLES_PER_MEMORY_ROW);
+            offsets[n] += strides[n];
+
+            switch (node.kind) {
+                case NodeKind::LOAD:
+                    sink.emit(PIM_ISA::createMemoryInstruction(node.slot, true, false, address));
+                    break;
+                case NodeKind::COMPUTE:
+                    sink.emit(PIM_ISA::createComputeInstruction(node.core, node.rowAddress));
+                    break;
+                case NodeKind::STORE:
+                    sink.emit(PIM_ISA::createMemoryInstruction(node.slot, false, true, address));
+                    break;
+                case NodeKind::LOOP:
+                    break;
+            }
+        }
+    }
+    ivs[loop.loop] = loop.end;
+}
+
+// Emit the instructions of one node
+void lowerNode(const Node& node, std::vector<int64_t>& ivs, PIM_ISA::InstructionSink& sink) {
+    switch (node.kind) {
+        case NodeKind::LOOP:
+            if (isInnermost(node)) {
+                lowerInnermostLoop(node, ivs, sink);
+                break;
+            }
+            for (int64_t iv = node.begin; iv < node.end; iv += node.step) {
+                ivs[node.loop] = iv;
+                lowerNodes(node.body, ivs, sink);
+            }
+            break;
+        case NodeKind::LOAD:
+            sink.emit(PIM_ISA::createMemoryInstruction(node.slot, true, false, node.address.evaluate(ivs)));
+            break;
+        case NodeKind::COMPUTE:
+            sink.emit(PIM_ISA::createComputeInstruction(node.core, node.rowAddress));
+            break;
+        case NodeKind::STORE:
+            sink.emit(PIM_ISA::createMemoryInstruction(node.slot, false, true, node.address.evaluate(ivs)));
+            break;
+    }
+}
+
+// Emit the instructions of a list of nodes
+void lowerNodes(const std::vector<Node>& nodes, std::vector<int64_t>& ivs, PIM_ISA::InstructionSink& sink) {
+    for (const auto& node : nodes) {
+        lowerNode(node, ivs, sink);
+    }
+}
+
+// Count the nodes in a list of nodes
+size_t countNodes(const std::vector<Node>& nodes) {
+    size_t count = nodes.size();
+    for (const auto& node : nodes) {
+        if (node.kind == NodeKind::LOOP) {
+            count += countNodes(node.body);
+        }
+    }
+    return count;
+}
+
+// Count the instructions a list of nodes lowers to
+uint64_t countInstructions(const std::vector<Node>& nodes) {
+    uint64_t count = 0;
+    for (const auto& node : nodes) {
+        if (node.kind == NodeKind::LOOP) {
+            count += node.tripCount() * countInstructions(node.body);
+        } else {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Mark the cores the compute nodes in a list of nodes run on
+void markComputeCores(const std::vector<Node>& nodes, std::vector<bool>& used) {
+    for (const auto& node : nodes) {
+        if (node.kind == NodeKind::LOOP) {
+            markComputeCores(node.body, used);
+        } else if (node.kind == NodeKind::COMPUTE) {
+            used[node.core] = true;
+        }
+    }
+}
+
+// Print an affine expression using loop names i0, i1, ...
+void printExpr(const AffineExpr& expr, std::ostream& out) {
+    bool first = true;
+    for (const auto& term : expr.terms) {
+        if (!first) out << " + ";
+        if (term.second != 1) out << term.second << "*";
+        out << "i" << term.first;
+        first = false;
+    }
+    if (expr.constant != 0 || first) {
+        if (!first) out << " + ";
+        out << expr.constant;
+    }
+}
+
+// Print an address
+void printAddress(const Address& address, std::ostream& out) {
+    out << "row " << address.baseAddress << " + (";
+    printExpr(address.offset, out);
+    out << ") / " << MemoryMap::NIBBLES_PER_MEMORY_ROW;
+}
+
+// Name of a compute operation in printed loop nests
+const char* computeOpName(ComputeOp op) {
+    switch (op) {
+        case ComputeOp::MULTIPLY:
+            return "multiply";
+        case ComputeOp::MAC:
+            return "mac";
+        case ComputeOp::ADD:
+            return "add";
+        case ComputeOp::SUBTRACT:
+            return "subtract";
+    }
+    return "compute";
+}
+
+// Print a list of nodes at an indentation level
+void printNodes(const std::vector<Node>& nodes, int depth, std::ostream& out) {
+    std::string indent(depth * 2, ' ');
+    for (const auto& node : nodes) {
+        out << indent;
+        switch (node.kind) {
+            case NodeKind::LOOP:
+                out << "for i" << node.loop << " in [" << node.begin << ", " << node.end << ")";
+                if (node.step != 1) out << " step " << node.step;
+                out << std::endl;
+                printNodes(node.body, depth + 1, out);
+                continue;
+            case NodeKind::LOAD:
+                out << "read ptr" << static_cast<int>(node.slot) << " <- ";
+                printAddress(node.address, out);
+                break;
+            case NodeKind::COMPUTE:
+                out << computeOpName(node.op) << " core" << static_cast<int>(node.core);
+                break;
+            case NodeKind::STORE:
+                out << "write ";
+                printAddress(node.address, out);
+                out << " <- ptr" << static_cast<int>(node.slot);
+                break;
+        }
+        out << std::endl;
+    }
+}
+
+// Append an integer to an encoding, 7 bits per byte
+void encodeValue(int64_t value, std::string& out) {
+    uint64_t bits = static_cast<uint64_t>(value);
+    while (bits >= 0x80) {
+        out.push_back(static_cast<char>((bits & 0x7F) | 0x80));
+        bits >>= 7;
+    }
+    out.push_back(static_cast<char>(bits));
+}
+
+// Append every field of a list of nodes to an encoding
+void encodeNodes(const std::vector<Node>& nodes, std::string& out) {
+    encodeValue(static_cast<int64_t>(nodes.size()), out);
+    for (const auto& node : nodes) {
+        encodeValue(static_cast<int64_t>(node.kind), out);
+        switch (node.kind) {
+            case NodeKind::LOOP:
+                encodeValue(node.loop, out);
+                encodeValue(node.begin, out);
+                encodeValue(node.end, out);
+                encodeValue(node.step, out);
+                encodeNodes(node.body, out);
+                break;
+            case NodeKind::LOAD:
+            case NodeKind::STORE:
+                encodeValue(node.slot, out);
+                encodeValue(node.address.baseAddress, out);
+                encodeValue(node.address.offset.constant, out);
+                encodeValue(static_cast<int64_t>(node.address.offset.terms.size()), out);
+                for (const auto& term : node.address.offset.terms) {
+                    encodeValue(term.first, out);
+                    encodeValue(term.second, out);
+                }
+                break;
+            case NodeKind::COMPUTE:
+                encodeValue(static_cast<int64_t>(node.op), out);
+                encodeValue(node.core, out);
+                encodeValue(node.rowAddress, out);
+                break;
+        }
+    }
+}
+
+} // namespace
+
+// Add a term to an affine expression
+AffineExpr& AffineExpr::add(LoopId loop, int64_t coefficient) {
+    if (coefficient == 0) {
+        return *this;
+    }
+    for (auto& term : terms) {
+        if (term.first == loop) {
+            term.second += coefficient;
+            return *this;
+        }
+    }
+    terms.emplace_back(loop, coefficient);
+    return *this;
+}
+
+// Add a scaled copy of another expression
+AffineExpr& AffineExpr::add(const AffineExpr& other, int64_t scale) {
+    constant += other.constant * scale;
+    for (const auto& term : other.terms) {
+        add(term.first, term.second * scale);
+    }
+    return *this;
+}
+
+// Create the expression iv(loop)
+AffineExpr AffineExpr::index(LoopId loop) {
+    AffineExpr expr;
+    expr.terms.emplace_back(loop, 1);
+    return expr;
+}
+
+// Create a constant expression
+AffineExpr AffineExpr::value(int64_t value) {
+    AffineExpr expr;
+    expr.constant = value;
+    return expr;
+}
+
+// Get the coefficient of an induction variable
+int64_t AffineExpr::coefficient(LoopId loop) const {
+    for (const auto& term : terms) {
+        if (term.first == loop) {
+            return term.second;
+        }
+    }
+    return 0;
+}
+
+// Create a loop node
+Node Node::makeLoop(LoopId loop, uint32_t begin, uint32_t end, std::vector<Node> body, uint32_t step) {
+    Node node;
+    node.kind = NodeKind::LOOP;
+    node.loop = loop;
+    node.begin = begin;
+    node.end = end;
+    node.step = step;
+    node.body = std::move(body);
+    return node;
+}
+
+// Create a load node
+Node Node::makeLoad(uint8_t slot, Address address) {
+    Node node;
+    node.kind = NodeKind::LOAD;
+    node.slot = slot;
+    node.address = std::move(address);
+    return node;
+}
+
+// Create a compute node
+Node Node::makeCompute(ComputeOp op, uint8_t core, uint16_t rowAddress) {
+    Node node;
+    node.kind = NodeKind::COMPUTE;
+    node.op = op;
+    node.core = core;
+    node.rowAddress = rowAddress;
+    return node;
+}
+
+// Create a store node
+Node Node::makeStore(uint8_t slot, Address address) {
+    Node node;
+    node.kind = NodeKind::STORE;
+    node.slot = slot;
+    node.address = std::move(address);
+    return node;
+}
+
+// Count the instructions of a node
+uint64_t Node::instructionCount() const {
+    return kind == NodeKind::LOOP ? tripCount() * countInstructions(body) : 1;
+}
+
+// Count the nodes of a kernel
+size_t Kernel::nodeCount() const {
+    return countNodes(body);
+}
+
+// Count the instructions of a kernel
+uint64_t Kernel::instructionCount() const {
+    return countInstructions(body);
+}
+
+// List the cores the compute nodes of a kernel run on
+std::vector<uint8_t> Kernel::computeCores() const {
+    std::vector<bool> used(PIM_ISA::NUM_CORES, false);
+    markComputeCores(body, used);
+
+    std::vector<uint8_t> cores;
+    for (uint32_t core = 0; core < PIM_ISA::NUM_CORES; ++core) {
+        if (used[core]) {
+            cores.push_back(static_cast<uint8_t>(core));
+        }
+    }
+    return cores;
+}
+
+// Expand a kernel into instructions
+void lower(const Kernel& kernel, PIM_ISA::InstructionSink& sink) {
+    std::vector<int64_t> ivs(kernel.loopCount, 0);
+    lowerNodes(kernel.body, ivs, sink);
+}
+
+// Expand one top-level node of a kernel into instructions
+void lowerTopLevelNode(const Kernel& kernel, size_t index, PIM_ISA::InstructionSink& sink) {
+    std::vector<int64_t> ivs(kernel.loopCount, 0);
+    lowerNode(kernel.body.at(index), ivs, sink);
+}
+
+// Expand a range of iterations of a top-level loop into instructions
+void lowerLoopIterations(const Kernel& kernel, size_t index, uint32_t firstIteration, uint32_t lastIteration,
+                         PIM_ISA::InstructionSink& sink) {
+    const Node& loop = kernel.body.at(index);
+    if (loop.kind != NodeKind::LOOP) {
+        throw std::runtime_error("Node " + std::to_string(index) + " of kernel '" + kernel.name + "' is not a loop");
+    }
+
+    lastIteration = std::min(lastIteration, loop.tripCount());
+
+    std::vector<int64_t> ivs(kernel.loopCount, 0);
+    for (uint32_t iteration = firstIteration; iteration < lastIteration; ++iteration) {
+        ivs[loop.loop] = static_cast<int64_t>(loop.begin) + static_cast<int64_t>(iteration) * loop.step;
+        lowerNodes(loop.body, ivs, sink);
+    }
+}
+
+// Encode everything the instructions of a kernel depend on
+std::string fingerprint(const Kernel& kernel) {
+    std::string out;
+    encodeValue(kernel.loopCount, out);
+    encodeValue(static_cast<int64_t>(kernel.cores.size()), out);
+    for (const auto& setup : kernel.cores) {
+        encodeValue(setup.core, out);
+        encodeValue(static_cast<int64_t>(setup.opType), out);
+    }
+    encodeNodes(kernel.body, out);
+    return out;
+}
+
+// Print a kernel as indented pseudo-code
+void print(const Kernel& kernel, std::ostream& out) {
+    printNodes(kernel.body, 0, out);
+}
+
+} // namespace IR
@@ -0,0 +1,171 @@
+#include "../../include/ir/transforms.h"
+
+namespace IR {
+
+namespace {
+
+// Check whether a list of nodes contains a loop
+bool containsLoop(const std::vector<Node>& nodes) {
+    for (const auto& node : nodes) {
+        if (node.kind == NodeKind::LOOP) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Copy a loop body with the induction variable shifted by a number of steps
+std::vector<Node> shiftedBody(const Node& loop, uint32_t steps) {
+    std::vector<Node> body = loop.body;
+    int64_t delta = static_cast<int64_t>(steps) * loop.step;
+    for (auto& node : body) {
+        if (node.kind == NodeKind::LOAD || node.kind == NodeKind::STORE) {
+            node.address.offset.constant += node.address.offset.coefficient(loop.loop) * delta;
+        }
+    }
+    return body;
+}
+
+// Unroll the innermost loops in a list of nodes
+size_t unrollNodes(std::vector<Node>& nodes, uint32_t factor) {
+    size_t unrolled = 0;
+    std::vector<Node> result;
+    result.reserve(nodes.size());
+
+    for (auto& node : nodes) {
+        if (node.kind != NodeKind::LOOP) {
+            result.push_back(std::move(node));
+            continue;
+        }
+
+        if (containsLoop(node.body)) {
+            unrolled += unrollNodes(node.body, factor);
+            result.push_back(std::move(node));
+            continue;
+        }
+
+        uint32_t trips = node.tripCount();
+        if (trips < factor) {
+            result.push_back(std::move(node));
+            continue;
+        }
+
+        // Main loop: `factor` copies of the body per iteration
+        uint32_t mainTrips = trips - trips % factor;
+        uint32_t mainEnd = node.begin + mainTrips * node.step;
+
+        std::vector<Node> body;
+        for (uint32_t copy = 0; copy < factor; ++copy) {
+            for (auto& copied : shiftedBody(node, copy)) {
+                body.push_back(std::move(copied));
+            }
+        }
+
+        result.push_back(Node::makeLoop(node.loop, node.begin, mainEnd, std::move(body), node.step * factor));
+
+        // Remainder loop for the leftover iterations
+        if (mainEnd < node.end) {
+            result.push_back(Node::makeLoop(node.loop, mainEnd, node.end, std::move(node.body), node.step));
+        }
+
+        unrolled++;
+    }
+
+    nodes = std::move(result);
+    return unrolled;
+}
+
+// Marks a core without a product waiting to be stored
+constexpr int32_t NO_PENDING_PRODUCT = -1;
+
+// Split the compute nodes in a list of nodes into nibble lookups
+//
+// pendingProducts holds, for each core, the first operand slot of the last
+// product it computed since its result was last stored.
+size_t sliceNodes(std::vector<Node>& nodes, uint32_t slices, std::vector<int32_t>& pendingProducts) {
+    size_t sliced = 0;
+    std::vector<Node> result;
+    result.reserve(nodes.size());
+
+    for (auto& node : nodes) {
+        switch (node.kind) {
+            case NodeKind::LOOP:
+                sliced += sliceNodes(node.body, slices, pendingProducts);
+                break;
+            case NodeKind::COMPUTE: {
+                bool product = node.op == ComputeOp::MULTIPLY || node.op == ComputeOp::MAC;
+                result.insert(result.end(), (product ? slices * slices : slices) - 1, node);
+                if (product) {
+                    pendingProducts[node.core] = PIM_ISA::operandSlotA(node.rowAddress);
+                }
+                sliced++;
+                break;
+            }
+            case NodeKind::STORE:
+                if (pendingProducts[node.slot] != NO_PENDING_PRODUCT) {
+                    // Spill the column sums and ripple their carries from the slot they are read into
+                    uint8_t sums = static_cast<uint8_t>(pendingProducts[node.slot]);
+                    result.push_back(Node::makeStore(node.slot, node.address));
+                    result.push_back(Node::makeLoad(sums, node.address));
+                    result.insert(result.end(), 2 * (slices - 1),
+                                  Node::makeCompute(ComputeOp::ADD, node.slot, PIM_ISA::encodeOperandSlots(sums, sums)));
+                    pendingProducts[node.slot] = NO_PENDING_PRODUCT;
+                }
+                break;
+            case NodeKind::LOAD:
+                break;
+        }
+        result.push_back(std::move(node));
+    }
+
+    nodes = std::move(result);
+    return sliced;
+}
+
+// Rename the cores used by a list of nodes
+void renameNodeCores(std::vector<Node>& nodes, const std::vector<uint8_t>& cores) {
+    for (auto& node : nodes) {
+        switch (node.kind) {
+            case NodeKind::LOOP:
+                renameNodeCores(node.body, cores);
+                break;
+            case NodeKind::COMPUTE:
+                node.core = cores[node.core];
+                break;
+            case NodeKind::STORE:
+                node.slot = cores[node.slot];
+                break;
+            case NodeKind::LOAD:
+                break;
+        }
+    }
+}
+
+} // namespace
+
+// Unroll every innermost loop of a kernel
+size_t unrollInnermostLoops(Kernel& kernel, uint32_t factor) {
+    if (factor < 2) {
+        return 0;
+    }
+    return unrollNodes(kernel.body, factor);
+}
+
+// Split the compute EXEs of a kernel into 4-bit LUT lookups
+size_t sliceComputeNodes(Kernel& kernel, uint32_t slices) {
+    if (slices < 2) {
+        return 0;
+    }
+    std::vector<int32_t> pendingProducts(PIM_ISA::NUM_CORES, NO_PENDING_PRODUCT);
+    return sliceNodes(kernel.body, slices, pendingProducts);
+}
+
+// Move the work of a kernel to other cores
+void renameCores(Kernel& kernel, const std::vector<uint8_t>& cores) {
+    renameNodeCores(kernel.body, cores);
+    for (auto& setup : kernel.cores) {
+        setup.core = cores[setup.core];
+    }
+}
+
+} // namespace IR
@@ -1,22 +1,113 @@
 #include "../include/compiler.h"
+#include "../include/server/compile_server.h"
+#include "../include/frontend/parser.h"
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <cstdio>
+#include <exception>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
 void printUsage(const char* programName) {
     std::cout << "Usage: " << programName << " [options] input_file output_file" << std::endl;
+    std::cout << "       " << programName << " --serve[=<socket>] [--workers=<N>] [-v]" << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "  -O<level>       Set optimization level (0-3, default: 0)" << std::endl;
     std::cout << "  -v, --verbose   Enable verbose output" << std::endl;
+    std::cout << "  -fbounded-memory  Stream instructions to the output file without storing them" << std::endl;
+    std::cout << "  -fbinary        Write a binary object file (.pbin) instead of assembly" << std::endl;
+    std::cout << "  -j <threads>    Generate code on this many threads (default: 1)" << std::endl;
+    std::cout << "  -ftile=<R>x<C>  Use R x C tiles for blocked matrix multiplication at -O3" << std::endl;
+    std::cout << "  -fno-fusion     Do not fuse sums into the products they add to" << std::endl;
+    std::cout << "  -fstrassen=<N>  Split square products of N x N or larger into 7 half-size products from -O1" << std::endl;
+    std::cout << "  -fprecision=<B> Compute on B-bit operands (4, 8 or 16, default: 4) as 4-bit LUT lookups" << std::endl;
+    std::cout << "  --cache-dir=<D> Reuse outputs of earlier compilations cached in directory D" << std::endl;
+    std::cout << "  --cache-size=<MB>  Evict least recently used outputs beyond MB megabytes (default: 256)" << std::endl;
+    std::cout << "  --incremental   Regenerate only the operations changed since the last build of output_file" << std::endl;
+    std::cout << "  --watch         Recompile incrementally whenever the input changes" << std::endl;
+    std::cout << "  --serve[=<S>]   Serve compile requests on Unix domain socket S (default: "
+              << Server::DEFAULT_SOCKET_PATH << ")" << std::endl;
+    std::cout << "  --workers=<N>   Compile N server requests at a time (default: one per hardware thread)" << std::endl;
     std::cout << "  -h, --help      Show this help message" << std::endl;
 }
 
+// Interval at which --watch checks the input for changes
+constexpr std::chrono::milliseconds WATCH_INTERVAL(250);
+
+// Describe the state of a source file and its side files; changes when any of them is modified
+std::string watchStamp(const std::string& inputFile) {
+    std::ifstream file(inputFile);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    
+    std::ostringstream stamp;
+    std::vector<std::string> paths = Frontend::Parser::findSideFiles(buffer.str(), inputFile);
+    paths.insert(paths.begin(), inputFile);
+    for (const auto& path : paths) {
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(path, error);
+        auto size = std::filesystem::file_size(path, error);
+        stamp << path << " " << (error ? 0 : modified.time_since_epoch().count()) << " " << (error ? 0 : size) << "\n";
+    }
+    return stamp.str();
+}
+
+// Recompile incrementally whenever the input or one of its side files changes
+[[noreturn]] void watch(PIMCompiler& compiler, const std::string& inputFile, const std::string& outputFile) {
+    std::cout << "Watching " << inputFile << " (Ctrl-C to stop)" << std::endl;
+    
+    std::string built;
+    while (true) {
+        std::string stamp = watchStamp(inputFile);
+        if (stamp != built) {
+            built = stamp;
+            auto start = std::chrono::steady_clock::now();
+            bool success = false;
+            try {
+                success = compiler.compile(inputFile, outputFile);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            
+            const auto& stats = compiler.getIncrementalStats();
+            if (success) {
+                std::cout << "Built " << outputFile << " in " << static_cast<int>(ms) << " ms ("
+                          << (stats.fullBuild ? "full build of " : "reused " + std::to_string(stats.reused) + " of ")
+                          << stats.nests << " loop nests)" << std::endl;
+            } else {
+                std::cout << "Build of " << outputFile << " failed; waiting for changes" << std::endl;
+            }
+        }
+        std::this_thread::sleep_for(WATCH_INTERVAL);
+    }
+}
+
 int main(int argc, char* argv[]) {
     // Default values
     std::string inputFile;
     std::string outputFile;
     int optimizationLevel = 0;
     bool verbose = false;
+    bool boundedMemory = false;
+    int threads = 1;
+    unsigned tileRows = 0;
+    unsigned tileCols = 0;
+    bool fusion = true;
+    unsigned strassenThreshold = 0;
+    unsigned precision = 4;
+    std::string cacheDirectory;
+    unsigned long long cacheMegabytes = 256;
+    std::string socketPath;
+    bool incremental = false;
+    bool watchInput = false;
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    PIMCompiler::OutputFormat outputFormat = PIMCompiler::OutputFormat::ASSEMBLY;
     
     // Parse command-line arguments
     for (int i = 1; i < argc; ++i) {
@@ -28,6 +119,82 @@ int main(int argc, char* argv[]) {
             } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
                 // Verbose output
                 verbose = true;
+            } else if (strcmp(argv[i], "-fbounded-memory") == 0) {
+                // Stream instructions instead of storing the whole program
+                boundedMemory = true;
+            } else if (strcmp(argv[i], "-fbinary") == 0) {
+                // Binary object output
+                outputFormat = PIMCompiler::OutputFormat::BINARY;
+            } else if (strncmp(argv[i], "-j", 2) == 0) {
+                // Thread count, either -jN or -j N
+                const char* count = argv[i][2] != '\0' ? &argv[i][2] : (i + 1 < argc ? argv[++i] : "");
+                threads = atoi(count);
+                if (threads < 1) {
+                    std::cerr << "Error: Invalid thread count for -j" << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (strncmp(argv[i], "-ftile=", 7) == 0) {
+                // Forced tile size
+                if (sscanf(argv[i] + 7, "%ux%u", &tileRows, &tileCols) != 2) {
+                    std::cerr << "Error: Invalid tile size " << argv[i] + 7 << " (expected <rows>x<cols>)" << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (strcmp(argv[i], "-fno-fusion") == 0) {
+                // Keep GEMM + bias as separate operations
+                fusion = false;
+            } else if (strncmp(argv[i], "-fstrassen=", 11) == 0) {
+                // Strassen-Winograd splitting of large square products
+                if (sscanf(argv[i] + 11, "%u", &strassenThreshold) != 1 || strassenThreshold < 2) {
+                    std::cerr << "Error: Invalid Strassen threshold " << argv[i] + 11 << " (expected a size of at least 2)" << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (strncmp(argv[i], "-fprecision=", 12) == 0) {
+                // Operand width
+                if (sscanf(argv[i] + 12, "%u", &precision) != 1) {
+                    std::cerr << "Error: Invalid precision " << argv[i] + 12 << " (expected 4, 8 or 16)" << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (strncmp(argv[i], "--cache-dir=", 12) == 0) {
+                // Compile cache directory
+                cacheDirectory = argv[i] + 12;
+                if (cacheDirectory.empty()) {
+                    std::cerr << "Error: Missing compile cache directory" << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (strncmp(argv[i], "--cache-size=", 13) == 0) {
+                // Compile cache size bound
+                if (sscanf(argv[i] + 13, "%llu", &cacheMegabytes) != 1 || cacheMegabytes == 0) {
+                    std::cerr << "Error: Invalid compile cache size " << argv[i] + 13 << " (expected megabytes)" << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (strcmp(argv[i], "--incremental") == 0) {
+                // Reuse the segment table of the previous build
+                incremental = true;
+            } else if (strcmp(argv[i], "--watch") == 0) {
+                // Incremental rebuilds on every change of the input
+                watchInput = true;
+                incremental = true;
+            } else if (strcmp(argv[i], "--serve") == 0 || strncmp(argv[i], "--serve=", 8) == 0) {
+                // Compile server socket
+                socketPath = argv[i][7] == '=' ? argv[i] + 8 : Server::DEFAULT_SOCKET_PATH;
+                if (socketPath.empty()) {
+                    std::cerr << "Error: Missing server socket path" << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (strncmp(argv[i], "--workers=", 10) == 0) {
+                // Compile server worker threads
+                if (sscanf(argv[i] + 10, "%u", &workers) != 1 || workers == 0) {
+                    std::cerr << "Error: Invalid worker count " << argv[i] + 10 << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
             } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
                 // Help
                 printUsage(argv[0]);
@@ -52,6 +219,18 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Serve requests instead of compiling files; each request carries its own options
+    if (!socketPath.empty()) {
+        if (!inputFile.empty()) {
+            std::cerr << "Error: --serve takes no input or output file" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        Server::CompileServer server(socketPath, workers);
+        server.setVerbose(verbose);
+        return server.run() ? 0 : 1;
+    }
+    
     // Check required arguments
     if (inputFile.empty() || outputFile.empty()) {
         std::cerr << "Error: Missing required arguments" << std::endl;
@@ -65,9 +244,43 @@ int main(int argc, char* argv[]) {
     // Configure compiler
     compiler.setOptimizationLevel(optimizationLevel);
     compiler.setVerbose(verbose);
+    compiler.setBoundedMemory(boundedMemory);
+    compiler.setOutputFormat(outputFormat);
+    compiler.setThreads(static_cast<unsigned>(threads));
+    compiler.setFusion(fusion);
+    compiler.setStrassenThreshold(strassenThreshold);
+    if (!compiler.setPrecision(precision)) {
+        return 1;
+    }
+    if (tileRows > 0 || tileCols > 0) {
+        if (!compiler.setTileSize(tileRows, tileCols)) {
+            return 1;
+        }
+    }
+    if (incremental) {
+        if (!cacheDirectory.empty() || boundedMemory) {
+            std::cerr << "Error: " << (watchInput ? "--watch" : "--incremental") << " cannot be combined with "
+                      << (boundedMemory ? "-fbounded-memory" : "--cache-dir") << std::endl;
+            return 1;
+        }
+        compiler.setIncremental(true);
+    }
+    if (watchInput) {
+        watch(compiler, inputFile, outputFile);
+    }
+    if (!cacheDirectory.empty()) {
+        if (!compiler.setCache(cacheDirectory, cacheMegabytes * 1024 * 1024)) {
+            return 1;
+        }
+    }
     
-    // Compile the input file
-    bool success = compiler.compile(inputFile, outputFile);
+    // Compile the input file; mapping and code generation report errors by exception
+    bool success = false;
+    try {
+        success = compiler.compile(inputFile, outputFile);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
     
     // Print performance analysis if verbose mode is enabled
     if (success && verbose) {
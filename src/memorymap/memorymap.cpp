@@ -1,4 +1,5 @@
 #include "../../include/memorymap/memorymap.h"
+#include "../../include/pim_isa/instructions.h"
 #include <stdexcept>
 #include <algorithm>
 #include <cmath>
@@ -37,37 +38,183 @@ uint16_t MemoryMapper::mapMatrix(const std::string& matrixName, const MatrixDime
     return startAddress;
 }
 
-// Get mapped address for a matrix element
-uint16_t MemoryMapper::getElementAddress(const std::string& matrixName, uint32_t row, uint32_t col) const {
-    // Check if matrix is mapped
-    if (!isMatrixMapped(matrixName)) {
+// Map a batch of equally shaped matrices to memory
+uint16_t MemoryMapper::mapBatch(const std::string& matrixName, const MatrixDimensions& dimensions, uint32_t count) {
+    if (isMatrixMapped(matrixName)) {
+        throw std::runtime_error("Matrix '" + matrixName + "' is already mapped");
+    }
+    
+    // Items are padded to whole memory rows
+    uint32_t batchSize = static_cast<uint32_t>(calculateMatrixSize(dimensions)) * count;
+    if (count == 0 || nextRowAddress_ + batchSize > 512) { // 9-bit address space
+        throw std::runtime_error("Not enough memory space to map batch '" + matrixName + "'");
+    }
+    
+    uint16_t startAddress = nextRowAddress_;
+    matrixMap_[matrixName] = std::tuple<uint16_t, MatrixDimensions>(startAddress, dimensions);
+    batches_[matrixName] = count;
+    nextRowAddress_ += static_cast<uint16_t>(batchSize);
+    
+    return startAddress;
+}
+
+// Map a sparse matrix to memory in CSR layout
+uint16_t MemoryMapper::mapSparseMatrix(const std::string& matrixName, const MatrixDimensions& dimensions,
+                                       const std::vector<std::pair<uint32_t, uint32_t>>& nonzeros) {
+    if (isMatrixMapped(matrixName)) {
+        throw std::runtime_error("Matrix '" + matrixName + "' is already mapped");
+    }
+    
+    SparseLayout layout;
+    layout.rows = dimensions.rows;
+    layout.cols = dimensions.cols;
+    layout.rowStart.assign(dimensions.rows + 1, 0);
+    layout.elementWidth = elementWidth_;
+    layout.columns.reserve(nonzeros.size());
+    for (size_t n = 0; n < nonzeros.size(); ++n) {
+        uint32_t row = nonzeros[n].first;
+        uint32_t col = nonzeros[n].second;
+        if (row >= dimensions.rows || col >= dimensions.cols || (n > 0 && nonzeros[n - 1] >= nonzeros[n])) {
+            throw std::runtime_error("Invalid nonzero (" + std::to_string(row) + ", " + std::to_string(col) +
+                                     ") of sparse matrix '" + matrixName + "'");
+        }
+        layout.rowStart[row + 1]++;
+        layout.columns.push_back(col);
+    }
+    for (uint32_t row = 0; row < dimensions.rows; ++row) {
+        layout.rowStart[row + 1] += layout.rowStart[row];
+    }
+    
+    // Only the nonzeros take memory rows
+    uint16_t matrixSize = calculateSparseSize(nonzeros.size());
+    if (nextRowAddress_ + matrixSize > 512) { // 9-bit address space
+        throw std::runtime_error("Not enough memory space to map matrix '" + matrixName + "'");
+    }
+    
+    layout.baseAddress = nextRowAddress_;
+    matrixMap_[matrixName] = std::tuple<uint16_t, MatrixDimensions>(nextRowAddress_, dimensions);
+    sparse_[matrixName] = std::move(layout);
+    nextRowAddress_ += matrixSize;
+    
+    return sparse_[matrixName].baseAddress;
+}
+
+// Map a matrix onto the storage of another mapped matrix
+uint16_t MemoryMapper::mapAlias(const std::string& aliasName, const std::string& targetName) {
+    if (isMatrixMapped(aliasName)) {
+        throw std::runtime_error("Matrix '" + aliasName + "' is already mapped");
+    }
+    
+    auto target = matrixMap_.find(targetName);
+    if (target == matrixMap_.end()) {
+        throw std::runtime_error("Matrix '" + targetName + "' is not mapped");
+    }
+    
+    // Share the start address and dimensions; no new rows are allocated
+    matrixMap_[aliasName] = target->second;
+    auto view = views_.find(targetName);
+    if (view != views_.end()) {
+        views_[aliasName] = view->second;
+    }
+    auto sparse = sparse_.find(targetName);
+    if (sparse != sparse_.end()) {
+        sparse_[aliasName] = sparse->second;
+    }
+    auto batch = batches_.find(targetName);
+    if (batch != batches_.end()) {
+        batches_[aliasName] = batch->second;
+    }
+    return std::get<0>(target->second);
+}
+
+// Map a matrix as the transpose of another mapped matrix
+uint16_t MemoryMapper::mapTransposedView(const std::string& viewName, const std::string& targetName) {
+    if (getSparseLayout(targetName) != nullptr) {
+        throw std::runtime_error("Sparse matrix '" + targetName + "' has no transposed view");
+    }
+    
+    uint16_t startAddress = mapAlias(viewName, targetName);
+    
+    MatrixDimensions& dimensions = std::get<1>(matrixMap_[viewName]);
+    std::swap(dimensions.rows, dimensions.cols);
+    views_[viewName] = resolveMatrix(targetName).transposed();
+    return startAddress;
+}
+
+// Map a matrix as a block of another mapped matrix
+uint16_t MemoryMapper::mapBlockView(const std::string& viewName, const std::string& targetName,
+                                    uint32_t row, uint32_t col, const MatrixDimensions& dimensions) {
+    if (getSparseLayout(targetName) != nullptr) {
+        throw std::runtime_error("Sparse matrix '" + targetName + "' has no block views");
+    }
+    
+    MatrixHandle target = resolveMatrix(targetName);
+    if (row + dimensions.rows > target.rows || col + dimensions.cols > target.cols) {
+        throw std::runtime_error("Block '" + viewName + "' lies outside matrix '" + targetName + "'");
+    }
+    
+    uint16_t startAddress = mapAlias(viewName, targetName);
+    std::get<1>(matrixMap_[viewName]) = dimensions;
+    views_[viewName] = target.block(row, col, dimensions.rows, dimensions.cols);
+    return startAddress;
+}
+
+// Resolve a mapped matrix to a handle
+MatrixHandle MemoryMapper::resolveMatrix(const std::string& matrixName) const {
+    auto it = matrixMap_.find(matrixName);
+    if (it == matrixMap_.end()) {
         throw std::runtime_error("Matrix '" + matrixName + "' is not mapped");
     }
     
-    // Get matrix information
-    const auto& matrixInfo = matrixMap_.at(matrixName);
-    uint16_t startAddress = std::get<0>(matrixInfo);
-    const MatrixDimensions& dimensions = std::get<1>(matrixInfo);
+    // Sparse matrices have no element strides
+    if (sparse_.count(matrixName) > 0) {
+        throw std::runtime_error("Matrix '" + matrixName + "' has a sparse layout");
+    }
     
-    // Check if indices are valid
-    if (row >= dimensions.rows || col >= dimensions.cols) {
-        throw std::out_of_range("Matrix indices out of range");
+    // Views walk the storage they share with their own strides
+    auto view = views_.find(matrixName);
+    if (view != views_.end()) {
+        return view->second;
     }
     
-    // Calculate element address (row-major layout)
-    // For pPIM architecture, we optimize for efficient MAC operations by ensuring
-    // adjacent elements are in the same bank where possible
+    const MatrixDimensions& dimensions = std::get<1>(it->second);
     
-    // Calculate row offset (each row may span multiple memory rows)
-    uint16_t rowOffset = (row * dimensions.cols) / 256; // 256 elements per memory row
+    // Row-major layout; each row is addressed by the memory row holding its
+    // first element (each row may span multiple memory rows)
+    MatrixHandle handle;
+    handle.baseAddress = std::get<0>(it->second);
+    handle.rows = dimensions.rows;
+    handle.cols = dimensions.cols;
+    handle.rowStride = dimensions.cols * elementWidth_;
+    handle.colStride = 0;
     
-    // Calculate element offset within memory row (not used in current implementation)
-    // uint16_t elementOffset = (row * dimensions.cols + col) % 256;
+    // Items of a batch each start on a memory row of their own
+    auto batch = batches_.find(matrixName);
+    if (batch != batches_.end()) {
+        handle.batch = batch->second;
+        handle.batchStride = calculateMatrixSize(dimensions) * NIBBLES_PER_MEMORY_ROW;
+    }
+    return handle;
+}
+
+// Get the layout of a sparse matrix
+const SparseLayout* MemoryMapper::getSparseLayout(const std::string& matrixName) const {
+    auto sparse = sparse_.find(matrixName);
+    return sparse != sparse_.end() ? &sparse->second : nullptr;
+}
+
+// Get mapped address for a matrix element
+uint16_t MemoryMapper::getElementAddress(const std::string& matrixName, uint32_t row, uint32_t col) const {
+    MatrixHandle handle = resolveMatrix(matrixName);
     
-    // Combine to get actual address
-    uint16_t elementAddress = startAddress + rowOffset;
+    // Check if indices are valid
+    if (row >= handle.rows || col >= handle.cols) {
+        throw std::out_of_range("Matrix indices out of range");
+    }
     
-    return elementAddress;
+    // For pPIM architecture, we optimize for efficient MAC operations by ensuring
+    // adjacent elements are in the same bank where possible
+    return handle.elementAddress(row, col);
 }
 
 // Get mapped address for a matrix row
@@ -96,28 +243,14 @@ uint16_t MemoryMapper::getRowAddress(const std::string& matrixName, uint32_t row
 
 // Get bank index for a matrix element
 uint8_t MemoryMapper::getBankIndex(const std::string& matrixName, uint32_t row, uint32_t col) const {
-    // Check if matrix is mapped
-    if (!isMatrixMapped(matrixName)) {
-        throw std::runtime_error("Matrix '" + matrixName + "' is not mapped");
-    }
-    
-    // Get matrix information
-    const auto& matrixInfo = matrixMap_.at(matrixName);
-    const MatrixDimensions& dimensions = std::get<1>(matrixInfo);
-    
-    // Check if indices are valid
-    if (row >= dimensions.rows || col >= dimensions.cols) {
-        throw std::out_of_range("Matrix indices out of range");
-    }
-    
-    // Calculate bank index (assuming 4 banks per DRAM array)
-    // For pPIM architecture, we want to distribute matrix elements across banks
-    // to enable parallel processing
-    
-    // Simple distribution strategy - alternate banks based on row and column
-    uint8_t bankIndex = (row + col) % 4;
-    
-    return bankIndex;
+    // Memory rows are interleaved over the banks, so the bank is that of the element's row
+    return PIM_ISA::bankOfRow(getElementAddress(matrixName, row, col));
+}
+
+// Get the number of items of a batch
+uint32_t MemoryMapper::getBatchSize(const std::string& matrixName) const {
+    auto batch = batches_.find(matrixName);
+    return batch != batches_.end() ? batch->second : 0;
 }
 
 // Check if a matrix is mapped
@@ -125,6 +258,11 @@ bool MemoryMapper::isMatrixMapped(const std::string& matrixName) const {
     return matrixMap_.find(matrixName) != matrixMap_.end();
 }
 
+// Check if a matrix is mapped as a view of another
+bool MemoryMapper::isView(const std::string& matrixName) const {
+    return views_.count(matrixName) > 0;
+}
+
 // Get matrix dimensions
 MatrixDimensions MemoryMapper::getMatrixDimensions(const std::string& matrixName) const {
     // Check if matrix is mapped
@@ -147,8 +285,13 @@ AddressRange MemoryMapper::getMatrixAddressRange(const std::string& matrixName)
     uint16_t startAddress = std::get<0>(matrixInfo);
     const MatrixDimensions& dimensions = std::get<1>(matrixInfo);
     
-    // Calculate matrix size in memory rows
+    // Calculate matrix size in memory rows (a sparse matrix stores its nonzeros only)
     uint16_t matrixSize = calculateMatrixSize(dimensions);
+    const SparseLayout* sparse = getSparseLayout(matrixName);
+    if (sparse != nullptr) {
+        matrixSize = calculateSparseSize(sparse->nonzeroCount());
+    }
+    matrixSize *= static_cast<uint16_t>(std::max<uint32_t>(getBatchSize(matrixName), 1));
     
     // Calculate end address
     uint16_t endAddress = startAddress + matrixSize - 1;
@@ -156,22 +299,46 @@ AddressRange MemoryMapper::getMatrixAddressRange(const std::string& matrixName)
     return AddressRange(startAddress, endAddress);
 }
 
+// Get the names of all mapped matrices
+std::vector<std::string> MemoryMapper::getMatrixNames() const {
+    std::vector<std::string> names;
+    for (const auto& entry : matrixMap_) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+// Set the width of the elements mapped from now on
+void MemoryMapper::setElementWidth(uint32_t nibbles) {
+    elementWidth_ = nibbles;
+}
+
 // Reset memory map
 void MemoryMapper::reset() {
     matrixMap_.clear();
+    views_.clear();
+    sparse_.clear();
+    batches_.clear();
     nextRowAddress_ = 0;
 }
 
 // Calculate required memory size for a matrix
 uint16_t MemoryMapper::calculateMatrixSize(const MatrixDimensions& dimensions) const {
-    // Calculate number of elements in the matrix
-    uint32_t numElements = dimensions.rows * dimensions.cols;
+    // Calculate number of nibbles in the matrix
+    uint32_t numNibbles = dimensions.rows * dimensions.cols * elementWidth_;
     
-    // Calculate number of memory rows needed (each row can hold up to 256 elements)
-    uint16_t numRows = static_cast<uint16_t>(std::ceil(static_cast<double>(numElements) / 256.0));
+    // Calculate number of memory rows needed (each row can hold up to 256 nibbles)
+    uint16_t numRows = static_cast<uint16_t>(std::ceil(static_cast<double>(numNibbles) / 256.0));
     
     // Ensure at least one row
     return std::max(numRows, static_cast<uint16_t>(1));
 }
 
+// Calculate required memory size for the nonzeros of a sparse matrix
+uint16_t MemoryMapper::calculateSparseSize(size_t nonzeroCount) const {
+    uint16_t numRows = static_cast<uint16_t>((nonzeroCount * elementWidth_ + NIBBLES_PER_MEMORY_ROW - 1) /
+                                             NIBBLES_PER_MEMORY_ROW);
+    return std::max(numRows, static_cast<uint16_t>(1));
+}
+
 } // namespace MemoryMap
@@ -0,0 +1,199 @@
+#include "../../include/optimizer/dependency_graph.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace Optimizer {
+
+// Build the graph of a packed program
+DependencyGraph DependencyGraph::build(const PIM_ISA::PackedProgram& program) {
+    DependencyGraphBuilder builder;
+    builder.reserve(program.size());
+    program.replay(builder);
+    return builder.build();
+}
+
+// Build the graph of an instruction list
+DependencyGraph DependencyGraph::build(const std::vector<PIM_ISA::Instruction>& instructions) {
+    DependencyGraphBuilder builder;
+    builder.reserve(instructions.size());
+    for (const auto& instruction : instructions) {
+        builder.add(instruction);
+    }
+    return builder.build();
+}
+
+// Longest path from each node to the end of the graph
+std::vector<uint64_t> DependencyGraph::heights() const {
+    std::vector<uint64_t> height(size(), 0);
+    for (size_t n = size(); n-- > 0;) {
+        NodeId node = static_cast<NodeId>(n);
+        uint64_t longest = latencies_[node];
+        for (uint32_t edge : successors(node)) {
+            longest = std::max(longest, delay(node, edgeKind(edge)) + height[edgeNode(edge)]);
+        }
+        height[node] = longest;
+    }
+    return height;
+}
+
+// Bytes held by the graph
+size_t DependencyGraph::memoryBytes() const {
+    return latencies_.capacity() + warDelays_.capacity() +
+           sizeof(uint32_t) * (predecessorOffsets_.capacity() + predecessors_.capacity() +
+                               successorOffsets_.capacity() + successors_.capacity());
+}
+
+// Constructor
+DependencyGraphBuilder::DependencyGraphBuilder()
+    : slots_(PIM_ISA::NUM_READ_SLOTS), cores_(PIM_ISA::NUM_CORES), rows_(PIM_ISA::NUM_ROWS) {
+    graph_.predecessorOffsets_.push_back(0);
+}
+
+// Reserve space for a number of instructions
+void DependencyGraphBuilder::reserve(size_t instructions) {
+    graph_.latencies_.reserve(instructions);
+    graph_.warDelays_.reserve(instructions);
+    graph_.predecessorOffsets_.reserve(instructions + 1);
+    graph_.predecessors_.reserve(3 * instructions);
+    hasSuccessor_.reserve(instructions);
+}
+
+// Tracker of the slot, core or row an access uses
+DependencyGraphBuilder::Tracker& DependencyGraphBuilder::tracker(const PIM_ISA::ResourceAccess& access) {
+    switch (access.resource) {
+        case PIM_ISA::Resource::SLOT:
+            return slots_[access.index];
+        case PIM_ISA::Resource::CORE:
+            return cores_[access.index];
+        case PIM_ISA::Resource::ROW:
+            break;
+    }
+    return rows_[access.index];
+}
+
+// Add an edge from an older node to the node being added
+void DependencyGraphBuilder::addEdge(DependencyGraph::NodeId from, DependencyKind kind) {
+    if (graph_.predecessors_.size() >= DependencyGraph::MAX_EDGES) {
+        throw std::runtime_error("Dependency graph exceeds " + std::to_string(DependencyGraph::MAX_EDGES) + " edges");
+    }
+    graph_.predecessors_.push_back(from | (static_cast<uint32_t>(kind) << 30));
+    hasSuccessor_[from] = true;
+}
+
+// Forget every writer and reader
+void DependencyGraphBuilder::clearTrackers() {
+    for (auto* trackers : {&slots_, &cores_, &rows_}) {
+        for (auto& tracker : *trackers) {
+            tracker.writer = NO_NODE;
+            tracker.readers.clear();
+        }
+    }
+}
+
+// Add the next instruction
+DependencyGraph::NodeId DependencyGraphBuilder::add(const PIM_ISA::Instruction& instruction) {
+    if (size() >= DependencyGraph::MAX_NODES) {
+        throw std::runtime_error("Dependency graph exceeds " + std::to_string(DependencyGraph::MAX_NODES) + " nodes");
+    }
+
+    DependencyGraph::NodeId id = static_cast<DependencyGraph::NodeId>(size());
+    uint32_t latency = PIM_ISA::instructionLatency(instruction);
+    bool memoryRead = instruction.type == PIM_ISA::InstructionType::EXE && instruction.read;
+    graph_.latencies_.push_back(static_cast<uint8_t>(latency));
+    graph_.warDelays_.push_back(static_cast<uint8_t>(memoryRead ? latency : 0));
+    hasSuccessor_.push_back(false);
+
+    size_t firstEdge = graph_.predecessors_.size();
+
+    if (PIM_ISA::isBarrier(instruction)) {
+        // Wait for every node since the previous barrier that nothing waits for
+        DependencyGraph::NodeId first = lastBarrier_ == NO_NODE ? 0 : lastBarrier_ + 1;
+        for (DependencyGraph::NodeId node = first; node < id; ++node) {
+            if (!hasSuccessor_[node]) {
+                addEdge(node, DependencyKind::ORDER);
+            }
+        }
+        if (graph_.predecessors_.size() == firstEdge && lastBarrier_ != NO_NODE) {
+            addEdge(lastBarrier_, DependencyKind::ORDER);
+        }
+        clearTrackers();
+        lastBarrier_ = id;
+    } else {
+        PIM_ISA::ResourceAccess accesses[PIM_ISA::MAX_RESOURCE_ACCESSES];
+        size_t count = PIM_ISA::resourceAccesses(instruction, accesses);
+        for (size_t a = 0; a < count; ++a) {
+            Tracker& used = tracker(accesses[a]);
+            if (accesses[a].write) {
+                if (used.writer != NO_NODE) {
+                    addEdge(used.writer, accesses[a].read ? DependencyKind::RAW : DependencyKind::WAW);
+                }
+                for (DependencyGraph::NodeId reader : used.readers) {
+                    addEdge(reader, DependencyKind::WAR);
+                }
+                used.readers.clear();
+                used.writer = id;
+            } else {
+                if (used.writer != NO_NODE) {
+                    addEdge(used.writer, DependencyKind::RAW);
+                }
+                used.readers.push_back(id);
+            }
+        }
+
+        // Nodes after a barrier depend on it directly or through a predecessor
+        if (graph_.predecessors_.size() == firstEdge && lastBarrier_ != NO_NODE) {
+            addEdge(lastBarrier_, DependencyKind::ORDER);
+        }
+
+        // Keep one edge per predecessor, preferring the kinds with the longest delay
+        if (graph_.predecessors_.size() - firstEdge > 1) {
+            auto begin = graph_.predecessors_.begin() + firstEdge;
+            auto byNode = [](uint32_t a, uint32_t b) {
+                return (static_cast<uint64_t>(DependencyGraph::edgeNode(a)) << 2 | (a >> 30)) <
+                       (static_cast<uint64_t>(DependencyGraph::edgeNode(b)) << 2 | (b >> 30));
+            };
+            std::sort(begin, graph_.predecessors_.end(), byNode);
+            auto last = std::unique(begin, graph_.predecessors_.end(), [](uint32_t a, uint32_t b) {
+                return DependencyGraph::edgeNode(a) == DependencyGraph::edgeNode(b);
+            });
+            graph_.predecessors_.erase(last, graph_.predecessors_.end());
+        }
+    }
+
+    graph_.predecessorOffsets_.push_back(static_cast<uint32_t>(graph_.predecessors_.size()));
+    return id;
+}
+
+// Finish the graph and reset the builder
+DependencyGraph DependencyGraphBuilder::build() {
+    DependencyGraph graph = std::move(graph_);
+    size_t nodes = graph.size();
+
+    // Successor lists are the transpose of the predecessor lists
+    graph.successorOffsets_.assign(nodes + 1, 0);
+    for (uint32_t edge : graph.predecessors_) {
+        graph.successorOffsets_[DependencyGraph::edgeNode(edge) + 1]++;
+    }
+    for (size_t n = 0; n < nodes; ++n) {
+        graph.successorOffsets_[n + 1] += graph.successorOffsets_[n];
+    }
+
+    graph.successors_.resize(graph.predecessors_.size());
+    std::vector<uint32_t> cursor(graph.successorOffsets_.begin(), graph.successorOffsets_.end() - 1);
+    for (size_t n = 0; n < nodes; ++n) {
+        for (uint32_t edge : graph.predecessors(static_cast<DependencyGraph::NodeId>(n))) {
+            uint32_t& slot = cursor[DependencyGraph::edgeNode(edge)];
+            graph.successors_[slot++] = static_cast<uint32_t>(n) | (edge & ~DependencyGraph::MAX_NODES);
+        }
+    }
+
+    graph_ = DependencyGraph();
+    graph_.predecessorOffsets_.push_back(0);
+    hasSuccessor_.clear();
+    lastBarrier_ = NO_NODE;
+    clearTrackers();
+    return graph;
+}
+
+} // namespace Optimizer
@@ -0,0 +1,261 @@
+#include "../../include/optimizer/list_scheduler.h"
+#include <algorithm>
+
+namespace Optimizer {
+
+// Constructor
+ListScheduler::ListScheduler(PIM_ISA::InstructionSink& next, size_t window, ScheduleStats& stats)
+    : InstructionFilter(next), windowSize_(std::max<size_t>(1, window)), stats_(stats),
+      bankReady_(PIM_ISA::NUM_BANKS), slots_(PIM_ISA::NUM_READ_SLOTS), cores_(PIM_ISA::NUM_CORES),
+      rows_(PIM_ISA::NUM_ROWS), bankFree_(PIM_ISA::NUM_BANKS, 0) {
+}
+
+// Add an instruction to the window, scheduling older ones when it is full
+void ListScheduler::emit(const PIM_ISA::Instruction& instruction) {
+    if (PIM_ISA::isBarrier(instruction)) {
+        drain();
+        scheduleBarrier(instruction);
+        return;
+    }
+
+    uint64_t id = nextId_++;
+    window_.emplace_back();
+    Node& added = window_.back();
+    added.instruction = instruction;
+    added.instruction.bundleStart = false;
+    added.latency = PIM_ISA::instructionLatency(instruction);
+    added.earliest = floor_;
+
+    PIM_ISA::ResourceAccess accesses[PIM_ISA::MAX_RESOURCE_ACCESSES];
+    size_t count = PIM_ISA::resourceAccesses(instruction, accesses);
+    for (size_t a = 0; a < count; ++a) {
+        // Operands are taken from a slot when a compute starts; a row is
+        // read until the Read finishes
+        if (accesses[a].write) {
+            addWriteAccess(id, tracker(accesses[a]), readerDelay(accesses[a].resource));
+        } else {
+            addReadAccess(id, tracker(accesses[a]));
+        }
+    }
+
+    if (added.pendingPredecessors == 0) {
+        makeReady(id);
+    }
+    pending_++;
+
+    while (pending_ > windowSize_) {
+        scheduleNext();
+    }
+}
+
+// Schedule the remaining instructions and finish the downstream sink
+bool ListScheduler::finish() {
+    drain();
+    return next_.finish();
+}
+
+// Depend on the last writer of a resource and join its readers
+void ListScheduler::addReadAccess(uint64_t id, Tracker& tracker) {
+    Node& reader = node(id);
+    if (tracker.writer >= 0 && isPending(static_cast<uint64_t>(tracker.writer))) {
+        uint64_t writer = static_cast<uint64_t>(tracker.writer);
+        addEdge(writer, id, node(writer).latency);
+    } else {
+        reader.earliest = std::max(reader.earliest, tracker.writeReady);
+    }
+
+    if (tracker.readers.size() >= tracker.pruneSize) {
+        tracker.readers.erase(std::remove_if(tracker.readers.begin(), tracker.readers.end(),
+                                             [this](uint64_t r) { return !isPending(r); }),
+                              tracker.readers.end());
+        tracker.pruneSize = std::max(READER_PRUNE_THRESHOLD, 2 * tracker.readers.size());
+    }
+    tracker.readers.push_back(id);
+}
+
+// Depend on the last writer and the readers of a resource, then become its writer
+void ListScheduler::addWriteAccess(uint64_t id, Tracker& tracker, uint32_t readerDelay) {
+    Node& writer = node(id);
+    if (tracker.writer >= 0 && isPending(static_cast<uint64_t>(tracker.writer))) {
+        uint64_t previous = static_cast<uint64_t>(tracker.writer);
+        addEdge(previous, id, node(previous).latency);
+    } else {
+        writer.earliest = std::max(writer.earliest, tracker.writeReady);
+    }
+
+    for (uint64_t reader : tracker.readers) {
+        if (isPending(reader)) {
+            addEdge(reader, id, readerDelay);
+        }
+    }
+    writer.earliest = std::max(writer.earliest, tracker.readRelease);
+
+    tracker.writer = static_cast<int64_t>(id);
+    tracker.readers.clear();
+}
+
+// Record that one node must start at least `delay` cycles after another
+void ListScheduler::addEdge(uint64_t from, uint64_t to, uint32_t delay) {
+    node(from).successors.emplace_back(to, delay);
+    node(to).pendingPredecessors++;
+}
+
+// Start the ready instruction that can start first
+void ListScheduler::scheduleNext() {
+    uint64_t floor = std::max(cycle_, floor_);
+    bool found = false;
+    ReadyEntry best;
+    int bestBank = -1;
+
+    if (!ready_.empty()) {
+        best = {std::max(ready_.top().first, floor), ready_.top().second};
+        found = true;
+    }
+
+    // Only the oldest of the ready accesses to a bank can start next on it
+    for (size_t bank = 0; bank < bankReady_.size(); ++bank) {
+        if (bankReady_[bank].empty()) {
+            continue;
+        }
+        const ReadyEntry& top = bankReady_[bank].top();
+        ReadyEntry candidate{std::max({top.first, floor, bankFree_[bank]}), top.second};
+        if (!found || candidate < best) {
+            best = candidate;
+            bestBank = static_cast<int>(bank);
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return;
+    }
+    if (bestBank >= 0) {
+        bankReady_[bestBank].pop();
+    } else {
+        ready_.pop();
+    }
+    start(node(best.second), best.second, best.first);
+}
+
+// Queue an instruction whose predecessors have all been scheduled
+void ListScheduler::makeReady(uint64_t id) {
+    Node& waiting = node(id);
+    int bank = bankOf(waiting.instruction);
+    if (bank >= 0) {
+        bankReady_[bank].push({waiting.earliest, id});
+    } else {
+        ready_.push({waiting.earliest, id});
+    }
+}
+
+// Schedule every instruction in the window
+void ListScheduler::drain() {
+    while (pending_ > 0) {
+        scheduleNext();
+    }
+}
+
+// Start an instruction and pass it downstream
+void ListScheduler::start(Node& scheduled, uint64_t id, uint64_t cycle) {
+    scheduled.scheduled = true;
+    pending_--;
+
+    const PIM_ISA::Instruction& instruction = scheduled.instruction;
+    uint64_t finish = cycle + scheduled.latency;
+
+    int bank = bankOf(instruction);
+    if (bank >= 0) {
+        bankFree_[bank] = finish;
+    }
+
+    // Fold the start time into the trackers for instructions that arrive later
+    auto releaseWrite = [&](Tracker& tracker) {
+        if (tracker.writer == static_cast<int64_t>(id)) {
+            tracker.writeReady = std::max(tracker.writeReady, finish);
+        }
+    };
+    auto releaseRead = [&](Tracker& tracker, uint32_t delay) {
+        tracker.readRelease = std::max(tracker.readRelease, cycle + delay);
+    };
+
+    PIM_ISA::ResourceAccess accesses[PIM_ISA::MAX_RESOURCE_ACCESSES];
+    size_t count = PIM_ISA::resourceAccesses(instruction, accesses);
+    for (size_t a = 0; a < count; ++a) {
+        if (accesses[a].write) {
+            releaseWrite(tracker(accesses[a]));
+        } else {
+            releaseRead(tracker(accesses[a]), readerDelay(accesses[a].resource));
+        }
+    }
+
+    for (const auto& successor : scheduled.successors) {
+        Node& waiting = node(successor.first);
+        waiting.earliest = std::max(waiting.earliest, cycle + successor.second);
+        if (--waiting.pendingPredecessors == 0) {
+            makeReady(successor.first);
+        }
+    }
+    std::vector<std::pair<uint64_t, uint32_t>>().swap(scheduled.successors);
+
+    // The first instruction of each cycle opens a bundle
+    PIM_ISA::Instruction out = instruction;
+    out.bundleStart = !cycleOpen_ || cycle != cycle_;
+    if (out.bundleStart) {
+        stats_.bundles++;
+    }
+    cycle_ = cycle;
+    cycleOpen_ = true;
+    stats_.instructions++;
+    stats_.cycles = std::max(stats_.cycles, finish);
+    next_.emit(out);
+
+    while (!window_.empty() && window_.front().scheduled) {
+        window_.pop_front();
+        firstId_++;
+    }
+}
+
+// Schedule a barrier after everything before it has finished
+void ListScheduler::scheduleBarrier(const PIM_ISA::Instruction& instruction) {
+    uint64_t cycle = std::max({stats_.cycles, cycle_, floor_});
+    uint32_t latency = PIM_ISA::instructionLatency(instruction);
+
+    PIM_ISA::Instruction out = instruction;
+    out.bundleStart = true;
+    stats_.bundles++;
+    stats_.instructions++;
+    stats_.cycles = std::max(stats_.cycles, cycle + latency);
+
+    cycle_ = cycle;
+    cycleOpen_ = true;
+    floor_ = cycle + latency;
+    next_.emit(out);
+}
+
+// Tracker of the slot, core or row an access uses
+ListScheduler::Tracker& ListScheduler::tracker(const PIM_ISA::ResourceAccess& access) {
+    switch (access.resource) {
+        case PIM_ISA::Resource::SLOT:
+            return slots_[access.index];
+        case PIM_ISA::Resource::CORE:
+            return cores_[access.index];
+        case PIM_ISA::Resource::ROW:
+            break;
+    }
+    return rows_[access.index];
+}
+
+// Cycles after a reader starts before its resource may be overwritten
+uint32_t ListScheduler::readerDelay(PIM_ISA::Resource resource) {
+    return resource == PIM_ISA::Resource::ROW ? PIM_ISA::READ_CYCLES : 0;
+}
+
+// Bank a Read or Write occupies
+int ListScheduler::bankOf(const PIM_ISA::Instruction& instruction) {
+    if (instruction.type != PIM_ISA::InstructionType::EXE || instruction.read == instruction.write) {
+        return -1;
+    }
+    return PIM_ISA::bankOfRow(instruction.rowAddress);
+}
+
+} // namespace Optimizer
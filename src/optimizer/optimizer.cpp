@@ -1,11 +1,97 @@
 #include "../../include/optimizer/optimizer.h"
+#include "../../include/ir/transforms.h"
+#include <array>
+#include <queue>
 #include <iostream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <functional>
 #include <algorithm>
+#include <numeric>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace Optimizer {
 
+namespace {
+
+// Unroll factor applied to innermost loops at level 3
+constexpr uint32_t LOOP_UNROLL_FACTOR = 4;
+
+// Cores left for tile accumulators (cores 0-2 are programmed at program start)
+constexpr uint32_t MAX_TILE_ACCUMULATORS = PIM_ISA::NUM_CORES - 3;
+
+// Accumulators per row of C at level 2 (each may need its own B slot after slot 0)
+constexpr uint32_t MAX_ROW_ACCUMULATORS = std::min(MAX_TILE_ACCUMULATORS, PIM_ISA::MAX_OPERAND_SLOT_B);
+
+// Accumulators of a folded product (its constants take read slots MAX_OPERAND_SLOT_A + 1 and up)
+constexpr uint32_t MAX_SCALE_ACCUMULATORS = PIM_ISA::MAX_OPERAND_SLOT_B - PIM_ISA::MAX_OPERAND_SLOT_A;
+
+// Items of a batch computed at once (each reads one slot of A and one of B after all of A's)
+constexpr uint32_t MAX_BATCH_ACCUMULATORS =
+    std::min(PIM_ISA::MAX_OPERAND_SLOT_A + 1, (PIM_ISA::MAX_OPERAND_SLOT_B + 1) / 2);
+
+// Instructions the reordering pass reorders at a time
+constexpr size_t REORDERING_BLOCK = 4096;
+
+// Unscheduled instructions the list scheduler looks ahead over
+constexpr size_t SCHEDULING_WINDOW = 1024;
+
+// Dimensions of a matrix product C (rows x cols) = A (rows x depth) * B (depth x cols)
+struct ProductDimensions {
+    uint64_t rows{0};
+    uint64_t depth{0};
+    uint64_t cols{0};
+};
+
+// Look up the dimensions of a multiplication; false if it is not a valid product
+bool getProductDimensions(const Frontend::MatrixOperation& op,
+                          const std::map<std::string, const Frontend::MatrixInfo*>& byName,
+                          ProductDimensions& dimensions) {
+    if (op.type != Frontend::OperationType::MULTIPLY || (op.inputs.size() != 2 && op.inputs.size() != 4)) {
+        return false;
+    }
+    
+    auto a = byName.find(op.inputs[0]);
+    auto b = byName.find(op.inputs[1]);
+    if (a == byName.end() || b == byName.end() || a->second->cols != b->second->rows) {
+        return false;
+    }
+    
+    dimensions.rows = a->second->rows;
+    dimensions.depth = a->second->cols;
+    dimensions.cols = b->second->cols;
+    return dimensions.rows > 0 && dimensions.depth > 0 && dimensions.cols > 0;
+}
+
+// Index matrices by name
+std::map<std::string, const Frontend::MatrixInfo*> indexMatrices(const std::vector<Frontend::MatrixInfo>& matrices) {
+    std::map<std::string, const Frontend::MatrixInfo*> byName;
+    for (const auto& matrix : matrices) {
+        byName[matrix.name] = &matrix;
+    }
+    return byName;
+}
+
+// Memory rows a matrix of the given size and element width occupies
+uint32_t memoryRows(uint64_t rows, uint64_t cols, uint32_t elementWidth) {
+    uint64_t nibbles = rows * cols * elementWidth;
+    return static_cast<uint32_t>(std::max<uint64_t>(1, (nibbles + MemoryMap::NIBBLES_PER_MEMORY_ROW - 1) /
+                                                           MemoryMap::NIBBLES_PER_MEMORY_ROW));
+}
+
+// Add a 1x1 constant matrix unless it is already declared
+void addConstant(std::vector<Frontend::MatrixInfo>& matrices, const char* name) {
+    bool declared = std::any_of(matrices.begin(), matrices.end(),
+                                [&](const Frontend::MatrixInfo& matrix) { return matrix.name == name; });
+    if (!declared) {
+        matrices.push_back(Frontend::MatrixInfo(name, 1, 1, true, false));
+    }
+}
+
+} // namespace
+
 // Constructor
 Optimizer::Optimizer() : optimizationLevel_(0), verbose_(false) {
 }
@@ -27,7 +113,12 @@ void Optimizer::setVerbose(bool verbose) {
 
 // Optimize matrix operations
 std::vector<Frontend::MatrixOperation> Optimizer::optimizeOperations(
-    const std::vector<Frontend::MatrixOperation>& operations) {
+    const std::vector<Frontend::MatrixOperation>& operations,
+    std::vector<Frontend::MatrixInfo>& matrices) {
+    
+    foldedOperations_ = 0;
+    fusedOperations_ = 0;
+    strassenSplits_ = 0;
     
     // If optimization level is 0, return the original operations
     if (optimizationLevel_ == 0) {
@@ -42,36 +133,48 @@ std::vector<Frontend::MatrixOperation> Optimizer::optimizeOperations(
     }
     
     // Apply optimizations based on optimization level
-    if (optimizationLevel_ >= 1) {
-        // Level 1: Simple optimizations (removing redundant operations)
-        
-        // Identify and remove unnecessary operations (e.g., A * I = A)
-        // This is a simplified example, in a real compiler we'd need deeper analysis
-        
-        optimizedOps.erase(
-            std::remove_if(optimizedOps.begin(), optimizedOps.end(),
-                [](const Frontend::MatrixOperation& op) {
-                    // Example: Remove identity matrix multiplications (placeholder)
-                    // In reality, we'd need to analyze the actual matrix values
-                    return false;
-                }
-            ),
-            optimizedOps.end()
-        );
-    }
-    
     if (optimizationLevel_ >= 2) {
         // Level 2: More complex optimizations (reordering operations)
         
         // For matrix multiplications, reorder to minimize total computation
         // E.g., for (A * B) * C vs A * (B * C), choose the one with fewer operations
+        applyChainOrdering(optimizedOps, matrices);
+    }
+    
+    if (optimizationLevel_ >= 1) {
+        // Level 1: Simple optimizations (removing redundant operations)
+        
+        // Products by constant identity, zero, diagonal and permutation
+        // matrices become copies, scales or nothing at all (A * I = A);
+        // runs after chain ordering, which can move the constant next to
+        // the smaller operand
+        if (folding_) {
+            foldConstantOperands(optimizedOps, matrices);
+        }
+        
+        // Compute products that appear more than once only once; runs after
+        // chain ordering so products exposed by reassociation are shared too
+        eliminateCommonSubexpressions(optimizedOps, matrices);
         
-        // This is a complex optimization that requires dependency analysis
-        // We're only implementing a simplified version here
+        // Accumulate biases with the products they are added to
+        if (fusion_) {
+            applyBiasFusion(optimizedOps, matrices);
+        }
+        
+        // Trade multiply-accumulates of large square products for sums
+        if (strassenThreshold_ > 0) {
+            applyStrassen(optimizedOps, matrices);
+        }
     }
     
     if (optimizationLevel_ >= 3) {
         // Level 3: Advanced optimizations (blocking, tiling, etc.)
+        applyTiling(optimizedOps, matrices);
+    }
+    
+    if (optimizationLevel_ >= 2) {
+        // Spread the dot products not blocked above over many MAC cores
+        applyCoreAllocation(optimizedOps, matrices);
     }
     
     if (verbose_) {
@@ -81,115 +184,1507 @@ std::vector<Frontend::MatrixOperation> Optimizer::optimizeOperations(
     return optimizedOps;
 }
 
-// Optimize pPIM instructions
-std::vector<PIM_ISA::Instruction> Optimizer::optimizeInstructions(
-    const std::vector<PIM_ISA::Instruction>& instructions) {
+// Set a fixed tile size for blocked matrix multiplication
+bool Optimizer::setTileSize(uint32_t rows, uint32_t cols) {
+    if (rows == 0 || cols == 0 ||
+        rows - 1 > PIM_ISA::MAX_OPERAND_SLOT_A ||
+        rows + cols - 1 > PIM_ISA::MAX_OPERAND_SLOT_B ||
+        rows * cols > MAX_TILE_ACCUMULATORS) {
+        std::cerr << "Error: Invalid tile size " << rows << "x" << cols
+                 << " (at most " << PIM_ISA::MAX_OPERAND_SLOT_A + 1 << " rows, "
+                 << PIM_ISA::MAX_OPERAND_SLOT_B + 1 << " rows plus columns and "
+                 << MAX_TILE_ACCUMULATORS << " elements)" << std::endl;
+        return false;
+    }
     
-    // If optimization level is 0, return the original instructions
-    if (optimizationLevel_ == 0) {
-        return instructions;
+    tileRows_ = rows;
+    tileCols_ = cols;
+    return true;
+}
+
+// Choose the tile size for a product of a rows x depth and a depth x cols matrix
+std::pair<uint32_t, uint32_t> Optimizer::chooseTileSize(uint32_t rows, uint32_t cols) const {
+    // A forced tile size is only clamped to the matrix
+    if (tileRows_ > 0) {
+        return {std::min(tileRows_, rows), std::min(tileCols_, cols)};
     }
     
-    std::vector<PIM_ISA::Instruction> optimizedInst = instructions;
+    // Rows per tile are at most the bank count so the A loads of a tile go
+    // to different banks; columns fill the remaining accumulator cores and
+    // read slots. Per k, a tile loads tileRows + tileCols operands for
+    // tileRows * tileCols MACs, so pick the shape with the most reuse,
+    // preferring taller tiles on a tie.
+    std::pair<uint32_t, uint32_t> best{std::min(rows, PIM_ISA::NUM_BANKS), 1};
+    double bestReadsPerMac = 2.0;
     
-    if (verbose_) {
-        std::cout << "Optimizing pPIM instructions (level " << optimizationLevel_ << ")..." << std::endl;
-        std::cout << "Original instruction count: " << instructions.size() << std::endl;
+    for (uint32_t tileRows = std::min(PIM_ISA::NUM_BANKS, PIM_ISA::MAX_OPERAND_SLOT_A + 1); tileRows > 0;
+         --tileRows) {
+        uint32_t r = std::min(tileRows, rows);
+        uint32_t c = std::min({cols, MAX_TILE_ACCUMULATORS / r, PIM_ISA::MAX_OPERAND_SLOT_B + 1 - r});
+        
+        double readsPerMac = 1.0 / c + 1.0 / r;
+        if (readsPerMac < bestReadsPerMac) {
+            bestReadsPerMac = readsPerMac;
+            best = {r, c};
+        }
     }
     
-    // Apply optimizations based on optimization level
-    if (optimizationLevel_ >= 1) {
-        // Level 1: Basic optimizations
-        optimizedInst = applyInstructionReordering(optimizedInst);
+    return best;
+}
+
+// Fold products by constant identity, zero, diagonal and permutation matrices
+void Optimizer::foldConstantOperands(std::vector<Frontend::MatrixOperation>& operations,
+                                     std::vector<Frontend::MatrixInfo>& matrices) {
+    std::map<std::string, Frontend::MatrixInfo*> byName;
+    std::set<std::string> viewed;
+    for (auto& matrix : matrices) {
+        byName[matrix.name] = &matrix;
+        if (!matrix.aliasOf.empty()) {
+            viewed.insert(matrix.aliasOf);
+        }
     }
     
-    if (optimizationLevel_ >= 2) {
-        // Level 2: More advanced optimizations
-        optimizedInst = applyMemoryAccessOptimization(optimizedInst);
-        optimizedInst = applyInstructionScheduling(optimizedInst);
+    // Results that may share storage: assigned by exactly one operation and not read before it
+    std::map<std::string, uint32_t> definitions;
+    std::map<std::string, size_t> lastDefinition;
+    std::set<std::string> readBeforeDefinition;
+    for (size_t n = 0; n < operations.size(); ++n) {
+        for (const auto& input : operations[n].inputs) {
+            if (!definitions.count(input)) {
+                readBeforeDefinition.insert(input);
+            }
+        }
+        definitions[operations[n].output]++;
+        lastDefinition[operations[n].output] = n;
+    }
+    auto shareable = [&](const std::string& name) {
+        return definitions[name] == 1 && !readBeforeDefinition.count(name) && byName.count(name) > 0;
+    };
+    
+    // Elements of a constant operand in row-major order, including the
+    // transpose of a constant matrix; null if unknown or sparse
+    auto constantValues = [&](const Frontend::MatrixInfo& matrix) -> std::shared_ptr<const std::vector<double>> {
+        if (!matrix.transposed) {
+            return matrix.nonzeros ? nullptr : matrix.values;
+        }
+        auto source = byName.find(matrix.aliasOf);
+        if (source == byName.end() || source->second->nonzeros || !source->second->values) {
+            return nullptr;
+        }
+        auto values = std::make_shared<std::vector<double>>(static_cast<size_t>(matrix.rows) * matrix.cols);
+        for (uint32_t row = 0; row < matrix.rows; ++row) {
+            for (uint32_t col = 0; col < matrix.cols; ++col) {
+                (*values)[static_cast<size_t>(row) * matrix.cols + col] =
+                    (*source->second->values)[static_cast<size_t>(col) * matrix.rows + row];
+            }
+        }
+        return values;
+    };
+    
+    // The nonzero of each column (or row) of a constant matrix; false if one has several
+    auto selectNonzeros = [](const std::vector<double>& values, const Frontend::MatrixInfo& matrix, bool byColumn,
+                             std::vector<uint32_t>& selected) {
+        uint32_t lines = byColumn ? matrix.cols : matrix.rows;
+        uint32_t length = byColumn ? matrix.rows : matrix.cols;
+        selected.assign(lines, Frontend::NO_ELEMENT);
+        for (uint32_t line = 0; line < lines; ++line) {
+            for (uint32_t n = 0; n < length; ++n) {
+                size_t index = byColumn ? static_cast<size_t>(n) * matrix.cols + line
+                                        : static_cast<size_t>(line) * matrix.cols + n;
+                if (values[index] == 0.0) {
+                    continue;
+                }
+                if (selected[line] != Frontend::NO_ELEMENT) {
+                    return false;
+                }
+                selected[line] = n;
+            }
+        }
+        return true;
+    };
+    
+    std::vector<Frontend::MatrixOperation> result;
+    std::map<std::string, std::string> replacements;
+    std::set<std::string> removedTemporaries;
+    for (size_t n = 0; n < operations.size(); ++n) {
+        Frontend::MatrixOperation op = operations[n];
+        for (auto& input : op.inputs) {
+            auto replacement = replacements.find(input);
+            if (replacement != replacements.end()) {
+                input = replacement->second;
+            }
+        }
+        
+        auto a = byName.find(op.inputs[0]);
+        auto b = byName.find(op.inputs.size() > 1 ? op.inputs[1] : op.inputs[0]);
+        auto output = byName.find(op.output);
+        if (op.type != Frontend::OperationType::MULTIPLY || op.inputs.size() != 2 ||
+            a == byName.end() || b == byName.end() || output == byName.end()) {
+            result.push_back(op);
+            continue;
+        }
+        
+        // A constant right operand scales columns, a constant left operand rows
+        std::vector<uint32_t> selected;
+        auto right = constantValues(*b->second);
+        auto left = constantValues(*a->second);
+        bool byColumn = right && selectNonzeros(*right, *b->second, true, selected);
+        if (!byColumn && !(left && selectNonzeros(*left, *a->second, false, selected))) {
+            result.push_back(op);
+            continue;
+        }
+        const Frontend::MatrixInfo& constant = byColumn ? *b->second : *a->second;
+        const std::vector<double>& values = byColumn ? *right : *left;
+        const std::string& source = byColumn ? op.inputs[0] : op.inputs[1];
+        Frontend::MatrixInfo* sourceInfo = byColumn ? a->second : b->second;
+        if (sourceInfo->nonzeros) {
+            result.push_back(op);
+            continue;
+        }
+        
+        bool zero = true;
+        bool diagonal = constant.rows == constant.cols;
+        bool permutation = constant.rows == constant.cols;
+        std::set<uint32_t> used;
+        for (uint32_t line = 0; line < selected.size(); ++line) {
+            if (selected[line] == Frontend::NO_ELEMENT) {
+                permutation = false;
+                continue;
+            }
+            size_t index = byColumn ? static_cast<size_t>(selected[line]) * constant.cols + line
+                                    : static_cast<size_t>(line) * constant.cols + selected[line];
+            zero = false;
+            diagonal = diagonal && selected[line] == line;
+            permutation = permutation && values[index] == 1.0 && used.insert(selected[line]).second;
+        }
+        bool identity = diagonal && permutation;
+        
+        auto report = [&](const std::string& action) {
+            if (verbose_) {
+                const char* kind = identity ? "identity" : zero ? "zero matrix" : diagonal ? "diagonal" :
+                                   permutation ? "permutation" : byColumn ? "one nonzero per column" :
+                                   "one nonzero per row";
+                std::cout << "Folding " << op.output << " = " << op.inputs[0] << " * " << op.inputs[1] << " ("
+                          << constant.name << ": " << kind << "): " << action << std::endl;
+            }
+            foldedOperations_++;
+        };
+        
+        // A copy needs no code when the result can share the operand's storage
+        bool stable = !lastDefinition.count(source) || lastDefinition[source] < n;
+        if (identity && stable && shareable(op.output)) {
+            Frontend::MatrixInfo* target = output->second;
+            if (target->isTemporary) {
+                replacements[op.output] = source;
+                removedTemporaries.insert(op.output);
+                report("replaced by " + source);
+                continue;
+            }
+            if (sourceInfo->aliasOf.empty() && !sourceInfo->isTemporary) {
+                target->aliasOf = source;
+                report("alias of " + source);
+                continue;
+            }
+            if (sourceInfo->aliasOf.empty() && !viewed.count(source) && shareable(source)) {
+                // The operation computing the temporary writes the result instead
+                for (auto& earlier : result) {
+                    if (earlier.output == source) {
+                        earlier.output = op.output;
+                    }
+                    for (auto& input : earlier.inputs) {
+                        if (input == source) {
+                            input = op.output;
+                        }
+                    }
+                }
+                replacements[source] = op.output;
+                removedTemporaries.insert(source);
+                report("computed in place of " + source);
+                continue;
+            }
+        }
+        
+        Frontend::MatrixOperation scale(byColumn ? Frontend::OperationType::SCALE_COLUMNS
+                                                 : Frontend::OperationType::SCALE_ROWS,
+                                        op.inputs, op.output);
+        scale.selected = std::move(selected);
+        report(zero ? "zero fill" : identity ? "copy" : "one multiply-accumulate per element");
+        result.push_back(std::move(scale));
+    }
+    
+    if (removedTemporaries.empty() && foldedOperations_ == 0) {
+        return;
+    }
+    operations = std::move(result);
+    
+    matrices.erase(std::remove_if(matrices.begin(), matrices.end(),
+                                  [&](const Frontend::MatrixInfo& matrix) {
+                                      return removedTemporaries.count(matrix.name) > 0;
+                                  }),
+                   matrices.end());
+}
+
+// Reassociate chained products to minimize multiply-accumulates
+void Optimizer::applyChainOrdering(std::vector<Frontend::MatrixOperation>& operations,
+                                   std::vector<Frontend::MatrixInfo>& matrices) {
+    std::map<std::string, Frontend::MatrixInfo> byName;
+    for (const auto& matrix : matrices) {
+        byName[matrix.name] = matrix;
+    }
+    
+    // Products computing a temporary that exactly one other product uses
+    std::map<std::string, size_t> producers;
+    std::map<std::string, uint32_t> uses;
+    std::map<std::string, uint32_t> multipliedUses;
+    for (size_t i = 0; i < operations.size(); ++i) {
+        const auto& op = operations[i];
+        for (const auto& input : op.inputs) {
+            uses[input]++;
+            if (op.type == Frontend::OperationType::MULTIPLY) {
+                multipliedUses[input]++;
+            }
+        }
+        auto output = byName.find(op.output);
+        if (op.type == Frontend::OperationType::MULTIPLY && op.inputs.size() == 2 &&
+            output != byName.end() && output->second.isTemporary) {
+            producers[op.output] = i;
+        }
+    }
+    for (auto it = producers.begin(); it != producers.end();) {
+        it = uses[it->first] == 1 && multipliedUses[it->first] == 1 ? std::next(it) : producers.erase(it);
+    }
+    
+    std::vector<bool> replaced(operations.size(), false);
+    std::map<size_t, std::vector<Frontend::MatrixOperation>> rewritten;
+    std::set<std::string> removedTemporaries;
+    std::vector<Frontend::MatrixInfo> newTemporaries;
+    std::set<std::string> newNames;
+    
+    for (size_t root = 0; root < operations.size(); ++root) {
+        const auto& op = operations[root];
+        if (op.type != Frontend::OperationType::MULTIPLY || op.inputs.size() != 2 || producers.count(op.output)) {
+            continue;
+        }
+        
+        // Flatten the chain into its factors, in order
+        std::vector<std::string> factors;
+        std::vector<size_t> chain;
+        uint64_t writtenMacs = 0;
+        bool valid = true;
+        std::function<void(size_t)> flatten = [&](size_t index) {
+            const auto& product = operations[index];
+            chain.push_back(index);
+            auto a = byName.find(product.inputs[0]);
+            auto b = byName.find(product.inputs[1]);
+            if (a == byName.end() || b == byName.end() || a->second.cols != b->second.rows) {
+                valid = false;
+                return;
+            }
+            writtenMacs += static_cast<uint64_t>(a->second.rows) * a->second.cols * b->second.cols;
+            for (const auto& input : product.inputs) {
+                auto producer = producers.find(input);
+                if (producer != producers.end() && producer->second < index) {
+                    flatten(producer->second);
+                } else {
+                    factors.push_back(input);
+                }
+            }
+        };
+        flatten(root);
+        if (!valid || factors.size() < 3) {
+            continue;
+        }
+        
+        // dims[i] x dims[i + 1] is the shape of factor i
+        size_t n = factors.size();
+        std::vector<uint64_t> dims;
+        dims.push_back(byName[factors[0]].rows);
+        for (const auto& factor : factors) {
+            dims.push_back(byName[factor].cols);
+        }
+        
+        // macs[i][j]: fewest MACs computing factors i..j; split[i][j]: last product's split
+        std::vector<std::vector<uint64_t>> macs(n, std::vector<uint64_t>(n, 0));
+        std::vector<std::vector<size_t>> split(n, std::vector<size_t>(n, 0));
+        for (size_t length = 2; length <= n; ++length) {
+            for (size_t i = 0; i + length <= n; ++i) {
+                size_t j = i + length - 1;
+                macs[i][j] = UINT64_MAX;
+                for (size_t k = i; k < j; ++k) {
+                    uint64_t cost = macs[i][k] + macs[k + 1][j] + dims[i] * dims[k + 1] * dims[j + 1];
+                    if (cost < macs[i][j]) {
+                        macs[i][j] = cost;
+                        split[i][j] = k;
+                    }
+                }
+            }
+        }
+        
+        if (macs[0][n - 1] >= writtenMacs) {
+            continue;
+        }
+        
+        // Emit the products of the chosen order, innermost first
+        for (size_t index : chain) {
+            if (index != root) {
+                removedTemporaries.insert(operations[index].output);
+            }
+            replaced[index] = true;
+        }
+        std::vector<Frontend::MatrixOperation>& products = rewritten[root];
+        uint32_t temporaryCount = 0;
+        std::function<std::string(size_t, size_t)> emit = [&](size_t i, size_t j) -> std::string {
+            if (i == j) {
+                return factors[i];
+            }
+            std::string left = emit(i, split[i][j]);
+            std::string right = emit(split[i][j] + 1, j);
+            std::string target = op.output;
+            if (i != 0 || j != n - 1) {
+                do {
+                    target = op.output + "." + std::to_string(++temporaryCount);
+                } while ((byName.count(target) && !removedTemporaries.count(target)) || newNames.count(target));
+                newNames.insert(target);
+                newTemporaries.push_back(Frontend::MatrixInfo(target, static_cast<uint32_t>(dims[i]),
+                                                              static_cast<uint32_t>(dims[j + 1]), false, false, true));
+            }
+            products.push_back(Frontend::MatrixOperation(Frontend::OperationType::MULTIPLY, {left, right}, target));
+            return target;
+        };
+        std::function<std::string(size_t, size_t)> describe = [&](size_t i, size_t j) -> std::string {
+            if (i == j) {
+                return factors[i];
+            }
+            std::string text = describe(i, split[i][j]) + " * " + describe(split[i][j] + 1, j);
+            return (i == 0 && j == n - 1) ? text : "(" + text + ")";
+        };
+        emit(0, n - 1);
+        
+        if (verbose_) {
+            std::cout << "Reordering chain " << op.output << " = " << describe(0, n - 1) << ": "
+                     << writtenMacs << " -> " << macs[0][n - 1] << " MACs" << std::endl;
+        }
+    }
+    
+    if (rewritten.empty()) {
+        return;
+    }
+    
+    std::vector<Frontend::MatrixOperation> result;
+    for (size_t i = 0; i < operations.size(); ++i) {
+        auto products = rewritten.find(i);
+        if (products != rewritten.end()) {
+            result.insert(result.end(), products->second.begin(), products->second.end());
+        } else if (!replaced[i]) {
+            result.push_back(operations[i]);
+        }
+    }
+    operations = std::move(result);
+    
+    matrices.erase(std::remove_if(matrices.begin(), matrices.end(),
+                                  [&](const Frontend::MatrixInfo& matrix) {
+                                      return removedTemporaries.count(matrix.name) > 0;
+                                  }),
+                   matrices.end());
+    matrices.insert(matrices.end(), newTemporaries.begin(), newTemporaries.end());
+}
+
+// Compute each distinct product once
+void Optimizer::eliminateCommonSubexpressions(std::vector<Frontend::MatrixOperation>& operations,
+                                              std::vector<Frontend::MatrixInfo>& matrices) {
+    std::map<std::string, Frontend::MatrixInfo*> byName;
+    for (auto& matrix : matrices) {
+        byName[matrix.name] = &matrix;
+    }
+    
+    // Results that may be shared: assigned by exactly one operation and not read before it
+    std::map<std::string, uint32_t> definitions;
+    std::set<std::string> readBeforeDefinition;
+    for (const auto& op : operations) {
+        for (const auto& input : op.inputs) {
+            if (!definitions.count(input)) {
+                readBeforeDefinition.insert(input);
+            }
+        }
+        definitions[op.output]++;
+    }
+    auto shareable = [&](const std::string& name) {
+        return definitions[name] == 1 && !readBeforeDefinition.count(name) && byName.count(name) > 0;
+    };
+    
+    // Value number of each matrix's current contents (matrices not yet
+    // assigned get one on first use) and of each computed (type, operands)
+    std::map<std::string, uint32_t> valueOf;
+    std::map<std::pair<Frontend::OperationType, std::vector<uint32_t>>, uint32_t> computed;
+    std::map<uint32_t, std::string> holders;
+    std::map<std::string, std::string> replacements;
+    uint32_t nextValue = 0;
+    auto value = [&](const std::string& name) {
+        auto it = valueOf.find(name);
+        return it != valueOf.end() ? it->second : (valueOf[name] = nextValue++);
+    };
+    
+    // A transposed view holds the current transpose of the matrix it views,
+    // the same value as a copy C = X^T
+    auto operandValue = [&](const std::string& name) {
+        auto matrix = byName.find(name);
+        if (matrix == byName.end() || !matrix->second->transposed) {
+            return value(name);
+        }
+        auto key = std::make_pair(Frontend::OperationType::TRANSPOSE,
+                                  std::vector<uint32_t>{value(matrix->second->aliasOf), value(Frontend::CONSTANT_ONE)});
+        auto found = computed.find(key);
+        return found != computed.end() ? found->second : (computed[key] = nextValue++);
+    };
+    
+    std::vector<Frontend::MatrixOperation> result;
+    std::set<std::string> removedTemporaries;
+    for (auto op : operations) {
+        for (auto& input : op.inputs) {
+            auto replacement = replacements.find(input);
+            if (replacement != replacements.end()) {
+                input = replacement->second;
+            }
+        }
+        
+        std::vector<uint32_t> operands;
+        for (const auto& input : op.inputs) {
+            operands.push_back(operandValue(input));
+        }
+        if (op.type == Frontend::OperationType::ADD) {
+            std::sort(operands.begin(), operands.end());
+        }
+        auto key = std::make_pair(op.type, operands);
+        auto found = computed.find(key);
+        if (found == computed.end()) {
+            found = computed.emplace(key, nextValue++).first;
+        }
+        
+        // Reuse an earlier result holding the same value
+        auto holder = holders.find(found->second);
+        if (holder != holders.end() && shareable(op.output) && holder->second != op.output &&
+            byName[op.output]->rows == byName[holder->second]->rows &&
+            byName[op.output]->cols == byName[holder->second]->cols) {
+            Frontend::MatrixInfo* output = byName[op.output];
+            if (verbose_) {
+                const char* symbol = op.type == Frontend::OperationType::ADD ? " + " :
+                                     op.type == Frontend::OperationType::SUBTRACT ? " - " : " * ";
+                std::cout << "Eliminating " << op.output << " = " << op.inputs[0];
+                if (op.type == Frontend::OperationType::TRANSPOSE) {
+                    std::cout << "^T";
+                }
+                for (size_t i = 1; op.type != Frontend::OperationType::TRANSPOSE && i < op.inputs.size(); ++i) {
+                    std::cout << symbol << op.inputs[i];
+                }
+                std::cout << " (same as " << holder->second << ")" << std::endl;
+            }
+            if (output->isTemporary) {
+                replacements[op.output] = holder->second;
+                removedTemporaries.insert(op.output);
+            } else {
+                output->aliasOf = holder->second;
+            }
+            valueOf[op.output] = found->second;
+            continue;
+        }
+        
+        valueOf[op.output] = found->second;
+        if (shareable(op.output) && !holders.count(found->second)) {
+            holders[found->second] = op.output;
+        }
+        result.push_back(op);
+    }
+    
+    if (result.size() == operations.size()) {
+        return;
+    }
+    operations = std::move(result);
+    
+    matrices.erase(std::remove_if(matrices.begin(), matrices.end(),
+                                  [&](const Frontend::MatrixInfo& matrix) {
+                                      return removedTemporaries.count(matrix.name) > 0;
+                                  }),
+                   matrices.end());
+}
+
+// Fuse sums into the products they add to
+void Optimizer::applyBiasFusion(std::vector<Frontend::MatrixOperation>& operations,
+                                std::vector<Frontend::MatrixInfo>& matrices) {
+    std::map<std::string, const Frontend::MatrixInfo*> byName = indexMatrices(matrices);
+    
+    // Temporary products read by exactly one operation
+    std::map<std::string, uint32_t> uses;
+    std::map<std::string, size_t> producers;
+    for (size_t i = 0; i < operations.size(); ++i) {
+        const auto& op = operations[i];
+        for (const auto& input : op.inputs) {
+            uses[input]++;
+        }
+        auto output = byName.find(op.output);
+        if (op.type == Frontend::OperationType::MULTIPLY && op.inputs.size() == 2 &&
+            output != byName.end() && output->second->isTemporary && output->second->aliasOf.empty()) {
+            producers[op.output] = i;
+        }
+    }
+    
+    auto storageOf = [&](const std::string& name) -> const std::string& {
+        auto matrix = byName.find(name);
+        return matrix != byName.end() && matrix->second->transposed ? matrix->second->aliasOf : name;
+    };
+    
+    std::vector<bool> removed(operations.size(), false);
+    std::set<std::string> removedTemporaries;
+    bool needOne = false;
+    bool needMinusOne = false;
+    
+    for (size_t e = 0; e < operations.size(); ++e) {
+        auto& op = operations[e];
+        bool add = op.type == Frontend::OperationType::ADD;
+        if ((!add && op.type != Frontend::OperationType::SUBTRACT) || op.inputs.size() != 2) {
+            continue;
+        }
+        
+        // The product may be either term of a sum but only the first of a difference
+        for (size_t term = 0; term < (add ? 2u : 1u); ++term) {
+            auto producer = producers.find(op.inputs[term]);
+            if (producer == producers.end() || uses[producer->first] != 1 || producer->second >= e ||
+                removed[producer->second]) {
+                continue;
+            }
+            const auto& product = operations[producer->second];
+            
+            // The fused product reads A and B (or the matrices they are
+            // transposed views of) later than the original one and writes E
+            // while reading them
+            const std::string& storageA = storageOf(product.inputs[0]);
+            const std::string& storageB = storageOf(product.inputs[1]);
+            bool safe = op.output != storageA && op.output != storageB;
+            for (size_t between = producer->second + 1; safe && between < e; ++between) {
+                safe = operations[between].output != storageA && operations[between].output != storageB;
+            }
+            if (!safe) {
+                continue;
+            }
+            
+            const std::string& bias = op.inputs[1 - term];
+            const char* scale = add ? Frontend::CONSTANT_ONE : Frontend::CONSTANT_MINUS_ONE;
+            needOne = needOne || add;
+            needMinusOne = needMinusOne || !add;
+            
+            if (verbose_) {
+                std::cout << "Fusing " << op.output << " = " << op.inputs[0] << (add ? " + " : " - ")
+                         << op.inputs[1] << " into " << product.output << " = " << product.inputs[0]
+                         << " * " << product.inputs[1] << " (accumulators start from "
+                         << (add ? "" : "-") << bias << ")" << std::endl;
+            }
+            
+            Frontend::MatrixOperation fused(Frontend::OperationType::MULTIPLY,
+                                            {product.inputs[0], product.inputs[1], bias, scale}, op.output);
+            removedTemporaries.insert(product.output);
+            removed[producer->second] = true;
+            op = fused;
+            fusedOperations_++;
+            break;
+        }
+    }
+    
+    if (fusedOperations_ == 0) {
+        return;
+    }
+    
+    std::vector<Frontend::MatrixOperation> result;
+    for (size_t i = 0; i < operations.size(); ++i) {
+        if (!removed[i]) {
+            result.push_back(operations[i]);
+        }
+    }
+    operations = std::move(result);
+    
+    matrices.erase(std::remove_if(matrices.begin(), matrices.end(),
+                                  [&](const Frontend::MatrixInfo& matrix) {
+                                      return removedTemporaries.count(matrix.name) > 0;
+                                  }),
+                   matrices.end());
+    if (needOne) {
+        addConstant(matrices, Frontend::CONSTANT_ONE);
+    }
+    if (needMinusOne) {
+        addConstant(matrices, Frontend::CONSTANT_MINUS_ONE);
+    }
+}
+
+// Split large square products into seven half-size products
+void Optimizer::applyStrassen(std::vector<Frontend::MatrixOperation>& operations,
+                              std::vector<Frontend::MatrixInfo>& matrices) {
+    std::map<std::string, Frontend::MatrixInfo> byName;
+    uint32_t usedRows = 0;
+    for (const auto& matrix : matrices) {
+        byName[matrix.name] = matrix;
+        if (matrix.aliasOf.empty()) {
+            usedRows += memoryRows(matrix.rows, matrix.cols, elementWidth_);
+        }
+    }
+    auto addMatrix = [&](const Frontend::MatrixInfo& matrix) {
+        byName[matrix.name] = matrix;
+        matrices.push_back(matrix);
+    };
+    
+    // Square block of a matrix, as a view of the matrix holding the storage
+    auto block = [&](const std::string& name, uint32_t row, uint32_t col, uint32_t size) {
+        std::string target = name;
+        const Frontend::MatrixInfo& matrix = byName.at(name);
+        if (matrix.block) {
+            target = matrix.aliasOf;
+            row += matrix.blockRow;
+            col += matrix.blockCol;
+        }
+        
+        std::string view = target + "[" + std::to_string(row) + ":" + std::to_string(row + size) + "," +
+                           std::to_string(col) + ":" + std::to_string(col + size) + "]";
+        if (!byName.count(view)) {
+            Frontend::MatrixInfo info(view, size, size, false, false);
+            info.aliasOf = target;
+            info.block = true;
+            info.blockRow = row;
+            info.blockCol = col;
+            addMatrix(info);
+        }
+        return view;
+    };
+    
+    std::vector<Frontend::MatrixOperation> result;
+    std::function<void(const Frontend::MatrixOperation&)> lower = [&](const Frontend::MatrixOperation& op) {
+        auto a = byName.find(op.inputs.empty() ? "" : op.inputs[0]);
+        auto b = byName.find(op.inputs.size() < 2 ? "" : op.inputs[1]);
+        auto c = byName.find(op.output);
+        if (op.type != Frontend::OperationType::MULTIPLY || op.inputs.size() != 2 ||
+            a == byName.end() || b == byName.end() || c == byName.end()) {
+            result.push_back(op);
+            return;
+        }
+        
+        // Sparse operands have no blocks; their zeros are skipped instead
+        uint32_t n = a->second.rows;
+        bool square = a->second.cols == n && b->second.rows == n && b->second.cols == n &&
+                      c->second.rows == n && c->second.cols == n;
+        bool sparse = a->second.nonzeros || b->second.nonzeros;
+        if (!square || sparse || n % 2 != 0 || n < strassenThreshold_) {
+            result.push_back(op);
+            return;
+        }
+        
+        // 18 temporaries of n/2 x n/2 (the blocks themselves take no memory)
+        uint32_t h = n / 2;
+        uint32_t temporaryRows = 18 * memoryRows(h, h, elementWidth_);
+        if (usedRows + temporaryRows > PIM_ISA::NUM_ROWS) {
+            if (verbose_) {
+                std::cout << "Not splitting " << op.output << " = " << op.inputs[0] << " * " << op.inputs[1]
+                         << ": its temporaries need " << temporaryRows << " memory rows, "
+                         << PIM_ISA::NUM_ROWS - std::min(usedRows, PIM_ISA::NUM_ROWS) << " are free" << std::endl;
+            }
+            result.push_back(op);
+            return;
+        }
+        usedRows += temporaryRows;
+        strassenSplits_++;
+        
+        if (verbose_) {
+            uint64_t before = static_cast<uint64_t>(n) * n * n;
+            std::cout << "Splitting " << op.output << " = " << op.inputs[0] << " * " << op.inputs[1]
+                     << " (" << n << "x" << n << ") into 7 products of " << h << "x" << h
+                     << " (" << before << " -> " << 7 * before / 8 << " MACs before further splits)" << std::endl;
+        }
+        
+        std::string prefix = op.output;
+        for (uint32_t copy = 2; byName.count(prefix + ".M1"); ++copy) {
+            prefix = op.output + "." + std::to_string(copy);
+        }
+        auto temporary = [&](const std::string& tag) {
+            std::string name = prefix + "." + tag;
+            addMatrix(Frontend::MatrixInfo(name, h, h, false, false, true));
+            return name;
+        };
+        auto emit = [&](Frontend::OperationType type, const std::string& left, const std::string& right,
+                        const std::string& target) {
+            result.push_back(Frontend::MatrixOperation(type, {left, right}, target));
+        };
+        const auto ADD = Frontend::OperationType::ADD;
+        const auto SUB = Frontend::OperationType::SUBTRACT;
+        
+        std::string a11 = block(op.inputs[0], 0, 0, h), a12 = block(op.inputs[0], 0, h, h);
+        std::string a21 = block(op.inputs[0], h, 0, h), a22 = block(op.inputs[0], h, h, h);
+        std::string b11 = block(op.inputs[1], 0, 0, h), b12 = block(op.inputs[1], 0, h, h);
+        std::string b21 = block(op.inputs[1], h, 0, h), b22 = block(op.inputs[1], h, h, h);
+        std::string c11 = block(op.output, 0, 0, h), c12 = block(op.output, 0, h, h);
+        std::string c21 = block(op.output, h, 0, h), c22 = block(op.output, h, h, h);
+        
+        std::string s1 = temporary("S1"), s2 = temporary("S2"), s3 = temporary("S3"), s4 = temporary("S4");
+        emit(ADD, a21, a22, s1);
+        emit(SUB, s1, a11, s2);
+        emit(SUB, a11, a21, s3);
+        emit(SUB, a12, s2, s4);
+        std::string t1 = temporary("T1"), t2 = temporary("T2"), t3 = temporary("T3"), t4 = temporary("T4");
+        emit(SUB, b12, b11, t1);
+        emit(SUB, b22, t1, t2);
+        emit(SUB, b22, b12, t3);
+        emit(SUB, t2, b21, t4);
+        
+        // C is written only after every block of A and B has been read
+        const std::pair<std::string, std::string> factors[] = {
+            {a11, b11}, {a12, b21}, {s4, b22}, {a22, t4}, {s1, t1}, {s2, t2}, {s3, t3}
+        };
+        std::vector<std::string> m;
+        for (size_t i = 0; i < 7; ++i) {
+            m.push_back(temporary("M" + std::to_string(i + 1)));
+            lower(Frontend::MatrixOperation(Frontend::OperationType::MULTIPLY,
+                                            {factors[i].first, factors[i].second}, m.back()));
+        }
+        
+        std::string u2 = temporary("U2"), u3 = temporary("U3"), u4 = temporary("U4");
+        emit(ADD, m[0], m[1], c11);
+        emit(ADD, m[0], m[5], u2);
+        emit(ADD, u2, m[6], u3);
+        emit(ADD, u2, m[4], u4);
+        emit(ADD, u4, m[2], c12);
+        emit(SUB, u3, m[3], c21);
+        emit(ADD, u3, m[4], c22);
+    };
+    
+    for (const auto& op : operations) {
+        lower(op);
+    }
+    operations = std::move(result);
+}
+
+// Apply blocking to matrix multiplications
+void Optimizer::applyTiling(std::vector<Frontend::MatrixOperation>& operations,
+                            const std::vector<Frontend::MatrixInfo>& matrices) {
+    auto byName = indexMatrices(matrices);
+    
+    for (auto& op : operations) {
+        ProductDimensions dimensions;
+        if (!getProductDimensions(op, byName, dimensions)) {
+            continue;
+        }
+        uint64_t rows = dimensions.rows;
+        uint64_t depth = dimensions.depth;
+        uint64_t cols = dimensions.cols;
+        
+        auto tile = chooseTileSize(static_cast<uint32_t>(rows), static_cast<uint32_t>(cols));
+        if (tile.first * tile.second < 2) {
+            continue;
+        }
+        
+        op.tileRows = tile.first;
+        op.tileCols = tile.second;
+        
+        if (verbose_) {
+            // Each tile loads its rows of A and columns of B at most once per k
+            uint64_t readsBefore = 2 * rows * depth * cols;
+            uint64_t readsAfter = depth * (cols * ((rows + tile.first - 1) / tile.first) +
+                                           rows * ((cols + tile.second - 1) / tile.second));
+            std::cout << "Tiling " << op.output << " = " << op.inputs[0] << " * " << op.inputs[1]
+                     << " with " << tile.first << "x" << tile.second << " tiles" << std::endl;
+            std::cout << "  EXE Read instructions: " << readsBefore << " -> at most " << readsAfter
+                     << " (" << std::fixed << std::setprecision(1)
+                     << static_cast<double>(readsBefore) / readsAfter << "x fewer)"
+                     << std::defaultfloat << std::endl;
+        }
+    }
+}
+
+// Assign the dot products of each row of C to separate MAC cores
+void Optimizer::applyCoreAllocation(std::vector<Frontend::MatrixOperation>& operations,
+                                    const std::vector<Frontend::MatrixInfo>& matrices) {
+    auto byName = indexMatrices(matrices);
+    
+    for (auto& op : operations) {
+        // Items of a batch go to their own cores, a group at a time; the
+        // reads of a group are in consecutive banks
+        if (op.type == Frontend::OperationType::BATCH_MULTIPLY) {
+            auto batch = byName.find(op.inputs[0]);
+            if (op.tileRows > 0 || batch == byName.end() || batch->second->batch < 2) {
+                continue;
+            }
+            op.tileRows = 1;
+            op.tileCols = std::min(batch->second->batch, MAX_BATCH_ACCUMULATORS);
+            if (verbose_) {
+                std::cout << "Interleaving " << batch->second->batch << " items of " << op.output << "[] = "
+                         << op.inputs[0] << "[] * " << op.inputs[1] << "[] over " << op.tileCols << " MAC cores"
+                         << std::endl;
+            }
+            continue;
+        }
+        
+        // Rows or columns of a folded product go to their own cores, as
+        // many as the read slots hold constants for
+        if ((op.type == Frontend::OperationType::SCALE_ROWS || op.type == Frontend::OperationType::SCALE_COLUMNS) &&
+            op.tileRows == 0 && op.selected.size() >= 2) {
+            op.tileRows = 1;
+            op.tileCols = static_cast<uint32_t>(std::min<size_t>(op.selected.size(), MAX_SCALE_ACCUMULATORS));
+            if (verbose_) {
+                std::cout << "Distributing " << op.output << " = " << op.inputs[0] << " * " << op.inputs[1]
+                         << " over " << op.tileCols << " MAC cores" << std::endl;
+            }
+            continue;
+        }
+        
+        ProductDimensions dimensions;
+        if (op.tileRows > 0 || !getProductDimensions(op, byName, dimensions)) {
+            continue;
+        }
+        
+        // Columns j, j+1, ... of a row go to consecutive cores round-robin;
+        // they share the row of A, so each k loads it once for all of them
+        uint32_t cores = static_cast<uint32_t>(std::min<uint64_t>(dimensions.cols, MAX_ROW_ACCUMULATORS));
+        if (cores < 2) {
+            continue;
+        }
+        
+        op.tileRows = 1;
+        op.tileCols = cores;
+        
+        if (verbose_) {
+            std::cout << "Distributing " << op.output << " = " << op.inputs[0] << " * " << op.inputs[1]
+                     << " over " << cores << " MAC cores" << std::endl;
+        }
+    }
+}
+
+// Optimize the loop nests built for the operations
+void Optimizer::optimizeLoopNests(std::vector<IR::Kernel>& kernels) {
+    progCount_ = 0;
+    progBaseline_ = 0;
+    
+    if (optimizationLevel_ >= 1) {
+        // Level 1: Program only the cores that are used, reusing matching ones
+        applyCoreConfiguration(kernels);
     }
     
     if (optimizationLevel_ >= 3) {
-        // Level 3: Most aggressive optimizations
-        optimizedInst = applyLoopUnrolling(optimizedInst);
+        // Level 3: Loop transformations
+        for (auto& kernel : kernels) {
+            applyLoopUnrolling(kernel);
+        }
     }
     
     if (verbose_) {
-        std::cout << "Optimized instruction count: " << optimizedInst.size() << std::endl;
+        for (const auto& kernel : kernels) {
+            if (kernel.body.empty()) {
+                continue;
+            }
+            std::cout << "Loop nest for " << kernel.name << ":" << std::endl;
+            IR::print(kernel, std::cout);
+        }
+    }
+}
+
+namespace {
+
+// Marks a core without a LUT configuration
+constexpr int UNPROGRAMMED_CORE = -1;
+
+// Operation programmed into each core (UNPROGRAMMED_CORE if none)
+using CoreConfiguration = std::vector<int>;
+
+// Sorted, disjoint ranges of memory rows [first, last]
+using RowRanges = std::vector<std::pair<int64_t, int64_t>>;
+
+// Memory rows a loop nest reads and writes
+struct RowAccesses {
+    RowRanges reads;
+    RowRanges writes;
+};
+
+// Collect the rows accessed by a list of nodes, given the range of each enclosing induction variable
+void collectRows(const std::vector<IR::Node>& nodes, std::vector<std::pair<int64_t, int64_t>>& ivRanges,
+                 RowAccesses& accesses) {
+    for (const auto& node : nodes) {
+        if (node.kind == IR::NodeKind::LOOP) {
+            if (node.tripCount() > 0) {
+                ivRanges[node.loop] = {node.begin, node.begin + static_cast<int64_t>(node.tripCount() - 1) * node.step};
+                collectRows(node.body, ivRanges, accesses);
+            }
+            continue;
+        }
+        if (node.kind == IR::NodeKind::COMPUTE) {
+            continue;
+        }
+        
+        // Extremes of the nibble offset over the iteration space
+        int64_t low = node.address.offset.constant;
+        int64_t high = low;
+        for (const auto& term : node.address.offset.terms) {
+            int64_t first = term.second * ivRanges[term.first].first;
+            int64_t last = term.second * ivRanges[term.first].second;
+            low += std::min(first, last);
+            high += std::max(first, last);
+        }
+        
+        RowRanges& rows = node.kind == IR::NodeKind::LOAD ? accesses.reads : accesses.writes;
+        rows.emplace_back(node.address.baseAddress + low / MemoryMap::NIBBLES_PER_MEMORY_ROW,
+                          node.address.baseAddress + high / MemoryMap::NIBBLES_PER_MEMORY_ROW);
+    }
+}
+
+// Sort row ranges and merge the overlapping ones
+void mergeRanges(RowRanges& ranges) {
+    std::sort(ranges.begin(), ranges.end());
+    size_t merged = 0;
+    for (size_t n = 0; n < ranges.size(); ++n) {
+        if (merged > 0 && ranges[n].first <= ranges[merged - 1].second + 1) {
+            ranges[merged - 1].second = std::max(ranges[merged - 1].second, ranges[n].second);
+        } else {
+            ranges[merged++] = ranges[n];
+        }
+    }
+    ranges.resize(merged);
+}
+
+// Get the memory rows a loop nest reads and writes
+RowAccesses getRowAccesses(const IR::Kernel& kernel) {
+    RowAccesses accesses;
+    std::vector<std::pair<int64_t, int64_t>> ivRanges(kernel.loopCount, {0, 0});
+    collectRows(kernel.body, ivRanges, accesses);
+    mergeRanges(accesses.reads);
+    mergeRanges(accesses.writes);
+    return accesses;
+}
+
+// Check whether two sets of row ranges share a row
+bool rangesOverlap(const RowRanges& a, const RowRanges& b) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].second < b[j].first) {
+            i++;
+        } else if (b[j].second < a[i].first) {
+            j++;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Count the PROGs code generation emits for loop nests run in order
+uint32_t countProgs(const std::vector<IR::Kernel>& kernels) {
+    CoreConfiguration configuration(PIM_ISA::NUM_CORES, UNPROGRAMMED_CORE);
+    uint32_t progs = 0;
+    for (const auto& kernel : kernels) {
+        for (const auto& setup : kernel.cores) {
+            if (configuration[setup.core] != static_cast<int>(setup.opType)) {
+                configuration[setup.core] = static_cast<int>(setup.opType);
+                progs++;
+            }
+        }
+    }
+    return progs;
+}
+
+// Cores chosen for a loop nest
+struct CoreAssignment {
+    // New number of each core, indexed by its number in the nest
+    std::vector<uint8_t> cores;
+    
+    // Cores that have to be programmed
+    uint32_t progs{0};
+    
+    // Of those, cores that lose another configuration
+    uint32_t reprograms{0};
+};
+
+// Choose the cores a loop nest runs on, given the current core configuration
+//
+// A core keeps its number if it is already programmed as needed; otherwise
+// it moves to another core holding the same configuration, then to an
+// unprogrammed core, so that configurations later nests may need are kept.
+CoreAssignment assignCores(const IR::Kernel& kernel, const CoreConfiguration& configuration) {
+    CoreAssignment assignment;
+    assignment.cores.resize(PIM_ISA::NUM_CORES);
+    std::iota(assignment.cores.begin(), assignment.cores.end(), 0);
+    std::vector<bool> taken(PIM_ISA::NUM_CORES, false);
+    std::vector<bool> placed(kernel.cores.size(), false);
+    
+    for (size_t n = 0; n < kernel.cores.size(); ++n) {
+        const IR::CoreSetup& setup = kernel.cores[n];
+        if (configuration[setup.core] == static_cast<int>(setup.opType) && !taken[setup.core]) {
+            taken[setup.core] = true;
+            placed[n] = true;
+        }
+    }
+    
+    // First free core satisfying a condition (NUM_CORES if none)
+    auto findFree = [&](const std::function<bool(uint32_t)>& condition) {
+        for (uint32_t core = 0; core < PIM_ISA::NUM_CORES; ++core) {
+            if (!taken[core] && condition(core)) {
+                return core;
+            }
+        }
+        return PIM_ISA::NUM_CORES;
+    };
+    
+    for (size_t n = 0; n < kernel.cores.size(); ++n) {
+        if (placed[n]) {
+            continue;
+        }
+        const IR::CoreSetup& setup = kernel.cores[n];
+        int opType = static_cast<int>(setup.opType);
+        
+        uint32_t core = findFree([&](uint32_t candidate) { return configuration[candidate] == opType; });
+        if (core == PIM_ISA::NUM_CORES) {
+            if (!taken[setup.core] && configuration[setup.core] == UNPROGRAMMED_CORE) {
+                core = setup.core;
+            } else {
+                core = findFree([&](uint32_t candidate) { return configuration[candidate] == UNPROGRAMMED_CORE; });
+            }
+            if (core == PIM_ISA::NUM_CORES) {
+                core = taken[setup.core] ? findFree([](uint32_t) { return true; }) : setup.core;
+                assignment.reprograms++;
+            }
+            assignment.progs++;
+        }
+        taken[core] = true;
+        assignment.cores[setup.core] = static_cast<uint8_t>(core);
     }
     
-    return optimizedInst;
+    return assignment;
 }
 
-// Apply loop unrolling optimization
-std::vector<PIM_ISA::Instruction> Optimizer::applyLoopUnrolling(
-    const std::vector<PIM_ISA::Instruction>& instructions) {
+} // namespace
+
+// Program only the cores loop nests use, as rarely as possible
+void Optimizer::applyCoreConfiguration(std::vector<IR::Kernel>& kernels) {
+    progBaseline_ = countProgs(kernels);
+    
+    // Liveness: a nest keeps the setups of the cores it computes on; nests
+    // left without work or setups (e.g. the LUT initialization) are dropped
+    std::vector<IR::Kernel> live;
+    for (auto& kernel : kernels) {
+        std::vector<bool> computes(PIM_ISA::NUM_CORES, false);
+        for (uint8_t core : kernel.computeCores()) {
+            computes[core] = true;
+        }
+        std::vector<IR::CoreSetup> setups;
+        for (const auto& setup : kernel.cores) {
+            if (computes[setup.core]) {
+                setups.push_back(setup);
+                computes[setup.core] = false;
+            }
+        }
+        kernel.cores = std::move(setups);
+        if (!kernel.body.empty() || !kernel.cores.empty()) {
+            live.push_back(std::move(kernel));
+        }
+    }
+    
+    // Nests that must run before each nest: the previous one at level 1;
+    // from level 2 the earlier nests whose rows it reads or writes, or that
+    // read rows it writes
+    size_t count = live.size();
+    std::vector<uint32_t> waiting(count, 0);
+    std::vector<std::vector<size_t>> successors(count);
+    if (optimizationLevel_ >= 2) {
+        std::vector<RowAccesses> accesses;
+        for (const auto& kernel : live) {
+            accesses.push_back(getRowAccesses(kernel));
+        }
+        for (size_t later = 0; later < count; ++later) {
+            for (size_t earlier = 0; earlier < later; ++earlier) {
+                if (rangesOverlap(accesses[earlier].writes, accesses[later].reads) ||
+                    rangesOverlap(accesses[earlier].writes, accesses[later].writes) ||
+                    rangesOverlap(accesses[earlier].reads, accesses[later].writes)) {
+                    successors[earlier].push_back(later);
+                    waiting[later]++;
+                }
+            }
+        }
+    } else {
+        for (size_t n = 1; n < count; ++n) {
+            successors[n - 1].push_back(n);
+            waiting[n]++;
+        }
+    }
+    
+    // Run the ready nest that overwrites the fewest configurations next
+    // (program order on ties), on the cores that already hold its own
+    CoreConfiguration configuration(PIM_ISA::NUM_CORES, UNPROGRAMMED_CORE);
+    std::vector<int64_t> lastUse(PIM_ISA::NUM_CORES, -1);
+    std::vector<bool> done(count, false);
+    std::vector<IR::Kernel> ordered;
+    size_t reordered = 0;
+    size_t hoisted = 0;
+    
+    for (size_t step = 0; step < count; ++step) {
+        size_t best = count;
+        uint32_t bestReprograms = 0;
+        for (size_t n = 0; n < count && (best == count || bestReprograms > 0); ++n) {
+            if (done[n] || waiting[n] > 0) {
+                continue;
+            }
+            uint32_t reprograms = assignCores(live[n], configuration).reprograms;
+            if (best == count || reprograms < bestReprograms) {
+                best = n;
+                bestReprograms = reprograms;
+            }
+        }
+        
+        done[best] = true;
+        for (size_t successor : successors[best]) {
+            waiting[successor]--;
+        }
+        if (best != step) {
+            reordered++;
+        }
+        
+        IR::Kernel& kernel = live[best];
+        IR::renameCores(kernel, assignCores(kernel, configuration).cores);
+        
+        // Program each core right after its last use, so the PROG overlaps
+        // the nests in between
+        int64_t position = static_cast<int64_t>(ordered.size());
+        for (const auto& setup : kernel.cores) {
+            if (configuration[setup.core] != static_cast<int>(setup.opType)) {
+                configuration[setup.core] = static_cast<int>(setup.opType);
+                int64_t target = lastUse[setup.core] + 1;
+                if (target < position) {
+                    ordered[target].cores.push_back(setup);
+                    hoisted++;
+                }
+            }
+            lastUse[setup.core] = position;
+        }
+        ordered.push_back(std::move(kernel));
+    }
+    
+    kernels = std::move(ordered);
+    progCount_ = countProgs(kernels);
     
+    if (verbose_) {
+        std::cout << "Core configuration: " << progCount_ << " PROGs instead of " << progBaseline_ << " ("
+                 << (progBaseline_ - progCount_) * PIM_ISA::PROG_CYCLES << " cycles saved)";
+        if (reordered > 0 || hoisted > 0) {
+            std::cout << ", " << reordered << " loop nest(s) reordered, " << hoisted << " PROG(s) hoisted";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Apply loop unrolling to a loop nest
+void Optimizer::applyLoopUnrolling(IR::Kernel& kernel) {
     if (verbose_) {
         std::cout << "Applying loop unrolling optimization..." << std::endl;
     }
     
-    // For now, return the original instructions
-    // Loop unrolling is complex and would require pattern recognition in the instruction stream
-    return instructions;
+    // Unroll the accumulation loops; the expanded instruction stream is the
+    // same, but later loop passes see whole groups of iterations
+    size_t unrolled = IR::unrollInnermostLoops(kernel, LOOP_UNROLL_FACTOR);
+    
+    if (verbose_) {
+        std::cout << "  Unrolled " << unrolled << " loop(s) of " << kernel.name
+                 << " by " << LOOP_UNROLL_FACTOR << std::endl;
+    }
 }
 
-// Apply instruction reordering optimization
-std::vector<PIM_ISA::Instruction> Optimizer::applyInstructionReordering(
-    const std::vector<PIM_ISA::Instruction>& instructions) {
+namespace {
+
+/**
+ * @brief Chain of streaming passes that owns its stages
+ */
+class PassPipeline : public PIM_ISA::InstructionSink {
+public:
+    explicit PassPipeline(PIM_ISA::InstructionSink& output) : output_(output) {}
     
-    if (verbose_) {
-        std::cout << "Applying instruction reordering optimization..." << std::endl;
+    // First sink of the stream (the next pass created forwards to it)
+    PIM_ISA::InstructionSink& head() {
+        return stages_.empty() ? output_ : *stages_.back();
+    }
+    
+    // Add a pass in front of the current head of the pipeline
+    void prepend(std::unique_ptr<PIM_ISA::InstructionFilter> pass) {
+        stages_.push_back(std::move(pass));
+    }
+    
+    void emit(const PIM_ISA::Instruction& instruction) override {
+        head().emit(instruction);
     }
     
-    // Copy instructions for modification
-    std::vector<PIM_ISA::Instruction> reorderedInst = instructions;
+    bool finish() override {
+        return head().finish();
+    }
+    
+private:
+    PIM_ISA::InstructionSink& output_;
+    
+    // Passes in reverse stream order (the last one receives instructions first)
+    std::vector<std::unique_ptr<PIM_ISA::InstructionFilter>> stages_;
+};
+
+} // namespace
+
+// Optimize pPIM instructions
+PIM_ISA::PackedProgram Optimizer::optimizeInstructions(const PIM_ISA::PackedProgram& program) {
     
-    // In a real optimizer, we would analyze data dependencies and reorder
-    // instructions to minimize pipeline stalls and maximize parallelism
+    // If optimization level is 0, return the original program
+    if (optimizationLevel_ == 0) {
+        return program;
+    }
     
-    // For this simplified implementation, we'll just identify sequences of
-    // read instructions and group them together
+    if (verbose_) {
+        std::cout << "Original instruction count: " << program.size() << std::endl;
+    }
     
-    // This is a very basic reordering that doesn't take into account data dependencies
-    // A real implementation would need much more sophisticated analysis
+    PIM_ISA::PackedProgram optimized;
+    optimized.reserve(program.size());
+    PIM_ISA::PackedProgramSink output(optimized);
     
-    return reorderedInst;
+    auto pipeline = createInstructionPipeline(output);
+    program.replay(*pipeline);
+    pipeline->finish();
+    
+    if (verbose_) {
+        std::cout << "Optimized instruction count: " << optimized.size() << std::endl;
+        printStats();
+    }
+    
+    return optimized;
 }
 
-// Apply memory access optimization
-std::vector<PIM_ISA::Instruction> Optimizer::applyMemoryAccessOptimization(
-    const std::vector<PIM_ISA::Instruction>& instructions) {
+// Create the streaming instruction-level optimization pipeline
+std::unique_ptr<PIM_ISA::InstructionSink> Optimizer::createInstructionPipeline(
+    PIM_ISA::InstructionSink& output) {
+    
+    auto pipeline = std::make_unique<PassPipeline>(output);
+    stats_ = OptimizationStats();
+    
+    // If optimization level is 0, instructions go straight to the output
+    if (optimizationLevel_ == 0) {
+        return pipeline;
+    }
     
     if (verbose_) {
-        std::cout << "Applying memory access optimization..." << std::endl;
+        std::cout << "Optimizing pPIM instructions (level " << optimizationLevel_ << ")..." << std::endl;
+    }
+    
+    // Passes are created from the output backwards, so the stream runs
+    // reordering -> memory access -> scheduling
+    if (optimizationLevel_ >= 2) {
+        // Level 2: More advanced optimizations
+        pipeline->prepend(createInstructionSchedulingPass(pipeline->head()));
+        pipeline->prepend(createMemoryAccessPass(pipeline->head()));
+    }
+    
+    if (optimizationLevel_ >= 1) {
+        // Level 1: Basic optimizations
+        pipeline->prepend(createInstructionReorderingPass(pipeline->head()));
+    }
+    
+    return pipeline;
+}
+
+namespace {
+
+/**
+ * @brief Pass that reorders instructions by their dependency graph
+ *
+ * Collects blocks of up to REORDERING_BLOCK instructions (cut at barriers),
+ * builds their DependencyGraph and emits each block in a topological order
+ * that always picks the ready instruction with the longest remaining path,
+ * oldest first on ties. Instructions on the critical path move forward and
+ * independent work fills in behind them, which shortens in-order execution.
+ */
+class DependencyReorderFilter : public PIM_ISA::InstructionFilter {
+public:
+    DependencyReorderFilter(PIM_ISA::InstructionSink& next, OptimizationStats& stats)
+        : InstructionFilter(next), stats_(stats) {
+        block_.reserve(REORDERING_BLOCK);
+        builder_.reserve(REORDERING_BLOCK);
+    }
+    
+    void emit(const PIM_ISA::Instruction& instruction) override {
+        if (PIM_ISA::isBarrier(instruction)) {
+            flush();
+            next_.emit(instruction);
+            return;
+        }
+        block_.push_back(instruction);
+        builder_.add(instruction);
+        if (block_.size() >= REORDERING_BLOCK) {
+            flush();
+        }
+    }
+    
+    bool finish() override {
+        flush();
+        return next_.finish();
+    }
+    
+private:
+    // Emit the buffered block in dependency order
+    void flush() {
+        if (block_.empty()) {
+            return;
+        }
+        
+        DependencyGraph graph = builder_.build();
+        std::vector<uint64_t> height = graph.heights();
+        std::vector<uint32_t> waiting(block_.size());
+        
+        // Longest remaining path first, then program order
+        using ReadyEntry = std::pair<uint64_t, DependencyGraph::NodeId>;
+        auto later = [](const ReadyEntry& a, const ReadyEntry& b) {
+            return a.first != b.first ? a.first < b.first : a.second > b.second;
+        };
+        std::priority_queue<ReadyEntry, std::vector<ReadyEntry>, decltype(later)> ready(later);
+        
+        for (DependencyGraph::NodeId node = 0; node < block_.size(); ++node) {
+            waiting[node] = static_cast<uint32_t>(graph.predecessors(node).size());
+            if (waiting[node] == 0) {
+                ready.push({height[node], node});
+            }
+        }
+        
+        uint32_t position = 0;
+        while (!ready.empty()) {
+            DependencyGraph::NodeId node = ready.top().second;
+            ready.pop();
+            if (node != position++) {
+                stats_.reorderedInstructions++;
+            }
+            next_.emit(block_[node]);
+            for (uint32_t edge : graph.successors(node)) {
+                DependencyGraph::NodeId successor = DependencyGraph::edgeNode(edge);
+                if (--waiting[successor] == 0) {
+                    ready.push({height[successor], successor});
+                }
+            }
+        }
+        
+        block_.clear();
     }
     
-    // Copy instructions for modification
-    std::vector<PIM_ISA::Instruction> optimizedInst = instructions;
+    OptimizationStats& stats_;
+    std::vector<PIM_ISA::Instruction> block_;
+    DependencyGraphBuilder builder_;
+};
+
+} // namespace
+
+// Create the instruction reordering pass
+std::unique_ptr<PIM_ISA::InstructionFilter> Optimizer::createInstructionReorderingPass(
+    PIM_ISA::InstructionSink& next) {
     
-    // Optimize memory access patterns to maximize locality and reduce bank conflicts
-    // This would involve analyzing and possibly reordering memory operations
+    if (verbose_) {
+        std::cout << "Applying instruction reordering optimization..." << std::endl;
+    }
     
-    return optimizedInst;
+    // Move instructions on the longest dependency chains forward
+    return std::make_unique<DependencyReorderFilter>(next, stats_);
 }
 
-// Apply instruction scheduling optimization
-std::vector<PIM_ISA::Instruction> Optimizer::applyInstructionScheduling(
-    const std::vector<PIM_ISA::Instruction>& instructions) {
+namespace {
+
+/**
+ * @brief Pass that removes reads of a row already held by the read slot
+ *
+ * Models the operand buffer as the row each read slot holds (or none). A
+ * slot keeps its row until the next Read into it, so a Read of the row the
+ * slot already holds is dropped. The model is conservative:
+ * - a Write (or ReadWrite) to a row forgets every slot holding that row,
+ *   since the slot copy is stale once memory changes
+ * - a ReadWrite also forgets the slot named by its pointer
+ * - END forgets everything
+ * Compute EXEs and PROGs leave the slots unchanged.
+ */
+class RedundantReadFilter : public PIM_ISA::InstructionFilter {
+public:
+    RedundantReadFilter(PIM_ISA::InstructionSink& next, OptimizationStats& stats)
+        : InstructionFilter(next), stats_(stats) {
+        slotRows_.fill(EMPTY_SLOT);
+    }
+    
+    void emit(const PIM_ISA::Instruction& instruction) override {
+        if (instruction.type == PIM_ISA::InstructionType::EXE) {
+            if (instruction.read && !instruction.write) {
+                stats_.reads++;
+                int32_t& held = slotRows_[instruction.readPtr];
+                if (held == instruction.rowAddress) {
+                    stats_.eliminatedReads++;
+                    return;
+                }
+                held = instruction.rowAddress;
+            } else if (instruction.write) {
+                forgetRow(instruction.rowAddress);
+                if (instruction.read) {
+                    slotRows_[instruction.readPtr] = EMPTY_SLOT;
+                }
+            }
+        } else if (instruction.type == PIM_ISA::InstructionType::END) {
+            slotRows_.fill(EMPTY_SLOT);
+        }
+        next_.emit(instruction);
+    }
+    
+private:
+    static constexpr int32_t EMPTY_SLOT = -1;
+    
+    // Forget every slot holding a row
+    void forgetRow(uint16_t rowAddress) {
+        for (auto& held : slotRows_) {
+            if (held == rowAddress) {
+                held = EMPTY_SLOT;
+            }
+        }
+    }
+    
+    OptimizationStats& stats_;
+    
+    // Row held by each read slot (EMPTY_SLOT if unknown)
+    std::array<int32_t, PIM_ISA::NUM_READ_SLOTS> slotRows_;
+};
+
+} // namespace
+
+// Create the memory access optimization pass
+std::unique_ptr<PIM_ISA::InstructionFilter> Optimizer::createMemoryAccessPass(
+    PIM_ISA::InstructionSink& next) {
     
     if (verbose_) {
-        std::cout << "Applying instruction scheduling optimization..." << std::endl;
+        std::cout << "Applying memory access optimization..." << std::endl;
     }
     
-    // Copy instructions for modification
-    std::vector<PIM_ISA::Instruction> scheduledInst = instructions;
+    // Drop reads that reload the row a read slot already holds
+    return std::make_unique<RedundantReadFilter>(next, stats_);
+}
+
+// Create the instruction scheduling pass
+std::unique_ptr<PIM_ISA::InstructionFilter> Optimizer::createInstructionSchedulingPass(
+    PIM_ISA::InstructionSink& next) {
     
-    // Schedule instructions to maximize parallelism and minimize delays
-    // This requires understanding the microarchitecture details
+    if (verbose_) {
+        std::cout << "Applying instruction scheduling optimization..." << std::endl;
+    }
     
-    return scheduledInst;
+    // List-schedule the stream against the bank, slot and core model and
+    // mark the instructions that start together as bundles
+    return std::make_unique<ListScheduler>(next, SCHEDULING_WINDOW, stats_.schedule);
 }
 
-} // namespace Optimizer
+// Print what the instruction-level passes changed
+void Optimizer::printStats() const {
+    if (stats_.reorderedInstructions > 0) {
+        std::cout << "Reordered " << stats_.reorderedInstructions << " instructions by dependency height" << std::endl;
+    }
+    if (stats_.reads > 0) {
+        std::cout << "Eliminated " << stats_.eliminatedReads << " of " << stats_.reads
+                 << " EXE Read instructions (" << std::fixed << std::setprecision(1)
+                 << 100.0 * stats_.eliminatedReads / stats_.reads << "%)" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+    if (stats_.schedule.instructions > 0) {
+        std::cout << "Scheduled " << stats_.schedule.instructions << " instructions into "
+                 << stats_.schedule.bundles << " bundles (" << stats_.schedule.cycles << " cycles)" << std::endl;
+    }
+}
 
+} // namespace Optimizer
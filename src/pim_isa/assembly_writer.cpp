@@ -0,0 +1,253 @@
+#include "../../include/pim_isa/assembly_writer.h"
+#include <algorithm>
+#include <charconv>
+#include <thread>
+
+namespace PIM_ISA {
+
+namespace {
+
+// Assembly file header
+constexpr char ASSEMBLY_HEADER[] =
+    "// pPIM Assembly generated by pPIM Compiler\n"
+    "// Format: <Instruction> <Parameters>\n"
+    "\n";
+
+// Size at which the streaming writer hands its buffer to the stream
+constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+// Instructions formatted per chunk by writeAssembly
+constexpr size_t FORMAT_CHUNK_SIZE = 1 << 18;
+
+// Fixed line prefixes
+constexpr char READ_PREFIX[] = "EXE Read RowAddress";
+constexpr char WRITE_PREFIX[] = "EXE Write RowAddress";
+constexpr char READ_WRITE_PREFIX[] = "EXE ReadWrite RowAddress";
+constexpr char CORE_PREFIX[] = "EXE CorePtr";
+constexpr char ROW_ADDRESS_INFIX[] = " RowAddress";
+constexpr char PROG_PREFIX[] = "PROG Core";
+constexpr char BUNDLE_PREFIX[] = "// Bundle ";
+
+// Append a string literal without its terminator
+template <size_t N>
+void appendLiteral(std::string& buffer, const char (&text)[N]) {
+    buffer.append(text, N - 1);
+}
+
+// Append a decimal number
+void appendNumber(std::string& buffer, unsigned value) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+}
+
+// Name of a core operation as printed by Instruction::toString()
+const char* coreOpName(CoreOpType opType) {
+    switch (opType) {
+        case CoreOpType::MULTIPLIER:  return "MULTIPLIER";
+        case CoreOpType::ADDER:       return "ADDER";
+        case CoreOpType::MAC:         return "MAC";
+        case CoreOpType::SHIFTER:     return "SHIFTER";
+        case CoreOpType::LOGIC_AND:   return "LOGIC_AND";
+        case CoreOpType::LOGIC_OR:    return "LOGIC_OR";
+        case CoreOpType::LOGIC_XOR:   return "LOGIC_XOR";
+        case CoreOpType::COMPARATOR:  return "COMPARATOR";
+        case CoreOpType::CUSTOM:      return "CUSTOM";
+        case CoreOpType::SUBTRACTOR:  return "SUBTRACTOR";
+        default:                      return "UNKNOWN";
+    }
+}
+
+// Append an EXE line from its fields
+void appendExe(std::string& buffer, uint8_t ptr, bool read, bool write, uint16_t rowAddress) {
+    if (read && !write) {
+        appendLiteral(buffer, READ_PREFIX);
+    } else if (!read && write) {
+        appendLiteral(buffer, WRITE_PREFIX);
+    } else if (read && write) {
+        appendLiteral(buffer, READ_WRITE_PREFIX);
+    } else {
+        appendLiteral(buffer, CORE_PREFIX);
+        appendNumber(buffer, ptr);
+        appendLiteral(buffer, ROW_ADDRESS_INFIX);
+    }
+    appendNumber(buffer, rowAddress);
+    buffer.push_back('\n');
+}
+
+// Append a PROG line from its fields
+void appendProg(std::string& buffer, uint8_t corePtr, CoreOpType opType, const std::vector<uint8_t>& config) {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+    appendLiteral(buffer, PROG_PREFIX);
+    appendNumber(buffer, corePtr);
+    buffer.push_back(' ');
+    buffer.append(coreOpName(opType));
+
+    if (!config.empty()) {
+        buffer.append(" [");
+        for (size_t i = 0; i < config.size(); ++i) {
+            if (i > 0) buffer.append(", ");
+            char hex[4] = {'0', 'x', HEX_DIGITS[config[i] >> 4], HEX_DIGITS[config[i] & 0xF]};
+            buffer.append(hex, sizeof(hex));
+        }
+        buffer.push_back(']');
+    }
+    buffer.push_back('\n');
+}
+
+// Format a range of packed words, numbering bundles from firstBundle
+void formatRange(std::string& buffer, const PackedProgram& program, size_t begin, size_t end, uint64_t firstBundle) {
+    const auto& words = program.words();
+    const auto& configs = program.configs();
+    uint64_t bundle = firstBundle;
+    for (size_t i = begin; i < end; ++i) {
+        if (packedBundleStart(words[i])) {
+            AssemblyFormatter::appendBundleMarker(buffer, bundle++);
+        }
+        AssemblyFormatter::appendLine(buffer, words[i], configs);
+    }
+}
+
+// Count the bundles starting in a range of packed words
+uint64_t countBundles(const PackedProgram& program, size_t begin, size_t end) {
+    const auto& words = program.words();
+    return static_cast<uint64_t>(std::count_if(words.begin() + begin, words.begin() + end, packedBundleStart));
+}
+
+} // namespace
+
+// Append one instruction as a line of assembly
+void AssemblyFormatter::appendLine(std::string& buffer, const Instruction& instruction) {
+    switch (instruction.type) {
+        case InstructionType::PROG:
+            appendProg(buffer, instruction.corePtr, instruction.coreOpType, instruction.lutConfig);
+            break;
+        case InstructionType::EXE:
+            appendExe(buffer, instruction.readPtr, instruction.read, instruction.write, instruction.rowAddress);
+            break;
+        case InstructionType::END:
+            buffer.append("END\n");
+            break;
+        default:
+            buffer.append("UNKNOWN\n");
+            break;
+    }
+}
+
+// Append one packed instruction word as a line of assembly
+void AssemblyFormatter::appendLine(std::string& buffer, uint32_t word, const std::vector<LutConfig>& configs) {
+    switch (packedType(word)) {
+        case InstructionType::PROG: {
+            const LutConfig& lut = configs[packedConfigIndex(word)];
+            appendProg(buffer, packedPointer(word), lut.opType, lut.data);
+            break;
+        }
+        case InstructionType::EXE:
+            appendExe(buffer, packedPointer(word), packedRead(word), packedWrite(word), packedRowAddress(word));
+            break;
+        case InstructionType::END:
+            buffer.append("END\n");
+            break;
+        default:
+            buffer.append("UNKNOWN\n");
+            break;
+    }
+}
+
+// Append the comment line that opens a bundle
+void AssemblyFormatter::appendBundleMarker(std::string& buffer, uint64_t bundle) {
+    appendLiteral(buffer, BUNDLE_PREFIX);
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), bundle);
+    buffer.append(digits, result.ptr);
+    buffer.push_back('\n');
+}
+
+// Constructor
+AssemblyWriterSink::AssemblyWriterSink(std::ostream& out) : out_(out) {
+    buffer_.reserve(WRITE_BUFFER_SIZE + 4096);
+    appendLiteral(buffer_, ASSEMBLY_HEADER);
+}
+
+// Format one instruction into the buffer
+void AssemblyWriterSink::emit(const Instruction& instruction) {
+    if (instruction.bundleStart) {
+        AssemblyFormatter::appendBundleMarker(buffer_, bundles_++);
+    }
+    AssemblyFormatter::appendLine(buffer_, instruction);
+    if (buffer_.size() >= WRITE_BUFFER_SIZE) {
+        flushBuffer();
+    }
+}
+
+// Write out the buffer and flush the stream
+bool AssemblyWriterSink::finish() {
+    flushBuffer();
+    out_.flush();
+    return static_cast<bool>(out_);
+}
+
+// Hand the buffered text to the stream
+void AssemblyWriterSink::flushBuffer() {
+    out_.write(buffer_.data(), buffer_.size());
+    bytesWritten_ += buffer_.size();
+    buffer_.clear();
+}
+
+// Write a packed program as pPIM assembly text
+bool writeAssembly(const PackedProgram& program, std::ostream& out, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    writeAssemblyHeader(out);
+
+    size_t total = program.size();
+    size_t chunkCount = (total + FORMAT_CHUNK_SIZE - 1) / FORMAT_CHUNK_SIZE;
+    std::vector<std::string> buffers(std::min<size_t>(threads, std::max<size_t>(chunkCount, 1)));
+    std::vector<uint64_t> firstBundles(buffers.size());
+    uint64_t bundles = 0;
+
+    // Format up to one chunk per thread, then write them in program order
+    for (size_t firstChunk = 0; firstChunk < chunkCount; firstChunk += buffers.size()) {
+        size_t round = std::min(buffers.size(), chunkCount - firstChunk);
+        
+        // Bundle numbers continue across chunks
+        for (size_t slot = 0; slot < round; ++slot) {
+            size_t begin = (firstChunk + slot) * FORMAT_CHUNK_SIZE;
+            firstBundles[slot] = bundles;
+            bundles += countBundles(program, begin, std::min(begin + FORMAT_CHUNK_SIZE, total));
+        }
+
+        auto formatChunk = [&](size_t slot) {
+            size_t begin = (firstChunk + slot) * FORMAT_CHUNK_SIZE;
+            size_t end = std::min(begin + FORMAT_CHUNK_SIZE, total);
+            buffers[slot].clear();
+            formatRange(buffers[slot], program, begin, end, firstBundles[slot]);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t slot = 1; slot < round; ++slot) {
+            workers.emplace_back(formatChunk, slot);
+        }
+        formatChunk(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        for (size_t slot = 0; slot < round; ++slot) {
+            out.write(buffers[slot].data(), buffers[slot].size());
+        }
+    }
+
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+// Write the standard assembly file header
+void writeAssemblyHeader(std::ostream& out) {
+    out.write(ASSEMBLY_HEADER, sizeof(ASSEMBLY_HEADER) - 1);
+}
+
+} // namespace PIM_ISA
@@ -0,0 +1,210 @@
+#include "../../include/pim_isa/instruction_sink.h"
+#include "../../include/pim_isa/packed_program.h"
+#include "../../include/pim_isa/resources.h"
+#include <algorithm>
+
+namespace PIM_ISA {
+
+namespace {
+
+// Add one instruction to a set of counts
+void countInstruction(InstructionCounts& counts, const Instruction& instruction) {
+    switch (instruction.type) {
+        case InstructionType::PROG:
+            counts.prog++;
+            break;
+        case InstructionType::EXE:
+            if (instruction.read) {
+                counts.read++;
+            } else if (instruction.write) {
+                counts.write++;
+            } else {
+                counts.compute++;
+            }
+            break;
+        case InstructionType::END:
+            counts.end++;
+            break;
+    }
+}
+
+} // namespace
+
+// Emit a block of instructions one at a time
+void InstructionSink::emitBlock(const PackedProgram& block) {
+    block.replay(*this);
+}
+
+// Forward an instruction to both sinks
+void TeeSink::emit(const Instruction& instruction) {
+    first_.emit(instruction);
+    second_.emit(instruction);
+}
+
+// Finish both sinks
+bool TeeSink::finish() {
+    bool firstOk = first_.finish();
+    bool secondOk = second_.finish();
+    return firstOk && secondOk;
+}
+
+// Count an instruction
+void CountingSink::emit(const Instruction& instruction) {
+    countInstruction(counts_, instruction);
+}
+
+// Accumulate the cycle cost of an instruction
+void SimulationSink::emit(const Instruction& instruction) {
+    countInstruction(counts_, instruction);
+
+    switch (instruction.type) {
+        case InstructionType::PROG:
+            totalCycles_ += PROG_CYCLES;
+            break;
+        case InstructionType::EXE:
+            if (instruction.read) {
+                totalCycles_ += READ_CYCLES;
+            } else if (instruction.write) {
+                totalCycles_ += WRITE_CYCLES;
+            } else {
+                totalCycles_ += COMPUTE_CYCLES;
+            }
+            break;
+        case InstructionType::END:
+            totalCycles_ += END_CYCLES;
+            break;
+    }
+}
+
+// Create a model with every core, bank and slot idle
+ParallelSimulationSink::ParallelSimulationSink()
+    : coreFree_(NUM_CORES, 0), bankFree_(NUM_BANKS, 0), slotReady_(NUM_READ_SLOTS, 0),
+      slotLastUse_(NUM_READ_SLOTS, 0), coreComputed_(NUM_CORES, false), depSlots_(NUM_READ_SLOTS),
+      depCores_(NUM_CORES), depRows_(NUM_ROWS) {
+}
+
+// Start an instruction once it is ready, but not before the previous one
+uint64_t ParallelSimulationSink::dispatch(uint64_t ready, uint32_t latency) {
+    uint64_t start = std::max(ready, lastStart_);
+    lastStart_ = start;
+    totalCycles_ = std::max(totalCycles_, start + latency);
+    sequentialCycles_ += latency;
+    return start;
+}
+
+// Extend the critical path with an instruction, using the dependency rules of resources.h
+void ParallelSimulationSink::trackDependencies(const Instruction& instruction) {
+    uint32_t latency = instructionLatency(instruction);
+    if (isBarrier(instruction)) {
+        depFloor_ = std::max(depFloor_, criticalPath_) + latency;
+        criticalPath_ = depFloor_;
+        return;
+    }
+
+    ResourceAccess accesses[MAX_RESOURCE_ACCESSES];
+    size_t count = resourceAccesses(instruction, accesses);
+    DependencyTimes* times[MAX_RESOURCE_ACCESSES];
+    uint64_t start = depFloor_;
+    for (size_t a = 0; a < count; ++a) {
+        switch (accesses[a].resource) {
+            case Resource::SLOT:
+                times[a] = &depSlots_[accesses[a].index];
+                break;
+            case Resource::CORE:
+                times[a] = &depCores_[accesses[a].index];
+                break;
+            case Resource::ROW:
+                times[a] = &depRows_[accesses[a].index];
+                break;
+        }
+        start = std::max(start, times[a]->written);
+        if (accesses[a].write) {
+            start = std::max(start, times[a]->released);
+        }
+    }
+
+    // Writers wait for a memory read to finish but may start with a compute that reads (as WAR edges do)
+    uint64_t finish = start + latency;
+    bool memoryRead = instruction.type == InstructionType::EXE && instruction.read;
+    uint64_t release = memoryRead ? finish : start;
+    for (size_t a = 0; a < count; ++a) {
+        if (accesses[a].write) {
+            times[a]->written = finish;
+            times[a]->released = finish;
+        } else {
+            times[a]->released = std::max(times[a]->released, release);
+        }
+    }
+    criticalPath_ = std::max(criticalPath_, finish);
+}
+
+// Schedule an instruction on the cores and banks it uses
+void ParallelSimulationSink::emit(const Instruction& instruction) {
+    if (instruction.bundleStart) {
+        bundles_++;
+    }
+    trackDependencies(instruction);
+
+    switch (instruction.type) {
+        case InstructionType::PROG: {
+            uint8_t core = instruction.corePtr;
+            uint64_t start = dispatch(coreFree_[core], PROG_CYCLES);
+            coreFree_[core] = start + PROG_CYCLES;
+            break;
+        }
+        case InstructionType::EXE: {
+            uint8_t bank = bankOfRow(instruction.rowAddress);
+            if (instruction.read) {
+                uint8_t slot = instruction.readPtr;
+                uint64_t start = dispatch(std::max(bankFree_[bank], slotLastUse_[slot]), READ_CYCLES);
+                bankFree_[bank] = start + READ_CYCLES;
+                slotReady_[slot] = start + READ_CYCLES;
+            } else if (instruction.write) {
+                uint8_t core = instruction.corePtr;
+                uint64_t start = dispatch(std::max(bankFree_[bank], coreFree_[core]), WRITE_CYCLES);
+                bankFree_[bank] = start + WRITE_CYCLES;
+                coreFree_[core] = start + WRITE_CYCLES;
+            } else {
+                uint8_t core = instruction.corePtr;
+                uint8_t slotA = operandSlotA(instruction.rowAddress);
+                uint8_t slotB = operandSlotB(instruction.rowAddress);
+                uint64_t ready = std::max({coreFree_[core], slotReady_[slotA], slotReady_[slotB]});
+                uint64_t start = dispatch(ready, COMPUTE_CYCLES);
+                coreFree_[core] = start + COMPUTE_CYCLES;
+                slotLastUse_[slotA] = std::max(slotLastUse_[slotA], start);
+                slotLastUse_[slotB] = std::max(slotLastUse_[slotB], start);
+                computeCycles_ += COMPUTE_CYCLES;
+                coreComputed_[core] = true;
+            }
+            break;
+        }
+        case InstructionType::END:
+            dispatch(totalCycles_, END_CYCLES);
+            break;
+    }
+}
+
+// Count the cores that executed a compute EXE
+uint32_t ParallelSimulationSink::computeCoresUsed() const {
+    return static_cast<uint32_t>(std::count(coreComputed_.begin(), coreComputed_.end(), true));
+}
+
+// Write one instruction as a little-endian 32-bit word
+void BinaryEncoderSink::emit(const Instruction& instruction) {
+    uint32_t word = instruction.toBinary();
+    char bytes[4] = {
+        static_cast<char>(word & 0xFF),
+        static_cast<char>((word >> 8) & 0xFF),
+        static_cast<char>((word >> 16) & 0xFF),
+        static_cast<char>((word >> 24) & 0xFF)
+    };
+    out_.write(bytes, sizeof(bytes));
+}
+
+// Flush the output stream
+bool BinaryEncoderSink::finish() {
+    out_.flush();
+    return static_cast<bool>(out_);
+}
+
+} // namespace PIM_ISA
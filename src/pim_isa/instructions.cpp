@@ -41,6 +41,7 @@ std::string Instruction::toString() const {
                 case CoreOpType::LOGIC_XOR:   ss << "LOGIC_XOR"; break;
                 case CoreOpType::COMPARATOR:  ss << "COMPARATOR"; break;
                 case CoreOpType::CUSTOM:      ss << "CUSTOM"; break;
+                case CoreOpType::SUBTRACTOR:  ss << "SUBTRACTOR"; break;
                 default:                      ss << "UNKNOWN"; break;
             }
             
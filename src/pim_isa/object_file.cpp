@@ -0,0 +1,285 @@
+#include "../../include/pim_isa/object_file.h"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace PIM_ISA {
+
+namespace {
+
+// Little-endian field encoding
+void putU8(std::string& buffer, uint8_t value) {
+    buffer.push_back(static_cast<char>(value));
+}
+
+void putU16(std::string& buffer, uint16_t value) {
+    for (int i = 0; i < 2; ++i) buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+void putU32(std::string& buffer, uint32_t value) {
+    for (int i = 0; i < 4; ++i) buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+void putU64(std::string& buffer, uint64_t value) {
+    for (int i = 0; i < 8; ++i) buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+// Little-endian field decoding
+uint16_t getU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t getU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t getU64(const uint8_t* p) {
+    return static_cast<uint64_t>(getU32(p)) | (static_cast<uint64_t>(getU32(p + 4)) << 32);
+}
+
+// Serialize a header
+std::string encodeHeader(const ObjectHeader& header) {
+    std::string buffer(header.magic, sizeof(header.magic));
+    putU32(buffer, header.version);
+    putU32(buffer, header.headerSize);
+    putU32(buffer, header.matrixCount);
+    putU32(buffer, header.configCount);
+    putU64(buffer, header.instructionCount);
+    putU64(buffer, header.instructionOffset);
+    putU64(buffer, header.configTableOffset);
+    putU64(buffer, header.matrixTableOffset);
+    putU32(buffer, header.flags);
+    putU32(buffer, header.reserved);
+    return buffer;
+}
+
+// Whether packed words can be used in place on this host
+bool hostIsLittleEndian() {
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+} // namespace
+
+// Constructor
+ObjectWriterSink::ObjectWriterSink(std::ostream& out) : out_(out) {
+    // Reserve the header and pad to the page-aligned instruction section
+    std::string padding(OBJECT_SECTION_ALIGNMENT, '\0');
+    out_.write(padding.data(), padding.size());
+}
+
+// Append one packed instruction word
+void ObjectWriterSink::emit(const Instruction& instruction) {
+    uint32_t word = instruction.toBinary() & PACKED_INSTRUCTION_MASK;
+    if (instruction.type == InstructionType::PROG) {
+        word |= configPool_.internConfig(instruction.coreOpType, instruction.lutConfig) << PACKED_CONFIG_SHIFT;
+    }
+    if (instruction.bundleStart) {
+        word |= PACKED_BUNDLE_START;
+    }
+
+    char bytes[4] = {
+        static_cast<char>(word & 0xFF),
+        static_cast<char>((word >> 8) & 0xFF),
+        static_cast<char>((word >> 16) & 0xFF),
+        static_cast<char>((word >> 24) & 0xFF)
+    };
+    out_.write(bytes, sizeof(bytes));
+    instructionCount_++;
+}
+
+// Write the tables and patch the header
+bool ObjectWriterSink::finish() {
+    ObjectHeader header{};
+    std::memcpy(header.magic, OBJECT_MAGIC, sizeof(header.magic));
+    header.version = OBJECT_VERSION;
+    header.headerSize = sizeof(ObjectHeader);
+    header.matrixCount = static_cast<uint32_t>(matrices_.size());
+    header.configCount = static_cast<uint32_t>(configPool_.configs().size());
+    header.instructionCount = instructionCount_;
+    header.instructionOffset = OBJECT_SECTION_ALIGNMENT;
+    header.configTableOffset = header.instructionOffset + instructionCount_ * sizeof(uint32_t);
+
+    // LUT configuration table
+    std::string tables;
+    for (const auto& lut : configPool_.configs()) {
+        putU8(tables, static_cast<uint8_t>(lut.opType));
+        putU8(tables, 0);
+        putU16(tables, static_cast<uint16_t>(lut.data.size()));
+        tables.append(lut.data.begin(), lut.data.end());
+    }
+
+    // Matrix table
+    header.matrixTableOffset = header.configTableOffset + tables.size();
+    for (const auto& matrix : matrices_) {
+        putU32(tables, matrix.rows);
+        putU32(tables, matrix.cols);
+        putU16(tables, matrix.startAddress);
+        putU16(tables, matrix.endAddress);
+        putU16(tables, static_cast<uint16_t>(matrix.name.size()));
+        tables.append(matrix.name);
+    }
+
+    out_.write(tables.data(), tables.size());
+
+    // Patch the header now that all counts and offsets are known
+    std::string encoded = encodeHeader(header);
+    out_.seekp(0);
+    out_.write(encoded.data(), encoded.size());
+    out_.seekp(0, std::ios::end);
+    out_.flush();
+
+    return static_cast<bool>(out_);
+}
+
+// Write a packed program as a .pbin file
+bool writeObjectFile(const PackedProgram& program, const std::vector<ObjectMatrix>& matrices, std::ostream& out) {
+    ObjectWriterSink writer(out);
+    writer.setMatrixTable(matrices);
+    program.replay(writer);
+    return writer.finish();
+}
+
+// Map and validate a .pbin file
+ObjectFile::ObjectFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open object file " + path);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ObjectHeader))) {
+        ::close(fd);
+        throw std::runtime_error("Object file " + path + " is truncated");
+    }
+
+    size_ = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map object file " + path);
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+
+    try {
+        if (std::memcmp(data_, OBJECT_MAGIC, sizeof(OBJECT_MAGIC)) != 0) {
+            throw std::runtime_error("Not a pPIM object file: " + path);
+        }
+
+        std::memcpy(header_.magic, data_, sizeof(header_.magic));
+        header_.version = getU32(data_ + 8);
+        header_.headerSize = getU32(data_ + 12);
+        header_.matrixCount = getU32(data_ + 16);
+        header_.configCount = getU32(data_ + 20);
+        header_.instructionCount = getU64(data_ + 24);
+        header_.instructionOffset = getU64(data_ + 32);
+        header_.configTableOffset = getU64(data_ + 40);
+        header_.matrixTableOffset = getU64(data_ + 48);
+        header_.flags = getU32(data_ + 56);
+        header_.reserved = getU32(data_ + 60);
+
+        if (header_.version != OBJECT_VERSION) {
+            throw std::runtime_error("Unsupported object file version " + std::to_string(header_.version));
+        }
+
+        if (header_.instructionOffset % sizeof(uint32_t) != 0 ||
+            header_.instructionOffset > size_ ||
+            header_.instructionCount > (size_ - header_.instructionOffset) / sizeof(uint32_t)) {
+            throw std::runtime_error("Object file instruction section is out of bounds");
+        }
+
+        if (!hostIsLittleEndian()) {
+            throw std::runtime_error("Object files can only be mapped on little-endian hosts");
+        }
+
+        words_ = reinterpret_cast<const uint32_t*>(data_ + header_.instructionOffset);
+        parseTables();
+    } catch (...) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+        throw;
+    }
+}
+
+// Destructor
+ObjectFile::~ObjectFile() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+// Decode the LUT configuration and matrix tables
+void ObjectFile::parseTables() {
+    auto require = [this](uint64_t offset, uint64_t length) {
+        if (offset > size_ || length > size_ - offset) {
+            throw std::runtime_error("Object file table is out of bounds");
+        }
+    };
+
+    uint64_t offset = header_.configTableOffset;
+    for (uint32_t i = 0; i < header_.configCount; ++i) {
+        require(offset, 4);
+        CoreOpType opType = static_cast<CoreOpType>(data_[offset]);
+        uint16_t length = getU16(data_ + offset + 2);
+        offset += 4;
+
+        require(offset, length);
+        configs_.emplace_back(opType, std::vector<uint8_t>(data_ + offset, data_ + offset + length));
+        offset += length;
+    }
+
+    offset = header_.matrixTableOffset;
+    for (uint32_t i = 0; i < header_.matrixCount; ++i) {
+        require(offset, 14);
+        ObjectMatrix matrix;
+        matrix.rows = getU32(data_ + offset);
+        matrix.cols = getU32(data_ + offset + 4);
+        matrix.startAddress = getU16(data_ + offset + 8);
+        matrix.endAddress = getU16(data_ + offset + 10);
+        uint16_t nameLength = getU16(data_ + offset + 12);
+        offset += 14;
+
+        require(offset, nameLength);
+        matrix.name.assign(reinterpret_cast<const char*>(data_ + offset), nameLength);
+        offset += nameLength;
+
+        matrices_.push_back(matrix);
+    }
+}
+
+// Decode an instruction
+Instruction ObjectFile::instruction(uint64_t index) const {
+    uint32_t word = words_[index];
+    InstructionType type = packedType(word);
+
+    if (type == InstructionType::PROG) {
+        uint32_t configIndex = packedConfigIndex(word);
+        if (configIndex >= configs_.size()) {
+            throw std::runtime_error("PROG instruction refers to missing LUT configuration " +
+                                     std::to_string(configIndex));
+        }
+        const LutConfig& lut = configs_[configIndex];
+        Instruction instruction(packedPointer(word), lut.opType, lut.data);
+        instruction.rowAddress = packedRowAddress(word);
+        instruction.bundleStart = packedBundleStart(word);
+        return instruction;
+    }
+
+    Instruction instruction(type, packedPointer(word), packedRead(word), packedWrite(word), packedRowAddress(word));
+    instruction.bundleStart = packedBundleStart(word);
+    return instruction;
+}
+
+// Stream every instruction into a sink
+void ObjectFile::replay(InstructionSink& sink) const {
+    for (uint64_t i = 0; i < header_.instructionCount; ++i) {
+        sink.emit(instruction(i));
+    }
+}
+
+} // namespace PIM_ISA
@@ -0,0 +1,115 @@
+#include "../../include/pim_isa/packed_program.h"
+#include <stdexcept>
+
+namespace PIM_ISA {
+
+// Append an instruction
+void PackedProgram::append(const Instruction& instruction) {
+    uint32_t word = instruction.toBinary() & PACKED_INSTRUCTION_MASK;
+
+    if (instruction.type == InstructionType::PROG) {
+        uint32_t index = internConfig(instruction.coreOpType, instruction.lutConfig);
+        word |= index << PACKED_CONFIG_SHIFT;
+    }
+    if (instruction.bundleStart) {
+        word |= PACKED_BUNDLE_START;
+    }
+
+    words_.push_back(word);
+}
+
+// Append every instruction of another program
+void PackedProgram::appendProgram(const PackedProgram& other) {
+    if (other.configs_.empty()) {
+        words_.insert(words_.end(), other.words_.begin(), other.words_.end());
+        return;
+    }
+
+    // Translate the other program's config indices into this table
+    std::vector<uint32_t> remap;
+    remap.reserve(other.configs_.size());
+    for (const auto& lut : other.configs_) {
+        remap.push_back(internConfig(lut.opType, lut.data));
+    }
+
+    words_.reserve(words_.size() + other.words_.size());
+    for (uint32_t word : other.words_) {
+        if (packedType(word) == InstructionType::PROG) {
+            uint32_t index = remap[packedConfigIndex(word)];
+            word = (word & (PACKED_INSTRUCTION_MASK | PACKED_BUNDLE_START)) | (index << PACKED_CONFIG_SHIFT);
+        }
+        words_.push_back(word);
+    }
+}
+
+// Intern a LUT configuration in the config table
+uint32_t PackedProgram::internConfig(CoreOpType opType, const std::vector<uint8_t>& data) {
+    auto key = std::make_pair(static_cast<uint8_t>(opType), data);
+    auto it = configIndex_.find(key);
+    if (it != configIndex_.end()) {
+        return it->second;
+    }
+
+    if (configs_.size() >= MAX_PACKED_CONFIGS) {
+        throw std::length_error("Too many distinct LUT configurations in program");
+    }
+
+    uint32_t index = static_cast<uint32_t>(configs_.size());
+    configs_.emplace_back(opType, data);
+    configIndex_.emplace(std::move(key), index);
+    return index;
+}
+
+// Decode an instruction
+Instruction PackedProgram::instruction(size_t index) const {
+    uint32_t word = words_[index];
+    InstructionType type = packedType(word);
+
+    if (type == InstructionType::PROG) {
+        const LutConfig& lut = configs_[packedConfigIndex(word)];
+        Instruction instruction(packedPointer(word), lut.opType, lut.data);
+        instruction.rowAddress = packedRowAddress(word);
+        instruction.bundleStart = packedBundleStart(word);
+        return instruction;
+    }
+
+    Instruction instruction(type, packedPointer(word), packedRead(word), packedWrite(word), packedRowAddress(word));
+    instruction.bundleStart = packedBundleStart(word);
+    return instruction;
+}
+
+// Stream every instruction into a sink
+void PackedProgram::replay(InstructionSink& sink) const {
+    for (size_t i = 0; i < words_.size(); ++i) {
+        sink.emit(instruction(i));
+    }
+}
+
+// Decode the whole program
+std::vector<Instruction> PackedProgram::toInstructions() const {
+    std::vector<Instruction> instructions;
+    instructions.reserve(words_.size());
+    for (size_t i = 0; i < words_.size(); ++i) {
+        instructions.push_back(instruction(i));
+    }
+    return instructions;
+}
+
+// Approximate heap memory used by the program in bytes
+size_t PackedProgram::memoryUsage() const {
+    size_t bytes = words_.capacity() * sizeof(uint32_t);
+    for (const auto& lut : configs_) {
+        // Table entry plus its copy in the lookup key
+        bytes += sizeof(LutConfig) + 2 * lut.data.capacity();
+    }
+    return bytes;
+}
+
+// Remove all instructions and configurations
+void PackedProgram::clear() {
+    words_.clear();
+    configs_.clear();
+    configIndex_.clear();
+}
+
+} // namespace PIM_ISA
@@ -0,0 +1,57 @@
+#include "../../include/pim_isa/resources.h"
+
+namespace PIM_ISA {
+
+// List the slots, cores and rows an instruction uses
+size_t resourceAccesses(const Instruction& instruction, ResourceAccess* accesses) {
+    switch (instruction.type) {
+        case InstructionType::PROG:
+            accesses[0] = {Resource::CORE, instruction.corePtr, false, true};
+            return 1;
+        case InstructionType::EXE:
+            if (instruction.read && instruction.write) {
+                return 0;
+            }
+            if (instruction.read) {
+                accesses[0] = {Resource::ROW, instruction.rowAddress, true, false};
+                accesses[1] = {Resource::SLOT, instruction.readPtr, false, true};
+                return 2;
+            }
+            if (instruction.write) {
+                accesses[0] = {Resource::CORE, instruction.corePtr, true, true};
+                accesses[1] = {Resource::ROW, instruction.rowAddress, false, true};
+                return 2;
+            }
+            accesses[0] = {Resource::SLOT, operandSlotA(instruction.rowAddress), true, false};
+            accesses[1] = {Resource::SLOT, operandSlotB(instruction.rowAddress), true, false};
+            accesses[2] = {Resource::CORE, instruction.corePtr, true, true};
+            return 3;
+        case InstructionType::END:
+            return 0;
+    }
+    return 0;
+}
+
+// Whether an instruction waits for everything before it
+bool isBarrier(const Instruction& instruction) {
+    return instruction.type == InstructionType::END ||
+           (instruction.type == InstructionType::EXE && instruction.read && instruction.write);
+}
+
+// Cycles an instruction occupies its core or bank
+uint32_t instructionLatency(const Instruction& instruction) {
+    switch (instruction.type) {
+        case InstructionType::PROG:
+            return PROG_CYCLES;
+        case InstructionType::EXE:
+            if (instruction.read) {
+                return READ_CYCLES;
+            }
+            return instruction.write ? WRITE_CYCLES : COMPUTE_CYCLES;
+        case InstructionType::END:
+            return END_CYCLES;
+    }
+    return 1;
+}
+
+} // namespace PIM_ISA
@@ -0,0 +1,536 @@
+#include "../../include/server/compile_server.h"
+#include "../../include/compiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Server {
+
+namespace {
+
+// Time allowed to the client for sending its request line (listening thread)
+constexpr std::chrono::seconds REQUEST_LINE_TIMEOUT(5);
+
+// Time allowed to a stats client for reading the reply (listening thread)
+constexpr int STATS_TIMEOUT_SECONDS = 1;
+
+// Time allowed to the client for sending its source and reading the reply (workers)
+constexpr int TRANSFER_TIMEOUT_SECONDS = 30;
+
+// Interval at which the listening thread checks for stop requests
+constexpr int POLL_INTERVAL_MS = 200;
+
+// Output buffered per data frame
+constexpr size_t FRAME_BYTES = 64 * 1024;
+
+// Set by SIGINT and SIGTERM while run() is serving
+volatile std::sig_atomic_t signalled = 0;
+
+void onSignal(int) {
+    signalled = 1;
+}
+
+// Apply receive and send timeouts to a connection
+void setTimeouts(int fd, int seconds) {
+    timeval timeout{};
+    timeout.tv_sec = seconds;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+// Send a whole buffer; false if the client is gone or too slow
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Switch a connection between non-blocking (request line) and blocking (reply) mode
+void setNonBlocking(int fd, bool nonBlocking) {
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags >= 0) {
+        ::fcntl(fd, F_SETFL, nonBlocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+    }
+}
+
+// Receive until data holds size bytes
+bool readExact(int fd, std::string& data, uint64_t size) {
+    char chunk[64 * 1024];
+    while (data.size() < size) {
+        size_t wanted = static_cast<size_t>(std::min<uint64_t>(sizeof(chunk), size - data.size()));
+        ssize_t received = ::recv(fd, chunk, wanted, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data.append(chunk, static_cast<size_t>(received));
+    }
+    return true;
+}
+
+// Send the final line of a reply
+bool sendTrailer(int fd, bool ok, std::string message = "") {
+    std::replace(message.begin(), message.end(), '\n', ' ');
+    std::string trailer = ok ? "ok\n" : "error " + message + "\n";
+    return sendAll(fd, trailer.data(), trailer.size());
+}
+
+// Send a whole reply of one data frame
+bool sendReply(int fd, const std::string& data) {
+    std::string frame = "data " + std::to_string(data.size()) + "\n" + data;
+    return sendAll(fd, frame.data(), frame.size()) && sendTrailer(fd, true);
+}
+
+/**
+ * @brief Stream buffer sending its contents to a connection as data frames
+ */
+class FrameBuffer : public std::streambuf {
+public:
+    explicit FrameBuffer(int fd) : fd_(fd), buffer_(FRAME_BYTES) {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    // Whether a frame could not be sent
+    bool failed() const { return failed_; }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!flushFrame()) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        return flushFrame() ? 0 : -1;
+    }
+
+private:
+    int fd_;
+    std::vector<char> buffer_;
+    bool failed_{false};
+
+    // Send the buffered bytes as one frame
+    bool flushFrame() {
+        size_t size = static_cast<size_t>(pptr() - pbase());
+        if (size > 0 && !failed_) {
+            std::string header = "data " + std::to_string(size) + "\n";
+            failed_ = !sendAll(fd_, header.data(), header.size()) || !sendAll(fd_, pbase(), size);
+        }
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+        return !failed_;
+    }
+};
+
+// Apply the options of a compile request; false with a reason for an invalid option
+bool configure(PIMCompiler& compiler, const std::string& options, std::string& sourceName, std::string& error) {
+    std::istringstream tokens(options);
+    std::string option;
+    unsigned value = 0;
+    unsigned rows = 0;
+    unsigned cols = 0;
+    while (tokens >> option) {
+        const char* text = option.c_str();
+        bool valid = true;
+        if (option.compare(0, 2, "-O") == 0) {
+            valid = std::sscanf(text + 2, "%u", &value) == 1 && value <= 3;
+            compiler.setOptimizationLevel(static_cast<int>(value));
+        } else if (option == "-fbinary") {
+            compiler.setOutputFormat(PIMCompiler::OutputFormat::BINARY);
+        } else if (option == "-fbounded-memory") {
+            compiler.setBoundedMemory(true);
+        } else if (option.compare(0, 7, "-ftile=") == 0) {
+            valid = std::sscanf(text + 7, "%ux%u", &rows, &cols) == 2 && compiler.setTileSize(rows, cols);
+        } else if (option == "-fno-fusion") {
+            compiler.setFusion(false);
+        } else if (option.compare(0, 11, "-fstrassen=") == 0) {
+            valid = std::sscanf(text + 11, "%u", &value) == 1 && value >= 2;
+            compiler.setStrassenThreshold(value);
+        } else if (option.compare(0, 12, "-fprecision=") == 0) {
+            valid = std::sscanf(text + 12, "%u", &value) == 1 && compiler.setPrecision(value);
+        } else if (option.compare(0, 9, "--source=") == 0) {
+            sourceName = option.substr(9);
+            valid = !sourceName.empty();
+        } else {
+            error = "Unknown option " + option;
+            return false;
+        }
+        if (!valid) {
+            error = "Invalid option " + option;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// Constructor
+CompileServer::CompileServer(const std::string& socketPath, unsigned workers)
+    : socketPath_(socketPath), workerCount_(std::max(1u, workers)) {
+}
+
+// Destructor; stops the workers
+CompileServer::~CompileServer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        draining_ = true;
+    }
+    queueReady_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+// Serve requests until stopped
+bool CompileServer::run() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath_.empty() || socketPath_.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Invalid socket path " << socketPath_ << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, socketPath_.c_str());
+
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error: Could not create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // A socket left by a server that is gone is replaced; a live one is not
+    struct stat status{};
+    if (::lstat(socketPath_.c_str(), &status) == 0) {
+        bool live = S_ISSOCK(status.st_mode) &&
+                    ::connect(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (live || !S_ISSOCK(status.st_mode)) {
+            std::cerr << "Error: " << socketPath_ << (live ? " is in use by another server" : " exists")
+                      << std::endl;
+            ::close(listenFd);
+            return false;
+        }
+        ::unlink(socketPath_.c_str());
+    }
+
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd, SOMAXCONN) < 0) {
+        std::cerr << "Error: Could not listen on " << socketPath_ << ": " << std::strerror(errno) << std::endl;
+        ::close(listenFd);
+        return false;
+    }
+
+    signalled = 0;
+    auto previousInt = std::signal(SIGINT, onSignal);
+    auto previousTerm = std::signal(SIGTERM, onSignal);
+
+    draining_ = false;
+    for (unsigned i = 0; i < workerCount_; ++i) {
+        workers_.emplace_back(&CompileServer::workerLoop, this);
+    }
+    if (verbose_) {
+        std::cout << "Serving on " << socketPath_ << " with " << workerCount_ << " workers" << std::endl;
+    }
+
+    // The listening thread never blocks on a client: it waits for new
+    // connections and for the request lines of accepted ones together
+    std::vector<pollfd> polled;
+    while (!stopping_ && !signalled) {
+        polled.assign(1, pollfd{listenFd, POLLIN, 0});
+        for (const auto& connection : pending_) {
+            polled.push_back(pollfd{connection.fd, POLLIN, 0});
+        }
+        int ready = ::poll(polled.data(), polled.size(), POLL_INTERVAL_MS);
+
+        // Read before accepting, so that polled[i + 1] is still pending_[i]
+        if (ready > 0) {
+            for (size_t i = pending_.size(); i-- > 0;) {
+                if (polled[i + 1].revents != 0 && receive(pending_[i])) {
+                    pending_.erase(pending_.begin() + static_cast<std::ptrdiff_t>(i));
+                }
+            }
+            if (polled[0].revents & POLLIN) {
+                accept(listenFd);
+            }
+        }
+        expirePending();
+    }
+
+    // Stop accepting, then let the workers finish the queue
+    for (const auto& connection : pending_) {
+        ::close(connection.fd);
+    }
+    pending_.clear();
+    ::close(listenFd);
+    ::unlink(socketPath_.c_str());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        draining_ = true;
+    }
+    queueReady_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+
+    std::signal(SIGINT, previousInt);
+    std::signal(SIGTERM, previousTerm);
+    if (verbose_) {
+        std::cout << "Stopped serving on " << socketPath_ << std::endl;
+    }
+    return true;
+}
+
+// Get the current load and latency percentiles
+ServerStats CompileServer::getStats() const {
+    ServerStats stats;
+    std::vector<double> latencies;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.workers = workerCount_;
+        stats.active = active_;
+        stats.queueDepth = queue_.size();
+        stats.completed = completed_;
+        stats.failed = failed_;
+        latencies = latencies_;
+    }
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double fraction) {
+            size_t rank = static_cast<size_t>(fraction * static_cast<double>(latencies.size()) + 0.999999);
+            return latencies[std::min(latencies.size(), std::max<size_t>(rank, 1)) - 1];
+        };
+        stats.p50Ms = percentile(0.50);
+        stats.p99Ms = percentile(0.99);
+    }
+    return stats;
+}
+
+// Accept a connection and wait for its request line
+void CompileServer::accept(int listenFd) {
+    int fd = ::accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+    if (pending_.size() >= MAX_QUEUED_REQUESTS) {
+        setTimeouts(fd, STATS_TIMEOUT_SECONDS);
+        sendTrailer(fd, false, "Server busy");
+        ::close(fd);
+        return;
+    }
+    setNonBlocking(fd, true);
+    pending_.push_back(Connection{fd, "", Clock::now()});
+}
+
+// Read what a connection has sent of its request line; true once it is done with
+bool CompileServer::receive(Connection& connection) {
+    char chunk[1024];
+    while (true) {
+        size_t newline = connection.buffer.find('\n');
+        if (newline != std::string::npos) {
+            setNonBlocking(connection.fd, false);
+            dispatch(connection.fd, connection.buffer.substr(0, newline), connection.buffer.substr(newline + 1));
+            return true;
+        }
+        if (connection.buffer.size() > MAX_REQUEST_LINE) {
+            ::close(connection.fd);
+            return true;
+        }
+        ssize_t received = ::recv(connection.fd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;
+        }
+        if (received <= 0) {
+            ::close(connection.fd);
+            return true;
+        }
+        connection.buffer.append(chunk, static_cast<size_t>(received));
+    }
+}
+
+// Close connections that did not send their request line in time
+void CompileServer::expirePending() {
+    auto deadline = Clock::now() - REQUEST_LINE_TIMEOUT;
+    auto expired = std::remove_if(pending_.begin(), pending_.end(), [&](const Connection& connection) {
+        if (connection.accepted > deadline) {
+            return false;
+        }
+        ::close(connection.fd);
+        return true;
+    });
+    pending_.erase(expired, pending_.end());
+}
+
+// Answer or queue a request whose line has been read
+void CompileServer::dispatch(int fd, const std::string& line, const std::string& rest) {
+    std::istringstream fields(line);
+    std::string command;
+    fields >> command;
+    if (command == "stats") {
+        setTimeouts(fd, STATS_TIMEOUT_SECONDS);
+        sendReply(fd, formatStats());
+        ::close(fd);
+        return;
+    }
+    setTimeouts(fd, TRANSFER_TIMEOUT_SECONDS);
+    if (command != "compile") {
+        sendTrailer(fd, false, "Unknown request " + command);
+        ::close(fd);
+        return;
+    }
+
+    Request request{fd, 0, 0, "", rest, Clock::now()};
+    if (!(fields >> request.sourceBytes) || request.sourceBytes > MAX_SOURCE_BYTES ||
+        rest.size() > request.sourceBytes) {
+        sendTrailer(fd, false, "Invalid source length");
+        ::close(fd);
+        return;
+    }
+    std::getline(fields >> std::ws, request.options);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() < MAX_QUEUED_REQUESTS) {
+            request.id = ++nextId_;
+            queue_.push_back(std::move(request));
+            queueReady_.notify_one();
+            return;
+        }
+    }
+    sendTrailer(fd, false, "Server busy");
+    ::close(fd);
+}
+
+// Compile queued requests until the server stops
+void CompileServer::workerLoop() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queueReady_.wait(lock, [&] { return !queue_.empty() || draining_; });
+            if (queue_.empty()) {
+                return;
+            }
+            request = std::move(queue_.front());
+            queue_.pop_front();
+            active_++;
+        }
+
+        bool success = false;
+        try {
+            success = compile(request);
+        } catch (const std::exception& e) {
+            sendTrailer(request.fd, false, e.what());
+        }
+        ::close(request.fd);
+        complete(request, success);
+    }
+}
+
+// Compile one request and stream the reply
+bool CompileServer::compile(Request& request) {
+    setTimeouts(request.fd, TRANSFER_TIMEOUT_SECONDS);
+    if (!readExact(request.fd, request.source, request.sourceBytes)) {
+        return false;
+    }
+
+    // A compiler per request: workers share no compilation state
+    PIMCompiler compiler;
+    std::string sourceName = "source.cpp";
+    std::string error;
+    if (!configure(compiler, request.options, sourceName, error)) {
+        sendTrailer(request.fd, false, error);
+        return false;
+    }
+
+    FrameBuffer frames(request.fd);
+    std::ostream out(&frames);
+    bool success = false;
+    try {
+        success = compiler.compileSource(request.source, sourceName, out);
+        error = compiler.getLastError();
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    out.flush();
+
+    if (frames.failed()) {
+        return false;
+    }
+    sendTrailer(request.fd, success, error.empty() ? "Compilation failed" : error);
+    return success;
+}
+
+// Record the completion of a compile request
+void CompileServer::complete(const Request& request, bool success) {
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - request.received).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_--;
+    completed_++;
+    if (!success) {
+        failed_++;
+    }
+    if (latencies_.size() < LATENCY_WINDOW) {
+        latencies_.push_back(ms);
+    } else {
+        latencies_[nextLatency_] = ms;
+        nextLatency_ = (nextLatency_ + 1) % LATENCY_WINDOW;
+    }
+
+    if (verbose_) {
+        std::cout << "Request " << request.id << ": " << request.sourceBytes << " bytes"
+                  << (request.options.empty() ? "" : " " + request.options) << ": "
+                  << (success ? "compiled" : "failed") << " in " << std::fixed << std::setprecision(2)
+                  << ms << " ms" << std::endl;
+    }
+}
+
+// Format the stats reply
+std::string CompileServer::formatStats() const {
+    ServerStats stats = getStats();
+    std::ostringstream text;
+    text << "workers " << stats.workers << "\n"
+         << "active " << stats.active << "\n"
+         << "queue_depth " << stats.queueDepth << "\n"
+         << "completed " << stats.completed << "\n"
+         << "failed " << stats.failed << "\n"
+         << std::fixed << std::setprecision(3)
+         << "latency_p50_ms " << stats.p50Ms << "\n"
+         << "latency_p99_ms " << stats.p99Ms << "\n";
+    return text.str();
+}
+
+} // namespace Server
@@ -0,0 +1,85 @@
+#include "../../include/utils/binary_io.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace Utils {
+
+// Append an integer in little-endian byte order
+void putInteger(std::string& out, uint64_t value, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+// Append a length-prefixed byte string
+void putBytes(std::string& out, const std::string& bytes) {
+    putInteger(out, bytes.size(), 8);
+    out += bytes;
+}
+
+// Read an integer in little-endian byte order; false past the end of the data
+bool getInteger(const std::string& data, size_t& offset, unsigned bytes, uint64_t& value) {
+    if (data.size() - offset < bytes) {
+        return false;
+    }
+    value = 0;
+    for (unsigned i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+    }
+    offset += bytes;
+    return true;
+}
+
+// Read a length-prefixed byte string; false past the end of the data
+bool getBytes(const std::string& data, size_t& offset, std::string& bytes) {
+    uint64_t length = 0;
+    if (!getInteger(data, offset, 8, length) || data.size() - offset < length) {
+        return false;
+    }
+    bytes = data.substr(offset, length);
+    offset += length;
+    return true;
+}
+
+// Read a whole file; false if it cannot be read
+bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return !file.bad();
+}
+
+// Write under a unique temporary name, then rename over the file
+bool writeFileAtomically(const std::string& path, const std::string& data) {
+    std::ostringstream unique;
+    unique << std::hex << std::chrono::steady_clock::now().time_since_epoch().count() << '-'
+           << std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::string tempPath = path + "." + unique.str() + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(data.data(), static_cast<std::streamsize>(data.size())) || !file.flush()) {
+            std::error_code error;
+            fs::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempPath, path, error);
+    if (error) {
+        fs::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+} // namespace Utils
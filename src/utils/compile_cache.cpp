@@ -0,0 +1,258 @@
+#include "../../include/utils/compile_cache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include "../../include/utils/binary_io.h"
+
+namespace fs = std::filesystem;
+
+namespace Utils {
+
+namespace {
+
+// Leading bytes of an entry file
+constexpr char ENTRY_MAGIC[8] = {'P', 'I', 'M', 'C', 'A', 'C', 'H', 'E'};
+
+// Entry file format version
+constexpr uint32_t ENTRY_VERSION = 1;
+
+// Suffix of entry files
+const char* const ENTRY_SUFFIX = ".entry";
+
+// File holding the hit and miss counters
+const char* const STATS_FILE = "stats";
+
+// Lock file serializing updates of the counters
+const char* const STATS_LOCK_FILE = "stats.lock";
+
+// Exclusive lock on a file, held until destruction
+class FileLock {
+public:
+    explicit FileLock(const fs::path& path) : fd_(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+        if (fd_ >= 0 && ::flock(fd_, LOCK_EX) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    ~FileLock() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    bool locked() const { return fd_ >= 0; }
+
+private:
+    int fd_;
+};
+
+// Entry files of a cache directory
+struct EntryFile {
+    fs::path path;
+    uint64_t size;
+    fs::file_time_type lastUse;
+};
+
+// List the entry files of a directory
+std::vector<EntryFile> listEntries(const std::string& directory) {
+    std::vector<EntryFile> entries;
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != ENTRY_SUFFIX) {
+            continue;
+        }
+        std::error_code entryError;
+        EntryFile entry{it->path(), it->file_size(entryError), {}};
+        if (!entryError) {
+            entry.lastUse = it->last_write_time(entryError);
+        }
+        if (!entryError) {
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
+
+} // namespace
+
+// Open a cache directory, creating it if needed
+CompileCache::CompileCache(const std::string& directory, uint64_t maxBytes)
+    : directory_(directory), maxBytes_(maxBytes) {
+    std::error_code error;
+    fs::create_directories(directory_, error);
+    if (error || !fs::is_directory(directory_)) {
+        throw std::runtime_error("Cannot create compile cache directory " + directory_ +
+                                 (error ? ": " + error.message() : ""));
+    }
+}
+
+// Copy the cached output of a compilation to a file
+bool CompileCache::lookup(const std::string& key, const std::string& outputFile) {
+    fs::path entryPath = fs::path(directory_) / (entryName(key) + ENTRY_SUFFIX);
+
+    // A missing, truncated or colliding entry is a miss
+    std::string data;
+    std::string storedKey;
+    std::string output;
+    uint64_t version = 0;
+    size_t offset = sizeof(ENTRY_MAGIC);
+    bool hit = readFile(entryPath.string(), data) && data.size() >= sizeof(ENTRY_MAGIC) &&
+               std::memcmp(data.data(), ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) == 0 &&
+               getInteger(data, offset, 4, version) && version == ENTRY_VERSION &&
+               getBytes(data, offset, storedKey) && storedKey == key &&
+               getBytes(data, offset, output) && offset == data.size();
+
+    if (hit) {
+        std::ofstream file(outputFile, std::ios::binary | std::ios::trunc);
+        hit = file && file.write(output.data(), static_cast<std::streamsize>(output.size()));
+    }
+    if (hit) {
+        // Mark the entry as recently used
+        std::error_code error;
+        fs::last_write_time(entryPath, fs::file_time_type::clock::now(), error);
+    }
+
+    count(hit);
+    return hit;
+}
+
+// Store the output of a compilation, then evict down to the bound
+bool CompileCache::store(const std::string& key, const std::string& outputFile) {
+    std::string output;
+    if (!readFile(outputFile, output)) {
+        return false;
+    }
+
+    std::string data(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+    putInteger(data, ENTRY_VERSION, 4);
+    putInteger(data, key.size(), 8);
+    data += key;
+    putInteger(data, output.size(), 8);
+    data += output;
+
+    // An entry larger than the whole cache would only evict everything else
+    if (data.size() > maxBytes_) {
+        return false;
+    }
+
+    // Rename into place so that readers never see a partial entry
+    fs::path entryPath = fs::path(directory_) / (entryName(key) + ENTRY_SUFFIX);
+    if (!writeFileAtomically(entryPath.string(), data)) {
+        return false;
+    }
+
+    evict();
+    return true;
+}
+
+// Get the hit and miss counters and the current contents
+CacheStats CompileCache::getStats() const {
+    CacheStats stats;
+    std::ifstream file(fs::path(directory_) / STATS_FILE);
+    if (!(file >> stats.hits >> stats.misses)) {
+        stats.hits = 0;
+        stats.misses = 0;
+    }
+
+    for (const auto& entry : listEntries(directory_)) {
+        stats.entries++;
+        stats.bytes += entry.size;
+    }
+    return stats;
+}
+
+// Get the name of the entry file of a key (64-bit FNV-1a)
+std::string CompileCache::entryName(const std::string& key) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return name.str();
+}
+
+// Normalize source text: collapse whitespace runs and trim
+std::string CompileCache::normalizeSource(const std::string& source) {
+    std::string normalized;
+    normalized.reserve(source.size());
+    bool pendingSpace = false;
+    for (char c : source) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pendingSpace = !normalized.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            normalized.push_back(' ');
+            pendingSpace = false;
+        }
+        normalized.push_back(c);
+    }
+    return normalized;
+}
+
+// Add to the hit or miss counter kept in the directory
+void CompileCache::count(bool hit) {
+    // Concurrent compilers take turns; the rename keeps readers from seeing a partial file
+    FileLock lock(fs::path(directory_) / STATS_LOCK_FILE);
+    if (!lock.locked()) {
+        return;
+    }
+
+    fs::path statsPath = fs::path(directory_) / STATS_FILE;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    {
+        std::ifstream file(statsPath);
+        if (!(file >> hits >> misses)) {
+            hits = 0;
+            misses = 0;
+        }
+    }
+    (hit ? hits : misses)++;
+
+    std::ostringstream stats;
+    stats << hits << ' ' << misses << '\n';
+    writeFileAtomically(statsPath.string(), stats.str());
+}
+
+// Remove least recently used entries until the bound is met
+void CompileCache::evict() {
+    std::vector<EntryFile> entries = listEntries(directory_);
+    uint64_t total = 0;
+    for (const auto& entry : entries) {
+        total += entry.size;
+    }
+    if (total <= maxBytes_) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const EntryFile& a, const EntryFile& b) { return a.lastUse < b.lastUse; });
+    for (const auto& entry : entries) {
+        if (total <= maxBytes_) {
+            break;
+        }
+        std::error_code error;
+        if (fs::remove(entry.path, error)) {
+            total -= entry.size;
+        }
+    }
+}
+
+} // namespace Utils
@@ -0,0 +1,116 @@
+#include "../../include/utils/segment_table.h"
+#include <cstring>
+#include "../../include/utils/binary_io.h"
+
+namespace Utils {
+
+namespace {
+
+// Leading bytes of a segment table file
+constexpr char TABLE_MAGIC[8] = {'P', 'I', 'M', 'N', 'E', 'S', 'T', 'S'};
+
+// Segment table format version
+constexpr uint32_t TABLE_VERSION = 2;
+
+// Read a packed program written by putProgram(); false if it is truncated or inconsistent
+bool getProgram(const std::string& data, size_t& offset, PIM_ISA::PackedProgram& program) {
+    uint64_t configCount = 0;
+    if (!getInteger(data, offset, 4, configCount) || configCount > PIM_ISA::MAX_PACKED_CONFIGS) {
+        return false;
+    }
+    for (uint64_t i = 0; i < configCount; ++i) {
+        uint64_t opType = 0;
+        std::string lut;
+        if (!getInteger(data, offset, 1, opType) || !getBytes(data, offset, lut)) {
+            return false;
+        }
+        // Stored configurations are distinct, so each keeps its index
+        uint32_t index = program.internConfig(static_cast<PIM_ISA::CoreOpType>(opType),
+                                              std::vector<uint8_t>(lut.begin(), lut.end()));
+        if (index != i) {
+            return false;
+        }
+    }
+
+    uint64_t wordCount = 0;
+    if (!getInteger(data, offset, 8, wordCount) || (data.size() - offset) / 4 < wordCount) {
+        return false;
+    }
+    program.reserve(wordCount);
+    for (uint64_t i = 0; i < wordCount; ++i) {
+        uint64_t word = 0;
+        getInteger(data, offset, 4, word);
+        if (PIM_ISA::packedType(static_cast<uint32_t>(word)) == PIM_ISA::InstructionType::PROG &&
+            PIM_ISA::packedConfigIndex(static_cast<uint32_t>(word)) >= configCount) {
+            return false;
+        }
+        program.appendWord(static_cast<uint32_t>(word));
+    }
+    return true;
+}
+
+// Append a packed program: its LUT configurations, then its words
+void putProgram(std::string& out, const PIM_ISA::PackedProgram& program) {
+    putInteger(out, program.configs().size(), 4);
+    for (const auto& lut : program.configs()) {
+        putInteger(out, static_cast<uint8_t>(lut.opType), 1);
+        putBytes(out, std::string(lut.data.begin(), lut.data.end()));
+    }
+    putInteger(out, program.size(), 8);
+    for (uint32_t word : program.words()) {
+        putInteger(out, word, 4);
+    }
+}
+
+} // namespace
+
+// Read a table written by save()
+bool SegmentTable::load(const std::string& path) {
+    segments.clear();
+    std::string data;
+    if (!readFile(path, data)) {
+        return false;
+    }
+
+    uint64_t version = 0;
+    uint64_t count = 0;
+    size_t offset = sizeof(TABLE_MAGIC);
+    bool valid = data.size() >= sizeof(TABLE_MAGIC) &&
+                 std::memcmp(data.data(), TABLE_MAGIC, sizeof(TABLE_MAGIC)) == 0 &&
+                 getInteger(data, offset, 4, version) && version == TABLE_VERSION &&
+                 getBytes(data, offset, compiler) && getBytes(data, offset, options) &&
+                 getBytes(data, offset, layout) && getInteger(data, offset, 4, count);
+
+    for (uint64_t i = 0; valid && i < count; ++i) {
+        std::pair<std::string, PIM_ISA::PackedProgram> segment;
+        valid = getBytes(data, offset, segment.first) && getProgram(data, offset, segment.second);
+        if (valid) {
+            segments.push_back(std::move(segment));
+        }
+    }
+
+    if (!valid || offset != data.size()) {
+        segments.clear();
+        return false;
+    }
+    return true;
+}
+
+// Write the table, replacing the file atomically
+bool SegmentTable::save(const std::string& path) const {
+    std::string data(TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    putInteger(data, TABLE_VERSION, 4);
+    putBytes(data, compiler);
+    putBytes(data, options);
+    putBytes(data, layout);
+    putInteger(data, segments.size(), 4);
+    for (const auto& segment : segments) {
+        putBytes(data, segment.first);
+        putProgram(data, segment.second);
+    }
+
+    // A build interrupted while writing must not leave a partial table behind
+    return writeFileAtomically(path, data);
+}
+
+} // namespace Utils
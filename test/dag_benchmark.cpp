@@ -0,0 +1,116 @@
+// Benchmark for building instruction dependency graphs
+//
+// Usage: dag_benchmark [instruction count | program.pbin]
+//
+// Without a .pbin file, generates a program shaped like -O2 matrix
+// multiplication (rows of A and B loaded into slots, MACs spread over 31
+// cores, results written back) with the given number of instructions.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include "../include/optimizer/dependency_graph.h"
+#include "../include/pim_isa/object_file.h"
+#include "../include/pim_isa/packed_program.h"
+
+namespace {
+
+constexpr uint64_t DEFAULT_INSTRUCTIONS = 20000000;
+constexpr uint8_t FIRST_MAC_CORE = 3;
+constexpr uint8_t MAC_CORES = 31;
+
+// Generate a matrix-multiplication-like program
+PIM_ISA::PackedProgram generateProgram(uint64_t instructions) {
+    PIM_ISA::PackedProgram program;
+    program.reserve(instructions);
+
+    std::vector<uint8_t> lut = {0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17};
+    for (uint8_t core = 0; core < FIRST_MAC_CORE + MAC_CORES; ++core) {
+        program.append(PIM_ISA::createProgInstruction(core, PIM_ISA::CoreOpType::MAC, lut));
+    }
+
+    uint16_t row = 0;
+    while (program.size() + 2 + MAC_CORES + MAC_CORES + 1 < instructions) {
+        // One row of C: for every k, load A and B and issue one MAC per core
+        for (uint32_t k = 0; k < 64 && program.size() + 2 + MAC_CORES + MAC_CORES + 1 < instructions; ++k) {
+            program.append(PIM_ISA::createMemoryInstruction(0, true, false, row % 128));
+            program.append(PIM_ISA::createMemoryInstruction(1, true, false, 128 + (row + k) % 256));
+            for (uint8_t c = 0; c < MAC_CORES; ++c) {
+                program.append(PIM_ISA::createComputeInstruction(FIRST_MAC_CORE + c, PIM_ISA::encodeOperandSlots(0, 1)));
+            }
+        }
+        for (uint8_t c = 0; c < MAC_CORES; ++c) {
+            program.append(PIM_ISA::createMemoryInstruction(FIRST_MAC_CORE + c, false, true, 384 + (row + c) % 128));
+        }
+        row++;
+    }
+    program.append(PIM_ISA::createEndInstruction());
+    return program;
+}
+
+// Peak resident set size in MiB
+double peakMemoryMiB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// Milliseconds since a start time
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string argument = argc > 1 ? argv[1] : std::to_string(DEFAULT_INSTRUCTIONS);
+    bool objectInput = argument.size() > 5 && argument.compare(argument.size() - 5, 5, ".pbin") == 0;
+
+    try {
+        Optimizer::DependencyGraph graph;
+        double buildMs = 0;
+        uint64_t instructions = 0;
+
+        if (objectInput) {
+            PIM_ISA::ObjectFile object(argument);
+            instructions = object.instructionCount();
+            auto start = std::chrono::steady_clock::now();
+            Optimizer::DependencyGraphBuilder builder;
+            builder.reserve(instructions);
+            object.replay(builder);
+            graph = builder.build();
+            buildMs = elapsedMs(start);
+        } else {
+            PIM_ISA::PackedProgram program = generateProgram(std::strtoull(argument.c_str(), nullptr, 10));
+            instructions = program.size();
+            auto start = std::chrono::steady_clock::now();
+            graph = Optimizer::DependencyGraph::build(program);
+            buildMs = elapsedMs(start);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint64_t> heights = graph.heights();
+        double heightsMs = elapsedMs(start);
+        uint64_t criticalPath = heights.empty() ? 0 : *std::max_element(heights.begin(), heights.end());
+
+        std::cout << "=== Dependency graph benchmark (" << (objectInput ? argument : "generated program") << ") ===" << std::endl;
+        std::cout << "Nodes: " << graph.size() << std::endl;
+        std::cout << "Edges: " << graph.edgeCount() << " ("
+                  << static_cast<double>(graph.edgeCount()) / std::max<uint64_t>(1, instructions) << " per node)" << std::endl;
+        std::cout << "Build time: " << buildMs << " ms ("
+                  << 1e6 * buildMs / std::max<uint64_t>(1, instructions) << " ns per node)" << std::endl;
+        std::cout << "Critical path: " << criticalPath << " cycles (computed in " << heightsMs << " ms)" << std::endl;
+        std::cout << "Graph memory: " << graph.memoryBytes() / (1024.0 * 1024.0) << " MiB ("
+                  << static_cast<double>(graph.memoryBytes()) / std::max<uint64_t>(1, instructions) << " bytes per node)"
+                  << std::endl;
+        std::cout << "Peak memory: " << peakMemoryMiB() << " MiB" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
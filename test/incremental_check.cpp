@@ -0,0 +1,129 @@
+// Check that incremental builds do not depend on earlier builds
+//
+// Usage: incremental_check
+//
+// For assembly at -O0 to -O3 and a binary object at -O2, builds a program
+// with --incremental, edits one statement and rebuilds it from the segment
+// table, then builds the edited program from scratch. The rebuild must
+// reuse the unchanged loop nests and write the same bytes as the build from
+// scratch; so must a second rebuild in which every nest is reused.
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "../include/compiler.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Program before the edit; the products keep their shapes and placement after it
+const char* const ORIGINAL_SOURCE =
+    "int main() {\n"
+    "    Matrix A(16, 16);\n"
+    "    Matrix B(16, 16);\n"
+    "    Matrix G(16, 16);\n"
+    "    Matrix C = A * B;\n"
+    "    Matrix D = B * A;\n"
+    "    Matrix E = A * A;\n"
+    "    Matrix F = B * G;\n"
+    "    return 0;\n"
+    "}\n";
+
+// Statement changed by the edit, and its replacement
+const char* const EDITED_STATEMENT = "Matrix F = B * G;";
+const char* const NEW_STATEMENT = "Matrix F = G * B;";
+
+// Write a file, replacing it
+void writeFile(const fs::path& path, const std::string& contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || !(file << contents)) {
+        throw std::runtime_error("Cannot write " + path.string());
+    }
+}
+
+// Read a whole file
+std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot read " + path.string());
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Build a source incrementally into an output; returns the reuse statistics
+PIMCompiler::IncrementalStats build(const fs::path& source, const fs::path& output, int level, bool binary) {
+    PIMCompiler compiler;
+    compiler.setOptimizationLevel(level);
+    compiler.setOutputFormat(binary ? PIMCompiler::OutputFormat::BINARY : PIMCompiler::OutputFormat::ASSEMBLY);
+    compiler.setIncremental(true);
+    if (!compiler.compile(source.string(), output.string())) {
+        throw std::runtime_error("Failed to compile " + source.string() + " at -O" + std::to_string(level));
+    }
+    return compiler.getIncrementalStats();
+}
+
+// Check one level and output format
+void check(const fs::path& directory, int level, bool binary) {
+    std::string label = "-O" + std::to_string(level) + (binary ? " -fbinary" : "");
+    std::string extension = binary ? ".pbin" : ".asm";
+    fs::path original = directory / "original.cpp";
+    fs::path edited = directory / "edited.cpp";
+    fs::path rebuilt = directory / ("rebuilt" + extension);
+    fs::path scratch = directory / ("scratch" + extension);
+    fs::remove(fs::path(rebuilt.string() + ".segments"));
+    fs::remove(fs::path(scratch.string() + ".segments"));
+
+    build(original, rebuilt, level, binary);
+    PIMCompiler::IncrementalStats edit = build(edited, rebuilt, level, binary);
+    if (edit.fullBuild || edit.reused + 1 != edit.nests) {
+        throw std::runtime_error("The edit reused " + std::to_string(edit.reused) + " of " +
+                                 std::to_string(edit.nests) + " loop nests at " + label);
+    }
+
+    PIMCompiler::IncrementalStats fresh = build(edited, scratch, level, binary);
+    if (!fresh.fullBuild) {
+        throw std::runtime_error("The build from scratch reused loop nests at " + label);
+    }
+    if (readFile(rebuilt) != readFile(scratch)) {
+        throw std::runtime_error("The rebuild and the build from scratch differ at " + label);
+    }
+
+    PIMCompiler::IncrementalStats again = build(edited, rebuilt, level, binary);
+    if (again.reused != again.nests || readFile(rebuilt) != readFile(scratch)) {
+        throw std::runtime_error("A rebuild reusing every loop nest differs at " + label);
+    }
+    std::cout << label << ": rebuild after the edit reused " << edit.reused << " of " << edit.nests
+              << " loop nests, identical to a build from scratch" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    fs::path directory = fs::temp_directory_path() / "incremental_check";
+    try {
+        fs::create_directories(directory);
+        std::string source = ORIGINAL_SOURCE;
+        writeFile(directory / "original.cpp", source);
+        source.replace(source.find(EDITED_STATEMENT), std::string(EDITED_STATEMENT).size(), NEW_STATEMENT);
+        writeFile(directory / "edited.cpp", source);
+
+        std::cout << "=== Incremental build check ===" << std::endl;
+        for (int level = 0; level <= 3; ++level) {
+            check(directory, level, false);
+        }
+        check(directory, 2, true);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    fs::remove_all(directory, error);
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Check that programs survive a round trip through a .pbin object file
+//
+// Usage: objdump_check <pim-objdump>
+//
+// Compiles each example at -O0 to -O3 to assembly and to a -fbinary object,
+// disassembles the object with `pim-objdump -S` and compares the text with
+// the assembly byte for byte. The PROG lines carry the LUT configurations
+// from the object's config table and the bundle comments come from the
+// bundle-start bits, so both must be rebuilt exactly. The check fails if
+// the examples never use more than one configuration or never form a bundle.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/compiler.h"
+#include "../include/pim_isa/object_file.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Source compiled by the check and the options it needs
+struct Case {
+    const char* source;
+    uint32_t strassenThreshold;
+    uint32_t precision;
+};
+
+const Case CASES[] = {
+    {"test/complex_test.cpp", 0, 4},
+    {"test/complex_test.cpp", 0, 8},
+    {"examples/matrix_multiplication.cpp", 0, 4},
+    {"examples/constant_scaling.cpp", 0, 4},
+    {"examples/sparse_layer.cpp", 0, 4},
+    {"examples/batched_gemm.cpp", 0, 4},
+    {"examples/strassen.cpp", 16, 4},
+};
+
+// Read a whole file
+std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot read " + path.string());
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Run a command and return what it writes to stdout
+std::string run(const std::string& command) {
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        throw std::runtime_error("Cannot run " + command);
+    }
+    std::string output;
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, count);
+    }
+    if (pclose(pipe) != 0) {
+        throw std::runtime_error(command + " failed");
+    }
+    return output;
+}
+
+// Compile a case to assembly or to an object file
+void compile(const Case& test, int level, bool binary, const fs::path& output) {
+    PIMCompiler compiler;
+    compiler.setOptimizationLevel(level);
+    compiler.setStrassenThreshold(test.strassenThreshold);
+    compiler.setPrecision(test.precision);
+    compiler.setOutputFormat(binary ? PIMCompiler::OutputFormat::BINARY : PIMCompiler::OutputFormat::ASSEMBLY);
+    if (!compiler.compile(test.source, output.string())) {
+        throw std::runtime_error("Failed to compile " + std::string(test.source) + " at -O" + std::to_string(level));
+    }
+}
+
+// Count the lines of a text that start with a prefix, after indentation
+size_t countLines(const std::string& text, const std::string& prefix) {
+    std::istringstream lines(text);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(lines, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, prefix.size(), prefix) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <pim-objdump>" << std::endl;
+        return 1;
+    }
+    std::string objdump = argv[1];
+    fs::path directory = fs::temp_directory_path() / "objdump_check";
+    size_t maxConfigs = 0;
+    size_t bundles = 0;
+
+    try {
+        fs::create_directories(directory);
+        fs::path assemblyPath = directory / "program.asm";
+        fs::path objectPath = directory / "program.pbin";
+
+        std::cout << "=== Object file round trip check ===" << std::endl;
+        for (const Case& test : CASES) {
+            for (int level = 0; level <= 3; ++level) {
+                std::string label = std::string(test.source) + " -O" + std::to_string(level);
+                if (test.strassenThreshold) {
+                    label += " -fstrassen=" + std::to_string(test.strassenThreshold);
+                }
+                if (test.precision != 4) {
+                    label += " -fprecision=" + std::to_string(test.precision);
+                }
+
+                compile(test, level, false, assemblyPath);
+                compile(test, level, true, objectPath);
+                std::string assembly = readFile(assemblyPath);
+                std::string disassembly = run("'" + objdump + "' -S '" + objectPath.string() + "'");
+                if (disassembly != assembly) {
+                    throw std::runtime_error("pim-objdump -S differs from the assembly of " + label);
+                }
+
+                PIM_ISA::ObjectFile object(objectPath.string());
+                size_t configs = object.configs().size();
+                size_t programBundles = countLines(assembly, "// Bundle");
+                maxConfigs = std::max(maxConfigs, configs);
+                bundles += programBundles;
+                std::cout << label << ": " << object.instructionCount() << " instructions, " << configs
+                          << " LUT configs, " << programBundles << " bundles identical" << std::endl;
+            }
+        }
+
+        if (maxConfigs < 2) {
+            throw std::runtime_error("No program uses more than one LUT configuration");
+        }
+        if (bundles == 0) {
+            throw std::runtime_error("No program forms a bundle");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    fs::remove_all(directory, error);
+    return 0;
+}
@@ -0,0 +1,389 @@
+// Check of the compile server protocol (pim_compiler --serve)
+//
+// Usage: server_check
+//
+// Starts a CompileServer with one worker on a temporary socket and checks:
+// - a connection that never sends its request line is closed without a reply
+// - malformed requests are answered with an error trailer, or closed when
+//   the request line is too long, and the server keeps serving
+// - with the worker busy and MAX_QUEUED_REQUESTS compile requests queued,
+//   one more request is refused as busy
+// - compile replies are well formed "data <n>" frames ended by "ok", and
+//   their output is byte for byte that of a local compilation
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../include/compiler.h"
+#include "../include/server/compile_server.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Longest wait for the server to reach an expected state
+constexpr std::chrono::seconds STATE_TIMEOUT(30);
+
+// Longest wait for the server to close an idle connection
+constexpr int IDLE_TIMEOUT_SECONDS = 15;
+
+// Compile request checked against a local compilation
+struct Case {
+    const char* source;
+    int level;
+    bool binary;
+    bool boundedMemory;
+    uint32_t strassenThreshold;
+    uint32_t precision;
+};
+
+const Case CASES[] = {
+    {"test/complex_test.cpp", 0, false, false, 0, 4},
+    {"test/complex_test.cpp", 1, false, false, 0, 4},
+    {"test/complex_test.cpp", 2, false, false, 0, 4},
+    {"test/complex_test.cpp", 3, false, false, 0, 4},
+    {"test/complex_test.cpp", 2, true, false, 0, 4},
+    {"test/complex_test.cpp", 2, false, true, 0, 4},
+    {"test/complex_test.cpp", 2, false, false, 0, 8},
+    {"examples/sparse_layer.cpp", 2, false, false, 0, 4},
+    {"examples/strassen.cpp", 3, true, false, 16, 4},
+};
+
+// Reply split into its output and its trailer line
+struct Reply {
+    std::string output;
+    std::string trailer;
+};
+
+// Read a whole file
+std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot read " + path.string());
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Connect to the server socket; -1 if nothing listens on it
+int connectTo(const std::string& socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create a socket: " + std::string(std::strerror(errno)));
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Connect to the server socket, which must be listening
+int openConnection(const std::string& socketPath) {
+    int fd = connectTo(socketPath);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot connect to " + socketPath + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+// Send a whole buffer
+void sendAll(int fd, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t sent = ::send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            throw std::runtime_error("Cannot send a request: " + std::string(std::strerror(errno)));
+        }
+        offset += static_cast<size_t>(sent);
+    }
+}
+
+// Receive until the server closes the connection
+std::string receiveAll(int fd) {
+    std::string data;
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0) {
+            throw std::runtime_error("Cannot receive a reply: " + std::string(std::strerror(errno)));
+        }
+        if (received == 0) {
+            return data;
+        }
+        data.append(chunk, static_cast<size_t>(received));
+    }
+}
+
+// Split a reply into frames and trailer; throws if it is not well formed
+Reply parseReply(const std::string& raw) {
+    Reply reply;
+    size_t position = 0;
+    while (true) {
+        size_t newline = raw.find('\n', position);
+        if (newline == std::string::npos) {
+            throw std::runtime_error("Reply without a trailer line");
+        }
+        std::string line = raw.substr(position, newline - position);
+        position = newline + 1;
+        if (line.compare(0, 5, "data ") != 0) {
+            if (position != raw.size()) {
+                throw std::runtime_error("Bytes after the trailer \"" + line + "\"");
+            }
+            if (line != "ok" && line.compare(0, 6, "error ") != 0) {
+                throw std::runtime_error("Invalid trailer \"" + line + "\"");
+            }
+            reply.trailer = line;
+            return reply;
+        }
+        size_t size = std::stoul(line.substr(5));
+        if (size == 0 || raw.size() - position < size) {
+            throw std::runtime_error("Invalid frame \"" + line + "\"");
+        }
+        reply.output.append(raw, position, size);
+        position += size;
+    }
+}
+
+// Send one request and return the whole raw reply
+std::string request(const std::string& socketPath, const std::string& text) {
+    int fd = openConnection(socketPath);
+    sendAll(fd, text);
+    std::string raw = receiveAll(fd);
+    ::close(fd);
+    return raw;
+}
+
+// Read one value of the stats reply
+uint64_t readStat(const std::string& socketPath, const std::string& name) {
+    Reply reply = parseReply(request(socketPath, "stats\n"));
+    std::istringstream lines(reply.output);
+    std::string key;
+    std::string value;
+    while (lines >> key >> value) {
+        if (key == name) {
+            return std::stoull(value);
+        }
+    }
+    throw std::runtime_error("No " + name + " in the stats reply");
+}
+
+// Wait until a stats value reaches an expected value
+void waitForStat(const std::string& socketPath, const std::string& name, uint64_t expected) {
+    auto deadline = std::chrono::steady_clock::now() + STATE_TIMEOUT;
+    while (readStat(socketPath, name) != expected) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error("The server never reported " + name + " " + std::to_string(expected));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// Check that malformed requests get an error, or no reply, and leave the server serving
+void checkMalformed(const std::string& socketPath) {
+    struct Malformed {
+        const char* description;
+        std::string text;
+        const char* trailer;    // Expected trailer; null if the connection is closed without a reply
+    };
+    const Malformed requests[] = {
+        {"unknown command", "assemble 4\nabcd", "error Unknown request assemble"},
+        {"source length that is not a number", "compile many\n", "error Invalid source length"},
+        {"more source than its length", "compile 4\nint main() {}\n", "error Invalid source length"},
+        {"source above the size limit", "compile " + std::to_string(Server::MAX_SOURCE_BYTES + 1) + "\n",
+         "error Invalid source length"},
+        {"unknown option", "compile 2 -fvectorize\n{}", "error Unknown option -fvectorize"},
+        {"invalid option value", "compile 2 -O7\n{}", "error Invalid option -O7"},
+        {"request line above the size limit", std::string(Server::MAX_REQUEST_LINE + 1, 'x'), nullptr},
+    };
+
+    for (const auto& malformed : requests) {
+        std::string raw = request(socketPath, malformed.text);
+        if (!malformed.trailer) {
+            if (!raw.empty()) {
+                throw std::runtime_error("A " + std::string(malformed.description) + " got a reply");
+            }
+        } else if (parseReply(raw).trailer != malformed.trailer) {
+            throw std::runtime_error("A " + std::string(malformed.description) + " got \"" +
+                                     parseReply(raw).trailer + "\" instead of \"" + malformed.trailer + "\"");
+        }
+        std::cout << "Malformed request (" << malformed.description << "): "
+                  << (malformed.trailer ? malformed.trailer : "closed without a reply") << std::endl;
+    }
+
+    const std::string source = "int main() { Matrix A(4, 4); Matrix C = A * Q; return 0; }\n";
+    Reply reply = parseReply(request(socketPath, "compile " + std::to_string(source.size()) + "\n" + source));
+    if (reply.trailer.compare(0, 6, "error ") != 0) {
+        throw std::runtime_error("A source that does not compile got \"" + reply.trailer + "\"");
+    }
+    std::cout << "Source that does not compile: " << reply.trailer << std::endl;
+}
+
+// Check that requests beyond the queue limit are refused while the worker is busy
+void checkQueueLimit(const std::string& socketPath) {
+    // The only worker waits for source bytes that never come
+    int busy = openConnection(socketPath);
+    sendAll(busy, "compile 100\n");
+    waitForStat(socketPath, "active", 1);
+
+    std::vector<int> queued;
+    for (size_t i = 0; i < Server::MAX_QUEUED_REQUESTS; ++i) {
+        queued.push_back(openConnection(socketPath));
+        sendAll(queued.back(), "compile 2\n");
+    }
+    waitForStat(socketPath, "queue_depth", Server::MAX_QUEUED_REQUESTS);
+
+    Reply refused = parseReply(request(socketPath, "compile 2\n{}"));
+    if (refused.trailer != "error Server busy") {
+        throw std::runtime_error("A request beyond the queue limit got \"" + refused.trailer + "\"");
+    }
+
+    // Closing the connections fails the requests without a reply and empties the queue
+    ::close(busy);
+    for (int fd : queued) {
+        ::close(fd);
+    }
+    waitForStat(socketPath, "queue_depth", 0);
+    waitForStat(socketPath, "active", 0);
+    std::cout << "Request beyond " << Server::MAX_QUEUED_REQUESTS << " queued: " << refused.trailer << std::endl;
+}
+
+// Check that a compile request sends the output of a local compilation
+void checkCompile(const std::string& socketPath, const Case& test, const fs::path& directory) {
+    std::string options = "-O" + std::to_string(test.level);
+    if (test.binary) {
+        options += " -fbinary";
+    }
+    if (test.boundedMemory) {
+        options += " -fbounded-memory";
+    }
+    if (test.strassenThreshold) {
+        options += " -fstrassen=" + std::to_string(test.strassenThreshold);
+    }
+    if (test.precision != 4) {
+        options += " -fprecision=" + std::to_string(test.precision);
+    }
+    std::string label = std::string(test.source) + " " + options;
+
+    PIMCompiler compiler;
+    compiler.setOptimizationLevel(test.level);
+    compiler.setOutputFormat(test.binary ? PIMCompiler::OutputFormat::BINARY : PIMCompiler::OutputFormat::ASSEMBLY);
+    compiler.setBoundedMemory(test.boundedMemory);
+    compiler.setStrassenThreshold(test.strassenThreshold);
+    compiler.setPrecision(test.precision);
+    fs::path output = directory / (test.binary ? "local.pbin" : "local.asm");
+    if (!compiler.compile(test.source, output.string())) {
+        throw std::runtime_error("Failed to compile " + label);
+    }
+    std::string expected = readFile(output);
+
+    std::string source = readFile(test.source);
+    Reply reply = parseReply(request(socketPath, "compile " + std::to_string(source.size()) + " " + options +
+                                                     " --source=" + test.source + "\n" + source));
+    if (reply.trailer != "ok") {
+        throw std::runtime_error("The server failed " + label + ": " + reply.trailer);
+    }
+    if (reply.output != expected) {
+        throw std::runtime_error("The server output of " + label + " differs from the local compilation");
+    }
+    std::cout << label << ": " << reply.output.size() << " bytes identical to the local compilation" << std::endl;
+}
+
+// Allow the connections of the queue check
+void raiseFileLimit() {
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < 2 * Server::MAX_QUEUED_REQUESTS + 64) {
+        throw std::runtime_error("The queue check needs " + std::to_string(2 * Server::MAX_QUEUED_REQUESTS + 64) +
+                                 " open files, the limit is " + std::to_string(limit.rlim_cur));
+    }
+}
+
+} // namespace
+
+int main() {
+    fs::path directory = fs::temp_directory_path() / "server_check";
+    std::string socketPath = (directory / "server.sock").string();
+    Server::CompileServer server(socketPath, 1);
+    std::thread serving;
+    bool started = true;
+    bool passed = false;
+
+    try {
+        raiseFileLimit();
+        fs::create_directories(directory);
+        serving = std::thread([&] { started = server.run(); });
+        auto deadline = std::chrono::steady_clock::now() + STATE_TIMEOUT;
+        int probe;
+        while ((probe = connectTo(socketPath)) < 0) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("The server never listened on " + socketPath);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ::close(probe);
+
+        std::cout << "=== Compile server check ===" << std::endl;
+
+        // Runs alongside the other checks: the server must give up on it by itself
+        int idle = openConnection(socketPath);
+        auto idleSince = std::chrono::steady_clock::now();
+
+        checkMalformed(socketPath);
+        checkQueueLimit(socketPath);
+        for (const Case& test : CASES) {
+            checkCompile(socketPath, test, directory);
+        }
+
+        timeval timeout{};
+        timeout.tv_sec = IDLE_TIMEOUT_SECONDS;
+        setsockopt(idle, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string raw = receiveAll(idle);
+        ::close(idle);
+        if (!raw.empty()) {
+            throw std::runtime_error("A connection without a request line got a reply");
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - idleSince).count();
+        std::cout << "Connection without a request line: closed without a reply after " << static_cast<int>(seconds)
+                  << " s" << std::endl;
+
+        uint64_t completed = readStat(socketPath, "completed");
+        uint64_t failed = readStat(socketPath, "failed");
+        std::cout << completed << " compile requests completed, " << failed << " failed" << std::endl;
+        passed = true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    server.stop();
+    if (serving.joinable()) {
+        serving.join();
+    }
+    std::error_code error;
+    fs::remove_all(directory, error);
+    return passed && started ? 0 : 1;
+}
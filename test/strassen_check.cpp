@@ -0,0 +1,229 @@
+// Check of Strassen-Winograd splitting (-fstrassen)
+//
+// Usage: strassen_check [source.cpp] [threshold]
+//
+// Compiles the source (default examples/strassen.cpp, threshold 16) at -O1
+// to -O3 and checks two things at each level:
+// - in the optimized operations, every element of a temporary is written
+//   before an operation reads it, and every element of each output is
+//   written (the blocks of C cover C)
+// - in the generated program, every memory row of a temporary is written
+//   before it is read, and every row of each output is written
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/compiler.h"
+#include "../include/frontend/parser.h"
+#include "../include/optimizer/optimizer.h"
+#include "../include/pim_isa/object_file.h"
+
+namespace {
+
+constexpr const char* DEFAULT_SOURCE = "examples/strassen.cpp";
+constexpr uint32_t DEFAULT_THRESHOLD = 16;
+
+// Storage matrix of a view and the position of the view's first element in it
+struct Placement {
+    std::string storage;
+    uint32_t row{0};
+    uint32_t col{0};
+    bool transposed{false};
+};
+
+// Follow block, transpose and plain aliases down to the matrix holding the storage
+Placement place(const std::string& name, const std::map<std::string, Frontend::MatrixInfo>& byName) {
+    Placement placement{name};
+    for (auto matrix = byName.find(name); matrix != byName.end() && !matrix->second.aliasOf.empty();
+         matrix = byName.find(placement.storage)) {
+        const Frontend::MatrixInfo& info = matrix->second;
+        if (info.transposed) {
+            placement.transposed = !placement.transposed;
+        }
+        if (info.block) {
+            placement.row += info.blockRow;
+            placement.col += info.blockCol;
+        }
+        placement.storage = info.aliasOf;
+    }
+    return placement;
+}
+
+// Check the optimized operations element by element; returns the temporaries
+std::set<std::string> checkOperations(const std::string& source, int level, uint32_t threshold,
+                                      const std::vector<std::string>& outputs) {
+    Frontend::Parser parser;
+    if (!parser.parseFile(source)) {
+        throw std::runtime_error("Failed to parse " + source);
+    }
+    std::vector<Frontend::MatrixInfo> matrices = parser.getMatrices();
+    Optimizer::Optimizer optimizer;
+    optimizer.setOptimizationLevel(level);
+    optimizer.setStrassenThreshold(threshold);
+    std::vector<Frontend::MatrixOperation> operations = optimizer.optimizeOperations(parser.getOperations(), matrices);
+    if (optimizer.getStrassenSplitCount() == 0) {
+        throw std::runtime_error("No product was split at -O" + std::to_string(level));
+    }
+
+    std::map<std::string, Frontend::MatrixInfo> byName;
+    for (const auto& matrix : matrices) {
+        byName[matrix.name] = matrix;
+    }
+
+    // Written elements of every storage matrix, row-major
+    std::map<std::string, std::vector<bool>> written;
+    std::set<std::string> temporaries;
+    for (const auto& matrix : matrices) {
+        if (matrix.aliasOf.empty()) {
+            written[matrix.name].assign(static_cast<size_t>(matrix.rows) * matrix.cols, false);
+            if (matrix.isTemporary) {
+                temporaries.insert(matrix.name);
+            }
+        }
+    }
+
+    // Visit each element of a view in its storage matrix
+    auto forEachElement = [&](const std::string& name, auto&& visit) {
+        const Frontend::MatrixInfo& view = byName.at(name);
+        Placement placement = place(name, byName);
+        uint32_t storageCols = byName.at(placement.storage).cols;
+        std::vector<bool>& elements = written.at(placement.storage);
+        for (uint32_t i = 0; i < view.rows; ++i) {
+            for (uint32_t j = 0; j < view.cols; ++j) {
+                uint32_t row = placement.transposed ? j : i;
+                uint32_t col = placement.transposed ? i : j;
+                visit(placement.storage, elements[(placement.row + row) * storageCols + placement.col + col]);
+            }
+        }
+    };
+
+    for (const auto& op : operations) {
+        for (const auto& input : op.inputs) {
+            if (!byName.count(input)) {
+                continue;
+            }
+            forEachElement(input, [&](const std::string& storage, std::vector<bool>::reference element) {
+                if (temporaries.count(storage) && !element) {
+                    throw std::runtime_error(op.output + " reads " + input + " before all of " + storage +
+                                             " is written at -O" + std::to_string(level));
+                }
+            });
+        }
+        forEachElement(op.output, [](const std::string&, std::vector<bool>::reference element) {
+            element = true;
+        });
+    }
+
+    for (const auto& output : outputs) {
+        forEachElement(output, [&](const std::string&, std::vector<bool>::reference element) {
+            if (!element) {
+                throw std::runtime_error("Not every element of " + output + " is written at -O" + std::to_string(level));
+            }
+        });
+    }
+    return temporaries;
+}
+
+// Check the program row by row; returns the number of reads of temporaries
+uint64_t checkProgram(const std::string& source, int level, uint32_t threshold,
+                      const std::vector<std::string>& outputs, const std::set<std::string>& temporaries) {
+    std::string objectPath = (std::filesystem::temp_directory_path() /
+                              ("strassen_check_O" + std::to_string(level) + ".pbin")).string();
+    PIMCompiler compiler;
+    compiler.setOptimizationLevel(level);
+    compiler.setStrassenThreshold(threshold);
+    compiler.setOutputFormat(PIMCompiler::OutputFormat::BINARY);
+    if (!compiler.compile(source, objectPath)) {
+        throw std::runtime_error("Failed to compile " + source + " at -O" + std::to_string(level));
+    }
+    PIM_ISA::ObjectFile object(objectPath);
+    std::filesystem::remove(objectPath);
+
+    // Rows held only by temporaries, and the rows of each output
+    std::set<uint16_t> temporaryRows;
+    std::set<uint16_t> otherRows;
+    std::map<std::string, std::pair<uint16_t, uint16_t>> outputRows;
+    for (const auto& matrix : object.matrices()) {
+        for (uint32_t row = matrix.startAddress; row <= matrix.endAddress; ++row) {
+            (temporaries.count(matrix.name) ? temporaryRows : otherRows).insert(static_cast<uint16_t>(row));
+        }
+        outputRows[matrix.name] = {matrix.startAddress, matrix.endAddress};
+    }
+    for (uint16_t row : otherRows) {
+        temporaryRows.erase(row);
+    }
+    if (temporaryRows.empty()) {
+        throw std::runtime_error("No temporary in the matrix table at -O" + std::to_string(level));
+    }
+
+    std::vector<bool> rowWritten(PIM_ISA::NUM_ROWS, false);
+    uint64_t temporaryReads = 0;
+    for (uint64_t i = 0; i < object.instructionCount(); ++i) {
+        PIM_ISA::Instruction instruction = object.instruction(i);
+        if (instruction.type != PIM_ISA::InstructionType::EXE || instruction.read == instruction.write) {
+            continue;
+        }
+        if (instruction.write) {
+            rowWritten[instruction.rowAddress] = true;
+        } else if (temporaryRows.count(instruction.rowAddress)) {
+            if (!rowWritten[instruction.rowAddress]) {
+                throw std::runtime_error("Instruction " + std::to_string(i) + " reads row " +
+                                         std::to_string(instruction.rowAddress) +
+                                         " of a temporary before it is written at -O" + std::to_string(level));
+            }
+            temporaryReads++;
+        }
+    }
+
+    for (const auto& output : outputs) {
+        auto rows = outputRows.find(output);
+        if (rows == outputRows.end()) {
+            throw std::runtime_error(output + " is missing from the matrix table at -O" + std::to_string(level));
+        }
+        for (uint32_t row = rows->second.first; row <= rows->second.second; ++row) {
+            if (!rowWritten[row]) {
+                throw std::runtime_error("Row " + std::to_string(row) + " of " + output +
+                                         " is never written at -O" + std::to_string(level));
+            }
+        }
+    }
+    return temporaryReads;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string source = argc > 1 ? argv[1] : DEFAULT_SOURCE;
+    uint32_t threshold = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : DEFAULT_THRESHOLD;
+
+    try {
+        Frontend::Parser parser;
+        if (!parser.parseFile(source)) {
+            throw std::runtime_error("Failed to parse " + source);
+        }
+        std::vector<std::string> outputs;
+        for (const auto& matrix : parser.getMatrices()) {
+            if (matrix.isOutput) {
+                outputs.push_back(matrix.name);
+            }
+        }
+
+        std::cout << "=== Strassen check (" << source << ", -fstrassen=" << threshold << ") ===" << std::endl;
+        for (int level = 1; level <= 3; ++level) {
+            std::set<std::string> temporaries = checkOperations(source, level, threshold, outputs);
+            uint64_t reads = checkProgram(source, level, threshold, outputs, temporaries);
+            std::cout << "-O" << level << ": " << temporaries.size() << " temporaries written before use, "
+                      << reads << " temporary row reads, " << outputs.size() << " outputs fully written" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "../include/pim_isa/object_file.h"
+#include "../include/pim_isa/assembly_writer.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstring>
+
+// Display names for LUT core operations
+const char* coreOpName(PIM_ISA::CoreOpType opType) {
+    switch (opType) {
+        case PIM_ISA::CoreOpType::MULTIPLIER:  return "MULTIPLIER";
+        case PIM_ISA::CoreOpType::ADDER:       return "ADDER";
+        case PIM_ISA::CoreOpType::MAC:         return "MAC";
+        case PIM_ISA::CoreOpType::SHIFTER:     return "SHIFTER";
+        case PIM_ISA::CoreOpType::LOGIC_AND:   return "LOGIC_AND";
+        case PIM_ISA::CoreOpType::LOGIC_OR:    return "LOGIC_OR";
+        case PIM_ISA::CoreOpType::LOGIC_XOR:   return "LOGIC_XOR";
+        case PIM_ISA::CoreOpType::COMPARATOR:  return "COMPARATOR";
+        case PIM_ISA::CoreOpType::CUSTOM:      return "CUSTOM";
+        case PIM_ISA::CoreOpType::SUBTRACTOR:  return "SUBTRACTOR";
+        default:                               return "UNKNOWN";
+    }
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options] object_file" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -f, --file-header   Display the file header" << std::endl;
+    std::cout << "  -t, --matrices      Display the matrix table" << std::endl;
+    std::cout << "  -c, --configs       Display the LUT configuration table" << std::endl;
+    std::cout << "  -d, --disassemble   Disassemble instructions with their encodings (default)" << std::endl;
+    std::cout << "  -S, --assembly      Print the program as pPIM assembly text" << std::endl;
+    std::cout << "  -h, --help          Show this help message" << std::endl;
+}
+
+void printFileHeader(const PIM_ISA::ObjectFile& object) {
+    const auto& header = object.header();
+    std::cout << "File header:" << std::endl;
+    std::cout << "  Version:             " << header.version << std::endl;
+    std::cout << "  Instructions:        " << header.instructionCount
+              << " at offset " << header.instructionOffset << std::endl;
+    std::cout << "  LUT configurations:  " << header.configCount
+              << " at offset " << header.configTableOffset << std::endl;
+    std::cout << "  Matrices:            " << header.matrixCount
+              << " at offset " << header.matrixTableOffset << std::endl;
+    std::cout << std::endl;
+}
+
+void printMatrixTable(const PIM_ISA::ObjectFile& object) {
+    std::cout << "Matrix table:" << std::endl;
+    for (const auto& matrix : object.matrices()) {
+        std::cout << "  " << std::left << std::setw(16) << matrix.name << std::right
+                  << matrix.rows << "x" << matrix.cols
+                  << "  rows " << matrix.startAddress << " - " << matrix.endAddress << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+void printConfigTable(const PIM_ISA::ObjectFile& object) {
+    std::cout << "LUT configuration table:" << std::endl;
+    const auto& configs = object.configs();
+    for (size_t i = 0; i < configs.size(); ++i) {
+        std::cout << "  [" << i << "] " << coreOpName(configs[i].opType)
+                  << " (" << configs[i].data.size() << " bytes)" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+void printDisassembly(const PIM_ISA::ObjectFile& object) {
+    std::cout << "Disassembly:" << std::endl;
+    const uint32_t* words = object.words();
+    uint64_t bundle = 0;
+    for (uint64_t i = 0; i < object.instructionCount(); ++i) {
+        PIM_ISA::Instruction instruction = object.instruction(i);
+        if (instruction.bundleStart) {
+            std::cout << "            // Bundle " << bundle++ << '\n';
+        }
+        std::cout << std::setw(10) << std::setfill(' ') << i << ":  "
+                  << std::hex << std::setw(8) << std::setfill('0') << words[i]
+                  << std::dec << std::setfill(' ') << "  "
+                  << instruction.toString() << '\n';
+    }
+    std::cout << std::flush;
+}
+
+int main(int argc, char* argv[]) {
+    std::string objectFile;
+    bool showHeader = false;
+    bool showMatrices = false;
+    bool showConfigs = false;
+    bool showDisassembly = false;
+    bool showAssembly = false;
+
+    // Parse command-line arguments
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--file-header") == 0) {
+            showHeader = true;
+        } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--matrices") == 0) {
+            showMatrices = true;
+        } else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--configs") == 0) {
+            showConfigs = true;
+        } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--disassemble") == 0) {
+            showDisassembly = true;
+        } else if (strcmp(argv[i], "-S") == 0 || strcmp(argv[i], "--assembly") == 0) {
+            showAssembly = true;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        } else if (argv[i][0] == '-') {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        } else if (objectFile.empty()) {
+            objectFile = argv[i];
+        } else {
+            std::cerr << "Error: Too many arguments" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (objectFile.empty()) {
+        std::cerr << "Error: Missing object file" << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!showHeader && !showMatrices && !showConfigs && !showAssembly) {
+        showDisassembly = true;
+    }
+
+    try {
+        PIM_ISA::ObjectFile object(objectFile);
+
+        if (showAssembly) {
+            // Same text the compiler writes without -fbinary
+            PIM_ISA::AssemblyWriterSink writer(std::cout);
+            object.replay(writer);
+            writer.finish();
+            return 0;
+        }
+
+        if (showHeader) printFileHeader(object);
+        if (showMatrices) printMatrixTable(object);
+        if (showConfigs) printConfigTable(object);
+        if (showDisassembly) printDisassembly(object);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}